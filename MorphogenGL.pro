@@ -37,16 +37,24 @@ RESOURCES += resource.qrc
 #RC_ICONS = ./icons/morphogengl.ico
 
 HEADERS += \
+    src/benchmark.h \
+    src/checkpoint.h \
     src/colorpath.h \
     src/configparser.h \
     src/controlwidget.h \
+    src/convergencedetector.h \
+    src/convergencewidget.h \
     src/cycle.h \
     src/cyclesearch.h \
     src/edge.h \
     src/edgewidget.h \
     src/factory.h \
+    src/fingerprintengine.h \
+    src/formula.h \
+    src/framedecoder.h \
     src/graphwidget.h \
     src/gridwidget.h \
+    src/histogramengine.h \
     src/histogramwidget.h \
     src/imageoperation.h \
     src/imageoperationnode.h \
@@ -61,6 +69,9 @@ HEADERS += \
     src/node.h \
     src/nodemanager.h \
     src/operationbuilder.h \
+    src/operationbundle.h \
+    src/operationcatalogue.h \
+    src/operationgraph.h \
     src/operationparser.h \
     src/operationwidget.h \
     src/overlay.h \
@@ -68,15 +79,24 @@ HEADERS += \
     src/parameters/number.h \
     src/parameters/optionsparameter.h \
     src/parameters/parameter.h \
+    src/parameters/parameterstore.h \
     src/parameters/uniformmat4parameter.h \
     src/parameters/uniformparameter.h \
     src/plotswidget.h \
+    src/programcache.h \
+    src/programpool.h \
     src/recorder.h \
     src/rendermanager.h \
+    src/rewindbuffer.h \
     src/rgbwidget.h \
     src/seed.h \
     src/seedwidget.h \
+    src/shadercompiler.h \
+    src/shaderpreprocessor.h \
+    src/statisticsengine.h \
+    src/statisticswidget.h \
     src/texformat.h \
+    src/textureuploader.h \
     src/timerthread.h \
     src/videoinputcontrol.h \
     src/widgets/focuswidgets.h \
@@ -84,19 +104,28 @@ HEADERS += \
     src/widgets/optionswidget.h \
     src/widgets/parameterwidget.h \
     src/widgets/uniformmat4widget.h \
+    src/widgets/uniformtablemodel.h \
     src/widgets/uniformwidget.h
 
 SOURCES += \
+    src/benchmark.cpp \
+    src/checkpoint.cpp \
     src/colorpath.cpp \
     src/configparser.cpp \
     src/controlwidget.cpp \
+    src/convergencedetector.cpp \
+    src/convergencewidget.cpp \
     src/cycle.cpp \
     src/cyclesearch.cpp \
     src/edge.cpp \
     src/edgewidget.cpp \
     src/factory.cpp \
+    src/fingerprintengine.cpp \
+    src/formula.cpp \
+    src/framedecoder.cpp \
     src/graphwidget.cpp \
     src/gridwidget.cpp \
+    src/histogramengine.cpp \
     src/histogramwidget.cpp \
     src/imageoperation.cpp \
     src/imageoperationnode.cpp \
@@ -110,6 +139,9 @@ SOURCES += \
     src/node.cpp \
     src/nodemanager.cpp \
     src/operationbuilder.cpp \
+    src/operationbundle.cpp \
+    src/operationcatalogue.cpp \
+    src/operationgraph.cpp \
     src/operationparser.cpp \
     src/operationwidget.cpp \
     src/overlay.cpp \
@@ -118,12 +150,21 @@ SOURCES += \
     src/parameters/uniformmat4parameter.cpp \
     src/parameters/uniformparameter.cpp \
     src/plotswidget.cpp \
+    src/programcache.cpp \
+    src/programpool.cpp \
     src/recorder.cpp \
     src/rendermanager.cpp \
+    src/rewindbuffer.cpp \
     src/rgbwidget.cpp \
     src/seed.cpp \
     src/seedwidget.cpp \
+    src/shadercompiler.cpp \
+    src/shaderpreprocessor.cpp \
+    src/statisticsengine.cpp \
+    src/statisticswidget.cpp \
+    src/textureuploader.cpp \
     src/timerthread.cpp \
     src/videoinputcontrol.cpp \
     src/widgets/uniformmat4widget.cpp \
+    src/widgets/uniformtablemodel.cpp \
     src/widgets/uniformwidget.cpp
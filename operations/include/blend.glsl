@@ -0,0 +1,7 @@
+// Shared by operations with an opacity uniform: #include "blend.glsl"
+// Opacity 0 passes the input through, 1 outputs the operation's color
+
+vec4 blendOpacity(vec3 srcColor, vec3 dstColor, float opacity)
+{
+    return vec4(mix(srcColor, dstColor, opacity), 1.0);
+}
@@ -0,0 +1,52 @@
+#version 330 core
+
+in vec2 ndcPos;
+out vec4 fragColor;
+
+uniform usampler3D densityTex;
+uniform mat4 inverseTransform;
+uniform float densityScale;
+
+const int numSteps = 128;
+
+void main()
+{
+    // Ray through the RGB cube in color space
+
+    vec4 near = inverseTransform * vec4(ndcPos, -1.0, 1.0);
+    vec4 far = inverseTransform * vec4(ndcPos, 1.0, 1.0);
+
+    vec3 origin = near.xyz / near.w;
+    vec3 dir = normalize(far.xyz / far.w - origin);
+
+    vec3 invDir = 1.0 / dir;
+    vec3 t0 = (vec3(0.0) - origin) * invDir;
+    vec3 t1 = (vec3(1.0) - origin) * invDir;
+    float tNear = max(max(min(t0.x, t1.x), min(t0.y, t1.y)), min(t0.z, t1.z));
+    float tFar = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), max(t0.z, t1.z));
+
+    if (tFar < max(tNear, 0.0)) {
+        discard;
+    }
+
+    tNear = max(tNear, 0.0);
+
+    float dt = (tFar - tNear) / float(numSteps);
+    int bins = textureSize(densityTex, 0).x;
+
+    vec3 color = vec3(0.0);
+    float alpha = 0.0;
+
+    // Front to back compositing, bins colored by their position
+
+    for (int i = 0; i < numSteps && alpha < 0.99; i++) {
+        vec3 pos = origin + dir * (tNear + (float(i) + 0.5) * dt);
+        ivec3 bin = clamp(ivec3(pos * float(bins)), ivec3(0), ivec3(bins - 1));
+        float density = log(1.0 + float(texelFetch(densityTex, bin, 0).r)) * densityScale;
+        float a = 1.0 - exp(-density * dt * float(bins));
+        color += (1.0 - alpha) * a * pos;
+        alpha += (1.0 - alpha) * a;
+    }
+
+    fragColor = vec4(alpha > 0.0 ? color / alpha : color, alpha);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+uniform sampler2D inTexture;
+uniform float alpha;
+
+in vec2 texCoords;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(texture(inTexture, texCoords).rgb, alpha);
+}
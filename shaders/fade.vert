@@ -0,0 +1,13 @@
+#version 330 core
+
+uniform vec4 frame;
+
+out vec2 texCoords;
+
+void main()
+{
+    vec2 pos = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    gl_Position = vec4(2.0 * pos - 1.0, 0.0, 1.0);
+    texCoords = vec2(frame.x + pos.x * frame.z, frame.y + (1.0 - pos.y) * frame.w);
+}
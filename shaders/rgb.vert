@@ -1,15 +1,20 @@
 #version 330 core
 
-layout (location = 0) in vec2 texCoord;
-
 out vec3 texColor;
 
 uniform sampler2D texSampler;
 uniform mat4 transform;
+uniform ivec2 texSize;
+uniform int stride;
 
 void main()
 {
-    vec4 color = texture(texSampler, texCoord);
+    // Texel of this point derived from the vertex index: no vertex attributes
+
+    int gridWidth = (texSize.x + stride - 1) / stride;
+    ivec2 texel = ivec2(gl_VertexID % gridWidth, gl_VertexID / gridWidth) * stride;
+
+    vec4 color = texelFetch(texSampler, texel, 0);
     gl_Position = transform * vec4(color.rgb, 1.0);
     texColor = color.rgb;
 }
@@ -0,0 +1,136 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "benchmark.h"
+
+#include <QDir>
+#include <QFile>
+#include <QDebug>
+
+
+
+Benchmark::Benchmark(Factory* factory, NodeManager* nodeManager, ConfigurationParser* configParser, int numNodes, QObject* parent) :
+    QObject(parent),
+    mFactory { factory },
+    mNodeManager { nodeManager },
+    mConfigParser { configParser },
+    mNumNodes { numNodes }
+{
+    mFilename = QDir::temp().filePath("fosforo-benchmark.xml");
+}
+
+
+
+void Benchmark::run()
+{
+    if (mFactory->availableOperationNames().isEmpty())
+    {
+        qWarning() << "Benchmark: no operations available";
+        emit finished(1);
+        return;
+    }
+
+    QList<QUuid> ids;
+
+    mClock.start();
+    build(ids);
+    qInfo() << "Benchmark:" << ids.size() << "nodes built in" << mClock.elapsed() << "ms";
+
+    copyPaste(ids);
+
+    mClock.restart();
+    mConfigParser->write(mFilename);
+    qInfo() << "Benchmark: configuration written in" << mClock.elapsed() << "ms";
+
+    // Loading finishes once the programs are prepared and the graph is reconciled, in later event loop passes
+
+    connect(mConfigParser, &ConfigurationParser::configurationLoaded, this, &Benchmark::loaded);
+
+    mClock.restart();
+    mConfigParser->read(mFilename);
+    qInfo() << "Benchmark: configuration parsed in" << mClock.elapsed() << "ms";
+}
+
+
+
+// Chain of available operations cycling through all of them
+
+void Benchmark::build(QList<QUuid>& ids)
+{
+    int numAvailable = mFactory->availableOperationNames().size();
+
+    for (int i = 0; i < mNumNodes; i++)
+    {
+        QUuid id;
+
+        if (!mFactory->addAvailableOperation(i % numAvailable, id))
+            continue;
+
+        if (!ids.isEmpty())
+            mNodeManager->connectOperations(ids.last(), id, 1.0);
+
+        ids.append(id);
+    }
+}
+
+
+
+void Benchmark::copyPaste(const QList<QUuid>& ids)
+{
+    mClock.restart();
+
+    QList<QUuid> copiedIds;
+
+    foreach (QUuid id, ids)
+        copiedIds.append(mNodeManager->copyOperation(id));
+
+    for (int i = 1; i < ids.size(); i++)
+        mNodeManager->connectCopiedOperationsA(ids[i - 1], ids[i], copiedIds[i - 1], copiedIds[i]);
+
+    qInfo() << "Benchmark:" << copiedIds.size() << "nodes copied in" << mClock.elapsed() << "ms";
+
+    mClock.restart();
+    mNodeManager->pasteOperations();
+    qInfo() << "Benchmark:" << copiedIds.size() << "nodes pasted in" << mClock.elapsed() << "ms";
+}
+
+
+
+void Benchmark::loaded(bool ok)
+{
+    disconnect(mConfigParser, &ConfigurationParser::configurationLoaded, this, &Benchmark::loaded);
+
+    QFile::remove(mFilename);
+
+    if (!ok)
+    {
+        qWarning() << "Benchmark: configuration could not be loaded";
+        emit finished(1);
+        return;
+    }
+
+    qInfo() << "Benchmark: configuration loaded in" << mClock.elapsed() << "ms";
+
+    emit finished(0);
+}
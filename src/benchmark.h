@@ -0,0 +1,74 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+
+
+#include "factory.h"
+#include "nodemanager.h"
+#include "configparser.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QUuid>
+
+
+
+// Benchmark: builds a synthetic chain of operations, copies and pastes it, then saves and loads it as a configuration
+// Run with fosforo --benchmark [nodes], reports the timings and exits
+
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    Benchmark(Factory* factory, NodeManager* nodeManager, ConfigurationParser* configParser, int numNodes, QObject* parent = nullptr);
+
+    void run();
+
+signals:
+    void finished(int exitCode);
+
+private:
+    Factory* mFactory;
+    NodeManager* mNodeManager;
+    ConfigurationParser* mConfigParser;
+    int mNumNodes;
+
+    QString mFilename;
+    QElapsedTimer mClock;
+
+    void build(QList<QUuid>& ids);
+    void copyPaste(const QList<QUuid>& ids);
+
+private slots:
+    void loaded(bool ok);
+};
+
+
+
+#endif // BENCHMARK_H
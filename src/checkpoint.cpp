@@ -0,0 +1,376 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "checkpoint.h"
+
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDebug>
+#include <limits>
+
+
+
+CheckpointWriter::CheckpointWriter(QObject* parent)
+    : QObject { parent }
+{
+    moveToThread(&mThread);
+    mThread.start();
+}
+
+
+
+CheckpointWriter::~CheckpointWriter()
+{
+    stop();
+}
+
+
+
+// Pending checkpoints are written before the thread quits
+
+void CheckpointWriter::stop()
+{
+    if (mThread.isRunning())
+    {
+        QMetaObject::invokeMethod(this, &CheckpointWriter::processJobs, Qt::BlockingQueuedConnection);
+
+        mThread.quit();
+        mThread.wait();
+    }
+}
+
+
+
+bool CheckpointWriter::compressed() const
+{
+    return mCompressed;
+}
+
+
+
+void CheckpointWriter::setCompressed(bool set)
+{
+    mCompressed = set;
+}
+
+
+
+void CheckpointWriter::write(quint64 ticket, QString filename, const CheckpointInfo& info, const QList<CheckpointEntry>& entries)
+{
+    WriteJob job;
+    job.ticket = ticket;
+    job.filename = filename;
+    job.info = info;
+    job.entries = entries;
+    job.compressed = mCompressed;
+
+    mMutex.lock();
+    mJobs.append(job);
+    mMutex.unlock();
+
+    QMetaObject::invokeMethod(this, &CheckpointWriter::processJobs, Qt::QueuedConnection);
+}
+
+
+
+void CheckpointWriter::processJobs()
+{
+    mMutex.lock();
+    QList<WriteJob> jobs = mJobs;
+    mJobs.clear();
+    mMutex.unlock();
+
+    for (WriteJob& job : jobs)
+    {
+        emit written(job.ticket, job.filename, writeJob(job));
+    }
+}
+
+
+
+bool CheckpointWriter::writeJob(WriteJob& job)
+{
+    // Written to a temporary file that replaces the target only once complete
+
+    QSaveFile outFile(job.filename);
+
+    if (!outFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&outFile);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << magic << formatVersion;
+
+    for (CheckpointEntry& entry : job.entries)
+    {
+        entry.offset = outFile.pos();
+        entry.codec = rawCodec;
+        entry.storedSize = entry.size;
+
+        // Fastest zlib level, kept only if it pays off; qCompress stores sizes in 32 bits
+
+        if (job.compressed && entry.size < std::numeric_limits<qint32>::max())
+        {
+            QByteArray packed = qCompress(reinterpret_cast<const uchar*>(entry.data), entry.size, 1);
+
+            if (packed.size() < entry.size)
+            {
+                entry.codec = zlibCodec;
+                entry.storedSize = packed.size();
+
+                if (outFile.write(packed) != packed.size())
+                {
+                    outFile.cancelWriting();
+                    return false;
+                }
+
+                continue;
+            }
+        }
+
+        if (outFile.write(entry.data, entry.size) != entry.size)
+        {
+            outFile.cancelWriting();
+            return false;
+        }
+    }
+
+    qint64 indexOffset = outFile.pos();
+
+    stream << job.info.iteration << static_cast<quint32>(job.info.width) << static_cast<quint32>(job.info.height) << static_cast<quint32>(job.info.texFormat);
+    stream << job.info.randomStates;
+
+    stream << static_cast<quint32>(job.entries.size());
+
+    foreach (const CheckpointEntry& entry, job.entries)
+    {
+        stream << entry.key << static_cast<quint32>(entry.target) << static_cast<qint32>(entry.layers) << static_cast<quint32>(entry.type);
+        stream << entry.codec << entry.size << entry.offset << entry.storedSize;
+    }
+
+    stream << indexOffset << magic;
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        outFile.cancelWriting();
+        return false;
+    }
+
+    return outFile.commit();
+}
+
+
+
+CheckpointReader::CheckpointReader()
+{}
+
+
+
+CheckpointReader::~CheckpointReader()
+{
+    close();
+}
+
+
+
+bool CheckpointReader::open(QString filename)
+{
+    close();
+    mErrorString.clear();
+
+    mFile.setFileName(filename);
+
+    if (!mFile.open(QIODevice::ReadOnly))
+    {
+        mErrorString = mFile.errorString();
+        return false;
+    }
+
+    mSize = mFile.size();
+
+    const qint64 headerSize = 2 * sizeof(quint32);
+    const qint64 footerSize = sizeof(qint64) + sizeof(quint32);
+
+    if (mSize < headerSize + footerSize)
+    {
+        mErrorString = "Not a checkpoint file";
+        close();
+        return false;
+    }
+
+    mMap = mFile.map(0, mSize);
+
+    if (!mMap)
+    {
+        mErrorString = mFile.errorString();
+        close();
+        return false;
+    }
+
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(mMap), mSize);
+
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 fileMagic = 0;
+    quint32 fileVersion = 0;
+
+    stream >> fileMagic >> fileVersion;
+
+    if (fileMagic != CheckpointWriter::magic || fileVersion != CheckpointWriter::formatVersion)
+    {
+        mErrorString = "Not a checkpoint file, or written by another version";
+        close();
+        return false;
+    }
+
+    qint64 indexOffset = 0;
+    quint32 footerMagic = 0;
+
+    stream.device()->seek(mSize - footerSize);
+    stream >> indexOffset >> footerMagic;
+
+    if (footerMagic != CheckpointWriter::magic || indexOffset < headerSize || indexOffset > mSize - footerSize)
+    {
+        mErrorString = "Truncated checkpoint file";
+        close();
+        return false;
+    }
+
+    stream.device()->seek(indexOffset);
+
+    quint32 width = 0, height = 0, texFormat = 0;
+
+    stream >> mInfo.iteration >> width >> height >> texFormat;
+    stream >> mInfo.randomStates;
+
+    mInfo.width = width;
+    mInfo.height = height;
+    mInfo.texFormat = texFormat;
+
+    quint32 numEntries = 0;
+    stream >> numEntries;
+
+    for (quint32 i = 0; i < numEntries && stream.status() == QDataStream::Ok; i++)
+    {
+        CheckpointEntry entry;
+        quint32 target = 0, type = 0;
+        qint32 layers = 0;
+
+        stream >> entry.key >> target >> layers >> type;
+        stream >> entry.codec >> entry.size >> entry.offset >> entry.storedSize;
+
+        entry.target = target;
+        entry.layers = layers;
+        entry.type = type;
+
+        if (entry.offset < headerSize || entry.storedSize < 0 || entry.offset + entry.storedSize > indexOffset)
+        {
+            mErrorString = "Corrupt checkpoint index";
+            close();
+            return false;
+        }
+
+        mEntries.append(entry);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        mErrorString = "Corrupt checkpoint index";
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+
+void CheckpointReader::close()
+{
+    if (mMap)
+    {
+        mFile.unmap(mMap);
+        mMap = nullptr;
+    }
+
+    if (mFile.isOpen()) {
+        mFile.close();
+    }
+
+    mSize = 0;
+    mInfo = CheckpointInfo();
+    mEntries.clear();
+    mUncompressed.clear();
+}
+
+
+
+QString CheckpointReader::errorString() const
+{
+    return mErrorString;
+}
+
+
+
+const CheckpointInfo& CheckpointReader::info() const
+{
+    return mInfo;
+}
+
+
+
+const QList<CheckpointEntry>& CheckpointReader::entries() const
+{
+    return mEntries;
+}
+
+
+
+const char* CheckpointReader::data(const CheckpointEntry& entry)
+{
+    if (!mMap) {
+        return nullptr;
+    }
+
+    const char* stored = reinterpret_cast<const char*>(mMap) + entry.offset;
+
+    if (entry.codec == CheckpointWriter::rawCodec) {
+        return entry.storedSize == entry.size ? stored : nullptr;
+    }
+
+    if (entry.codec == CheckpointWriter::zlibCodec)
+    {
+        mUncompressed = qUncompress(reinterpret_cast<const uchar*>(stored), entry.storedSize);
+
+        if (mUncompressed.size() == entry.size) {
+            return mUncompressed.constData();
+        }
+    }
+
+    return nullptr;
+}
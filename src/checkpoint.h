@@ -0,0 +1,177 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QOpenGLFunctions>
+#include <QFile>
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QUuid>
+#include <QByteArray>
+
+
+
+// Texture holding simulation state, named after its node
+
+struct StateTexture
+{
+    QString key;
+    GLuint texId = 0;
+    GLenum target = GL_TEXTURE_2D;
+    GLsizei layers = 1;
+};
+
+
+
+// Checkpoint: binary snapshot of the simulation state, every texture of seeds and operations as raw blobs,
+// plus the iteration number and the random generators of the seeds
+// Layout: header, blobs, index, index offset and magic as footer, so that blobs are written as they come
+
+struct CheckpointEntry
+{
+    QString key;
+    GLenum target = GL_TEXTURE_2D;
+    GLsizei layers = 1;
+    GLenum type = GL_UNSIGNED_BYTE;
+    quint8 codec = 0;
+    qint64 size = 0;
+    qint64 offset = 0;
+    qint64 storedSize = 0;
+
+    // Source of the blob while writing: persistently mapped readback buffer
+
+    const char* data = nullptr;
+};
+
+
+
+struct CheckpointInfo
+{
+    quint32 iteration = 0;
+    GLuint width = 0;
+    GLuint height = 0;
+    GLenum texFormat = GL_RGBA8;
+    QMap<QUuid, QByteArray> randomStates;
+};
+
+
+
+// CheckpointWriter: compresses and writes checkpoints on its own thread
+
+class CheckpointWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CheckpointWriter(QObject* parent = nullptr);
+    ~CheckpointWriter();
+
+    void stop();
+
+    bool compressed() const;
+    void setCompressed(bool set);
+
+    // Blob data must stay valid until written is emitted with the same ticket
+
+    void write(quint64 ticket, QString filename, const CheckpointInfo& info, const QList<CheckpointEntry>& entries);
+
+    static constexpr quint32 magic = 0x4d47434b;
+    static constexpr quint32 formatVersion = 1;
+
+    static constexpr quint8 rawCodec = 0;
+    static constexpr quint8 zlibCodec = 1;
+
+signals:
+    void written(quint64 ticket, QString filename, bool success);
+
+private:
+    struct WriteJob
+    {
+        quint64 ticket = 0;
+        QString filename;
+        CheckpointInfo info;
+        QList<CheckpointEntry> entries;
+        bool compressed = false;
+    };
+
+    QThread mThread;
+
+    bool mCompressed = false;
+
+    QMutex mMutex;
+    QList<WriteJob> mJobs;
+
+    bool writeJob(WriteJob& job);
+
+private slots:
+    void processJobs();
+};
+
+
+
+// CheckpointReader: memory-maps a checkpoint file, blobs are read in place
+
+class CheckpointReader
+{
+public:
+    CheckpointReader();
+    ~CheckpointReader();
+
+    bool open(QString filename);
+    void close();
+
+    QString errorString() const;
+
+    const CheckpointInfo& info() const;
+    const QList<CheckpointEntry>& entries() const;
+
+    // Points into the mapped file for raw blobs, or into decompressed storage kept until the next call
+
+    const char* data(const CheckpointEntry& entry);
+
+private:
+    QFile mFile;
+    uchar* mMap = nullptr;
+    qint64 mSize = 0;
+
+    CheckpointInfo mInfo;
+    QList<CheckpointEntry> mEntries;
+
+    QByteArray mUncompressed;
+
+    QString mErrorString;
+};
+
+
+
+#endif // CHECKPOINT_H
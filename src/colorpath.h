@@ -5,6 +5,7 @@
 
 #include <QList>
 #include <QPoint>
+#include <QOpenGLFunctions>
 
 
 
@@ -16,6 +17,11 @@ public:
     void setSource(QPoint source) { source_ = source; }
     QPoint source() { return source_; }
 
+    // Probed texture, null for the output texture
+
+    void setTexId(GLuint* texId) { texId_ = texId; }
+    GLuint* texId() { return texId_; }
+
     void setMaxNumPoints(int maxPoints) { maxNumPoints = maxPoints; }
 
     void addPoint(float red, float green, float blue);
@@ -28,6 +34,7 @@ public:
 
 private:
     QPoint source_;
+    GLuint* texId_ = nullptr;
     QList<float> redPoints_, greenPoints_, bluePoints_;
     QList<float> lines_;
     int numPoints = 0;
@@ -26,6 +26,11 @@
 #include "operationparser.h"
 
 #include <QFile>
+#include <QSet>
+#include <QPair>
+#include <QHash>
+#include <QMultiHash>
+#include <QDebug>
 
 
 
@@ -135,6 +140,14 @@ void ConfigurationParser::writeSeedNode(QUuid id, Seed* seed, QXmlStreamWriter &
     stream.writeCharacters(seed->imageFilename());
     stream.writeEndElement();
 
+    stream.writeStartElement("sequence_filename");
+    stream.writeCharacters(seed->sequenceFilename());
+    stream.writeEndElement();
+
+    stream.writeStartElement("iterations_per_frame");
+    stream.writeCharacters(QString::number(seed->iterationsPerFrame()));
+    stream.writeEndElement();
+
     QPointF position = mGraphWidget->nodePosition(id);
 
     stream.writeStartElement("position");
@@ -260,79 +273,394 @@ void ConfigurationParser::writeMidiData(QXmlStreamWriter& stream)
 
 
 
+ConfigurationParser::~ConfigurationParser()
+{
+    discardPending();
+}
+
+
+
+void ConfigurationParser::setCrossfadeDuration(int duration)
+{
+    mCrossfadeDuration = duration;
+}
+
+
+
 void ConfigurationParser::read(QString filename)
 {
+    Configuration configuration;
+    configuration.width = mRenderManager->texWidth();
+    configuration.height = mRenderManager->texHeight();
+
+    if (!parse(filename, configuration))
+    {
+        foreach (const OperationNodeData& data, configuration.operations) {
+            delete data.operation;
+        }
+        for (auto [dstId, inputs] : configuration.connections.asKeyValueRange()) {
+            qDeleteAll(inputs);
+        }
+        emit configurationLoaded(false);
+        return;
+    }
+
+    // A configuration still being prepared is superseded
+
+    discardPending();
+
+    matchOperations(configuration);
+
+    mPending = configuration;
+    mHasPending = true;
+
+    // Operations that will not be kept get their programs linked while the current graph keeps rendering
+
+    foreach (const OperationNodeData& data, mPending.operations) {
+        if (!keepsOperation(data))
+            mRenderManager->prepareOperation(data.operation);
+    }
+
+    mPrepareClock.start();
+    mPrepareTimer.start();
+}
+
+
+
+// Commit once every new program is linked, or failed, or after a while, in which case the rest pass their input through until ready
+
+void ConfigurationParser::checkPrepared()
+{
+    if (!mHasPending)
+    {
+        mPrepareTimer.stop();
+        return;
+    }
+
+    if (mRenderManager->operationsPrepared() || mPrepareClock.hasExpired(5000))
+    {
+        mPrepareTimer.stop();
+        commit();
+    }
+}
+
+
+
+void ConfigurationParser::discardPending()
+{
+    mPrepareTimer.stop();
+
+    if (!mHasPending) {
+        return;
+    }
+
+    mRenderManager->releasePreparedOperations();
+
+    foreach (const OperationNodeData& data, mPending.operations) {
+        delete data.operation;
+    }
+    for (auto [dstId, inputs] : mPending.connections.asKeyValueRange()) {
+        qDeleteAll(inputs);
+    }
+
+    mPending = Configuration();
+    mHasPending = false;
+}
+
+
+
+bool ConfigurationParser::keepsSeed(const SeedNodeData& data)
+{
+    Seed* seed = mNodeManager->seedsMap().value(data.id, nullptr);
+
+    return seed && seed->type() == data.type && seed->imageFilename() == data.imageFilename &&
+        seed->sequenceFilename() == data.sequenceFilename && seed->iterationsPerFrame() == data.iterationsPerFrame;
+}
+
+
+
+bool ConfigurationParser::keepsOperation(const OperationNodeData& data)
+{
+    ImageOperationNode* node = mNodeManager->operationNodesMap().value(data.id, nullptr);
+
+    return node && node->operation()->sameLayout(data.operation);
+}
+
+
+
+// Second pass: operations not kept by id, as when the configuration was saved by another session,
+// are paired with running operations of the same layout that the configuration does not list
+// They take the ids of the running nodes and numbers, throughout the configuration, and are kept like the others
+
+void ConfigurationParser::matchOperations(Configuration& configuration)
+{
+    QSet<QUuid> listedIds;
+
+    foreach (const SeedNodeData& data, configuration.seeds)
+        listedIds.insert(data.id);
+    foreach (const OperationNodeData& data, configuration.operations)
+        listedIds.insert(data.id);
+
+    QMultiHash<QByteArray, QUuid> candidates;
+
+    for (auto [id, node] : mNodeManager->operationNodesMap().asKeyValueRange()) {
+        if (!listedIds.contains(id))
+            candidates.insert(node->operation()->layoutKey(), id);
+    }
+
+    if (candidates.isEmpty()) {
+        return;
+    }
+
+    QHash<QUuid, QUuid> nodeIds;
+    QHash<QUuid, QUuid> numberIds;
+
+    for (OperationNodeData& data : configuration.operations)
+    {
+        if (keepsOperation(data)) {
+            continue;
+        }
+
+        auto it = candidates.find(data.operation->layoutKey());
+
+        if (it == candidates.end()) {
+            continue;
+        }
+
+        QUuid id = it.value();
+        candidates.erase(it);
+
+        data.operation->takeIds(mNodeManager->getOperation(id), numberIds);
+
+        nodeIds.insert(data.id, id);
+        data.id = id;
+    }
+
+    if (nodeIds.isEmpty()) {
+        return;
+    }
+
+    QMap<QUuid, QMap<QUuid, InputData*>> connections;
+
+    for (auto [dstId, inputs] : configuration.connections.asKeyValueRange()) {
+        for (auto [srcId, inData] : inputs.asKeyValueRange())
+            connections[nodeIds.value(dstId, dstId)].insert(nodeIds.value(srcId, srcId), inData);
+    }
+
+    configuration.connections = connections;
+
+    configuration.outputNodeId = nodeIds.value(configuration.outputNodeId, configuration.outputNodeId);
+
+    for (MidiLinkData& link : configuration.midiLinks) {
+        link.numberId = numberIds.value(link.numberId, link.numberId);
+    }
+}
+
+
+
+// Runs between two iterations, as everything else on this thread
+
+void ConfigurationParser::commit()
+{
+    Configuration configuration = mPending;
+
+    mPending = Configuration();
+    mHasPending = false;
+
+    mRenderManager->releasePreparedOperations();
+
+    if (mCrossfadeDuration > 0 && !mNodeManager->outputId().isNull()) {
+        emit crossfadeRequested(mCrossfadeDuration);
+    }
+
+    QSet<QUuid> keptIds;
+
+    foreach (const SeedNodeData& data, configuration.seeds) {
+        if (keepsSeed(data))
+            keptIds.insert(data.id);
+    }
+
+    foreach (const OperationNodeData& data, configuration.operations) {
+        if (keepsOperation(data))
+            keptIds.insert(data.id);
+    }
+
+    // Edges go first, so that removing their nodes does not reconnect their neighbours
+
+    QList<QPair<QUuid, QUuid>> removedEdges;
+
+    for (auto [dstId, node] : mNodeManager->operationNodesMap().asKeyValueRange())
+    {
+        for (auto [srcId, inData] : node->inputs().asKeyValueRange())
+        {
+            InputData* newData = configuration.connections.value(dstId).value(srcId, nullptr);
+
+            if (!keptIds.contains(dstId) || !keptIds.contains(srcId) || !newData || newData->type() != inData->type()) {
+                removedEdges.append(qMakePair(srcId, dstId));
+            }
+        }
+    }
+
+    foreach (auto edge, removedEdges) {
+        mNodeManager->removeEdge(edge.first, edge.second);
+    }
+
+    // Nodes not kept
+
+    foreach (QUuid id, mNodeManager->operationNodesMap().keys()) {
+        if (!keptIds.contains(id))
+            mNodeManager->removeOperation(id);
+    }
+
+    foreach (QUuid id, mNodeManager->seedsMap().keys()) {
+        if (!keptIds.contains(id))
+            mNodeManager->removeSeed(id);
+    }
+
+    // Kept nodes take the new values, the others are added
+
+    foreach (const SeedNodeData& data, configuration.seeds)
+    {
+        if (keptIds.contains(data.id))
+        {
+            mNodeManager->setSeedFixed(data.id, data.fixed);
+        }
+        else
+        {
+            Seed* seed = new Seed(data.type, data.fixed, data.imageFilename, data.sequenceFilename, data.iterationsPerFrame);
+            mFactory->addSeed(data.id, seed);
+        }
+
+        mGraphWidget->setNodePosition(data.id, data.position);
+    }
+
+    foreach (const OperationNodeData& data, configuration.operations)
+    {
+        if (keptIds.contains(data.id))
+        {
+            mNodeManager->getOperation(data.id)->assignValues(data.operation);
+            delete data.operation;
+
+            mGraphWidget->setNodePosition(data.id, data.position);
+        }
+        else
+        {
+            mFactory->addOperation(data.id, data.operation, data.position);
+        }
+    }
+
+    // Edges kept take the new blend factors, the others are connected
+
+    QMap<QUuid, QMap<QUuid, InputData*>> newConnections;
+
+    for (auto [dstId, inputs] : configuration.connections.asKeyValueRange())
+    {
+        for (auto [srcId, inData] : inputs.asKeyValueRange())
+        {
+            ImageOperationNode* node = mNodeManager->operationNodesMap().value(dstId, nullptr);
+
+            if (node && node->inputs().contains(srcId))
+            {
+                mNodeManager->setBlendFactor(srcId, dstId, inData->blendFactor()->value());
+                delete inData;
+            }
+            else
+            {
+                newConnections[dstId].insert(srcId, inData);
+            }
+        }
+    }
+
+    mNodeManager->connectOperations(newConnections);
+    mNodeManager->sortOperations();
+
+    if (!configuration.outputNodeId.isNull()) {
+        mNodeManager->setOutput(configuration.outputNodeId);
+    }
+
+    if (configuration.hasMidi) {
+        applyMidiData(configuration);
+    }
+
+    if (configuration.hasScene) {
+        mGraphWidget->fitInView(configuration.sceneRect);
+    }
+
+    // Textures are kept if the size does not change
+
+    if (static_cast<GLuint>(configuration.width) != mRenderManager->texWidth() || static_cast<GLuint>(configuration.height) != mRenderManager->texHeight()) {
+        emit newImageSizeRead(configuration.width, configuration.height);
+    }
+
+    emit configurationLoaded(true);
+}
+
+
+
+bool ConfigurationParser::parse(QString filename, Configuration& configuration)
+{
+    bool success = false;
+
     QFile inFile(filename);
     if (inFile.open(QIODevice::ReadOnly))
     {
         QXmlStreamReader mStream;
         mStream.setDevice(&inFile);
 
-        OperationParser opParser;
-
         if (mStream.readNextStartElement() && mStream.name() == "fosforo")
         {
-            mFactory->clear();
-
-            QUuid outputNodeId;
-            int width = mRenderManager->texWidth();
-            int height = mRenderManager->texHeight();
-
             while (mStream.readNextStartElement())
             {
                 if (mStream.name() == "nodes")
                 {
-                    QMap<QUuid, QMap<QUuid, InputData*>> connections;
-
                     while (mStream.readNextStartElement())
                     {
                         if (mStream.name() == "seed_node") {
-                            readSeedNode(mStream);
+                            readSeedNode(configuration, mStream);
                         }
                         else if (mStream.name() == "operation_node") {
-                            readOperationNode(connections, mStream);
+                            readOperationNode(configuration, mStream);
                         }
                         else {
                             mStream.skipCurrentElement();
                         }
                     }
-
-                    mNodeManager->connectOperations(connections);
-                    mNodeManager->sortOperations();
                 }
                 else if (mStream.name() == "display") {
-                    readDisplay(width, height, outputNodeId, mStream);
+                    readDisplay(configuration, mStream);
                 }
                 else if (mStream.name() == "midi") {
-                    readMidiData(mStream);
+                    readMidiData(configuration, mStream);
                 }
                 else {
                     mStream.skipCurrentElement();
                 }
             }
 
-            if (!outputNodeId.isNull()) {
-                mNodeManager->setOutput(outputNodeId);
-            }
-
-            emit newImageSizeRead(width, height);
+            success = true;
         }
 
         if (mStream.tokenType() == QXmlStreamReader::Invalid) {
             mStream.readNext();
         }
 
-        if (mStream.hasError()) {
-            mStream.raiseError();
+        // A malformed file keeps the current graph
+
+        if (mStream.hasError())
+        {
+            qWarning() << filename << "line" << mStream.lineNumber() << ":" << mStream.errorString();
+            success = false;
         }
 
         inFile.close();
     }
+
+    return success;
 }
 
 
 
-void ConfigurationParser::readDisplay(int &width, int &height, QUuid &outputNodeId, QXmlStreamReader& stream)
+void ConfigurationParser::readDisplay(Configuration& configuration, QXmlStreamReader& stream)
 {
     while (stream.readNextStartElement())
     {
@@ -341,10 +669,10 @@ void ConfigurationParser::readDisplay(int &width, int &height, QUuid &outputNode
             while (stream.readNextStartElement())
             {
                 if (stream.name() == "width") {
-                    width = stream.readElementText().toInt();
+                    configuration.width = stream.readElementText().toInt();
                 }
                 else if (stream.name() == "height") {
-                    height = stream.readElementText().toInt();
+                    configuration.height = stream.readElementText().toInt();
                 }
                 else {
                     stream.skipCurrentElement();
@@ -374,10 +702,11 @@ void ConfigurationParser::readDisplay(int &width, int &height, QUuid &outputNode
                 }
             }
 
-            mGraphWidget->fitInView(sceneRect);
+            configuration.sceneRect = sceneRect;
+            configuration.hasScene = true;
         }
         else if (stream.name() == "output_node") {
-            outputNodeId = QUuid(stream.readElementText());
+            configuration.outputNodeId = QUuid(stream.readElementText());
         }
         else {
             stream.skipCurrentElement();
@@ -387,36 +716,37 @@ void ConfigurationParser::readDisplay(int &width, int &height, QUuid &outputNode
 
 
 
-void ConfigurationParser::readSeedNode(QXmlStreamReader& stream)
+void ConfigurationParser::readSeedNode(Configuration& configuration, QXmlStreamReader& stream)
 {
-    QUuid id = QUuid(stream.attributes().value("id").toString());
-    int type = 0;
-    bool fixed = false;
-    QString imageFilename;
-    QPointF position(0.0, 0.0);
-
-    OperationParser opParser;
+    SeedNodeData data;
+    data.id = QUuid(stream.attributes().value("id").toString());
 
     while (stream.readNextStartElement())
     {
         if (stream.name() == "type") {
-            type = stream.readElementText().toInt();
+            data.type = stream.readElementText().toInt();
         }
         else if (stream.name() == "fixed") {
-            fixed = stream.readElementText().toInt();
+            data.fixed = stream.readElementText().toInt();
         }
         else if (stream.name() == "image_filename") {
-            imageFilename = stream.readElementText();
+            data.imageFilename = stream.readElementText();
+        }
+        else if (stream.name() == "sequence_filename") {
+            data.sequenceFilename = stream.readElementText();
+        }
+        else if (stream.name() == "iterations_per_frame") {
+            data.iterationsPerFrame = stream.readElementText().toInt();
         }
         else if (stream.name() == "position")
         {
             while (stream.readNextStartElement())
             {
                 if (stream.name() == "x") {
-                    position.setX(stream.readElementText().toFloat());
+                    data.position.setX(stream.readElementText().toFloat());
                 }
                 else if (stream.name() == "y") {
-                    position.setY(stream.readElementText().toFloat());
+                    data.position.setY(stream.readElementText().toFloat());
                 }
                 else {
                     stream.skipCurrentElement();
@@ -428,29 +758,28 @@ void ConfigurationParser::readSeedNode(QXmlStreamReader& stream)
         }
     }
 
-    Seed* seed = new Seed(type, fixed, imageFilename);
-    mFactory->addSeed(id, seed);
-    mGraphWidget->setNodePosition(id, position);
+    configuration.seeds.append(data);
 }
 
 
 
-void ConfigurationParser::readOperationNode(QMap<QUuid, QMap<QUuid, InputData*>> &connections, QXmlStreamReader& stream)
+void ConfigurationParser::readOperationNode(Configuration& configuration, QXmlStreamReader& stream)
 {
-    QUuid id = QUuid(stream.attributes().value("id").toString());
-    ImageOperation* operation = new ImageOperation();
-    QMap<QUuid, InputData*> inputs;
-    QPointF position(0.0, 0.0);
+    OperationNodeData data;
+    data.id = QUuid(stream.attributes().value("id").toString());
+    data.operation = new ImageOperation();
 
     OperationParser opParser;
 
     while (stream.readNextStartElement())
     {
         if (stream.name() == "operation") {
-            opParser.readOperation(operation, stream, true);
+            opParser.readOperation(data.operation, stream, true);
         }
         else if (stream.name() == "inputs")
         {
+            QMap<QUuid, InputData*> inputs;
+
             while (stream.readNextStartElement())
             {
                 if (stream.name() == "input")
@@ -476,17 +805,17 @@ void ConfigurationParser::readOperationNode(QMap<QUuid, QMap<QUuid, InputData*>>
                 }
             }
 
-            connections.insert(id, inputs);
+            configuration.connections.insert(data.id, inputs);
         }
         else if (stream.name() == "position")
         {
             while (stream.readNextStartElement())
             {
                 if (stream.name() == "x") {
-                    position.setX(stream.readElementText().toFloat());
+                    data.position.setX(stream.readElementText().toFloat());
                 }
                 else if (stream.name() == "y") {
-                    position.setY(stream.readElementText().toFloat());
+                    data.position.setY(stream.readElementText().toFloat());
                 }
                 else {
                     stream.skipCurrentElement();
@@ -495,52 +824,34 @@ void ConfigurationParser::readOperationNode(QMap<QUuid, QMap<QUuid, InputData*>>
         }
     }
 
-    mFactory->addOperation(id, operation, position);
+    configuration.operations.append(data);
 }
 
 
 
-void ConfigurationParser::readMidiData(QXmlStreamReader& stream)
+void ConfigurationParser::readMidiData(Configuration& configuration, QXmlStreamReader& stream)
 {
-    mMidiLinkManager->clearLinks();
+    configuration.hasMidi = true;
 
     while (stream.readNextStartElement())
     {
         if (stream.name() == "links")
         {
-            bool multiLink = false;
             if (stream.attributes().hasAttribute("multi_link")) {
-                multiLink = stream.attributes().value("multi_link").toInt();
+                configuration.multiLink = stream.attributes().value("multi_link").toInt();
             }
-            mMidiLinkManager->setMultiLink(multiLink);
 
             stream.readNextStartElement();
 
             while (stream.name() == "link")
             {
-                QString type = stream.attributes().value("type").toString();
-                QString portName = stream.attributes().value("port_name").toString();
-                int key = stream.attributes().value("key").toInt();
-                QUuid number_id = QUuid(stream.attributes().value("number_id").toString());
-
-                if (type == "float") {
-                    Number<float>* number = mFactory->number<float>(number_id);
-                    if (number) {
-                        mMidiLinkManager->setupMidiLink(portName, key, number);
-                    }
-                }
-                else if (type == "int") {
-                    Number<int>* number = mFactory->number<int>(number_id);
-                    if (number) {
-                        mMidiLinkManager->setupMidiLink(portName, key, number);
-                    }
-                }
-                else if (type == "uint") {
-                    Number<unsigned int>* number = mFactory->number<unsigned int>(number_id);
-                    if (number) {
-                        mMidiLinkManager->setupMidiLink(portName, key, number);
-                    }
-                }
+                MidiLinkData link;
+                link.type = stream.attributes().value("type").toString();
+                link.portName = stream.attributes().value("port_name").toString();
+                link.key = stream.attributes().value("key").toInt();
+                link.numberId = QUuid(stream.attributes().value("number_id").toString());
+
+                configuration.midiLinks.append(link);
 
                 stream.readNextStartElement();
             }
@@ -550,3 +861,33 @@ void ConfigurationParser::readMidiData(QXmlStreamReader& stream)
         }
     }
 }
+
+
+
+void ConfigurationParser::applyMidiData(const Configuration& configuration)
+{
+    mMidiLinkManager->clearLinks();
+    mMidiLinkManager->setMultiLink(configuration.multiLink);
+
+    foreach (const MidiLinkData& link, configuration.midiLinks)
+    {
+        if (link.type == "float") {
+            Number<float>* number = mFactory->number<float>(link.numberId);
+            if (number) {
+                mMidiLinkManager->setupMidiLink(link.portName, link.key, number);
+            }
+        }
+        else if (link.type == "int") {
+            Number<int>* number = mFactory->number<int>(link.numberId);
+            if (number) {
+                mMidiLinkManager->setupMidiLink(link.portName, link.key, number);
+            }
+        }
+        else if (link.type == "uint") {
+            Number<unsigned int>* number = mFactory->number<unsigned int>(link.numberId);
+            if (number) {
+                mMidiLinkManager->setupMidiLink(link.portName, link.key, number);
+            }
+        }
+    }
+}
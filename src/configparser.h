@@ -34,9 +34,67 @@
 #include <QString>
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QRectF>
+#include <QPointF>
+#include <QList>
+#include <QMap>
 
 
 
+// Configuration as read from file, before it is applied to the graph
+
+struct SeedNodeData
+{
+    QUuid id;
+    int type = 0;
+    bool fixed = false;
+    QString imageFilename;
+    QString sequenceFilename;
+    int iterationsPerFrame = 1;
+    QPointF position;
+};
+
+struct OperationNodeData
+{
+    QUuid id;
+    ImageOperation* operation = nullptr;
+    QPointF position;
+};
+
+struct MidiLinkData
+{
+    QString type;
+    QString portName;
+    int key = 0;
+    QUuid numberId;
+};
+
+struct Configuration
+{
+    int width = 0;
+    int height = 0;
+    QRectF sceneRect;
+    bool hasScene = false;
+    QUuid outputNodeId;
+
+    QList<SeedNodeData> seeds;
+    QList<OperationNodeData> operations;
+    QMap<QUuid, QMap<QUuid, InputData*>> connections;
+
+    bool hasMidi = false;
+    bool multiLink = false;
+    QList<MidiLinkData> midiLinks;
+};
+
+
+
+// Loading a configuration reconciles the graph with it instead of rebuilding it:
+// nodes with the same id and the same operation or seed are kept, with their textures and programs, and take the new values
+// Operations saved with other ids are then paired by layout with running ones, whose ids they take
+// Programs of new operations are linked in the background, and the switch happens once they are ready
+
 class ConfigurationParser: public QObject
 {
     Q_OBJECT
@@ -48,15 +106,24 @@ public:
     mRenderManager { renderManager},
     mGraphWidget { graphWidget },
     mMidiLinkManager { midiLinkManager }
-    {}
+    {
+        mPrepareTimer.setInterval(10);
+        connect(&mPrepareTimer, &QTimer::timeout, this, &ConfigurationParser::checkPrepared);
+    }
+
+    ~ConfigurationParser();
 
 signals:
     void newImageSizeRead(int width, int height);
+    void crossfadeRequested(int duration);
+    void configurationLoaded(bool ok);
 
 public slots:
     void write(QString filename);
     void read(QString filename);
 
+    void setCrossfadeDuration(int duration);
+
 private:
     Factory* mFactory;
     NodeManager* mNodeManager;
@@ -64,13 +131,32 @@ private:
     GraphWidget* mGraphWidget;
     MidiLinkManager* mMidiLinkManager;
 
+    Configuration mPending;
+    bool mHasPending = false;
+    QTimer mPrepareTimer;
+    QElapsedTimer mPrepareClock;
+
+    int mCrossfadeDuration = 0;
+
     void writeDisplay(QXmlStreamWriter& stream);
     void writeSeedNode(QUuid id, Seed* seed, QXmlStreamWriter& stream);
     void writeOperationNode(ImageOperationNode* node, QXmlStreamWriter& stream);
     void writeMidiData(QXmlStreamWriter& stream);
 
-    void readDisplay(int& width, int& height, QUuid &outputNodeId, QXmlStreamReader& stream);
-    void readSeedNode(QXmlStreamReader& stream);
-    void readOperationNode(QMap<QUuid, QMap<QUuid, InputData*>>& connections, QXmlStreamReader& stream);
-    void readMidiData(QXmlStreamReader& stream);
+    bool parse(QString filename, Configuration& configuration);
+    void readDisplay(Configuration& configuration, QXmlStreamReader& stream);
+    void readSeedNode(Configuration& configuration, QXmlStreamReader& stream);
+    void readOperationNode(Configuration& configuration, QXmlStreamReader& stream);
+    void readMidiData(Configuration& configuration, QXmlStreamReader& stream);
+
+    bool keepsSeed(const SeedNodeData& data);
+    bool keepsOperation(const OperationNodeData& data);
+    void matchOperations(Configuration& configuration);
+
+    void commit();
+    void applyMidiData(const Configuration& configuration);
+    void discardPending();
+
+private slots:
+    void checkPrepared();
 };
@@ -29,6 +29,7 @@
 #include <QHeaderView>
 #include <QScrollBar>
 #include <QSplitter>
+#include <QFileInfo>
 #include <QDebug>
 
 
@@ -66,6 +67,7 @@ ControlWidget::ControlWidget(double itFPS, double updFPS, GraphWidget* graphWidg
     constructDisplayOptionsWidget(itFPS, updFPS);
     constructRecordingOptionsWidget();
     constructSortedOperationWidget();
+    constructShaderLogWidget();
 
     //updateScrollArea();
 
@@ -112,12 +114,19 @@ ControlWidget::ControlWidget(double itFPS, double updFPS, GraphWidget* graphWidg
     iterationFPSLabel = new QLabel("FPS: 0");
     timePerUpdateLabel = new QLabel("uSPF: 0");
     updateFPSLabel = new QLabel("FPS: 0");
+    cacheLabel = new QLabel("Cached: 0");
+    cacheLabel->setToolTip("Operations reused from a previous iteration and GPU time saved per iteration");
 
     statusBar->insertWidget(0, iterationNumberLabel, 4);
     statusBar->insertWidget(1, timePerIterationLabel, 1);
     statusBar->insertWidget(2, iterationFPSLabel, 1);
     statusBar->insertWidget(3, timePerUpdateLabel, 1);
     statusBar->insertWidget(4, updateFPSLabel, 1);
+    statusBar->insertWidget(5, cacheLabel, 1);
+
+    programCacheLabel = new QLabel("Programs: 0");
+    programCacheLabel->setToolTip("Programs linked and shared by operations, and program binaries in the disk cache, hit rate and size");
+    statusBar->insertWidget(6, programCacheLabel, 1);
 
     // Main layout
 
@@ -161,6 +170,7 @@ ControlWidget::~ControlWidget()
     delete recordingOptionsWidget;
 
     delete sortedOperationWidget;
+    delete shaderLogWidget;
     // qDeleteAll(operationsWidgets);
     //qDeleteAll(blendFactorWidgets);
 }
@@ -171,6 +181,7 @@ void ControlWidget::closeEvent(QCloseEvent* event)
 {
     displayOptionsWidget->close();
     recordingOptionsWidget->close();
+    shaderLogWidget->close();
 
     QWidget::closeEvent(event);
 }
@@ -196,6 +207,16 @@ void ControlWidget::constructSystemToolBar()
 
     QAction* resetAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/view-refresh.png")), "Reset");
 
+    // Rewind: scrubbing back pauses on a retained iteration, from which the simulation can resume
+
+    rewindSlider = new QSlider(Qt::Horizontal);
+    rewindSlider->setRange(0, 0);
+    rewindSlider->setMaximumWidth(200);
+    rewindSlider->setToolTip("Rewind through recent iterations");
+    systemToolBar->addWidget(rewindSlider);
+
+    QAction* resumeRewindAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/edit-redo-2.png")), "Resume from rewound iteration");
+
     systemToolBar->addSeparator();
 
     screenshotAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/digikam.png")), "Take screenshot");
@@ -211,6 +232,8 @@ void ControlWidget::constructSystemToolBar()
 
     recordingOptionsAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/emblem-videos.png")), "Recording options");
 
+    QAction* shaderLogAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/applications-development.png")), "Shader log");
+
     //systemToolBar->addSeparator();
 
     //systemToolBar->addAction(QIcon(QPixmap(":/icons/format-list-ordered.png")), "List sorted operations", this, &ControlWidget::toggleSortedOperationWidget);
@@ -223,6 +246,8 @@ void ControlWidget::constructSystemToolBar()
 
     loadConfigAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/document-open.png")), "Load configuration");
     saveConfigAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/document-save.png")), "Save configuration");
+    QAction* loadCheckpointAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/edit-undo-2.png")), "Restore checkpoint");
+    QAction* saveCheckpointAction = systemToolBar->addAction(QIcon(QPixmap(":/icons/bookmark.png")), "Save checkpoint");
 
     systemToolBar->addSeparator();
 
@@ -235,13 +260,31 @@ void ControlWidget::constructSystemToolBar()
 
     connect(iterateAction, &QAction::triggered, this, &ControlWidget::iterate);
     connect(resetAction, &QAction::triggered, mRenderManager, &RenderManager::reset);
+    connect(rewindSlider, &QSlider::sliderPressed, this, [=, this](){
+        rewindSlider->setMinimum(1 - qMax(1, mRenderManager->rewindCount()));
+    });
+    connect(rewindSlider, &QSlider::valueChanged, this, [=, this](int value){
+        if (value < 0)
+            pause();
+        mRenderManager->scrubRewind(-value);
+    });
+    connect(resumeRewindAction, &QAction::triggered, this, [=, this](){
+        if (rewindSlider->value() < 0 && mRenderManager->resumeRewind(-rewindSlider->value()))
+        {
+            rewindSlider->setValue(0);
+            updateIterationNumberLabel();
+        }
+    });
     connect(screenshotAction, &QAction::triggered, this, &ControlWidget::setScreenshotFilename);
     connect(recordAction, &QAction::triggered, this, &ControlWidget::record);
     //connect(displayOptionsAction, &QAction::toggled, displayOptionsWidget, &QWidget::setVisible);
     connect(displayOptionsAction, &QAction::triggered, this, &ControlWidget::toggleDisplayOptionsWidget);
     connect(recordingOptionsAction, &QAction::triggered, this, &ControlWidget::toggleRecordingOptionsWidget);
+    connect(shaderLogAction, &QAction::triggered, this, &ControlWidget::toggleShaderLogWidget);
     connect(loadConfigAction, &QAction::triggered, this, &ControlWidget::loadConfig);
     connect(saveConfigAction, &QAction::triggered, this, &ControlWidget::saveConfig);
+    connect(loadCheckpointAction, &QAction::triggered, this, &ControlWidget::loadCheckpoint);
+    connect(saveCheckpointAction, &QAction::triggered, this, &ControlWidget::saveCheckpoint);
     connect(midiAction, &QAction::triggered, this, &ControlWidget::showMidiWidget);
     connect(overlayAction, &QAction::triggered, this, &ControlWidget::toggleOverlay);
     connect(aboutAction, &QAction::triggered, this, &ControlWidget::about);
@@ -252,7 +295,10 @@ void ControlWidget::constructSystemToolBar()
 void ControlWidget::iterate()
 {
     if (iterateAction->isChecked())
+    {
         iterateAction->setIcon(QIcon(QPixmap(":/icons/media-playback-pause.png")));
+        rewindSlider->setValue(0);
+    }
     else
         iterateAction->setIcon(QIcon(QPixmap(":/icons/media-playback-start.png")));
 
@@ -261,6 +307,17 @@ void ControlWidget::iterate()
 
 
 
+void ControlWidget::pause()
+{
+    if (iterateAction->isChecked())
+    {
+        iterateAction->setChecked(false);
+        iterate();
+    }
+}
+
+
+
 void ControlWidget::reset()
 {
     mRenderManager->clearAllOpsTextures();
@@ -310,6 +367,52 @@ void ControlWidget::toggleRecordingOptionsWidget()
 
 
 
+void ControlWidget::toggleShaderLogWidget()
+{
+    shaderLogWidget->setVisible(!shaderLogWidget->isVisible());
+}
+
+
+
+void ControlWidget::constructShaderLogWidget()
+{
+    shaderLogTextEdit = new QPlainTextEdit;
+    shaderLogTextEdit->setReadOnly(true);
+    shaderLogTextEdit->setLineWrapMode(QPlainTextEdit::NoWrap);
+    shaderLogTextEdit->setMinimumSize(480, 240);
+
+    QPushButton* clearButton = new QPushButton("Clear");
+    clearButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addWidget(shaderLogTextEdit);
+    layout->addWidget(clearButton, 0, Qt::AlignRight);
+
+    shaderLogWidget = new QWidget;
+    shaderLogWidget->setWindowTitle("Shader log");
+    shaderLogWidget->setAttribute(Qt::WA_ShowWithoutActivating);
+    shaderLogWidget->setVisible(false);
+    shaderLogWidget->setLayout(layout);
+
+    connect(clearButton, &QPushButton::clicked, shaderLogTextEdit, &QPlainTextEdit::clear);
+    connect(mRenderManager, &RenderManager::shaderError, this, &ControlWidget::appendShaderLog);
+}
+
+
+
+void ControlWidget::appendShaderLog(QString name, QString log)
+{
+    // Shown without taking focus, so that rendering and editing go on
+
+    shaderLogTextEdit->appendPlainText(QString("[%1] %2\n%3").arg(QTime::currentTime().toString("hh:mm:ss"), name, log.trimmed()));
+
+    if (!shaderLogWidget->isVisible()) {
+        shaderLogWidget->show();
+    }
+}
+
+
+
 /*void ControlWidget::toggleSortedOperationWidget()
 {
     sortedOperationWidget->setVisible(!sortedOperationWidget->isVisible());
@@ -363,6 +466,36 @@ void ControlWidget::saveConfig()
 
 
 
+// Checkpoints hold the textures of the nodes, restored onto the loaded configuration they were taken from
+
+void ControlWidget::loadCheckpoint()
+{
+    QString filename = QFileDialog::getOpenFileName(this, "Restore checkpoint", mRenderManager->checkpointDirectory(), "Fosforo checkpoints (*.mgck)");
+
+    if (!filename.isEmpty())
+    {
+        if (mRenderManager->restoreCheckpoint(filename)) {
+            updateIterationNumberLabel();
+        }
+        else {
+            QMessageBox::information(this, "Error restoring checkpoint", mRenderManager->checkpointError());
+        }
+    }
+}
+
+
+
+void ControlWidget::saveCheckpoint()
+{
+    QString filename = QFileDialog::getSaveFileName(this, "Save checkpoint", mRenderManager->checkpointDirectory(), "Fosforo checkpoints (*.mgck)");
+
+    if (!filename.isEmpty()) {
+        mRenderManager->writeCheckpoint(filename, mRenderManager->iterationNumber());
+    }
+}
+
+
+
 void ControlWidget::toggleOverlay()
 {
     overlayEnabled = !overlayEnabled;
@@ -422,6 +555,10 @@ void ControlWidget::about()
 void ControlWidget::updateIterationNumberLabel()
 {
     iterationNumberLabel->setText(QString("Frame: %1").arg(mRenderManager->iterationNumber()));
+
+    if (rewindSlider->value() == 0) {
+        rewindSlider->setMinimum(1 - qMax(1, mRenderManager->rewindCount()));
+    }
 }
 
 
@@ -430,6 +567,16 @@ void ControlWidget::updateIterationMetricsLabels(double uspf, double fps)
 {
     timePerIterationLabel->setText(QString("uSPF: %1").arg(uspf));
     iterationFPSLabel->setText(QString("FPS: %1").arg(fps));
+
+    if (mRenderManager->numCachedOperations() > 0) {
+        cacheLabel->setText(QString("Cached: %1 (-%2 uSPF)").arg(mRenderManager->numCachedOperations()).arg(qRound(mRenderManager->cacheSavedTime())));
+    }
+    else {
+        cacheLabel->setText("Cached: 0");
+    }
+
+    ProgramCache* programCache = mRenderManager->programCache();
+    programCacheLabel->setText(QString("Programs: %1 (%2 cached, %3% hits, %4 KB)").arg(mRenderManager->programPool()->count()).arg(programCache->count()).arg(qRound(100.0 * programCache->hitRate())).arg(programCache->size() / 1024));
 }
 
 
@@ -683,6 +830,61 @@ void ControlWidget::constructDisplayOptionsWidget(double itsFPS, double updFPS)
     updateCheckBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
     updateCheckBox->setChecked(true);
 
+    QPushButton* programCacheButton = new QPushButton(mRenderManager->programCache()->directory());
+    programCacheButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    programCacheButton->setToolTip("Directory where linked program binaries are cached");
+
+    QSpinBox* crossfadeSpinBox = new QSpinBox;
+    crossfadeSpinBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    crossfadeSpinBox->setRange(0, 10000);
+    crossfadeSpinBox->setSingleStep(100);
+    crossfadeSpinBox->setValue(0);
+    crossfadeSpinBox->setToolTip("Fade from the previous output when loading a configuration");
+
+    QSpinBox* checkpointSpinBox = new QSpinBox;
+    checkpointSpinBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    checkpointSpinBox->setRange(0, 1000000);
+    checkpointSpinBox->setSingleStep(100);
+    checkpointSpinBox->setValue(mRenderManager->checkpointInterval());
+    checkpointSpinBox->setToolTip("Save a checkpoint every so many iterations, 0 to disable");
+
+    QCheckBox* checkpointCompressCheckBox = new QCheckBox;
+    checkpointCompressCheckBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    checkpointCompressCheckBox->setChecked(mRenderManager->checkpointCompressed());
+    checkpointCompressCheckBox->setToolTip("Compress checkpoint textures, smaller files at the cost of writing time");
+
+    QComboBox* rewindModeComboBox = new QComboBox;
+    rewindModeComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    rewindModeComboBox->addItem("Off", static_cast<int>(RewindMode::Off));
+    rewindModeComboBox->addItem("Output", static_cast<int>(RewindMode::Output));
+    rewindModeComboBox->addItem("Full state", static_cast<int>(RewindMode::State));
+    rewindModeComboBox->setCurrentIndex(rewindModeComboBox->findData(static_cast<int>(mRenderManager->rewindMode())));
+    rewindModeComboBox->setToolTip("Keep recent iterations on the GPU: the output only, or everything needed to resume exactly");
+
+    QSpinBox* rewindBudgetSpinBox = new QSpinBox;
+    rewindBudgetSpinBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    rewindBudgetSpinBox->setRange(16, 16384);
+    rewindBudgetSpinBox->setSingleStep(64);
+    rewindBudgetSpinBox->setValue(mRenderManager->rewindBudget());
+    rewindBudgetSpinBox->setToolTip("GPU memory for retained iterations");
+
+    QComboBox* rewindScaleComboBox = new QComboBox;
+    rewindScaleComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    rewindScaleComboBox->addItem("1/1", 1);
+    rewindScaleComboBox->addItem("1/2", 2);
+    rewindScaleComboBox->addItem("1/4", 4);
+    rewindScaleComboBox->setCurrentIndex(rewindScaleComboBox->findData(mRenderManager->rewindScale()));
+    rewindScaleComboBox->setToolTip("Resolution of the retained output");
+
+    QLabel* rewindErrorLabel = new QLabel;
+    rewindErrorLabel->setStyleSheet("QLabel { color: red; }");
+    rewindErrorLabel->setWordWrap(true);
+    rewindErrorLabel->setVisible(false);
+
+    QPushButton* checkpointDirButton = new QPushButton(mRenderManager->checkpointDirectory());
+    checkpointDirButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+    checkpointDirButton->setToolTip("Directory where periodic checkpoints are saved");
+
     QFormLayout* formLayout = new QFormLayout;
     formLayout->addRow("Its FPS:", itsFPSLineEdit);
     formLayout->addRow("Upd FPS:", updFPSLineEdit);
@@ -690,6 +892,15 @@ void ControlWidget::constructDisplayOptionsWidget(double itsFPS, double updFPS)
     formLayout->addRow("Width (px):", windowWidthLineEdit);
     formLayout->addRow("Height (px):", windowHeightLineEdit);
     formLayout->addRow("Format:", texFormatComboBox);
+    formLayout->addRow("Program cache:", programCacheButton);
+    formLayout->addRow("Preset fade (ms):", crossfadeSpinBox);
+    formLayout->addRow("Checkpoint every:", checkpointSpinBox);
+    formLayout->addRow("Compress checkpoints:", checkpointCompressCheckBox);
+    formLayout->addRow("Checkpoints:", checkpointDirButton);
+    formLayout->addRow("Rewind:", rewindModeComboBox);
+    formLayout->addRow("Rewind memory (MB):", rewindBudgetSpinBox);
+    formLayout->addRow("Rewind scale:", rewindScaleComboBox);
+    formLayout->addRow(rewindErrorLabel);
 
     displayOptionsWidget = new QWidget;
     displayOptionsWidget->setWindowTitle("Display options");
@@ -699,6 +910,56 @@ void ControlWidget::constructDisplayOptionsWidget(double itsFPS, double updFPS)
 
     // Signals + Slots
 
+    connect(crossfadeSpinBox, &QSpinBox::valueChanged, this, &ControlWidget::crossfadeDurationChanged);
+
+    connect(checkpointSpinBox, &QSpinBox::valueChanged, mRenderManager, &RenderManager::setCheckpointInterval);
+
+    connect(checkpointCompressCheckBox, &QCheckBox::checkStateChanged, this, [=, this](Qt::CheckState state){
+        mRenderManager->setCheckpointCompressed(state == Qt::Checked);
+    });
+
+    connect(checkpointDirButton, &QPushButton::clicked, this, [=, this]()
+    {
+        QString dir = QFileDialog::getExistingDirectory(this, "Checkpoints directory", mRenderManager->checkpointDirectory());
+        if (!dir.isEmpty())
+        {
+            mRenderManager->setCheckpointDirectory(dir);
+            checkpointDirButton->setText(dir);
+        }
+    });
+
+    connect(mRenderManager, &RenderManager::checkpointWritten, this, [=, this](QString filename, bool success){
+        if (!success)
+            statusBar->showMessage("Checkpoint could not be written: " + filename, 5000);
+    });
+
+    connect(mRenderManager, &RenderManager::sequenceFrameSkipped, this, [=, this](QString filename, int frame){
+        statusBar->showMessage(QString("Frame %1 of %2 not decoded in time, previous frame kept").arg(frame).arg(QFileInfo(filename).fileName()), 2000);
+    });
+
+    connect(rewindModeComboBox, &QComboBox::currentIndexChanged, this, [=, this](int index){
+        rewindSlider->setValue(0);
+        mRenderManager->setRewindMode(static_cast<RewindMode>(rewindModeComboBox->itemData(index).toInt()));
+    });
+
+    // Nothing is retained if the memory cannot hold a single iteration
+
+    connect(mRenderManager, &RenderManager::rewindErrorChanged, this, [=, this](QString error){
+        rewindErrorLabel->setText(error);
+        rewindErrorLabel->setVisible(!error.isEmpty());
+        rewindSlider->setToolTip(error.isEmpty() ? "Rewind through recent iterations" : error);
+    });
+
+    connect(rewindBudgetSpinBox, &QSpinBox::valueChanged, this, [=, this](int megabytes){
+        rewindSlider->setValue(0);
+        mRenderManager->setRewindBudget(megabytes);
+    });
+
+    connect(rewindScaleComboBox, &QComboBox::currentIndexChanged, this, [=, this](int index){
+        rewindSlider->setValue(0);
+        mRenderManager->setRewindScale(rewindScaleComboBox->itemData(index).toInt());
+    });
+
     connect(itsFPSLineEdit, &FocusLineEdit::editingFinished, this, [=, this]()
     {
         double fps = itsFPSLineEdit->text().toDouble();
@@ -711,6 +972,16 @@ void ControlWidget::constructDisplayOptionsWidget(double itsFPS, double updFPS)
         emit updateFPSChanged(fps);
     });
 
+    connect(programCacheButton, &QPushButton::clicked, this, [=, this]()
+    {
+        QString dir = QFileDialog::getExistingDirectory(this, "Program cache directory", mRenderManager->programCache()->directory());
+        if (!dir.isEmpty())
+        {
+            mRenderManager->programCache()->setDirectory(dir);
+            programCacheButton->setText(dir);
+        }
+    });
+
     connect(updateCheckBox, &QCheckBox::checkStateChanged, this, [=, this](Qt::CheckState state){
         emit updateStateChanged(state == Qt::Checked);
     });
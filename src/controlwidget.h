@@ -50,6 +50,7 @@
 #include <QCheckBox>
 #include <QLabel>
 #include <QComboBox>
+#include <QSpinBox>
 #include <QListWidget>
 #include <QSlider>
 #include <QMessageBox>
@@ -63,6 +64,7 @@
 #include <QTableWidgetItem>
 #include <QScrollArea>
 #include <QMediaFormat>
+#include <QPlainTextEdit>
 
 
 
@@ -98,9 +100,11 @@ signals:
 
     void readConfig(QString filename);
     void writeConfig(QString filename);
+    void crossfadeDurationChanged(int duration);
 
 public slots:
     void reset();
+    void pause();
 
     void updateWindowSizeLineEdits(int width, int height);
 
@@ -111,6 +115,8 @@ public slots:
     void updateUpdateMetricsLabels(double uspf, double fps);
 
     void setVideoCaptureElapsedTimeLabel(int frameNumber);
+
+    void appendShaderLog(QString name, QString log);
     //void setupMidi(QString portName, bool open);
     //void updateMidiLinks(QString portName, int key, int value);
 
@@ -132,6 +138,9 @@ private:
     QWidget* displayOptionsWidget;
     QWidget* recordingOptionsWidget;
     QWidget* sortedOperationWidget;
+    QWidget* shaderLogWidget;
+
+    QPlainTextEdit* shaderLogTextEdit;
 
     QTableWidget* sortedOperationsTable;
     QList<QPair<QUuid, QString>> sortedOperationsData;
@@ -145,6 +154,8 @@ private:
     QAction* saveConfigAction;
     QAction* loadConfigAction;
 
+    QSlider* rewindSlider;
+
     qreal framesPerSecond = 60.0;
     QString outputDir = QDir::currentPath();
     QMediaFormat format;
@@ -160,6 +171,8 @@ private:
     QLabel* iterationFPSLabel;
     QLabel* timePerUpdateLabel;
     QLabel* updateFPSLabel;
+    QLabel* cacheLabel;
+    QLabel* programCacheLabel;
 
     QLineEdit* windowWidthLineEdit;
     QLineEdit* windowHeightLineEdit;
@@ -188,6 +201,7 @@ private:
     void constructDisplayOptionsWidget(double itsFPS, double updFPS);
     void constructRecordingOptionsWidget();
     void constructSortedOperationWidget();
+    void constructShaderLogWidget();
 
     QString textureFormatToString(TextureFormat format);
 
@@ -204,10 +218,13 @@ private slots:
     void setOutputDir();
     void toggleDisplayOptionsWidget();
     void toggleRecordingOptionsWidget();
+    void toggleShaderLogWidget();
     //void toggleSortedOperationWidget();
     void plotsActionTriggered();
     void loadConfig();
     void saveConfig();
+    void loadCheckpoint();
+    void saveCheckpoint();
     void toggleOverlay();
     void about();
 
@@ -0,0 +1,238 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "convergencedetector.h"
+
+
+
+ConvergenceDetector::ConvergenceDetector(QObject* parent)
+    : QObject { parent }
+{
+    mRing.resize(mCapacity);
+}
+
+
+
+int ConvergenceDetector::hashTolerance() const
+{
+    return mHashTolerance;
+}
+
+
+
+void ConvergenceDetector::setHashTolerance(int bits)
+{
+    mHashTolerance = qBound(0, bits, 256);
+}
+
+
+
+float ConvergenceDetector::deltaThreshold() const
+{
+    return mDeltaThreshold;
+}
+
+
+
+void ConvergenceDetector::setDeltaThreshold(float threshold)
+{
+    mDeltaThreshold = qMax(0.0f, threshold);
+}
+
+
+
+int ConvergenceDetector::maxPeriod() const
+{
+    return mMaxPeriod;
+}
+
+
+
+void ConvergenceDetector::setMaxPeriod(int period)
+{
+    mMaxPeriod = qBound(2, period, mCapacity / 2);
+}
+
+
+
+bool ConvergenceDetector::isConverged() const
+{
+    return mConverged;
+}
+
+
+
+int ConvergenceDetector::period() const
+{
+    return mPeriod;
+}
+
+
+
+void ConvergenceDetector::reset()
+{
+    mRing.fill(Entry());
+
+    mHasLast = false;
+    mCandidate = 0;
+    mStreak = 0;
+    mMisses = 0;
+    mConverged = false;
+    mPeriod = 0;
+}
+
+
+
+const ConvergenceDetector::Entry* ConvergenceDetector::entryAt(unsigned int iteration) const
+{
+    // Readbacks may skip iterations: entries are valid only for the iteration they hold
+
+    const Entry& entry = mRing[iteration % mCapacity];
+
+    if (entry.valid && entry.iteration == iteration) {
+        return &entry;
+    }
+
+    return nullptr;
+}
+
+
+
+int ConvergenceDetector::detectPeriod(unsigned int iteration, const FrameFingerprint& fingerprint) const
+{
+    // Candidate period, 0 if there is none, -1 if the sample needed to check the current candidate is missing
+
+    // Fixed point: the frame barely changed on average, confirmed by no pixel having changed at all,
+    // so that motion which preserves the cell means is not taken for a fixed point
+
+    if (fingerprint.delta >= 0.0f && fingerprint.delta < mDeltaThreshold && !fingerprint.contentChanged) {
+        return 1;
+    }
+
+    // The hash does not see the change from the previous frame: undecidable
+
+    const Entry* previous = entryAt(iteration - 1);
+
+    if (previous && fingerprint.distance(previous->fingerprint) <= mHashTolerance) {
+        return 0;
+    }
+
+    // Smallest lag with a matching hash
+
+    bool candidateMissing = false;
+
+    for (int p = 2; p <= mMaxPeriod && static_cast<unsigned int>(p) <= iteration; p++)
+    {
+        const Entry* entry = entryAt(iteration - p);
+
+        if (entry && fingerprint.distance(entry->fingerprint) <= mHashTolerance) {
+            return p;
+        }
+
+        if (!entry && p == mCandidate) {
+            candidateMissing = true;
+        }
+    }
+
+    return candidateMissing ? -1 : 0;
+}
+
+
+
+void ConvergenceDetector::addFingerprint(unsigned int iteration, FrameFingerprint fingerprint)
+{
+    // Iteration number going back means the system has been reset
+
+    if (mHasLast && iteration <= mLastIteration)
+    {
+        bool wasConverged = mConverged;
+
+        reset();
+
+        if (wasConverged) {
+            emit diverged(iteration);
+        }
+    }
+
+    int candidate = detectPeriod(iteration, fingerprint);
+
+    Entry& entry = mRing[iteration % mCapacity];
+    entry.iteration = iteration;
+    entry.valid = true;
+    entry.fingerprint = fingerprint;
+
+    mHasLast = true;
+    mLastIteration = iteration;
+
+    // Missing sample: no data, the streak is neither extended nor broken
+
+    if (candidate < 0)
+    {
+        emit fingerprintAnalyzed(iteration, fingerprint.delta, mCandidate);
+        return;
+    }
+
+    if (candidate > 0 && candidate == mCandidate)
+    {
+        mStreak++;
+    }
+    else
+    {
+        mCandidate = candidate;
+        mStreak = candidate > 0 ? 1 : 0;
+    }
+
+    emit fingerprintAnalyzed(iteration, fingerprint.delta, candidate);
+
+    // A period is confirmed after repeating twice and a minimum number of matches
+
+    bool confirmed = mCandidate > 0 && mStreak >= qMax(mConfirmations, 2 * mCandidate);
+
+    if (!mConverged)
+    {
+        if (confirmed)
+        {
+            mConverged = true;
+            mPeriod = mCandidate;
+            mMisses = 0;
+
+            emit converged(mPeriod, iteration);
+        }
+    }
+    else if (candidate == mPeriod)
+    {
+        mMisses = 0;
+    }
+    else if (++mMisses >= mConfirmations)
+    {
+        // Hysteresis against isolated mismatches
+
+        mConverged = false;
+        mPeriod = 0;
+        mMisses = 0;
+
+        emit diverged(iteration);
+    }
+}
@@ -0,0 +1,101 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef CONVERGENCEDETECTOR_H
+#define CONVERGENCEDETECTOR_H
+
+
+
+#include "fingerprintengine.h"
+
+#include <QObject>
+#include <QList>
+
+
+
+// ConvergenceDetector: finds fixed points and periodic orbits from a ring of frame fingerprints
+// A fixed point is a sustained delta below threshold with no pixel changed, a period p a sustained hash match at lag p
+
+class ConvergenceDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConvergenceDetector(QObject* parent = nullptr);
+
+    int hashTolerance() const;
+    void setHashTolerance(int bits);
+
+    float deltaThreshold() const;
+    void setDeltaThreshold(float threshold);
+
+    int maxPeriod() const;
+    void setMaxPeriod(int period);
+
+    bool isConverged() const;
+    int period() const;
+
+signals:
+    void converged(int period, unsigned int iteration);
+    void diverged(unsigned int iteration);
+    void fingerprintAnalyzed(unsigned int iteration, float delta, int candidatePeriod);
+
+public slots:
+    void addFingerprint(unsigned int iteration, FrameFingerprint fingerprint);
+    void reset();
+
+private:
+    struct Entry
+    {
+        unsigned int iteration = 0;
+        bool valid = false;
+        FrameFingerprint fingerprint;
+    };
+
+    static const int mCapacity = 1024;
+    QList<Entry> mRing;
+
+    int mHashTolerance = 4;
+    float mDeltaThreshold = 1.0e-4f;
+    int mMaxPeriod = 256;
+    int mConfirmations = 16;
+
+    bool mHasLast = false;
+    unsigned int mLastIteration = 0;
+
+    int mCandidate = 0;
+    int mStreak = 0;
+    int mMisses = 0;
+
+    bool mConverged = false;
+    int mPeriod = 0;
+
+    const Entry* entryAt(unsigned int iteration) const;
+    int detectPeriod(unsigned int iteration, const FrameFingerprint& fingerprint) const;
+};
+
+
+
+#endif // CONVERGENCEDETECTOR_H
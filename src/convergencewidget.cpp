@@ -0,0 +1,173 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "convergencewidget.h"
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QIntValidator>
+#include <QDoubleValidator>
+
+
+
+ConvergenceWidget::ConvergenceWidget(FingerprintEngine* engine, QWidget* parent)
+    : QWidget { parent },
+    mEngine { engine }
+{
+    mDetector = new ConvergenceDetector(this);
+
+    QPushButton* enableButton = new QPushButton(QIcon(QPixmap(":/icons/circle-green.png")), "");
+    enableButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    enableButton->setCheckable(true);
+    enableButton->setChecked(mEngine->enabled());
+    enableButton->setToolTip("Convergence detection");
+
+    mActionComboBox = new QComboBox;
+    mActionComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    mActionComboBox->addItem("No action", static_cast<int>(Action::None));
+    mActionComboBox->addItem("Reseed", static_cast<int>(Action::Reseed));
+    mActionComboBox->addItem("Throttle", static_cast<int>(Action::Throttle));
+    mActionComboBox->addItem("Pause", static_cast<int>(Action::Pause));
+    mActionComboBox->setToolTip("Action on convergence");
+
+    mToleranceLineEdit = new QLineEdit;
+    QIntValidator* toleranceValidator = new QIntValidator(0, 256, mToleranceLineEdit);
+    mToleranceLineEdit->setValidator(toleranceValidator);
+    mToleranceLineEdit->setText(QString::number(mDetector->hashTolerance()));
+    mToleranceLineEdit->setToolTip("Hash tolerance (bits)");
+
+    mThresholdLineEdit = new QLineEdit;
+    QDoubleValidator* thresholdValidator = new QDoubleValidator(0.0, 1.0, 8, mThresholdLineEdit);
+    thresholdValidator->setLocale(QLocale::English);
+    mThresholdLineEdit->setValidator(thresholdValidator);
+    mThresholdLineEdit->setText(QString::number(mDetector->deltaThreshold()));
+    mThresholdLineEdit->setToolTip("Fixed point delta threshold");
+
+    mStateLabel = new QLabel("Evolving");
+    mDeltaLabel = new QLabel;
+
+    QHBoxLayout* controlsLayout = new QHBoxLayout;
+    controlsLayout->addWidget(enableButton);
+    controlsLayout->addWidget(mActionComboBox);
+    controlsLayout->addWidget(mToleranceLineEdit);
+    controlsLayout->addWidget(mThresholdLineEdit);
+
+    QHBoxLayout* stateLayout = new QHBoxLayout;
+    stateLayout->addWidget(mStateLabel);
+    stateLayout->addWidget(mDeltaLabel);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(controlsLayout);
+    layout->addLayout(stateLayout);
+
+    setLayout(layout);
+
+    connect(enableButton, &QPushButton::toggled, this, [=, this](bool checked) {
+        mEngine->setEnabled(checked);
+        mDetector->reset();
+        mStateLabel->setText("Evolving");
+        setThrottling(false);
+    });
+    connect(mToleranceLineEdit, &QLineEdit::editingFinished, this, [=, this]() {
+        mDetector->setHashTolerance(mToleranceLineEdit->text().toInt());
+    });
+    connect(mThresholdLineEdit, &QLineEdit::editingFinished, this, [=, this]() {
+        mDetector->setDeltaThreshold(mThresholdLineEdit->text().toFloat());
+    });
+    connect(mActionComboBox, &QComboBox::activated, this, &ConvergenceWidget::onActionChanged);
+
+    connect(mEngine, &FingerprintEngine::fingerprintReady, mDetector, &ConvergenceDetector::addFingerprint);
+    connect(mDetector, &ConvergenceDetector::converged, this, &ConvergenceWidget::onConverged);
+    connect(mDetector, &ConvergenceDetector::diverged, this, &ConvergenceWidget::onDiverged);
+    connect(mDetector, &ConvergenceDetector::fingerprintAnalyzed, this, [=, this](unsigned int, float delta, int) {
+        if (isVisible() && delta >= 0.0f) {
+            mDeltaLabel->setText("Delta: " + QString::number(delta, 'g', 3));
+        }
+    });
+}
+
+
+
+ConvergenceDetector* ConvergenceWidget::detector()
+{
+    return mDetector;
+}
+
+
+
+void ConvergenceWidget::setThrottling(bool on)
+{
+    if (on != mThrottling)
+    {
+        mThrottling = on;
+        emit throttleRequested(on);
+    }
+}
+
+
+
+void ConvergenceWidget::onConverged(int period, unsigned int iteration)
+{
+    if (period == 1) {
+        mStateLabel->setText("Fixed point at " + QString::number(iteration));
+    }
+    else {
+        mStateLabel->setText("Period " + QString::number(period) + " at " + QString::number(iteration));
+    }
+
+    Action action = static_cast<Action>(mActionComboBox->currentData().toInt());
+
+    if (action == Action::Reseed) {
+        emit reseedRequested();
+    }
+    else if (action == Action::Throttle) {
+        setThrottling(true);
+    }
+    else if (action == Action::Pause) {
+        emit pauseRequested();
+    }
+}
+
+
+
+void ConvergenceWidget::onDiverged(unsigned int iteration)
+{
+    Q_UNUSED(iteration)
+
+    mStateLabel->setText("Evolving");
+
+    setThrottling(false);
+}
+
+
+
+void ConvergenceWidget::onActionChanged(int index)
+{
+    if (static_cast<Action>(mActionComboBox->itemData(index).toInt()) != Action::Throttle) {
+        setThrottling(false);
+    }
+}
@@ -0,0 +1,81 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef CONVERGENCEWIDGET_H
+#define CONVERGENCEWIDGET_H
+
+
+
+#include "fingerprintengine.h"
+#include "convergencedetector.h"
+
+#include <QWidget>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QLabel>
+
+
+
+// ConvergenceWidget: fixed point and periodic orbit detection settings, state and action taken on convergence
+
+class ConvergenceWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ConvergenceWidget(FingerprintEngine* engine, QWidget* parent = nullptr);
+
+    enum class Action { None, Reseed, Throttle, Pause };
+
+    ConvergenceDetector* detector();
+
+signals:
+    void reseedRequested();
+    void throttleRequested(bool on);
+    void pauseRequested();
+
+private:
+    FingerprintEngine* mEngine;
+    ConvergenceDetector* mDetector;
+
+    QComboBox* mActionComboBox;
+    QLineEdit* mToleranceLineEdit;
+    QLineEdit* mThresholdLineEdit;
+    QLabel* mStateLabel;
+    QLabel* mDeltaLabel;
+
+    bool mThrottling = false;
+
+    void setThrottling(bool on);
+
+private slots:
+    void onConverged(int period, unsigned int iteration);
+    void onDiverged(unsigned int iteration);
+    void onActionChanged(int index);
+};
+
+
+
+#endif // CONVERGENCEWIDGET_H
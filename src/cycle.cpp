@@ -62,6 +62,8 @@ Cycle::Cycle(QList<Node*> nodes, QGraphicsItem *parent) :
     setAcceptedMouseButtons(Qt::NoButton);
     setCacheMode(DeviceCoordinateCache);
     setZValue(-3);
+
+    adjust();
 }
 
 
@@ -81,33 +83,38 @@ int Cycle::numPredges()
 
 
 
-QRectF Cycle::boundingRect() const
+void Cycle::adjust()
 {
-    QRectF whole;
+    prepareGeometryChange();
 
-    foreach (Edge* edge, edges) {
-        whole = whole.united(edge->boundingRect());
+    mBoundary.clear();
+    mBoundingRect = QRectF();
+
+    for (int i = 0; i < edges.size(); i++)
+    {
+        mBoundary << edges[i]->srcPoint() << edges[i]->dstPoint();
+        mBoundary << edges[(i + 1) % edges.size()]->srcPoint();
+
+        mBoundingRect = mBoundingRect.united(edges[i]->boundingRect());
     }
 
-    return whole;
+    mShape = QPainterPath();
+    mShape.addPolygon(mBoundary);
+    mShape.closeSubpath();
 }
 
 
 
-QPainterPath Cycle::shape() const
+QRectF Cycle::boundingRect() const
 {
-    QPolygonF boundary;
+    return mBoundingRect;
+}
+
 
-    for (int i = 0; i < edges.size(); i++)
-    {
-        boundary << edges[i]->srcPoint() << edges[i]->dstPoint();
-        boundary << edges[(i + 1) % edges.size()]->srcPoint();
-    }
 
-    QPainterPath path;
-    path.addPolygon(boundary);
-    path.closeSubpath();
-    return path;
+QPainterPath Cycle::shape() const
+{
+    return mShape;
 }
 
 
@@ -116,14 +123,5 @@ void Cycle::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
     painter->setPen(Qt::NoPen);
     painter->setBrush(QColor(16, 64, 255, 32));
-
-    QPolygonF boundary;
-
-    for (int i = 0; i < edges.size(); i++)
-    {
-        boundary << edges[i]->srcPoint() << edges[i]->dstPoint();
-        boundary << edges[(i + 1) % edges.size()]->srcPoint();
-    }
-
-    painter->drawPolygon(boundary);
+    painter->drawPolygon(mBoundary);
 }
@@ -28,6 +28,8 @@
 
 
 #include <QGraphicsItem>
+#include <QPolygonF>
+#include <QPainterPath>
 
 
 
@@ -47,12 +49,20 @@ public:
 
     int numPredges();
 
+    void adjust();
+
     QRectF boundingRect() const override;
     QPainterPath shape() const override;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 
 private:
     QList<Edge*> edges;
+
+    // Geometry cached until its edges move
+
+    QPolygonF mBoundary;
+    QRectF mBoundingRect;
+    QPainterPath mShape;
 };
 
 
@@ -20,296 +20,421 @@
 *  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+
+
+
 #include "cyclesearch.h"
 
+#include <algorithm>
+#include <bit>
+
+
+
 // Elementary cycles search
 
-ElementaryCyclesSearch::ElementaryCyclesSearch(QList<QList<bool>> matrix, QList<Node*> nodes)
-{
-    graphNodes = nodes;
-    adjacencyList = getAdjacencyList(matrix);
-}
+ElementaryCyclesSearch::ElementaryCyclesSearch(QList<QList<int>> adjacencyList, int maxCycles, int timeLimit, std::function<bool()> cancelled) :
+    mAdjacencyList { adjacencyList },
+    mMaxCycles { maxCycles },
+    mTimeLimit { timeLimit },
+    mCancelled { cancelled }
+{}
+
+
 
-QList<QList<int>> ElementaryCyclesSearch::getAdjacencyList(QList<QList<bool>> matrix)
+QList<QList<int>> ElementaryCyclesSearch::getElementaryCycles()
 {
-     QList<QList<int>> list;
+    mCycles.clear();
+    mComplete = true;
+    mNumSteps = 0;
+    mTimer.start();
 
-     for (int i = 0; i < matrix.size(); i++)
-     {
-         QList<int> v;
+    // Search the cycles through the lowest vertex of each strongly connected component,
+    // then remove that vertex and go on with the components of what remains
 
-         for (int j = 0; j < matrix[i].size(); j++)
-             if (matrix[i][j])
-                 v.push_back(j);
+    QList<int> vertices;
+    for (int v = 0; v < mAdjacencyList.size(); v++) {
+        vertices.append(v);
+    }
+
+    QList<QList<int>> components = stronglyConnectedComponents(vertices);
+
+    while (!components.isEmpty() && mComplete)
+    {
+        QList<int> component = components.takeLast();
+
+        searchCircuits(component);
 
-         list.push_back(v);
-     }
+        component.removeOne(*std::min_element(component.begin(), component.end()));
+        components.append(stronglyConnectedComponents(component));
+    }
 
-     return list;
+    return mCycles;
 }
 
-QList<QList<Node*>> ElementaryCyclesSearch::getElementaryCycles()
+
+
+bool ElementaryCyclesSearch::complete() const
 {
-    cycles.clear();
-    blocked.clear();
-    blocked.resize(adjacencyList.size());
-    B.clear();
-    B.resize(adjacencyList.size());
-    stack.clear();
+    return mComplete;
+}
 
-    StrongConnectedComponents sccs(adjacencyList);
 
-    int s = 0;
 
-    while (true)
-    {
-        SCCResult* sccResult = sccs.getAdjacencyList(s);
+bool ElementaryCyclesSearch::stopRequested()
+{
+    if (!mComplete) {
+        return true;
+    }
 
-        if(sccResult && !sccResult->adjacencyList.empty())
-        {
-            QList<QList<int>> scc = sccResult->adjacencyList;
-            s = sccResult->lowestNodeId;
+    if (mMaxCycles > 0 && mCycles.size() >= mMaxCycles) {
+        mComplete = false;
+    }
 
-            for (int i = 0; i < scc.size(); i++)
-            {
-                if (!scc[i].empty())
-                {
-                    blocked[i] = false;
-                }
-            }
+    // Clock and cancellation are checked every few steps only
 
-            findCycles(s, s, scc);
-            s++;
-        }
-        else
-        {
-            break;
+    else if ((++mNumSteps & 1023) == 0)
+    {
+        if ((mTimeLimit > 0 && mTimer.elapsed() > mTimeLimit) || (mCancelled && mCancelled())) {
+            mComplete = false;
         }
     }
 
-    return cycles;
+    return !mComplete;
 }
 
-bool ElementaryCyclesSearch::findCycles(int v, int s, QList<QList<int>> adjList)
-{
-    bool f = false;
-    stack.push_back(v);
-    blocked[v] = true;
 
-    for (int i = 0; i < adjList[v].size(); i++)
-    {
-        int w = adjList[v][i];
 
-        if (w == s)
-        {
-            QList<Node*> cycle;
+void ElementaryCyclesSearch::searchCircuits(const QList<int>& component)
+{
+    // Local indices within the component, the start vertex is the lowest one
 
-            for (int j = 0; j < stack.size(); j++)
-                cycle.push_back(graphNodes[stack[j]]);
+    QList<int> vertices = component;
+    std::sort(vertices.begin(), vertices.end());
 
-            cycles.push_back(cycle);
+    int size = vertices.size();
 
-            f = true;
-        }
-        else if (!blocked[w])
+    QList<QList<int>> adjacency(size);
+
+    for (int i = 0; i < size; i++)
+    {
+        foreach (int w, mAdjacencyList[vertices[i]])
         {
-            if (findCycles(w, s, adjList))
-                f = true;
+            auto it = std::lower_bound(vertices.begin(), vertices.end(), w);
+            if (it != vertices.end() && *it == w) {
+                adjacency[i].append(static_cast<int>(it - vertices.begin()));
+            }
         }
     }
 
-    if (f)
+    QBitArray blocked(size);
+    QList<BitSet> B(size);
+
+    // Explicit stack of frames instead of recursion: vertex, next successor to visit, and whether a cycle was found through it
+
+    struct Frame
     {
-        unblock(v);
-    }
-    else
+        int v;
+        int next;
+        bool found;
+    };
+
+    QList<int> path = { 0 };
+    QList<Frame> frames = { { 0, 0, false } };
+    blocked.setBit(0);
+
+    QList<int> unblockStack;
+
+    while (!frames.isEmpty())
     {
-        for (int i = 0; i < adjList[v].size(); i++)
+        if (stopRequested()) {
+            return;
+        }
+
+        Frame& frame = frames.last();
+
+        if (frame.next < adjacency[frame.v].size())
         {
-            int w = adjList[v][i];
+            int w = adjacency[frame.v][frame.next++];
+
+            if (w == 0)
+            {
+                QList<int> cycle;
+                cycle.reserve(path.size());
+
+                foreach (int v, path) {
+                    cycle.append(vertices[v]);
+                }
+
+                mCycles.append(cycle);
+
+                frame.found = true;
+            }
+            else if (!blocked.testBit(w))
+            {
+                path.append(w);
+                blocked.setBit(w);
+                frames.append({ w, 0, false });
+            }
 
-            if (!B[w].contains(v))
-                B[w].push_back(v);
+            continue;
         }
-    }
 
-    stack.remove(stack.indexOf(v));
-    return f;
-}
+        int v = frame.v;
+        bool found = frame.found;
 
-void ElementaryCyclesSearch::unblock(int node)
-{
-    blocked[node] = false;
+        if (found)
+        {
+            // Unblock v and, transitively, the vertices waiting on it
 
-    QList<int> Bnode = B[node];
+            blocked.clearBit(v);
+            unblockStack.append(v);
 
-    while (Bnode.size() > 0)
-    {
-        int w = Bnode[0];
-        Bnode.remove(0);
-        if (blocked[w])
-            unblock(w);
+            while (!unblockStack.isEmpty())
+            {
+                int u = unblockStack.takeLast();
+
+                B[u].forEach([&](int w) {
+                    if (blocked.testBit(w))
+                    {
+                        blocked.clearBit(w);
+                        unblockStack.append(w);
+                    }
+                });
+
+                B[u].clear();
+            }
+        }
+        else
+        {
+            foreach (int w, adjacency[v])
+            {
+                B[w].resize(size);
+                B[w].set(v);
+            }
+        }
+
+        frames.removeLast();
+        path.removeLast();
+
+        if (found && !frames.isEmpty()) {
+            frames.last().found = true;
+        }
     }
 }
 
-// Strong connected components
 
-StrongConnectedComponents::StrongConnectedComponents(QList<QList<int>> adjList)
-{
-    adjacencyListOriginal = adjList;
-}
 
-SCCResult* StrongConnectedComponents::getAdjacencyList(int node)
+QList<QList<int>> ElementaryCyclesSearch::stronglyConnectedComponents(const QList<int>& vertices) const
 {
-    visited.clear();
-    visited.resize(adjacencyListOriginal.size());
-    lowlink.clear();
-    lowlink.resize(adjacencyListOriginal.size());
-    number.clear();
-    number.resize(adjacencyListOriginal.size());
-    visited.clear();
-    visited.resize(adjacencyListOriginal.size());
-    stack.clear();
-    currentSCCs.clear();
-
-    makeAdjListSubgraph(node);
-
-    for (int i = node; i < adjacencyListOriginal.size(); i++)
+    // Iterative Tarjan's algorithm on the subgraph induced by the given vertices
+    // Only components that may hold cycles (more than one vertex) are returned
+
+    int n = mAdjacencyList.size();
+
+    QList<int> number(n, -1);
+    QList<int> lowlink(n, 0);
+    QBitArray inSubgraph(n);
+    QBitArray onStack(n);
+
+    foreach (int v, vertices) {
+        inSubgraph.setBit(v);
+    }
+
+    QList<QList<int>> components;
+    QList<int> stack;
+    QList<QPair<int, int>> frames;
+    int counter = 0;
+
+    foreach (int root, vertices)
     {
-        if(!visited[i])
+        if (number[root] >= 0) {
+            continue;
+        }
+
+        frames.append({ root, 0 });
+        number[root] = lowlink[root] = counter++;
+        stack.append(root);
+        onStack.setBit(root);
+
+        while (!frames.isEmpty())
         {
-            getStrongConnectedComponents(i);
+            int v = frames.last().first;
+            int& next = frames.last().second;
+
+            if (next < mAdjacencyList[v].size())
+            {
+                int w = mAdjacencyList[v][next++];
+
+                if (!inSubgraph.testBit(w)) {
+                    continue;
+                }
+
+                if (number[w] < 0)
+                {
+                    number[w] = lowlink[w] = counter++;
+                    stack.append(w);
+                    onStack.setBit(w);
+                    frames.append({ w, 0 });
+                }
+                else if (onStack.testBit(w)) {
+                    lowlink[v] = qMin(lowlink[v], number[w]);
+                }
 
-            QList<int> nodes = getLowestIdComponent();
+                continue;
+            }
+
+            frames.removeLast();
 
-            if(!nodes.contains(node) && !nodes.contains(node + 1))
+            if (!frames.isEmpty())
             {
-                return getAdjacencyList(node + 1);
+                int parent = frames.last().first;
+                lowlink[parent] = qMin(lowlink[parent], lowlink[v]);
             }
-            else
+
+            if (lowlink[v] == number[v])
             {
-                QList<QList<int>> adjList = getAdjList(nodes);
-                if (!adjList.empty())
-                    for (int j = 0; j < adjacencyListOriginal.size(); j++)
-                        if (!adjList[j].empty())
-                            return new SCCResult(adjList, j);
+                QList<int> component;
+                int w;
+
+                do
+                {
+                    w = stack.takeLast();
+                    onStack.clearBit(w);
+                    component.append(w);
+                }
+                while (w != v);
+
+                if (component.size() > 1) {
+                    components.append(component);
+                }
             }
         }
     }
 
-    return nullptr;
+    return components;
 }
 
-void StrongConnectedComponents::makeAdjListSubgraph(int node)
+
+
+void ElementaryCyclesSearch::BitSet::resize(int size)
 {
-    adjacencyList.clear();
-    adjacencyList.resize(adjacencyListOriginal.size());
+    int numWords = (size + 63) / 64;
 
-    for (int i = node; i < adjacencyList.size(); i++)
-    {
-        QList<int> successors;
+    if (mWords.size() < numWords) {
+        mWords.resize(numWords, 0);
+    }
+}
 
-        for (int j = 0; j < adjacencyListOriginal[i].size(); j++)
-            if (adjacencyListOriginal[i][j] >= node)
-                successors.push_back(adjacencyListOriginal[i][j]);
 
-        if (!successors.empty())
-        {
-            adjacencyList[i].clear();
-            adjacencyList[i].resize(successors.size());
 
-            for (int j = 0; j < successors.size(); j++)
-                adjacencyList[i][j] = successors[j];
-        }
+void ElementaryCyclesSearch::BitSet::set(int i)
+{
+    quint64& word = mWords[i / 64];
+
+    if (word == 0) {
+        mSetWords.append(i / 64);
     }
+
+    word |= quint64(1) << (i % 64);
 }
 
-QList<int> StrongConnectedComponents::getLowestIdComponent()
+
+
+void ElementaryCyclesSearch::BitSet::clear()
 {
-    int min = adjacencyList.size();
+    foreach (int k, mSetWords) {
+        mWords[k] = 0;
+    }
+
+    mSetWords.clear();
+}
 
-    QList<int> currScc;
 
-    for (int i = 0; i < currentSCCs.size(); i++)
+
+template <typename Function>
+void ElementaryCyclesSearch::BitSet::forEach(Function function) const
+{
+    foreach (int k, mSetWords)
     {
-        QList<int> scc = currentSCCs[i];
+        quint64 word = mWords[k];
 
-        for (int j = 0; j < scc.size(); j++)
+        while (word != 0)
         {
-            int node = scc[j];
-            if (node < min)
-            {
-                currScc = scc;
-                min = node;
-            }
+            function(k * 64 + std::countr_zero(word));
+            word &= word - 1;
         }
     }
+}
+
+
 
-    return currScc;
+// Cycle searcher
+
+CycleSearcher::CycleSearcher()
+{
+    moveToThread(&mThread);
+    mThread.start();
 }
 
-QList<QList<int>> StrongConnectedComponents::getAdjList(QList<int> nodes)
+
+
+CycleSearcher::~CycleSearcher()
 {
-    QList<QList<int>> lowestIdAdjacencyList;
+    stop();
+}
 
-    if (!nodes.empty())
-    {
-        lowestIdAdjacencyList.resize(adjacencyList.size());
 
-        for (int i = 0; i < nodes.size(); i++)
-        {
-            int node = nodes[i];
 
-            for (int j = 0; j < adjacencyList[node].size(); j++)
-            {
-                int succ = adjacencyList[node][j];
-                if (nodes.contains(succ))
-                    lowestIdAdjacencyList[node].push_back(succ);
-            }
-        }
-    }
+quint64 CycleSearcher::request(QList<QList<int>> adjacencyList)
+{
+    // Bumping the ticket cancels the search in progress
+
+    quint64 ticket = ++mLatestTicket;
 
-    return lowestIdAdjacencyList;
+    QMetaObject::invokeMethod(this, [=, this]() {
+        search(ticket, adjacencyList);
+    }, Qt::QueuedConnection);
+
+    return ticket;
 }
 
-void StrongConnectedComponents::getStrongConnectedComponents(int root)
+
+
+quint64 CycleSearcher::latestTicket() const
 {
-    sccCounter++;
-    lowlink[root] = sccCounter;
-    number[root] = sccCounter;
-    visited[root] = true;
-    stack.push_back(root);
+    return mLatestTicket;
+}
+
 
-    for (int i = 0; i < adjacencyList[root].size(); i++)
+
+void CycleSearcher::stop()
+{
+    if (mThread.isRunning())
     {
-        int w = adjacencyList[root][i];
+        ++mLatestTicket;
 
-        if (!visited[w])
-        {
-            getStrongConnectedComponents(w);
-            lowlink[root] = lowlink[root] < lowlink[w] ? lowlink[root] : lowlink[w];
-        }
-        else if (number[w] < number[root])
-        {
-            if (stack.contains(w))
-                lowlink[root] = lowlink[root] < number[w] ? lowlink[root] : number[w];
-        }
+        mThread.quit();
+        mThread.wait();
     }
+}
 
-    if (lowlink[root] == number[root] && !stack.empty())
-    {
-        int next = -1;
-        QList<int> scc;
 
-        do
-        {
-            next = stack.back();
-            stack.pop_back();
-            scc.push_back(next);
-        }
-        while (number[next] > number[root]);
 
-        if (scc.size() > 1)
-            currentSCCs.push_back(scc);
+void CycleSearcher::search(quint64 ticket, QList<QList<int>> adjacencyList)
+{
+    // Skip requests already superseded while queued
+
+    if (ticket != mLatestTicket) {
+        return;
+    }
+
+    ElementaryCyclesSearch ecs(adjacencyList, maxCycles, timeLimit, [=, this]() {
+        return ticket != mLatestTicket;
+    });
+
+    QList<QList<int>> cycles = ecs.getElementaryCycles();
+
+    if (ticket == mLatestTicket) {
+        emit cyclesFound(ticket, cycles, ecs.complete());
     }
 }
@@ -22,70 +22,95 @@
 
 
 
+
 #ifndef CYCLESEARCH_H
 #define CYCLESEARCH_H
 
 
 
-#include "node.h"
+#include <QObject>
+#include <QThread>
 #include <QList>
+#include <QBitArray>
+#include <QElapsedTimer>
+#include <atomic>
+#include <functional>
 
 
 
-struct SCCResult
-{
-    QList<QList<int>> adjacencyList;
-    int lowestNodeId;
-
-    SCCResult(QList<QList<int>> adjList, int id) :
-        adjacencyList { adjList },
-        lowestNodeId { id }
-    {}
-};
-
-
+// Elementary cycles search: iterative Johnson's algorithm over integer adjacency lists
+// Stops early after maxCycles cycles, timeLimit milliseconds or when cancelled (zero means no limit)
 
 class ElementaryCyclesSearch
 {
 public:
-    ElementaryCyclesSearch(QList<QList<bool>> matrix, QList<Node*> nodes);
-    QList<QList<Node*>> getElementaryCycles();
+    ElementaryCyclesSearch(QList<QList<int>> adjacencyList, int maxCycles = 0, int timeLimit = 0, std::function<bool()> cancelled = nullptr);
+
+    QList<QList<int>> getElementaryCycles();
+    bool complete() const;
 
 private:
-    QList<QList<Node*>> cycles;
-    QList<QList<int>> adjacencyList;
-    QList<Node*> graphNodes;
-    QList<bool> blocked;
-    QList<QList<int>> B;
-    QList<int> stack;
-
-    QList<QList<int>> getAdjacencyList(QList<QList<bool>> matrix);
-    bool findCycles(int v, int s, QList<QList<int>> adjList);
-    void unblock(int node);
+    // Set of integers in [0, size), with clearing and iteration proportional to the words in use
+
+    class BitSet
+    {
+    public:
+        void resize(int size);
+        void set(int i);
+        void clear();
+        template <typename Function>
+        void forEach(Function function) const;
+
+    private:
+        QList<quint64> mWords;
+        QList<int> mSetWords;
+    };
+
+    QList<QList<int>> mAdjacencyList;
+    int mMaxCycles;
+    int mTimeLimit;
+    std::function<bool()> mCancelled;
+
+    QElapsedTimer mTimer;
+    int mNumSteps = 0;
+    bool mComplete = true;
+
+    QList<QList<int>> mCycles;
+
+    bool stopRequested();
+    void searchCircuits(const QList<int>& component);
+    QList<QList<int>> stronglyConnectedComponents(const QList<int>& vertices) const;
 };
 
 
 
-class StrongConnectedComponents
+// CycleSearcher: runs the elementary cycles search on its own thread
+// A new request cancels the search in progress, only the result of the latest one is delivered
+
+class CycleSearcher : public QObject
 {
+    Q_OBJECT
+
 public:
-    StrongConnectedComponents(QList<QList<int>> adjList);
-    SCCResult* getAdjacencyList(int node);
+    static constexpr int maxCycles = 256;
+    static constexpr int timeLimit = 250;
+
+    explicit CycleSearcher();
+    ~CycleSearcher();
+
+    quint64 request(QList<QList<int>> adjacencyList);
+    quint64 latestTicket() const;
+
+    void stop();
+
+signals:
+    void cyclesFound(quint64 ticket, QList<QList<int>> cycles, bool complete);
 
 private:
-    QList<QList<int>> adjacencyListOriginal;
-    QList<QList<int>> adjacencyList;
-    QList<bool> visited;
-    QList<int> stack;
-    QList<int> lowlink;
-    QList<int> number;
-    int sccCounter = 0;
-    QList<QList<int>> currentSCCs;
-
-    void makeAdjListSubgraph(int node);
-    QList<int> getLowestIdComponent();
-    QList<QList<int>> getAdjList(QList<int> nodes);
-    void getStrongConnectedComponents(int root);
+    QThread mThread;
+    std::atomic<quint64> mLatestTicket = 0;
+
+    void search(quint64 ticket, QList<QList<int>> adjacencyList);
 };
 
 
@@ -24,7 +24,7 @@
 
 #include "edge.h"
 #include "node.h"
-//#include "cycle.h"
+#include "cycle.h"
 //#include "graphwidget.h"
 //#include "generator.h"
 #include "edgewidget.h"
@@ -151,6 +151,15 @@ void Edge::setWidgetVisible(bool visible)
 
 
 
+void Edge::setDetailed(bool detailed)
+{
+    // At low zoom the edge widget is hidden, so its proxy is not painted
+
+    mProxyWidget->setVisible(detailed);
+}
+
+
+
 void Edge::setPredge(bool predge)
 {
     mPredge = predge;
@@ -292,6 +301,10 @@ void Edge::adjust()
         mWidget->setVisible(!mProxyWidget->boundingRect().contains(mProxyWidget->mapFromScene(visibleLine.p1())) && !mProxyWidget->boundingRect().contains(mProxyWidget->mapFromScene(visibleLine.p2())));
         mWidget->adjustAllSizes();
     }
+
+    foreach (Cycle* cycle, cycleList) {
+        cycle->adjust();
+    }
 }
 
 
@@ -67,6 +67,7 @@ public:
     bool isPredge() const { return mPredge; }
 
     void setWidgetVisible(bool visible);
+    void setDetailed(bool detailed);
 
     QList<Cycle*> cycles() const { return cycleList; }
     void addCycle(Cycle* cycle) { cycleList.push_back(cycle); }
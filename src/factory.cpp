@@ -3,47 +3,85 @@
 
 #include "factory.h"
 #include "operationparser.h"
+#include "operationbundle.h"
 
 #include <QDir>
 #include <QStringList>
+#include <QSet>
+#include <QFile>
+#include <QDebug>
 
 
 
 Factory::Factory(VideoInputControl *videoInCtrl, QObject *parent)
     : QObject{parent},
+    mCatalogue { QDir::currentPath() + "/operations" },
     mVideoInputControl { videoInCtrl }
-{}
+{
+    // Editors often write a file in several steps: changes are collected for a moment before reloading
+
+    mReloadTimer.setSingleShot(true);
+    mReloadTimer.setInterval(250);
+
+    connect(&mWatcher, &QFileSystemWatcher::directoryChanged, this, &Factory::scheduleReload);
+    connect(&mWatcher, &QFileSystemWatcher::fileChanged, this, &Factory::scheduleReload);
+    connect(&mReloadTimer, &QTimer::timeout, this, &Factory::reload);
+
+    mSwapTimer.setInterval(10);
+    connect(&mSwapTimer, &QTimer::timeout, this, &Factory::swapReloaded);
+}
 
 
 
 Factory::~Factory()
 {
+    foreach (const PendingReload& pending, mPendingReloads) {
+        delete pending.operation;
+    }
+
     qDeleteAll(mAvailOps);
     qDeleteAll(mOperations);
     qDeleteAll(mSeeds);
 }
 
 
-QList<ImageOperation*> Factory::operations()
+const QList<ImageOperation*>& Factory::operations() const
 {
     return mOperations;
 }
 
 
 
-QList<Seed*> Factory::seeds()
+const QList<Seed*>& Factory::seeds() const
 {
     return mSeeds;
 }
 
 
 
+// Rebuilt operations waiting for their programs, not running yet
+
+QList<ImageOperation*> Factory::reloadingOperations() const
+{
+    QList<ImageOperation*> operations;
+
+    foreach (const PendingReload& pending, mPendingReloads) {
+        operations.append(pending.operation);
+    }
+
+    return operations;
+}
+
+
+
 void Factory::createNewOperation()
 {
     QUuid id = QUuid::createUuid();
 
     ImageOperation* operation = new ImageOperation();
     mOperations.append(operation);
+    mOperationIds.insert(operation, id);
+    indexNumbers(operation);
     emit newOperationCreated(id, operation);
 
     OperationWidget* widget = new OperationWidget(id, operation, mMidiEnabled, true, this);
@@ -67,32 +105,36 @@ void Factory::createNewSeed()
 
 
 
-void Factory::addAvailableOperation(int index)
+bool Factory::addAvailableOperation(int index)
 {
-    QUuid id = QUuid::createUuid();
-
-    ImageOperation* operation = new ImageOperation(*mAvailOps[index]);
-    mOperations.append(operation);
-    emit newOperationCreated(id, operation);
-
-    OperationWidget* widget = new OperationWidget(id, operation, mMidiEnabled, false, this);
-    emit newOpWidgetCreated(widget);
-    emit newOpWidgetCreated(id, widget);
+    QUuid id;
+    return addAvailableOperation(index, id);
 }
 
 
 
-void Factory::addAvailableOperation(int index, QUuid& id)
+bool Factory::addAvailableOperation(int index, QUuid& id)
 {
+    ImageOperation* availOp = availableOperation(index);
+
+    if (!availOp) {
+        return false;
+    }
+
     id = QUuid::createUuid();
 
-    ImageOperation* operation = new ImageOperation(*mAvailOps[index]);
+    ImageOperation* operation = new ImageOperation(*availOp);
     mOperations.append(operation);
+    mOperationIds.insert(operation, id);
+    indexNumbers(operation);
     emit newOperationCreated(id, operation);
+    watch(operation);
 
     OperationWidget* widget = new OperationWidget(id, operation, mMidiEnabled, false, this);
     emit newOpWidgetCreated(widget);
     emit newOpWidgetCreated(id, widget);
+
+    return true;
 }
 
 
@@ -100,7 +142,10 @@ void Factory::addAvailableOperation(int index, QUuid& id)
 void Factory::addOperation(QUuid id, ImageOperation* operation, QPointF position)
 {
     mOperations.append(operation);
+    mOperationIds.insert(operation, id);
+    indexNumbers(operation);
     emit newOperationCreated(id, operation);
+    watch(operation);
 
     OperationWidget* widget = new OperationWidget(id, operation, mMidiEnabled, false, this);
     emit newOpWidgetCreated(widget);
@@ -122,10 +167,19 @@ void Factory::addSeed(QUuid id, Seed* seed)
 
 ImageOperation* Factory::createReplaceOp(QUuid id, ImageOperation* oldOperation, int index)
 {
-    ImageOperation* operation = new ImageOperation(*mAvailOps[index], *oldOperation);
+    ImageOperation* availOp = availableOperation(index);
+
+    if (!availOp) {
+        return nullptr;
+    }
+
+    ImageOperation* operation = new ImageOperation(*availOp, *oldOperation);
     mOperations.append(operation);
+    mOperationIds.insert(operation, id);
+    indexNumbers(operation);
 
     emit replaceOpCreated(id, operation);
+    watch(operation);
 
     return operation;
 }
@@ -134,7 +188,11 @@ ImageOperation* Factory::createReplaceOp(QUuid id, ImageOperation* oldOperation,
 
 void Factory::deleteOperation(ImageOperation* operation)
 {
+    discardReload(operation);
+
     mOperations.removeOne(operation);
+    mOperationIds.remove(operation);
+    mNumberOwnersValid = false;
     delete operation;
 }
 
@@ -152,8 +210,8 @@ QList<QString> Factory::availableOperationNames()
 {
     QList<QString> opNames;
 
-    foreach (ImageOperation* operation, mAvailOps) {
-        opNames.append(operation->name());
+    foreach (const CatalogueEntry& entry, mCatalogue.entries()) {
+        opNames.append(entry.name);
     }
 
     return opNames;
@@ -161,13 +219,107 @@ QList<QString> Factory::availableOperationNames()
 
 
 
+// Operation files are parsed on first use, and again only if their contents change
+
 ImageOperation* Factory::availableOperation(int index)
 {
-    if (index >= 0 && index < mAvailOps.size()) {
-        return mAvailOps[index];
+    if (index < 0 || index >= mCatalogue.entries().size()) {
+        return nullptr;
+    }
+
+    const CatalogueEntry& entry = mCatalogue.entries().at(index);
+
+    if (mAvailOps.contains(entry.hash)) {
+        return mAvailOps.value(entry.hash);
+    }
+
+    ImageOperation* operation = new ImageOperation();
+
+    QString path = mCatalogue.filePath(index);
+
+    // An up to date bundle skips XML parsing, and the GLSL front end if it holds SPIR-V
+
+    bool read = false;
+
+    if (OperationBundle::upToDate(path))
+    {
+        OperationBundle bundle;
+        read = bundle.read(operation, OperationBundle::bundlePath(path));
+
+        if (read) {
+            operation->setSourceFile(path);
+        }
+    }
+
+    if (!read)
+    {
+        OperationParser opParser;
+        read = opParser.read(operation, path, false);
+    }
+
+    if (!read)
+    {
+        delete operation;
+        return nullptr;
+    }
+
+    mAvailOps.insert(entry.hash, operation);
+
+    return operation;
+}
+
+
+
+// Copied operations keep the ids of their numbers: the first operation holding an id wins, as a linear scan would
+
+ImageOperation* Factory::numberOwner(QUuid id, bool reindex)
+{
+    if (reindex || !mNumberOwnersValid) {
+        reindexNumbers();
     }
 
-    return nullptr;
+    return mNumberOwners.value(id, nullptr);
+}
+
+
+
+void Factory::indexNumbers(ImageOperation* operation)
+{
+    if (!mNumberOwnersValid) {
+        return;
+    }
+
+    foreach (auto parameter, operation->uniformParameters<float>())
+        foreach (Number<float>* number, parameter->numbers())
+            if (!mNumberOwners.contains(number->id()))
+                mNumberOwners.insert(number->id(), operation);
+
+    foreach (auto parameter, operation->mat4UniformParameters())
+        foreach (Number<float>* number, parameter->numbers())
+            if (!mNumberOwners.contains(number->id()))
+                mNumberOwners.insert(number->id(), operation);
+
+    foreach (auto parameter, operation->uniformParameters<int>())
+        foreach (Number<int>* number, parameter->numbers())
+            if (!mNumberOwners.contains(number->id()))
+                mNumberOwners.insert(number->id(), operation);
+
+    foreach (auto parameter, operation->uniformParameters<unsigned int>())
+        foreach (Number<unsigned int>* number, parameter->numbers())
+            if (!mNumberOwners.contains(number->id()))
+                mNumberOwners.insert(number->id(), operation);
+}
+
+
+
+void Factory::reindexNumbers()
+{
+    mNumberOwners.clear();
+    mNumberOwnersValid = true;
+
+    foreach (ImageOperation* operation, mOperations) {
+        indexNumbers(operation);
+    }
 }
 
 
@@ -175,17 +327,16 @@ ImageOperation* Factory::availableOperation(int index)
 template<>
 Number<float>* Factory::number(QUuid id)
 {
-    Number<float>* number = nullptr;
+    ImageOperation* operation = numberOwner(id, false);
+    Number<float>* number = operation ? operation->number<float>(id) : nullptr;
 
-    foreach (ImageOperation* operation, mOperations)
-    {
+    // Parameters may have been edited since indexing: reindex once on a miss
+
+    if (!number && (operation = numberOwner(id, true))) {
         number = operation->number<float>(id);
-        if (number) {
-            return number;
-        }
     }
 
-    return nullptr;
+    return number;
 }
 
 
@@ -193,17 +344,16 @@ Number<float>* Factory::number(QUuid id)
 template<>
 Number<int>* Factory::number(QUuid id)
 {
-    Number<int>* number = nullptr;
+    ImageOperation* operation = numberOwner(id, false);
+    Number<int>* number = operation ? operation->number<int>(id) : nullptr;
 
-    foreach (ImageOperation* operation, mOperations)
-    {
+    // Parameters may have been edited since indexing: reindex once on a miss
+
+    if (!number && (operation = numberOwner(id, true))) {
         number = operation->number<int>(id);
-        if (number) {
-            return number;
-        }
     }
 
-    return nullptr;
+    return number;
 }
 
 
@@ -211,46 +361,252 @@ Number<int>* Factory::number(QUuid id)
 template<>
 Number<unsigned int>* Factory::number(QUuid id)
 {
-    Number<unsigned int>* number = nullptr;
+    ImageOperation* operation = numberOwner(id, false);
+    Number<unsigned int>* number = operation ? operation->number<unsigned int>(id) : nullptr;
 
-    foreach (ImageOperation* operation, mOperations)
-    {
+    // Parameters may have been edited since indexing: reindex once on a miss
+
+    if (!number && (operation = numberOwner(id, true))) {
         number = operation->number<unsigned int>(id);
-        if (number) {
-            return number;
-        }
     }
 
-    return nullptr;
+    return number;
 }
 
 
 
 void Factory::scan()
 {
-    QDir opsDir = QDir(QDir::currentPath() + "/operations");
+    bool changed = mCatalogue.scan();
+
+    // Watch the directory for new files and every listed file for edits
+
+    QStringList paths;
+
+    if (QDir(mCatalogue.directory()).exists()) {
+        paths.append(mCatalogue.directory());
+    }
+
+    for (int i = 0; i < mCatalogue.entries().size(); i++) {
+        paths.append(mCatalogue.filePath(i));
+    }
+
+    QStringList watched = mWatcher.files() + mWatcher.directories();
+
+    foreach (QString path, paths) {
+        if (!watched.contains(path)) {
+            mWatcher.addPath(path);
+        }
+    }
 
-    if (opsDir.exists())
+    if (!changed) {
+        return;
+    }
+
+    // Drop parsed operations whose files changed or were removed
+
+    QSet<QByteArray> hashes;
+
+    foreach (const CatalogueEntry& entry, mCatalogue.entries()) {
+        hashes.insert(entry.hash);
+    }
+
+    for (auto it = mAvailOps.begin(); it != mAvailOps.end();)
     {
-        QStringList filters;
-        filters << "*.op";
+        if (!hashes.contains(it.key()))
+        {
+            delete it.value();
+            it = mAvailOps.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
 
-        QStringList fileNames = opsDir.entryList(filters, QDir::Files | QDir::NoSymLinks, QDir::Name);
 
-        qDeleteAll(mAvailOps);
-        mAvailOps.clear();
 
-        OperationParser opParser;
+void Factory::watch(ImageOperation* operation)
+{
+    QStringList watched = mWatcher.files();
+
+    QStringList paths({ operation->sourceFile(), operation->vertexShaderFile(), operation->fragmentShaderFile() });
+    paths.append(operation->includedFiles());
+
+    foreach (QString path, paths) {
+        if (!path.isEmpty() && !watched.contains(path) && QFile::exists(path)) {
+            mWatcher.addPath(path);
+        }
+    }
+}
+
+
+
+void Factory::scheduleReload(QString path)
+{
+    mChangedPaths.insert(path);
+    mReloadTimer.start();
+}
+
+
 
-        foreach (QString path, fileNames)
+void Factory::reload()
+{
+    QSet<QString> paths = mChangedPaths;
+    mChangedPaths.clear();
+
+    // Parsed operations reading a changed shader file: their own file did not change, so the catalogue keeps them
+
+    for (auto it = mAvailOps.begin(); it != mAvailOps.end();)
+    {
+        if (paths.contains(it.value()->vertexShaderFile()) || paths.contains(it.value()->fragmentShaderFile()))
         {
-            QString filePath = opsDir.absoluteFilePath(path);
+            delete it.value();
+            it = mAvailOps.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    scan();
+
+    // Running operations are rebuilt from their reparsed files, so that added or removed uniforms show up, and keep their values by uniform name
+    // The rebuilt instances link in the background and replace the running ones between two iterations
+    // Files replaced on save drop out of the watcher: watched again once reread
 
-            ImageOperation* operation = new ImageOperation();
+    QHash<QString, ImageOperation*> reloaded;
 
-            if (opParser.read(operation, filePath, false)) {
-                mAvailOps.append(operation);
+    OperationParser opParser;
+
+    foreach (ImageOperation* operation, mOperations)
+    {
+        QString source = operation->sourceFile();
+
+        // Only an included file changed: expanded again when relinking
+
+        if (!(paths.contains(source) || paths.contains(operation->vertexShaderFile()) || paths.contains(operation->fragmentShaderFile())))
+        {
+            bool included = false;
+            foreach (QString path, operation->includedFiles()) {
+                included |= paths.contains(path);
             }
+
+            if (included)
+            {
+                if (!operation->linkShaders(true)) {
+                    emit shaderError(operation->name(), operation->linkLog());
+                }
+                watch(operation);
+            }
+
+            continue;
+        }
+
+        if (source.isEmpty()) {
+            continue;
+        }
+
+        if (!reloaded.contains(source))
+        {
+            ImageOperation* newOperation = new ImageOperation();
+
+            if (!opParser.read(newOperation, source, false))
+            {
+                delete newOperation;
+                newOperation = nullptr;
+            }
+
+            reloaded.insert(source, newOperation);
+        }
+
+        if (ImageOperation* prototype = reloaded.value(source))
+        {
+            // A rebuild still linking is superseded
+
+            discardReload(operation);
+
+            PendingReload pending;
+            pending.oldOperation = operation;
+            pending.operation = new ImageOperation(*prototype, *operation);
+            pending.clock.start();
+
+            mPendingReloads.append(pending);
+
+            emit reloadOpCreated(pending.operation);
+        }
+
+        watch(operation);
+    }
+
+    qDeleteAll(reloaded);
+
+    if (!mPendingReloads.isEmpty()) {
+        mSwapTimer.start();
+    }
+}
+
+
+
+// Swap once the new program is linked, or failed, or after a while, in which case the operation passes its input through until ready
+// Values edited meanwhile are taken again
+
+void Factory::swapReloaded()
+{
+    QList<PendingReload> ready;
+
+    for (auto it = mPendingReloads.begin(); it != mPendingReloads.end();)
+    {
+        if (it->operation->programLinking() && !it->clock.hasExpired(5000))
+        {
+            it++;
+        }
+        else
+        {
+            ready.append(*it);
+            it = mPendingReloads.erase(it);
+        }
+    }
+
+    foreach (const PendingReload& pending, ready)
+    {
+        QUuid id = mOperationIds.value(pending.oldOperation);
+
+        pending.operation->takeValues(*pending.oldOperation);
+        pending.operation->enable(pending.oldOperation->enabled());
+
+        mOperations.append(pending.operation);
+        mOperationIds.insert(pending.operation, id);
+        indexNumbers(pending.operation);
+
+        emit replaceOpCreated(id, pending.operation);
+        emit operationReloaded(pending.oldOperation, pending.operation);
+        watch(pending.operation);
+
+        deleteOperation(pending.oldOperation);
+    }
+
+    if (mPendingReloads.isEmpty()) {
+        mSwapTimer.stop();
+    }
+}
+
+
+
+void Factory::discardReload(ImageOperation* oldOperation)
+{
+    for (auto it = mPendingReloads.begin(); it != mPendingReloads.end();)
+    {
+        if (it->oldOperation == oldOperation)
+        {
+            delete it->operation;
+            it = mPendingReloads.erase(it);
+        }
+        else
+        {
+            it++;
         }
     }
 }
@@ -261,8 +617,18 @@ void Factory::clear()
 {
     emit cleared();
 
+    foreach (const PendingReload& pending, mPendingReloads) {
+        delete pending.operation;
+    }
+    mPendingReloads.clear();
+    mSwapTimer.stop();
+
     qDeleteAll(mOperations);
     mOperations.clear();
+    mOperationIds.clear();
+
+    mNumberOwners.clear();
+    mNumberOwnersValid = true;
 
     qDeleteAll(mSeeds);
     mSeeds.clear();
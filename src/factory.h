@@ -9,12 +9,29 @@
 #include "seedwidget.h"
 #include "parameters/number.h"
 #include "videoinputcontrol.h"
+#include "operationcatalogue.h"
 
 #include <QObject>
 #include <QUuid>
 #include <QList>
+#include <QHash>
 #include <QString>
 #include <QPointF>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSet>
+
+
+
+// Running operation rebuilt from its reparsed file, swapped in once its program is linked
+
+struct PendingReload
+{
+    ImageOperation* oldOperation = nullptr;
+    ImageOperation* operation = nullptr;
+    QElapsedTimer clock;
+};
 
 
 
@@ -26,14 +43,15 @@ public:
     explicit Factory(VideoInputControl* videoInCtrl, QObject *parent = nullptr);
     ~Factory();
 
-    QList<ImageOperation*> operations();
-    QList<Seed*> seeds();
+    const QList<ImageOperation*>& operations() const;
+    const QList<Seed*>& seeds() const;
+    QList<ImageOperation*> reloadingOperations() const;
 
     void createNewOperation();
     void createNewSeed();
 
-    void addAvailableOperation(int index);
-    void addAvailableOperation(int index, QUuid& id);
+    bool addAvailableOperation(int index);
+    bool addAvailableOperation(int index, QUuid& id);
 
     void addOperation(QUuid id, ImageOperation* operation, QPointF position);
     void addSeed(QUuid id, Seed* operation);
@@ -63,19 +81,51 @@ signals:
 
     void replaceOpCreated(QUuid id, ImageOperation* operation);
 
+    void reloadOpCreated(ImageOperation* operation);
+    void operationReloaded(ImageOperation* oldOperation, ImageOperation* operation);
+
     void cleared();
 
+    void shaderError(QString name, QString log);
+
 public slots:
     void setMidiEnabled(bool enabled);
 
+private slots:
+    void scheduleReload(QString path);
+    void reload();
+    void swapReloaded();
+
 private:
-    QList<ImageOperation*> mAvailOps;
+    OperationCatalogue mCatalogue;
+    QHash<QByteArray, ImageOperation*> mAvailOps;
     QList<ImageOperation*> mOperations;
+    QHash<ImageOperation*, QUuid> mOperationIds;
     QList<Seed*> mSeeds;
 
     bool mMidiEnabled = false;
 
     VideoInputControl* mVideoInputControl;
+
+    QHash<QUuid, ImageOperation*> mNumberOwners;
+    bool mNumberOwnersValid = true;
+
+    // Hot reload: operation and shader files of the catalogue and of running operations
+
+    QFileSystemWatcher mWatcher;
+    QTimer mReloadTimer;
+    QSet<QString> mChangedPaths;
+
+    QList<PendingReload> mPendingReloads;
+    QTimer mSwapTimer;
+
+    void discardReload(ImageOperation* oldOperation);
+
+    void watch(ImageOperation* operation);
+
+    ImageOperation* numberOwner(QUuid id, bool reindex);
+    void indexNumbers(ImageOperation* operation);
+    void reindexNumbers();
 };
 
 
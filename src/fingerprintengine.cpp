@@ -0,0 +1,254 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "fingerprintengine.h"
+
+#include <QDebug>
+#include <bit>
+#include <cstring>
+
+
+
+int FrameFingerprint::distance(const FrameFingerprint& other) const
+{
+    // Hamming distance between hashes
+
+    int bits = 0;
+
+    for (size_t i = 0; i < hash.size(); i++) {
+        bits += std::popcount(hash[i] ^ other.hash[i]);
+    }
+
+    return bits;
+}
+
+
+
+FingerprintEngine::FingerprintEngine(QObject* parent)
+    : QObject { parent }
+{}
+
+
+
+void FingerprintEngine::init()
+{
+    // Expects current context
+
+    initializeOpenGLFunctions();
+
+    mCellsProgram = new QOpenGLShaderProgram();
+    if (!mCellsProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/fingerprint.comp"))
+        qDebug() << "Compute shader error:\n" << mCellsProgram->log();
+    if (!mCellsProgram->link())
+        qDebug() << "Shader link error:\n" << mCellsProgram->log();
+
+    mFinalProgram = new QOpenGLShaderProgram();
+    if (!mFinalProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/fingerprint-final.comp"))
+        qDebug() << "Compute shader error:\n" << mFinalProgram->log();
+    if (!mFinalProgram->link())
+        qDebug() << "Shader link error:\n" << mFinalProgram->log();
+
+    // Current and previous grids of cells
+
+    glCreateBuffers(1, &mCellsBuffer);
+    glNamedBufferStorage(mCellsBuffer, 2 * mGridSize * mGridSize * 4 * sizeof(GLfloat), nullptr, 0);
+
+    glCreateBuffers(1, &mCellHashesBuffer);
+    glNamedBufferStorage(mCellHashesBuffer, mGridSize * mGridSize * sizeof(GLuint), nullptr, 0);
+
+    glCreateBuffers(1, &mFingerprintBuffer);
+    glNamedBufferStorage(mFingerprintBuffer, mFingerprintSize, nullptr, 0);
+
+    mReadBuffers.resize(mRingSize, 0);
+    mFences.resize(mRingSize, 0);
+    mReadIterations.resize(mRingSize, 0);
+    mReadValid.resize(mRingSize, false);
+
+    glCreateBuffers(mRingSize, mReadBuffers.data());
+
+    foreach (GLuint buffer, mReadBuffers) {
+        glNamedBufferStorage(buffer, mFingerprintSize, nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+
+    mInitialized = true;
+}
+
+
+
+void FingerprintEngine::cleanup()
+{
+    // Expects current context
+
+    if (!mInitialized) {
+        return;
+    }
+
+    delete mCellsProgram;
+    delete mFinalProgram;
+
+    foreach (GLsync fence, mFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    glDeleteBuffers(1, &mCellsBuffer);
+    glDeleteBuffers(1, &mCellHashesBuffer);
+    glDeleteBuffers(1, &mFingerprintBuffer);
+    glDeleteBuffers(mRingSize, mReadBuffers.data());
+
+    mInitialized = false;
+}
+
+
+
+bool FingerprintEngine::enabled() const
+{
+    return mEnabled;
+}
+
+
+
+void FingerprintEngine::setEnabled(bool set)
+{
+    mEnabled = set;
+    mPreviousValid = false;
+}
+
+
+
+void FingerprintEngine::compute(GLuint* pOutputTexId, unsigned int iteration)
+{
+    // Expects current context
+
+    if (!mInitialized || !mEnabled || !mCellsProgram->isLinked() || !mFinalProgram->isLinked()) {
+        return;
+    }
+
+    readFingerprint();
+
+    if (!pOutputTexId || !*pOutputTexId) {
+        return;
+    }
+
+    // Downsample into the current grid, the other one holds the previous frame
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mCellsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mFingerprintBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mCellHashesBuffer);
+
+    mCellsProgram->bind();
+    mCellsProgram->setUniformValue("inTex", 0);
+    mCellsProgram->setUniformValue("current", mCurrent);
+
+    glBindTextureUnit(0, *pOutputTexId);
+
+    glDispatchCompute(mGridSize, mGridSize, 1);
+
+    glBindTextureUnit(0, 0);
+
+    mCellsProgram->release();
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Hash and delta
+
+    mFinalProgram->bind();
+    mFinalProgram->setUniformValue("current", mCurrent);
+
+    glDispatchCompute(1, 1, 1);
+
+    mFinalProgram->release();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, 0);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // Asynchronous readback, unless the ring is full
+
+    if (!mFences[mSubmitIndex])
+    {
+        glCopyNamedBufferSubData(mFingerprintBuffer, mReadBuffers[mSubmitIndex], 0, 0, mFingerprintSize);
+
+        mFences[mSubmitIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mReadIterations[mSubmitIndex] = iteration;
+        mReadValid[mSubmitIndex] = mPreviousValid;
+
+        mSubmitIndex = (mSubmitIndex + 1) % mRingSize;
+    }
+
+    mCurrent = 1 - mCurrent;
+    mPreviousValid = true;
+}
+
+
+
+void FingerprintEngine::readFingerprint()
+{
+    // Every readback whose fence has signaled, in order, never waiting on the GPU
+
+    for (int i = 0; i < mRingSize; i++)
+    {
+        int index = (mSubmitIndex + i) % mRingSize;
+
+        if (!mFences[index]) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(mFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(mFences[index]);
+        mFences[index] = 0;
+
+        GLuint data[mFingerprintSize / sizeof(GLuint)];
+        glGetNamedBufferSubData(mReadBuffers[index], 0, mFingerprintSize, data);
+
+        FrameFingerprint fingerprint;
+
+        for (size_t j = 0; j < fingerprint.hash.size(); j++) {
+            fingerprint.hash[j] = data[j];
+        }
+
+        memcpy(&fingerprint.delta, &data[8], sizeof(float));
+        memcpy(&fingerprint.luma, &data[9], sizeof(float));
+
+        fingerprint.contentHash = data[10];
+        fingerprint.contentChanged = data[11] != 0;
+
+        if (!mReadValid[index])
+        {
+            fingerprint.delta = -1.0f;
+            fingerprint.contentChanged = true;
+        }
+
+        emit fingerprintReady(mReadIterations[index], fingerprint);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef FINGERPRINTENGINE_H
+#define FINGERPRINTENGINE_H
+
+
+
+#include <QObject>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QList>
+#include <array>
+
+
+
+// Fingerprint of a frame: 256 bit perceptual hash of a 16 x 16 luminance grid,
+// root mean square difference to the previous frame (negative if there is none), mean luminance,
+// and whether any pixel changed since the previous frame, from a hash of the full resolution frame
+
+struct FrameFingerprint
+{
+    std::array<quint32, 8> hash {};
+    float delta = -1.0f;
+    float luma = 0.0f;
+    quint32 contentHash = 0;
+    bool contentChanged = true;
+
+    int distance(const FrameFingerprint& other) const;
+};
+
+
+
+// FingerprintEngine: computes the fingerprint of the output on the GPU every iteration
+// and reads it back asynchronously
+
+class FingerprintEngine : public QObject, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    explicit FingerprintEngine(QObject* parent = nullptr);
+
+    void init();
+    void cleanup();
+
+    bool enabled() const;
+    void setEnabled(bool set);
+
+    void compute(GLuint* pOutputTexId, unsigned int iteration);
+
+signals:
+    void fingerprintReady(unsigned int iteration, FrameFingerprint fingerprint);
+
+private:
+    bool mInitialized = false;
+    bool mEnabled = false;
+
+    QOpenGLShaderProgram* mCellsProgram = nullptr;
+    QOpenGLShaderProgram* mFinalProgram = nullptr;
+
+    static const int mGridSize = 32;
+    static const int mFingerprintSize = 12 * sizeof(GLuint);
+
+    GLuint mCellsBuffer = 0;
+    GLuint mCellHashesBuffer = 0;
+    GLuint mFingerprintBuffer = 0;
+    int mCurrent = 0;
+    bool mPreviousValid = false;
+
+    const int mRingSize = 3;
+    QList<GLuint> mReadBuffers;
+    QList<GLsync> mFences;
+    QList<unsigned int> mReadIterations;
+    QList<bool> mReadValid;
+    int mSubmitIndex = 0;
+
+    void readFingerprint();
+};
+
+
+
+#endif // FINGERPRINTENGINE_H
@@ -0,0 +1,349 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "formula.h"
+
+#include <cmath>
+
+
+
+Formula::Formula(QString expression) :
+    mExpression { expression }
+{
+    parseSum();
+
+    skipSpaces();
+
+    if (mError.isEmpty() && mPos < mExpression.size())
+        mError = QString("Unexpected '%1' at position %2").arg(mExpression.at(mPos)).arg(mPos + 1);
+
+    if (mError.isEmpty() && mProgram.isEmpty())
+        mError = "Empty expression";
+}
+
+
+
+double Formula::evaluate(int i, int n) const
+{
+    if (!mError.isEmpty())
+        return 0.0;
+
+    QList<double> stack;
+    stack.reserve(mProgram.size());
+
+    foreach (Op op, mProgram)
+    {
+        switch (op.code)
+        {
+        case OpCode::Constant:
+            stack.append(op.value);
+            break;
+        case OpCode::Index:
+            stack.append(i);
+            break;
+        case OpCode::Count:
+            stack.append(n);
+            break;
+        case OpCode::Coord:
+            stack.append(n > 1 ? static_cast<double>(i) / (n - 1) : 0.0);
+            break;
+        case OpCode::Neg:
+            stack.last() = -stack.last();
+            break;
+        case OpCode::Sin:
+            stack.last() = sin(stack.last());
+            break;
+        case OpCode::Cos:
+            stack.last() = cos(stack.last());
+            break;
+        case OpCode::Tan:
+            stack.last() = tan(stack.last());
+            break;
+        case OpCode::Abs:
+            stack.last() = fabs(stack.last());
+            break;
+        case OpCode::Sqrt:
+            stack.last() = sqrt(stack.last());
+            break;
+        case OpCode::Exp:
+            stack.last() = exp(stack.last());
+            break;
+        case OpCode::Log:
+            stack.last() = log(stack.last());
+            break;
+        case OpCode::Floor:
+            stack.last() = floor(stack.last());
+            break;
+        case OpCode::Fract:
+            stack.last() = stack.last() - floor(stack.last());
+            break;
+        case OpCode::Mix:
+        {
+            double t = stack.takeLast();
+            double b = stack.takeLast();
+            stack.last() = stack.last() * (1.0 - t) + b * t;
+            break;
+        }
+        default:
+        {
+            double b = stack.takeLast();
+            double& a = stack.last();
+
+            if (op.code == OpCode::Add)
+                a = a + b;
+            else if (op.code == OpCode::Sub)
+                a = a - b;
+            else if (op.code == OpCode::Mul)
+                a = a * b;
+            else if (op.code == OpCode::Div)
+                a = a / b;
+            else if (op.code == OpCode::Pow)
+                a = pow(a, b);
+            else if (op.code == OpCode::Min)
+                a = fmin(a, b);
+            else if (op.code == OpCode::Max)
+                a = fmax(a, b);
+            break;
+        }
+        }
+    }
+
+    return stack.isEmpty() ? 0.0 : stack.last();
+}
+
+
+
+void Formula::skipSpaces()
+{
+    while (mPos < mExpression.size() && mExpression.at(mPos).isSpace())
+        mPos++;
+}
+
+
+
+bool Formula::accept(QChar c)
+{
+    skipSpaces();
+
+    if (mPos < mExpression.size() && mExpression.at(mPos) == c)
+    {
+        mPos++;
+        return true;
+    }
+
+    return false;
+}
+
+
+
+void Formula::parseSum()
+{
+    parseProduct();
+
+    while (mError.isEmpty())
+    {
+        if (accept('+'))
+        {
+            parseProduct();
+            mProgram.append({ OpCode::Add });
+        }
+        else if (accept('-'))
+        {
+            parseProduct();
+            mProgram.append({ OpCode::Sub });
+        }
+        else
+            break;
+    }
+}
+
+
+
+void Formula::parseProduct()
+{
+    parseUnary();
+
+    while (mError.isEmpty())
+    {
+        if (accept('*'))
+        {
+            parseUnary();
+            mProgram.append({ OpCode::Mul });
+        }
+        else if (accept('/'))
+        {
+            parseUnary();
+            mProgram.append({ OpCode::Div });
+        }
+        else
+            break;
+    }
+}
+
+
+
+void Formula::parseUnary()
+{
+    if (accept('-'))
+    {
+        parseUnary();
+        mProgram.append({ OpCode::Neg });
+    }
+    else if (accept('+'))
+        parseUnary();
+    else
+        parsePower();
+}
+
+
+
+void Formula::parsePower()
+{
+    parsePrimary();
+
+    // Right associative, binds tighter than unary minus on its left: -x^2 == -(x^2)
+
+    if (mError.isEmpty() && accept('^'))
+    {
+        parseUnary();
+        mProgram.append({ OpCode::Pow });
+    }
+}
+
+
+
+void Formula::parsePrimary()
+{
+    if (!mError.isEmpty())
+        return;
+
+    skipSpaces();
+
+    if (mPos >= mExpression.size())
+    {
+        mError = "Unexpected end of expression";
+        return;
+    }
+
+    QChar c = mExpression.at(mPos);
+
+    if (accept('('))
+    {
+        parseSum();
+
+        if (mError.isEmpty() && !accept(')'))
+            mError = QString("Missing ')' at position %1").arg(mPos + 1);
+    }
+    else if (c.isDigit() || c == '.')
+    {
+        int start = mPos;
+
+        while (mPos < mExpression.size() && (mExpression.at(mPos).isDigit() || mExpression.at(mPos) == '.'))
+            mPos++;
+
+        if (mPos < mExpression.size() && (mExpression.at(mPos) == 'e' || mExpression.at(mPos) == 'E'))
+        {
+            int mark = mPos++;
+
+            if (mPos < mExpression.size() && (mExpression.at(mPos) == '+' || mExpression.at(mPos) == '-'))
+                mPos++;
+
+            if (mPos < mExpression.size() && mExpression.at(mPos).isDigit())
+            {
+                while (mPos < mExpression.size() && mExpression.at(mPos).isDigit())
+                    mPos++;
+            }
+            else
+                mPos = mark;
+        }
+
+        bool ok;
+        double value = mExpression.mid(start, mPos - start).toDouble(&ok);
+
+        if (ok)
+            mProgram.append({ OpCode::Constant, value });
+        else
+            mError = QString("Invalid number at position %1").arg(start + 1);
+    }
+    else if (c.isLetter())
+    {
+        int start = mPos;
+
+        while (mPos < mExpression.size() && mExpression.at(mPos).isLetterOrNumber())
+            mPos++;
+
+        QString name = mExpression.mid(start, mPos - start);
+
+        if (name == "i")
+            mProgram.append({ OpCode::Index });
+        else if (name == "n")
+            mProgram.append({ OpCode::Count });
+        else if (name == "x")
+            mProgram.append({ OpCode::Coord });
+        else if (name == "pi")
+            mProgram.append({ OpCode::Constant, M_PI });
+        else if (name == "sin") { parseArguments(1); mProgram.append({ OpCode::Sin }); }
+        else if (name == "cos") { parseArguments(1); mProgram.append({ OpCode::Cos }); }
+        else if (name == "tan") { parseArguments(1); mProgram.append({ OpCode::Tan }); }
+        else if (name == "abs") { parseArguments(1); mProgram.append({ OpCode::Abs }); }
+        else if (name == "sqrt") { parseArguments(1); mProgram.append({ OpCode::Sqrt }); }
+        else if (name == "exp") { parseArguments(1); mProgram.append({ OpCode::Exp }); }
+        else if (name == "log") { parseArguments(1); mProgram.append({ OpCode::Log }); }
+        else if (name == "floor") { parseArguments(1); mProgram.append({ OpCode::Floor }); }
+        else if (name == "fract") { parseArguments(1); mProgram.append({ OpCode::Fract }); }
+        else if (name == "min") { parseArguments(2); mProgram.append({ OpCode::Min }); }
+        else if (name == "max") { parseArguments(2); mProgram.append({ OpCode::Max }); }
+        else if (name == "mix") { parseArguments(3); mProgram.append({ OpCode::Mix }); }
+        else
+            mError = QString("Unknown name '%1' at position %2").arg(name).arg(start + 1);
+    }
+    else
+        mError = QString("Unexpected '%1' at position %2").arg(c).arg(mPos + 1);
+}
+
+
+
+void Formula::parseArguments(int count)
+{
+    if (!accept('('))
+    {
+        mError = QString("Expected '(' at position %1").arg(mPos + 1);
+        return;
+    }
+
+    for (int k = 0; k < count && mError.isEmpty(); k++)
+    {
+        if (k > 0 && !accept(','))
+        {
+            mError = QString("Expected ',' at position %1").arg(mPos + 1);
+            return;
+        }
+
+        parseSum();
+    }
+
+    if (mError.isEmpty() && !accept(')'))
+        mError = QString("Expected ')' at position %1").arg(mPos + 1);
+}
@@ -0,0 +1,83 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef FORMULA_H
+#define FORMULA_H
+
+
+
+#include <QString>
+#include <QList>
+
+
+
+// Formula: small arithmetic expression compiled once to postfix and evaluated per element
+// Variables: i (element index), n (element count), x (i / (n - 1)), pi
+// Operators: + - * / ^ and parentheses
+// Functions: sin cos tan abs sqrt exp log floor fract min max mix
+
+class Formula
+{
+public:
+    explicit Formula(QString expression);
+
+    bool isValid() const { return mError.isEmpty(); }
+    QString error() const { return mError; }
+
+    double evaluate(int i, int n) const;
+
+private:
+    enum class OpCode
+    {
+        Constant, Index, Count, Coord,
+        Add, Sub, Mul, Div, Pow, Neg,
+        Sin, Cos, Tan, Abs, Sqrt, Exp, Log, Floor, Fract, Min, Max, Mix
+    };
+
+    struct Op
+    {
+        OpCode code;
+        double value = 0.0;
+    };
+
+    QString mExpression;
+    int mPos = 0;
+    QList<Op> mProgram;
+    QString mError;
+
+    void skipSpaces();
+    bool accept(QChar c);
+
+    void parseSum();
+    void parseProduct();
+    void parseUnary();
+    void parsePower();
+    void parsePrimary();
+    void parseArguments(int count);
+};
+
+
+
+#endif // FORMULA_H
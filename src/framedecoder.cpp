@@ -0,0 +1,567 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "framedecoder.h"
+
+#include <QFileInfo>
+#include <QDir>
+#include <QImageReader>
+#include <QMediaMetaData>
+#include <QRegularExpression>
+#include <QUrl>
+
+
+
+FrameDecoder::FrameDecoder(QObject* parent)
+    : QObject { parent }
+{
+    mRing.resize(mRingSize);
+}
+
+
+
+FrameDecoder::~FrameDecoder()
+{
+    stop();
+
+    delete mSurface;
+}
+
+
+
+void FrameDecoder::init(QOpenGLContext* shareContext, QString filename, GLuint width, GLuint height)
+{
+    mFilename = filename;
+    mTargetWidth = width;
+    mTargetHeight = height;
+
+    // Create context sharing objects with the render context, to be used only from the decoder thread
+
+    mContext = new QOpenGLContext();
+    mContext->setFormat(shareContext->format());
+    mContext->setShareContext(shareContext);
+    mContext->create();
+
+    mSurface = new QOffscreenSurface();
+    mSurface->setFormat(shareContext->format());
+    mSurface->create();
+
+    mContext->moveToThread(&mThread);
+    moveToThread(&mThread);
+
+    mThread.start();
+
+    QMetaObject::invokeMethod(this, &FrameDecoder::open, Qt::QueuedConnection);
+}
+
+
+
+void FrameDecoder::stop()
+{
+    if (mThread.isRunning())
+    {
+        QMetaObject::invokeMethod(this, &FrameDecoder::cleanup, Qt::BlockingQueuedConnection);
+
+        mThread.quit();
+        mThread.wait();
+    }
+}
+
+
+
+bool FrameDecoder::isVideoFile(QString filename)
+{
+    QStringList suffixes = { "mp4", "m4v", "mov", "avi", "mkv", "webm", "mpg", "mpeg", "ogv" };
+    return suffixes.contains(QFileInfo(filename).suffix().toLower());
+}
+
+
+
+QStringList FrameDecoder::sequenceFiles(QString filename)
+{
+    // Files in the same directory sharing prefix and suffix with the given one, sorted by frame number
+
+    QFileInfo fileInfo(filename);
+
+    QRegularExpression numbered("^(.*?)(\\d+)$");
+    QRegularExpressionMatch match = numbered.match(fileInfo.completeBaseName());
+
+    if (!match.hasMatch()) {
+        return QStringList { fileInfo.absoluteFilePath() };
+    }
+
+    QString prefix = match.captured(1);
+    QString suffix = fileInfo.suffix();
+
+    QRegularExpression member("^" + QRegularExpression::escape(prefix) + "(\\d+)\\." + QRegularExpression::escape(suffix) + "$");
+
+    QDir dir = fileInfo.absoluteDir();
+    QMap<qint64, QString> framesMap;
+
+    foreach (QString name, dir.entryList(QDir::Files | QDir::NoSymLinks))
+    {
+        QRegularExpressionMatch memberMatch = member.match(name);
+        if (memberMatch.hasMatch()) {
+            framesMap.insert(memberMatch.captured(1).toLongLong(), dir.absoluteFilePath(name));
+        }
+    }
+
+    return framesMap.values();
+}
+
+
+
+int FrameDecoder::frameCount()
+{
+    // Zero until the source has been opened, callers just try again on the next iteration
+
+    QMutexLocker locker(&mMutex);
+    return mFrameCount;
+}
+
+
+
+void FrameDecoder::setTargetSize(GLuint width, GLuint height)
+{
+    QMutexLocker locker(&mMutex);
+
+    mTargetWidth = width;
+    mTargetHeight = height;
+}
+
+
+
+bool FrameDecoder::acquireFrame(int index, GLuint& texId, GLuint& width, GLuint& height, GLsync& fence)
+{
+    // Called from the render thread, never blocks
+    // Moves the prefetch window and returns false if the frame has not been decoded yet
+
+    QMutexLocker locker(&mMutex);
+
+    mCurrentFrame = index;
+
+    QMetaObject::invokeMethod(this, &FrameDecoder::decodeNext, Qt::QueuedConnection);
+
+    foreach (const Slot& slot, mRing)
+    {
+        if (slot.index == index && slot.ready)
+        {
+            texId = slot.texId;
+            width = slot.width;
+            height = slot.height;
+            fence = slot.fence;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+void FrameDecoder::releaseFrame(int index, GLsync consumedFence)
+{
+    // The decoder waits on the consumed fence before overwriting the frame's texture
+
+    QMutexLocker locker(&mMutex);
+
+    for (Slot& slot : mRing)
+    {
+        if (slot.index == index && slot.ready)
+        {
+            if (slot.consumedFence) {
+                mRetiredFences.append(slot.consumedFence);
+            }
+
+            slot.consumedFence = consumedFence;
+
+            return;
+        }
+    }
+
+    mRetiredFences.append(consumedFence);
+}
+
+
+
+void FrameDecoder::open()
+{
+    mContext->makeCurrent(mSurface);
+    initializeOpenGLFunctions();
+    mContext->doneCurrent();
+
+    if (isVideoFile(mFilename))
+    {
+        mPlayer = new QMediaPlayer();
+        mVideoSink = new QVideoSink();
+
+        mPlayer->setVideoSink(mVideoSink);
+
+        // Gives up on a seek whose frame never shows up, so that decoding does not stall
+
+        mSeekTimer = new QTimer();
+        mSeekTimer->setSingleShot(true);
+        mSeekTimer->setInterval(1000);
+
+        connect(mSeekTimer, &QTimer::timeout, this, &FrameDecoder::seekTimeout);
+
+        connect(mVideoSink, &QVideoSink::videoFrameChanged, this, &FrameDecoder::setVideoFrame);
+        connect(mPlayer, &QMediaPlayer::mediaStatusChanged, this, &FrameDecoder::setMediaStatus);
+
+        mPlayer->setSource(QUrl::fromLocalFile(mFilename));
+    }
+    else
+    {
+        mSequenceFiles = sequenceFiles(mFilename);
+
+        mMutex.lock();
+        mFrameCount = mSequenceFiles.size();
+        mOpened = true;
+        mMutex.unlock();
+
+        decodeNext();
+    }
+}
+
+
+
+void FrameDecoder::setMediaStatus(QMediaPlayer::MediaStatus status)
+{
+    if (status == QMediaPlayer::LoadedMedia)
+    {
+        qreal frameRate = mPlayer->metaData().value(QMediaMetaData::VideoFrameRate).toReal();
+        if (frameRate > 0.0) {
+            mVideoFrameRate = frameRate;
+        }
+
+        mMutex.lock();
+        mFrameCount = qMax(1, static_cast<int>(mPlayer->duration() * mVideoFrameRate / 1000.0));
+        mOpened = true;
+        mMutex.unlock();
+
+        decodeNext();
+
+        // Paused player presents the frame at the current position
+
+        mPlayer->pause();
+    }
+    else if (status == QMediaPlayer::InvalidMedia)
+    {
+        mMutex.lock();
+        mFrameCount = 0;
+        mOpened = true;
+        mMutex.unlock();
+    }
+}
+
+
+
+int FrameDecoder::nextFrameToDecode(int& slotIndex)
+{
+    // Expects locked mutex
+
+    if (!mOpened || mFrameCount == 0) {
+        return -1;
+    }
+
+    auto inWindow = [&](int index) {
+        return (index - mCurrentFrame + mFrameCount) % mFrameCount < qMin(mRingSize, mFrameCount);
+    };
+
+    // Free slots holding frames that fell out of the prefetch window
+
+    for (Slot& slot : mRing)
+    {
+        if (slot.ready && !inWindow(slot.index))
+        {
+            slot.index = -1;
+            slot.ready = false;
+        }
+    }
+
+    // First frame in window neither decoded nor being decoded
+
+    for (int k = 0; k < qMin(mRingSize, mFrameCount); k++)
+    {
+        int index = (mCurrentFrame + k) % mFrameCount;
+
+        bool present = false;
+
+        foreach (const Slot& slot, mRing)
+        {
+            if (slot.index == index) {
+                present = true;
+                break;
+            }
+        }
+
+        if (!present)
+        {
+            for (int i = 0; i < mRing.size(); i++)
+            {
+                if (mRing[i].index == -1 && !mRing[i].decoding)
+                {
+                    slotIndex = i;
+                    return index;
+                }
+            }
+
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+
+
+void FrameDecoder::decodeNext()
+{
+    if (mAwaitedFrame >= 0) {
+        return;
+    }
+
+    mMutex.lock();
+
+    int slot = -1;
+    int index = nextFrameToDecode(slot);
+
+    if (index >= 0)
+    {
+        mRing[slot].index = index;
+        mRing[slot].ready = false;
+        mRing[slot].decoding = true;
+    }
+
+    QSize targetSize(mTargetWidth, mTargetHeight);
+
+    mMutex.unlock();
+
+    if (index < 0) {
+        return;
+    }
+
+    if (mPlayer)
+    {
+        // Frame arrives through the video sink
+
+        mAwaitedFrame = index;
+        mAwaitedSlot = slot;
+
+        mPlayer->setPosition(static_cast<qint64>(index * 1000.0 / mVideoFrameRate));
+
+        mSeekTimer->start();
+    }
+    else
+    {
+        // Let the image decoder produce frames at the size they will be rendered at
+
+        QImageReader reader(mSequenceFiles.at(index));
+
+        QSize size = reader.size();
+        if (size.isValid() && (size.width() > targetSize.width() || size.height() > targetSize.height())) {
+            reader.setScaledSize(size.scaled(targetSize, Qt::KeepAspectRatio));
+        }
+
+        uploadFrame(slot, reader.read());
+
+        QMetaObject::invokeMethod(this, &FrameDecoder::decodeNext, Qt::QueuedConnection);
+    }
+}
+
+
+
+void FrameDecoder::setVideoFrame(const QVideoFrame& frame)
+{
+    if (mAwaitedFrame < 0 || !frame.isValid()) {
+        return;
+    }
+
+    // Frames presented before the seek completes belong to the previous position,
+    // only the one whose timestamp maps to the awaited frame number is taken
+
+    qint64 time = frame.startTime() >= 0 ? frame.startTime() / 1000 : mPlayer->position();
+
+    if (qRound64(time * mVideoFrameRate / 1000.0) != mAwaitedFrame) {
+        return;
+    }
+
+    finishSeek(frame.toImage());
+}
+
+
+
+void FrameDecoder::seekTimeout()
+{
+    // Seek landed elsewhere (past the end, or on a frame with an unexpected timestamp):
+    // use whatever the sink presents now rather than waiting forever
+
+    if (mAwaitedFrame >= 0) {
+        finishSeek(mVideoSink->videoFrame().toImage());
+    }
+}
+
+
+
+void FrameDecoder::finishSeek(const QImage& image)
+{
+    int slot = mAwaitedSlot;
+
+    mAwaitedFrame = -1;
+    mAwaitedSlot = -1;
+
+    mSeekTimer->stop();
+
+    uploadFrame(slot, image);
+
+    decodeNext();
+}
+
+
+
+void FrameDecoder::uploadFrame(int slotIndex, const QImage& frameImage)
+{
+    QImage image = frameImage.isNull() ? QImage(1, 1, QImage::Format_RGBA8888) : frameImage.convertToFormat(QImage::Format_RGBA8888);
+
+    if (frameImage.isNull()) {
+        image.fill(Qt::black);
+    }
+
+    mMutex.lock();
+    Slot slot = mRing[slotIndex];
+    mRing[slotIndex].consumedFence = 0;
+    QList<GLsync> retiredFences = mRetiredFences;
+    mRetiredFences.clear();
+    mMutex.unlock();
+
+    mContext->makeCurrent(mSurface);
+
+    // Do not overwrite the texture before the render context is done reading it
+
+    if (slot.consumedFence)
+    {
+        glWaitSync(slot.consumedFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(slot.consumedFence);
+    }
+
+    if (slot.fence) {
+        glDeleteSync(slot.fence);
+    }
+
+    foreach (GLsync fence, retiredFences) {
+        glDeleteSync(fence);
+    }
+
+    GLuint width = image.width();
+    GLuint height = image.height();
+
+    if (slot.texId == 0 || slot.width != width || slot.height != height)
+    {
+        glDeleteTextures(1, &slot.texId);
+
+        glGenTextures(1, &slot.texId);
+        glBindTexture(GL_TEXTURE_2D, slot.texId);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, slot.texId);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glFlush();
+
+    mContext->doneCurrent();
+
+    mMutex.lock();
+    mRing[slotIndex].texId = slot.texId;
+    mRing[slotIndex].width = width;
+    mRing[slotIndex].height = height;
+    mRing[slotIndex].fence = fence;
+    mRing[slotIndex].decoding = false;
+    mRing[slotIndex].ready = true;
+    mMutex.unlock();
+}
+
+
+
+void FrameDecoder::cleanup()
+{
+    if (mPlayer)
+    {
+        mPlayer->stop();
+
+        delete mPlayer;
+        delete mVideoSink;
+        delete mSeekTimer;
+
+        mPlayer = nullptr;
+        mVideoSink = nullptr;
+        mSeekTimer = nullptr;
+
+        mAwaitedFrame = -1;
+        mAwaitedSlot = -1;
+    }
+
+    mContext->makeCurrent(mSurface);
+
+    QMutexLocker locker(&mMutex);
+
+    for (Slot& slot : mRing)
+    {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        if (slot.consumedFence) {
+            glDeleteSync(slot.consumedFence);
+        }
+        glDeleteTextures(1, &slot.texId);
+
+        slot = Slot();
+    }
+
+    foreach (GLsync fence, mRetiredFences) {
+        glDeleteSync(fence);
+    }
+    mRetiredFences.clear();
+
+    locker.unlock();
+
+    mContext->doneCurrent();
+
+    delete mContext;
+    mContext = nullptr;
+}
@@ -0,0 +1,127 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QTimer>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QMediaPlayer>
+#include <QVideoSink>
+#include <QVideoFrame>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+
+
+// FrameDecoder: decodes a video file or a numbered image sequence on its own thread,
+// prefetching frames into a bounded ring of textures shared with the render context
+
+class FrameDecoder : public QObject, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    explicit FrameDecoder(QObject* parent = nullptr);
+    ~FrameDecoder();
+
+    void init(QOpenGLContext* shareContext, QString filename, GLuint width, GLuint height);
+    void stop();
+
+    static bool isVideoFile(QString filename);
+    static QStringList sequenceFiles(QString filename);
+
+    int frameCount();
+
+    void setTargetSize(GLuint width, GLuint height);
+
+    bool acquireFrame(int index, GLuint& texId, GLuint& width, GLuint& height, GLsync& fence);
+    void releaseFrame(int index, GLsync consumedFence);
+
+private:
+    struct Slot
+    {
+        int index = -1;
+        bool ready = false;
+        bool decoding = false;
+        GLuint texId = 0;
+        GLuint width = 0;
+        GLuint height = 0;
+        GLsync fence = 0;
+        GLsync consumedFence = 0;
+    };
+
+    QThread mThread;
+
+    QOpenGLContext* mContext = nullptr;
+    QOffscreenSurface* mSurface = nullptr;
+
+    QString mFilename;
+    QStringList mSequenceFiles;
+
+    QMediaPlayer* mPlayer = nullptr;
+    QVideoSink* mVideoSink = nullptr;
+    qreal mVideoFrameRate = 25.0;
+    int mAwaitedFrame = -1;
+    int mAwaitedSlot = -1;
+    QTimer* mSeekTimer = nullptr;
+
+    static const int mRingSize = 8;
+
+    QMutex mMutex;
+    QList<Slot> mRing;
+    QList<GLsync> mRetiredFences;
+    int mFrameCount = 0;
+    int mCurrentFrame = 0;
+    bool mOpened = false;
+
+    GLuint mTargetWidth = 2048;
+    GLuint mTargetHeight = 2048;
+
+    int nextFrameToDecode(int& slot);
+    void uploadFrame(int slot, const QImage& image);
+    void finishSeek(const QImage& image);
+
+private slots:
+    void open();
+    void decodeNext();
+    void setVideoFrame(const QVideoFrame& frame);
+    void setMediaStatus(QMediaPlayer::MediaStatus status);
+    void seekTimeout();
+    void cleanup();
+};
+
+
+
+#endif // FRAMEDECODER_H
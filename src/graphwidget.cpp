@@ -36,6 +36,8 @@
 #include <QAction>
 #include <QPainterPath>
 #include <QPointer>
+#include <QHash>
+#include <QScrollBar>
 
 
 
@@ -59,7 +61,9 @@ GraphWidget::GraphWidget(Factory *factory, NodeManager* nodeManager, QWidget *pa
 
     // setOptimizationFlags(DontAdjustForAntialiasing | DontSavePainterState);
 
-    setCacheMode(CacheBackground);
+    // Background is cached by ourselves, since it is drawn in view coordinates
+
+    setCacheMode(CacheNone);
     // setViewportUpdateMode(BoundingRectViewportUpdate);
     // setViewportUpdateMode(FullViewportUpdate);
     // setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
@@ -101,8 +105,33 @@ GraphWidget::GraphWidget(Factory *factory, NodeManager* nodeManager, QWidget *pa
     connect(mNodeManager, &NodeManager::nodeRemoved, this, &GraphWidget::removeNode);
     connect(mNodeManager, &NodeManager::nodesDisconnected, this, &GraphWidget::removeEdge);
     connect(mNodeManager, &NodeManager::nodeInserted, this, &GraphWidget::centerNodeBetween);
+    connect(mNodeManager, &NodeManager::cycleClosed, this, &GraphWidget::markClosedCycle, Qt::QueuedConnection);
 
     connect(mMainMenu, &QMenu::triggered, this, &GraphWidget::onActionTriggered);
+
+    // Cycle search on its own thread
+
+    mCycleSearcher = new CycleSearcher();
+
+    connect(mCycleSearcher, &CycleSearcher::cyclesFound, this, &GraphWidget::addCycles);
+
+    // Level of detail updated once the view or the scene settle
+
+    mDetailTimer = new QTimer(this);
+    mDetailTimer->setSingleShot(true);
+    mDetailTimer->setInterval(50);
+
+    connect(mDetailTimer, &QTimer::timeout, this, &GraphWidget::updateLevelOfDetail);
+
+    auto scheduleDetailUpdate = [=, this]() {
+        if (!mDetailTimer->isActive()) {
+            mDetailTimer->start();
+        }
+    };
+
+    connect(scene, &QGraphicsScene::changed, this, scheduleDetailUpdate);
+    connect(horizontalScrollBar(), &QScrollBar::valueChanged, this, scheduleDetailUpdate);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, scheduleDetailUpdate);
 }
 
 
@@ -111,6 +140,10 @@ GraphWidget::~GraphWidget()
 {
     //disconnect(scene(), &QGraphicsScene::selectionChanged, this, &GraphWidget::newSelectedNodes);
 
+    delete mCycleSearcher;
+
+    qDeleteAll(mProxyPool);
+
     delete mAddSeedAction;
     delete mBuildNewOpAction;
     qDeleteAll(mAvailOpsActions);
@@ -140,40 +173,141 @@ void GraphWidget::populateAvailOpsMenu()
 
 
 
-Node* GraphWidget::getNode(QUuid id)
+void GraphWidget::setCachedOperations(QList<ImageOperation*> operations)
 {
-    const QList<QGraphicsItem*> items = scene()->items();
+    QSet<QUuid> ids;
 
-    foreach (QGraphicsItem* item, items)
-    {
-        if (Node* node = qgraphicsitem_cast<Node*>(item))
-        {
-            if (node->id() == id) {
-                return node;
-            }
+    QSet<ImageOperation*> cached(operations.begin(), operations.end());
+
+    for (auto [id, node] : mNodeManager->operationNodesMap().asKeyValueRange()) {
+        if (cached.contains(node->operation())) {
+            ids.insert(id);
         }
     }
 
-    return nullptr;
+    foreach (QGraphicsItem* item, scene()->items()) {
+        if (Node* node = qgraphicsitem_cast<Node*>(item)) {
+            node->setCached(ids.contains(node->id()));
+        }
+    }
 }
 
 
 
-Edge* GraphWidget::getEdge(QUuid srcId, QUuid dstId)
+void GraphWidget::setPrunedNodes(QList<QUuid> ids)
 {
-    const QList<QGraphicsItem*> items = scene()->items();
+    mPrunedIds = ids;
 
-    foreach (QGraphicsItem* item, items)
+    foreach (QGraphicsItem* item, scene()->items()) {
+        if (Node* node = qgraphicsitem_cast<Node*>(item)) {
+            node->setPruned(mPrunedIds.contains(node->id()));
+        }
+    }
+}
+
+
+
+void GraphWidget::setRenderTimes(QMap<ImageOperation*, double> times)
+{
+    mRenderTimes = times;
+
+    // Only boxes show render times
+
+    foreach (QGraphicsItem* item, scene()->items()) {
+        if (Node* node = qgraphicsitem_cast<Node*>(item); node && !node->hasProxyWidget()) {
+            updateNodeLabels(node);
+        }
+    }
+}
+
+
+
+QGraphicsProxyWidget* GraphWidget::takeProxyWidget()
+{
+    if (!mProxyPool.isEmpty()) {
+        return mProxyPool.takeLast();
+    }
+
+    return new QGraphicsProxyWidget();
+}
+
+
+
+void GraphWidget::updateNodeLabels(Node* node)
+{
+    if (ImageOperation* operation = mNodeManager->getOperation(node->id()))
     {
-        if (Edge* edge = qgraphicsitem_cast<Edge*>(item))
+        node->setTitle(operation->name());
+        node->setRenderTime(mRenderTimes.value(operation, -1.0));
+    }
+    else
+    {
+        node->setTitle("Seed");
+        node->setRenderTime(-1.0);
+    }
+}
+
+
+
+void GraphWidget::updateLevelOfDetail()
+{
+    bool detailed = transform().m11() >= detailScale;
+
+    QRectF visibleRect = mapToScene(viewport()->rect()).boundingRect();
+
+    QRectF bound;
+
+    foreach (QGraphicsItem* item, scene()->items())
+    {
+        if (Node* node = qgraphicsitem_cast<Node*>(item))
         {
-            if (edge->sourceNode()->id() == srcId && edge->destNode()->id() == dstId) {
-                return edge;
+            QRectF nodeRect = node->sceneBoundingRect();
+            bound = bound.united(nodeRect);
+
+            bool embed = detailed && visibleRect.intersects(nodeRect);
+
+            if (embed && !node->hasProxyWidget())
+            {
+                node->setProxyWidget(takeProxyWidget());
+            }
+            else if (!embed && node->hasProxyWidget())
+            {
+                QGraphicsProxyWidget* proxyWidget = node->takeProxyWidget();
+                if (proxyWidget->scene()) {
+                    proxyWidget->scene()->removeItem(proxyWidget);
+                }
+                mProxyPool.append(proxyWidget);
+            }
+
+            if (!node->hasProxyWidget()) {
+                updateNodeLabels(node);
             }
         }
+        else if (Edge* edge = qgraphicsitem_cast<Edge*>(item))
+        {
+            edge->setDetailed(detailed);
+        }
+    }
+
+    if (bound != mItemsBoundingRect)
+    {
+        mItemsBoundingRect = bound;
+        viewport()->update();
     }
+}
+
+
 
-    return nullptr;
+Node* GraphWidget::getNode(QUuid id)
+{
+    return mNodes.value(id, nullptr);
+}
+
+
+
+Edge* GraphWidget::getEdge(QUuid srcId, QUuid dstId)
+{
+    return mEdges.value(qMakePair(srcId, dstId), nullptr);
 }
 
 
@@ -272,9 +406,11 @@ void GraphWidget::onActionTriggered(QAction* action)
 
 void GraphWidget::addNewNode(QUuid id, QWidget* widget)
 {
-    Node* node = new Node(id, widget);
+    Node* node = new Node(id, widget, takeProxyWidget());
     scene()->addItem(node);
+    mNodes.insert(id, node);
     node->setPos(mClickPoint);
+    node->setPruned(mPrunedIds.contains(id));
 
     //QGraphicsProxyWidget *proxyWidget = scene()->addWidget(mNodeManager->addNewOperation());
     //proxyWidget->setPos(mapToScene(mapFromGlobal(data.toPoint())));
@@ -288,9 +424,11 @@ void GraphWidget::addNewNode(QUuid id, QWidget* widget)
 
 void GraphWidget::addNewNodeOnPos(QUuid id, QWidget* widget, QPointF pos)
 {
-    Node* node = new Node(id, widget);
+    Node* node = new Node(id, widget, takeProxyWidget());
     scene()->addItem(node);
+    mNodes.insert(id, node);
     node->setPos(pos);
+    node->setPruned(mPrunedIds.contains(id));
 
     //QGraphicsProxyWidget *proxyWidget = scene()->addWidget(mNodeManager->addNewOperation());
     //proxyWidget->setPos(mapToScene(mapFromGlobal(data.toPoint())));
@@ -323,12 +461,34 @@ void GraphWidget::connectNodes(QUuid srcId, QUuid dstId, InputType type, EdgeWid
     {
         Edge* edge = new Edge(srcNode, dstNode, type == InputType::Blit, widget);
         scene()->addItem(edge);
+        mEdges.insert(qMakePair(srcId, dstId), edge);
         searchElementaryCycles();
     }
 }
 
 
 
+void GraphWidget::markClosedCycle(QUuid srcId, QUuid dstId, QList<QUuid> cycleIds)
+{
+    // The closing edge has been made the predge of the cycle, show it and select the nodes of the cycle
+
+    Edge* edge = getEdge(srcId, dstId);
+    if (edge && !edge->isPredge()) {
+        edge->setPredge(true);
+    }
+
+    scene()->clearSelection();
+
+    foreach (QUuid id, cycleIds)
+    {
+        if (Node* node = getNode(id)) {
+            node->setSelected(true);
+        }
+    }
+}
+
+
+
 void GraphWidget::reconnectNodes(Node* node)
 {
     if (node->edges().size() == 2)
@@ -405,10 +565,14 @@ void GraphWidget::removeNode(QUuid id)
                 edge->destNode()->removeEdge(edge);
             }
 
+            mEdges.remove(qMakePair(edge->sourceNode()->id(), edge->destNode()->id()));
+
             scene()->removeItem(edge);
             delete edge;
         }
 
+        mNodes.remove(id);
+
         scene()->removeItem(node);
         node->deleteLater();
         // delete node;
@@ -428,6 +592,8 @@ void GraphWidget::removeEdge(QUuid srcId, QUuid dstId)
         edge->sourceNode()->removeEdge(edge);
         edge->destNode()->removeEdge(edge);
 
+        mEdges.remove(qMakePair(srcId, dstId));
+
         scene()->removeItem(edge);
         edge->deleteLater();
 
@@ -916,6 +1082,13 @@ void GraphWidget::centerNodeBetween(QUuid srcId, QUuid dstId, QUuid opId)
 void GraphWidget::clearScene()
 {
     scene()->clear();
+
+    mNodes.clear();
+    mEdges.clear();
+
+    // Cancel any search over the removed nodes
+
+    searchElementaryCycles();
 }
 
 
@@ -1144,21 +1317,38 @@ void GraphWidget::wheelEvent(QWheelEvent *event)
 
     center = mapToScene(rect().center());
     centerOn(center);
+
+    mDetailTimer->start();
 }
 
 
 
 void GraphWidget::drawBackground(QPainter *painter, const QRectF &rect)
 {
-    QLinearGradient gradient(rect.topLeft(), rect.bottomLeft());
-    gradient.setColorAt(0, Qt::black);
-    gradient.setColorAt(1, QColor(128, 128, 128));
-    painter->fillRect(rect, gradient);
+    // Gradient in view coordinates, rendered once per view size
+
+    if (mBackground.size() != viewport()->size())
+    {
+        mBackground = QPixmap(viewport()->size());
+
+        QPainter backgroundPainter(&mBackground);
+        QLinearGradient gradient(0.0, 0.0, 0.0, mBackground.height());
+        gradient.setColorAt(0, Qt::black);
+        gradient.setColorAt(1, QColor(128, 128, 128));
+        backgroundPainter.fillRect(mBackground.rect(), gradient);
+    }
+
+    painter->save();
+    painter->resetTransform();
+    painter->drawPixmap(0, 0, mBackground);
+    painter->restore();
+
+    // Items bounds updated with the level of detail, instead of on every redraw
 
-    QRectF bound = scene()->itemsBoundingRect();
+    QRectF bound = mItemsBoundingRect;
     QRectF intersection = rect.intersected(bound);
 
-    if (intersection != bound)
+    if (!bound.isNull() && intersection != bound)
     {
         qreal arrowWidth = 40.0;
         qreal arrowHeight = 10.0;
@@ -1209,6 +1399,15 @@ void GraphWidget::drawBackground(QPainter *painter, const QRectF &rect)
 
 
 
+void GraphWidget::resizeEvent(QResizeEvent* event)
+{
+    QGraphicsView::resizeEvent(event);
+
+    mDetailTimer->start();
+}
+
+
+
 void GraphWidget::mouseMoveEvent(QMouseEvent* event)
 {
     if (event->modifiers() == Qt::ControlModifier && event->buttons() == Qt::LeftButton)
@@ -1219,10 +1418,6 @@ void GraphWidget::mouseMoveEvent(QMouseEvent* event)
             center -= delta / scaleFactor;
             centerOn(center);
 
-            // Draw background
-
-            resetCachedContent();
-
             prevPos = event->position();
         }
     }
@@ -1276,21 +1471,43 @@ void GraphWidget::searchElementaryCycles()
         }
     }
 
-    QList<bool> row(nodes.size(), false);
-    QList<QList<bool>> adjacencyMatrix(nodes.size(), row);
+    // Compact adjacency lists over the node indices
 
-    foreach (Edge* edge, edges)
-    {
-        int i = nodes.indexOf(edge->sourceNode());
-        int j = nodes.indexOf(edge->destNode());
-        adjacencyMatrix[i][j] = true;
+    QHash<Node*, int> indices;
+    indices.reserve(nodes.size());
+
+    for (int i = 0; i < nodes.size(); i++) {
+        indices.insert(nodes[i], i);
     }
 
-    ElementaryCyclesSearch ecs(adjacencyMatrix, nodes);
-    QList<QList<Node*>> cycles = ecs.getElementaryCycles();
+    QList<QList<int>> adjacencyList(nodes.size());
+
+    foreach (Edge* edge, edges) {
+        adjacencyList[indices.value(edge->sourceNode())].append(indices.value(edge->destNode()));
+    }
+
+    // Cycles are added once found, results of superseded searches are discarded
+
+    mCycleSearchNodes = nodes;
+    mCycleSearcher->request(adjacencyList);
+}
 
-    foreach (QList<Node*> nodeCycle, cycles)
+
+
+void GraphWidget::addCycles(quint64 ticket, QList<QList<int>> cycles)
+{
+    if (ticket != mCycleSearcher->latestTicket()) {
+        return;
+    }
+
+    foreach (QList<int> indexCycle, cycles)
     {
+        QList<Node*> nodeCycle;
+
+        foreach (int i, indexCycle) {
+            nodeCycle.append(mCycleSearchNodes[i]);
+        }
+
         Cycle* cycle = new Cycle(nodeCycle);
         scene()->addItem(cycle);
     }
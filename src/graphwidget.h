@@ -30,8 +30,14 @@
 #include "nodemanager.h"
 
 #include <QGraphicsView>
+#include <QGraphicsProxyWidget>
+#include <QTimer>
+#include <QPixmap>
 #include <QUuid>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QPair>
 #include <QPointF>
 
 
@@ -39,6 +45,7 @@
 class Node;
 class Edge;
 class EdgeWidget;
+class CycleSearcher;
 // class NodeManager;
 //struct InputData;
 
@@ -96,6 +103,9 @@ public:
 
 public slots:
     void clearScene();
+    void setCachedOperations(QList<ImageOperation*> operations);
+    void setPrunedNodes(QList<QUuid> ids);
+    void setRenderTimes(QMap<ImageOperation*, double> times);
     //void drawSelectedSeeds();
     //void enableSelectedOperations();
     //void disableSelectedOperations();
@@ -125,6 +135,7 @@ protected:
     void drawBackground(QPainter* painter, const QRectF& rect) override;
     void mousePressEvent(QMouseEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
     // void closeEvent(QCloseEvent* event) override;
 
 private:
@@ -144,6 +155,28 @@ private:
 
     QPointF mClickPoint;
 
+    QList<QUuid> mPrunedIds;
+
+    // Indexes of the scene's nodes and edges by id, kept in sync on add and remove
+
+    QHash<QUuid, Node*> mNodes;
+    QHash<QPair<QUuid, QUuid>, Edge*> mEdges;
+
+    CycleSearcher* mCycleSearcher;
+    QList<Node*> mCycleSearchNodes;
+
+    // Level of detail: below this zoom nodes are drawn as boxes, and only visible nodes embed their widgets
+    // Proxies of nodes leaving the view are kept for reuse
+
+    static constexpr qreal detailScale = 0.5;
+
+    QList<QGraphicsProxyWidget*> mProxyPool;
+    QTimer* mDetailTimer;
+    QMap<ImageOperation*, double> mRenderTimes;
+
+    QPixmap mBackground;
+    QRectF mItemsBoundingRect;
+
     QMenu* mMainMenu;
     QMenu* mAvailOpsMenu;
 
@@ -159,6 +192,9 @@ private:
 
     void searchElementaryCycles();
 
+    QGraphicsProxyWidget* takeProxyWidget();
+    void updateNodeLabels(Node* node);
+
     Node* getNode(QUuid id);
     Edge* getEdge(QUuid srcId, QUuid dstId);
 
@@ -175,6 +211,9 @@ private slots:
     void removeNode(QUuid id);
     void removeEdge(QUuid srcId, QUuid dstId);
     void centerNodeBetween(QUuid srcId, QUuid dstId, QUuid opId);
+    void markClosedCycle(QUuid srcId, QUuid dstId, QList<QUuid> cycleIds);
+    void addCycles(quint64 ticket, QList<QList<int>> cycles);
+    void updateLevelOfDetail();
 };
 
 
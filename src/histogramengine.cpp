@@ -0,0 +1,320 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "histogramengine.h"
+
+#include <QDebug>
+
+
+
+HistogramEngine::HistogramEngine(QObject* parent)
+    : QObject { parent }
+{
+    pCdfTexId = new GLuint(0);
+}
+
+
+
+HistogramEngine::~HistogramEngine()
+{
+    delete pCdfTexId;
+}
+
+
+
+void HistogramEngine::init()
+{
+    // Expects current context
+
+    initializeOpenGLFunctions();
+
+    mHistogramProgram = new QOpenGLShaderProgram();
+    if (!mHistogramProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/histogram.comp"))
+        qDebug() << "Compute shader error:\n" << mHistogramProgram->log();
+    if (!mHistogramProgram->link())
+        qDebug() << "Shader link error:\n" << mHistogramProgram->log();
+
+    mCdfProgram = new QOpenGLShaderProgram();
+    if (!mCdfProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/cdf.comp"))
+        qDebug() << "Compute shader error:\n" << mCdfProgram->log();
+    if (!mCdfProgram->link())
+        qDebug() << "Shader link error:\n" << mCdfProgram->log();
+
+    // Counts buffer sized for the maximum number of bins: 4 KB
+
+    glCreateBuffers(1, &mCountsBuffer);
+    glNamedBufferStorage(mCountsBuffer, 4 * mMaxBins * sizeof(GLuint), nullptr, 0);
+
+    mReadBuffers.resize(mRingSize, 0);
+    mFences.resize(mRingSize, 0);
+    mReadBins.resize(mRingSize, 0);
+
+    glCreateBuffers(mRingSize, mReadBuffers.data());
+
+    foreach (GLuint buffer, mReadBuffers) {
+        glNamedBufferStorage(buffer, 4 * mMaxBins * sizeof(GLuint), nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+
+    genCdfTexture();
+
+    mInitialized = true;
+}
+
+
+
+void HistogramEngine::cleanup()
+{
+    // Expects current context
+
+    if (!mInitialized) {
+        return;
+    }
+
+    delete mHistogramProgram;
+    delete mCdfProgram;
+
+    foreach (GLsync fence, mFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    glDeleteBuffers(1, &mCountsBuffer);
+    glDeleteBuffers(mRingSize, mReadBuffers.data());
+
+    glDeleteTextures(1, pCdfTexId);
+    *pCdfTexId = 0;
+
+    mInitialized = false;
+}
+
+
+
+bool HistogramEngine::enabled() const
+{
+    return mEnabled;
+}
+
+
+
+void HistogramEngine::setEnabled(bool set)
+{
+    mEnabled = set;
+}
+
+
+
+int HistogramEngine::bins() const
+{
+    return mBins;
+}
+
+
+
+void HistogramEngine::setBins(int numBins)
+{
+    numBins = qBound(2, numBins, mMaxBins);
+
+    if (numBins != mBins)
+    {
+        mBins = numBins;
+        mBinsChanged = true;
+    }
+}
+
+
+
+GLuint* HistogramEngine::source() const
+{
+    return pSourceTexId;
+}
+
+
+
+void HistogramEngine::setSource(GLuint* pTexId)
+{
+    pSourceTexId = pTexId;
+}
+
+
+
+GLuint* HistogramEngine::cdfTextureId()
+{
+    return pCdfTexId;
+}
+
+
+
+void HistogramEngine::genCdfTexture()
+{
+    // One texel per bin: red, green, blue and luminance cumulative distributions
+
+    glDeleteTextures(1, pCdfTexId);
+
+    glGenTextures(1, pCdfTexId);
+    glBindTexture(GL_TEXTURE_2D, *pCdfTexId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, mBins, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+
+void HistogramEngine::compute(GLuint* pOutputTexId)
+{
+    // Expects current context
+
+    if (!mInitialized || !mEnabled || !mHistogramProgram->isLinked() || !mCdfProgram->isLinked()) {
+        return;
+    }
+
+    readCounts();
+
+    GLuint* pTexId = pSourceTexId ? pSourceTexId : pOutputTexId;
+
+    if (!pTexId || !*pTexId) {
+        return;
+    }
+
+    if (mBinsChanged)
+    {
+        genCdfTexture();
+        mBinsChanged = false;
+    }
+
+    GLint texWidth = 0;
+    GLint texHeight = 0;
+    glGetTextureLevelParameteriv(*pTexId, 0, GL_TEXTURE_WIDTH, &texWidth);
+    glGetTextureLevelParameteriv(*pTexId, 0, GL_TEXTURE_HEIGHT, &texHeight);
+
+    // Histogram: shared memory atomics per work group, merged into the counts buffer
+
+    GLuint zero = 0;
+    glClearNamedBufferSubData(mCountsBuffer, GL_R32UI, 0, 4 * mBins * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mCountsBuffer);
+
+    mHistogramProgram->bind();
+    mHistogramProgram->setUniformValue("inTex", 0);
+    mHistogramProgram->setUniformValue("bins", mBins);
+
+    glBindTextureUnit(0, *pTexId);
+
+    glDispatchCompute((texWidth + 63) / 64, (texHeight + 63) / 64, 1);
+
+    glBindTextureUnit(0, 0);
+
+    mHistogramProgram->release();
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Cumulative distributions
+
+    mCdfProgram->bind();
+    mCdfProgram->setUniformValue("bins", mBins);
+
+    glBindImageTexture(0, *pCdfTexId, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glDispatchCompute(1, 1, 1);
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    mCdfProgram->release();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // Asynchronous readback of the counts, unless the ring is full
+
+    if (!mFences[mSubmitIndex])
+    {
+        glCopyNamedBufferSubData(mCountsBuffer, mReadBuffers[mSubmitIndex], 0, 0, 4 * mBins * sizeof(GLuint));
+
+        mFences[mSubmitIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mReadBins[mSubmitIndex] = mBins;
+
+        mSubmitIndex = (mSubmitIndex + 1) % mRingSize;
+    }
+}
+
+
+
+void HistogramEngine::readCounts()
+{
+    // Latest readback whose fence has signaled, never waiting on the GPU
+
+    int latest = -1;
+
+    for (int i = 0; i < mRingSize; i++)
+    {
+        int index = (mSubmitIndex + i) % mRingSize;
+
+        if (!mFences[index]) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(mFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(mFences[index]);
+        mFences[index] = 0;
+
+        latest = index;
+    }
+
+    if (latest < 0) {
+        return;
+    }
+
+    int bins = mReadBins[latest];
+
+    QList<GLuint> counts(4 * bins);
+    glGetNamedBufferSubData(mReadBuffers[latest], 0, counts.size() * sizeof(GLuint), counts.data());
+
+    // Every texel is counted once per channel
+
+    quint64 total = 0;
+    for (int i = 0; i < bins; i++) {
+        total += counts[i];
+    }
+
+    QList<float> fractions(counts.size(), 0.0f);
+
+    if (total > 0)
+    {
+        for (int i = 0; i < counts.size(); i++) {
+            fractions[i] = static_cast<float>(counts[i]) / total;
+        }
+    }
+
+    emit histogramReady(bins, fractions);
+}
@@ -0,0 +1,96 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef HISTOGRAMENGINE_H
+#define HISTOGRAMENGINE_H
+
+
+
+#include <QObject>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QList>
+
+
+
+// HistogramEngine: red, green, blue and luminance histograms of a texture computed on the GPU
+// Counts are read back asynchronously and their cumulative distributions kept in a texture operations can sample
+
+class HistogramEngine : public QObject, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    explicit HistogramEngine(QObject* parent = nullptr);
+    ~HistogramEngine();
+
+    void init();
+    void cleanup();
+
+    bool enabled() const;
+    void setEnabled(bool set);
+
+    int bins() const;
+    void setBins(int numBins);
+
+    GLuint* source() const;
+    void setSource(GLuint* pTexId);
+
+    GLuint* cdfTextureId();
+
+    void compute(GLuint* pOutputTexId);
+
+signals:
+    void histogramReady(int bins, QList<float> fractions);
+
+private:
+    bool mInitialized = false;
+    bool mEnabled = true;
+
+    static const int mMaxBins = 256;
+    int mBins = 64;
+    bool mBinsChanged = false;
+
+    GLuint* pSourceTexId = nullptr;
+
+    QOpenGLShaderProgram* mHistogramProgram = nullptr;
+    QOpenGLShaderProgram* mCdfProgram = nullptr;
+
+    GLuint mCountsBuffer = 0;
+    GLuint* pCdfTexId = nullptr;
+
+    const int mRingSize = 3;
+    QList<GLuint> mReadBuffers;
+    QList<GLsync> mFences;
+    QList<int> mReadBins;
+    int mSubmitIndex = 0;
+
+    void genCdfTexture();
+    void readCounts();
+};
+
+
+
+#endif // HISTOGRAMENGINE_H
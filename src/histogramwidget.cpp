@@ -1,5 +1,215 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
 #include "histogramwidget.h"
 
-HistogramWidget::HistogramWidget(QWidget *parent)
-    : QWidget{parent}
-{}
+#include <QPainter>
+#include <QPainterPath>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QIntValidator>
+#include <cmath>
+
+
+
+HistogramPlot::HistogramPlot(QWidget* parent)
+    : QWidget { parent }
+{
+    setMinimumHeight(120);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+}
+
+
+
+void HistogramPlot::setHistogram(int bins, QList<float> fractions)
+{
+    mBins = bins;
+    mFractions = fractions;
+
+    update();
+}
+
+
+
+void HistogramPlot::setLogScale(bool on)
+{
+    mLogScale = on;
+    update();
+}
+
+
+
+void HistogramPlot::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event)
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+
+    if (mBins < 2 || mFractions.size() != 4 * mBins) {
+        return;
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    auto barHeight = [&](float fraction) {
+        return mLogScale ? std::log1p(1000.0f * fraction) : fraction;
+    };
+
+    // Common vertical scale for all channels
+
+    float maxHeight = 0.0f;
+    foreach (float fraction, mFractions) {
+        maxHeight = qMax(maxHeight, barHeight(fraction));
+    }
+
+    if (maxHeight <= 0.0f) {
+        return;
+    }
+
+    QList<QColor> colors = { QColor(255, 64, 64), QColor(64, 255, 64), QColor(64, 128, 255), QColor(255, 255, 255) };
+
+    qreal w = width();
+    qreal h = height() - 1;
+
+    for (int channel = 0; channel < 4; channel++)
+    {
+        QPainterPath path;
+
+        for (int i = 0; i < mBins; i++)
+        {
+            QPointF point(w * (i + 0.5) / mBins, h - h * barHeight(mFractions[channel * mBins + i]) / maxHeight);
+
+            if (i == 0)
+                path.moveTo(point);
+            else
+                path.lineTo(point);
+        }
+
+        painter.setPen(QPen(colors[channel], 1.5));
+        painter.drawPath(path);
+    }
+}
+
+
+
+HistogramWidget::HistogramWidget(HistogramEngine* engine, QWidget* parent)
+    : QWidget { parent },
+    mEngine { engine }
+{
+    QPushButton* enableButton = new QPushButton(QIcon(QPixmap(":/icons/circle-green.png")), "");
+    enableButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    enableButton->setCheckable(true);
+    enableButton->setChecked(mEngine->enabled());
+    enableButton->setToolTip("Histogram");
+
+    mBinsLineEdit = new QLineEdit;
+    QIntValidator* binsValidator = new QIntValidator(2, 256, mBinsLineEdit);
+    mBinsLineEdit->setValidator(binsValidator);
+    mBinsLineEdit->setText(QString::number(mEngine->bins()));
+    mBinsLineEdit->setToolTip("Bins");
+
+    QPushButton* logButton = new QPushButton("log");
+    logButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    logButton->setCheckable(true);
+
+    mSourceComboBox = new QComboBox;
+    mSourceComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    mSourceComboBox->addItem("Output");
+
+    mPlot = new HistogramPlot;
+
+    QHBoxLayout* controlsLayout = new QHBoxLayout;
+    controlsLayout->addWidget(enableButton);
+    controlsLayout->addWidget(mBinsLineEdit);
+    controlsLayout->addWidget(logButton);
+    controlsLayout->addWidget(mSourceComboBox);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(controlsLayout);
+    layout->addWidget(mPlot);
+
+    setLayout(layout);
+
+    connect(enableButton, &QPushButton::toggled, this, [=, this](bool checked) {
+        mEngine->setEnabled(checked);
+    });
+    connect(mBinsLineEdit, &QLineEdit::editingFinished, this, [=, this]() {
+        mEngine->setBins(mBinsLineEdit->text().toInt());
+    });
+    connect(logButton, &QPushButton::toggled, mPlot, &HistogramPlot::setLogScale);
+    connect(mSourceComboBox, &QComboBox::activated, this, &HistogramWidget::setSource);
+
+    connect(mEngine, &HistogramEngine::histogramReady, this, &HistogramWidget::setHistogram);
+}
+
+
+
+void HistogramWidget::setHistogram(int bins, QList<float> fractions)
+{
+    if (isVisible()) {
+        mPlot->setHistogram(bins, fractions);
+    }
+}
+
+
+
+void HistogramWidget::setSource(int index)
+{
+    mEngine->setSource(index > 0 ? mOperations[index - 1]->pOutTextureId() : nullptr);
+}
+
+
+
+void HistogramWidget::setSourceOperations(QList<ImageOperation*> operations)
+{
+    mOperations = operations;
+
+    // Keep current source if its operation is still there, otherwise fall back to the output
+
+    int sourceIndex = 0;
+
+    for (int i = 0; i < mOperations.size(); i++)
+    {
+        if (mOperations[i]->pOutTextureId() == mEngine->source()) {
+            sourceIndex = i + 1;
+        }
+    }
+
+    if (sourceIndex == 0) {
+        mEngine->setSource(nullptr);
+    }
+
+    mSourceComboBox->clear();
+    mSourceComboBox->addItem("Output");
+
+    for (int i = 0; i < mOperations.size(); i++) {
+        mSourceComboBox->addItem(QString::number(i + 1) + ": " + mOperations[i]->name());
+    }
+
+    mSourceComboBox->setCurrentIndex(sourceIndex);
+}
@@ -1,15 +1,91 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
 #ifndef HISTOGRAMWIDGET_H
 #define HISTOGRAMWIDGET_H
 
+
+
+#include "histogramengine.h"
+#include "imageoperation.h"
+
 #include <QWidget>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPaintEvent>
+#include <QList>
+
+
+
+// Plot area: red, green, blue and luminance histograms as curves
+
+class HistogramPlot : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HistogramPlot(QWidget* parent = nullptr);
+
+    void setHistogram(int bins, QList<float> fractions);
+    void setLogScale(bool on);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    int mBins = 0;
+    QList<float> mFractions;
+    bool mLogScale = false;
+};
+
+
 
 class HistogramWidget : public QWidget
 {
     Q_OBJECT
+
 public:
-    explicit HistogramWidget(QWidget *parent = nullptr);
+    explicit HistogramWidget(HistogramEngine* engine, QWidget* parent = nullptr);
+
+public slots:
+    void setHistogram(int bins, QList<float> fractions);
+    void setSourceOperations(QList<ImageOperation*> operations);
+
+private:
+    HistogramEngine* mEngine;
+
+    QList<ImageOperation*> mOperations;
 
-signals:
+    HistogramPlot* mPlot;
+    QComboBox* mSourceComboBox;
+    QLineEdit* mBinsLineEdit;
+
+private slots:
+    void setSource(int index);
 };
 
+
+
 #endif // HISTOGRAMWIDGET_H
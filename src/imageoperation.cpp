@@ -23,9 +23,18 @@
 
 
 #include "imageoperation.h"
+#include "shaderpreprocessor.h"
 
-#include <QMessageBox>
-#include <QApplication>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <type_traits>
+
+
+
+#ifndef GL_SHADER_BINARY_FORMAT_SPIR_V
+#define GL_SHADER_BINARY_FORMAT_SPIR_V 0x9551
+#endif
 
 
 
@@ -39,8 +48,15 @@ ImageOperation::ImageOperation()
 
 ImageOperation::ImageOperation(const ImageOperation& operation) :
     mName { operation.mName },
+    mSourceFile { operation.mSourceFile },
+    mVertexShaderFile { operation.mVertexShaderFile },
+    mFragmentShaderFile { operation.mFragmentShaderFile },
     mVertexShader { operation.mVertexShader },
     mFragmentShader { operation.mFragmentShader },
+    mVertexSpirv { operation.mVertexSpirv },
+    mFragmentSpirv { operation.mFragmentSpirv },
+    mUniformLocations { operation.mUniformLocations },
+    mSpirvSourceKey { operation.mSpirvSourceKey },
     mMinMagFilter { operation.mMinMagFilter },
     mEnabled { operation.mEnabled },
     mInputData { operation.mInputData },
@@ -90,8 +106,15 @@ ImageOperation::ImageOperation(const ImageOperation& operation) :
 
 ImageOperation::ImageOperation(const ImageOperation& operation, const ImageOperation& oldOperation) :
     mName { operation.mName },
+    mSourceFile { operation.mSourceFile },
+    mVertexShaderFile { operation.mVertexShaderFile },
+    mFragmentShaderFile { operation.mFragmentShaderFile },
     mVertexShader { operation.mVertexShader },
     mFragmentShader { operation.mFragmentShader },
+    mVertexSpirv { operation.mVertexSpirv },
+    mFragmentSpirv { operation.mFragmentSpirv },
+    mUniformLocations { operation.mUniformLocations },
+    mSpirvSourceKey { operation.mSpirvSourceKey },
     mMinMagFilter { operation.mMinMagFilter },
     mEnabled { oldOperation.mEnabled },
     mInputData { oldOperation.mInputData },
@@ -135,6 +158,8 @@ ImageOperation::ImageOperation(const ImageOperation& operation, const ImageOpera
         newParameter->setOperation(this);
         mMat4UniformParameters.append(newParameter);
     }
+
+    takeValues(oldOperation);
 }
 
 
@@ -144,7 +169,8 @@ ImageOperation::~ImageOperation()
     {
         mContext->makeCurrent(mSurface);
 
-        delete mProgram;
+        mPendingProgram.reset();
+        setSharedProgram(nullptr);
 
         GLuint texIds[] = { mOutTexId, mBlitOutTexId, mBlendOutTexId };
         glDeleteTextures(3, texIds);
@@ -182,9 +208,9 @@ void ImageOperation::init(QOpenGLContext* context, QOffscreenSurface *surface)
 
         initializeOpenGLFunctions();
 
-        // Shader program
+        // Shader program, replaced on link by the one shared by instances with the same shaders
 
-        mProgram = new QOpenGLShaderProgram();
+        setSharedProgram(QSharedPointer<SharedProgram>::create());
 
         // Sampler
 
@@ -206,7 +232,7 @@ void ImageOperation::render()
 
         glClear(GL_COLOR_BUFFER_BIT);
 
-        mProgram->bind();
+        bindProgram();
 
         GLuint unit = 0;
 
@@ -215,7 +241,7 @@ void ImageOperation::render()
         if (mSampler2DAvailable)
         {
             glBindTextureUnit(unit, inTextureId());
-            int location = mProgram->uniformLocation(mSampler2DName);
+            int location = uniformLocation(mSampler2DName);
             glUniform1i(location, unit);
             unit++;
         }
@@ -225,93 +251,745 @@ void ImageOperation::render()
         if (mSampler2DArrayAvailable)
         {
             glBindTextureUnit(unit, mArrayTexId);
-            int location = mProgram->uniformLocation(mSampler2DArrayName);
+            int location = uniformLocation(mSampler2DArrayName);
             glUniform1i(location, unit);
+            unit++;
+        }
+
+        // Bind histogram cumulative distributions if sampled by the shader (uniform sampler2D histogramCdf)
+
+        if (pCdfTexId && *pCdfTexId)
+        {
+            int location = uniformLocation("histogramCdf");
+            if (location >= 0)
+            {
+                glBindTextureUnit(unit, *pCdfTexId);
+                glUniform1i(location, unit);
+            }
+        }
+
+        glBindSampler(0, mSamplerId);
+
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+        glBindSampler(0, 0);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        mProgram->release();
+    }
+}
+
+
+QOpenGLShaderProgram* ImageOperation::program()
+{
+    return mProgram;
+}
+
+
+
+QString ImageOperation::vertexShader() const
+{
+    return mVertexShader;
+}
+
+
+
+QString ImageOperation::fragmentShader() const
+{
+    return mFragmentShader;
+}
+
+
+
+// SPIR-V no longer matches edited shaders
+
+void ImageOperation::setVertexShader(QString shader)
+{
+    mVertexShader = shader;
+    setSpirv(QByteArray(), QByteArray(), QMap<QString, int>());
+}
+
+
+
+void ImageOperation::setFragmentShader(QString shader)
+{
+    mFragmentShader = shader;
+    setSpirv(QByteArray(), QByteArray(), QMap<QString, int>());
+}
+
+
+
+QByteArray ImageOperation::vertexSpirv() const
+{
+    return mVertexSpirv;
+}
+
+
+
+QByteArray ImageOperation::fragmentSpirv() const
+{
+    return mFragmentSpirv;
+}
+
+
+
+QMap<QString, int> ImageOperation::uniformLocations() const
+{
+    return mUniformLocations;
+}
+
+
+
+QByteArray ImageOperation::spirvSourceKey() const
+{
+    return mSpirvSourceKey;
+}
+
+
+
+void ImageOperation::setSpirv(QByteArray vertexSpirv, QByteArray fragmentSpirv, QMap<QString, int> locations, QByteArray sourceKey)
+{
+    mVertexSpirv = vertexSpirv;
+    mFragmentSpirv = fragmentSpirv;
+    mUniformLocations = locations;
+    mSpirvSourceKey = sourceKey;
+}
+
+
+
+// Key of the shaders with only their includes expanded, as compiled to SPIR-V: empty if an include fails
+
+QByteArray ImageOperation::expandedSourceKey(QStringList* includedFiles) const
+{
+    ShaderPreprocessor preprocessor;
+
+    if (!mSourceFile.isEmpty()) {
+        preprocessor.setBaseDirectory(QFileInfo(mSourceFile).absolutePath());
+    }
+
+    QString vertexShader = preprocessor.process(mVertexShader);
+
+    if (includedFiles) {
+        includedFiles->append(preprocessor.includedFiles());
+    }
+
+    QString fragmentShader = preprocessor.ok() ? preprocessor.process(mFragmentShader) : QString();
+
+    if (includedFiles) {
+        includedFiles->append(preprocessor.includedFiles());
+    }
+
+    if (!preprocessor.ok()) {
+        return QByteArray();
+    }
+
+    return ProgramCache::key(vertexShader, fragmentShader, QByteArray());
+}
+
+
+
+// Operation file and external shader files this operation was read from, watched for changes
+
+QString ImageOperation::sourceFile() const
+{
+    return mSourceFile;
+}
+
+
+
+void ImageOperation::setSourceFile(QString filename)
+{
+    mSourceFile = filename;
+}
+
+
+
+QString ImageOperation::vertexShaderFile() const
+{
+    return mVertexShaderFile;
+}
+
+
+
+void ImageOperation::setVertexShaderFile(QString filename)
+{
+    mVertexShaderFile = filename;
+}
+
+
+
+QString ImageOperation::fragmentShaderFile() const
+{
+    return mFragmentShaderFile;
+}
+
+
+
+void ImageOperation::setFragmentShaderFile(QString filename)
+{
+    mFragmentShaderFile = filename;
+}
+
+
+
+// Hot reload: relinked in the background, the current program renders until the new one is swapped in
+// Parameters are kept, so uniforms keep their values by name
+
+bool ImageOperation::linkShaders(bool async)
+{
+    bool ok = true;
+
+    mVersion++;
+    mLinkLog.clear();
+
+    if (!mVertexShader.isEmpty() && !mFragmentShader.isEmpty())
+    {
+        // Shaders as compiled: includes expanded, defines injected and specialized uniforms made constant
+
+        QString vertexShader, fragmentShader;
+
+        if (!preprocessShaders(vertexShader, fragmentShader)) {
+            return false;
+        }
+
+        // May be called from the render loop, with the context current
+
+        bool current = QOpenGLContext::currentContext() == mContext;
+        if (!current)
+            mContext->makeCurrent(mSurface);
+
+        // Reuse the program already linked, or being linked, by another instance with the same shaders
+
+        QByteArray poolKey = ProgramCache::key(vertexShader, fragmentShader, QByteArray());
+
+        if (mProgramPool)
+        {
+            QSharedPointer<SharedProgram> shared = mProgramPool->find(poolKey);
+            if (shared && shared->status != SharedProgram::Status::Failed)
+            {
+                adoptProgram(shared);
+                if (!current)
+                    mContext->doneCurrent();
+                return true;
+            }
+        }
+
+        QSharedPointer<SharedProgram> shared = QSharedPointer<SharedProgram>::create();
+        QOpenGLShaderProgram* program = &shared->program;
+
+        // SPIR-V from a bundle skips the GLSL front end: falls back to the sources if the driver rejects it
+
+        if (linkSpirv(shared))
+        {
+            if (mProgramPool) {
+                mProgramPool->insert(poolKey, shared);
+            }
+
+            adoptProgram(shared);
+            if (!current)
+                mContext->doneCurrent();
+            return true;
+        }
+
+        // Try the program binary cache first, compile on a miss or if the driver rejects the binary
+
+        QByteArray key;
+
+        if (mProgramCache)
+        {
+            QByteArray driver = QByteArray(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "\n" +
+                QByteArray(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) + "\n" +
+                QByteArray(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+            key = ProgramCache::key(vertexShader, fragmentShader, driver);
+
+            if (loadProgramBinary(program, key))
+            {
+                shared->status = SharedProgram::Status::Ready;
+
+                if (mProgramPool) {
+                    mProgramPool->insert(poolKey, shared);
+                }
+
+                adoptProgram(shared);
+                if (!current)
+                    mContext->doneCurrent();
+                return true;
+            }
+        }
+
+        if (async && mShaderCompiler)
+        {
+            // Linked in the background: until finishLink() the operation keeps its current program,
+            // or passes its input through if it has none
+
+            program->create();
+
+            if (mProgramCache) {
+                glProgramParameteri(program->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+
+            mShaderCompiler->submit(shared, vertexShader, fragmentShader, key);
+
+            if (mProgramPool) {
+                mProgramPool->insert(poolKey, shared);
+            }
+
+            adoptProgram(shared);
+            if (!current)
+                mContext->doneCurrent();
+            return true;
+        }
+
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader))
+        {
+            mLinkLog += program->log();
+            ok = false;
+        }
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader))
+        {
+            mLinkLog += program->log();
+            ok = false;
+        }
+
+        if (mProgramCache) {
+            glProgramParameteri(program->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        if (!program->link())
+        {
+            mLinkLog += program->log();
+            ok = false;
+        }
+
+        shared->status = ok ? SharedProgram::Status::Ready : SharedProgram::Status::Failed;
+
+        if (ok && mProgramCache) {
+            storeProgramBinary(program, key);
+        }
+
+        if (ok && mProgramPool) {
+            mProgramPool->insert(poolKey, shared);
+        }
+
+        adoptProgram(shared);
+
+        if (!current)
+            mContext->doneCurrent();
+    }
+    else
+    {
+        mLinkLog = "Missing vertex or fragment shader";
+        ok = false;
+    }
+
+    return ok;
+}
+
+
+
+template <typename T>
+static void setConstants(ShaderPreprocessor& preprocessor, const QList<UniformParameter<T>*>& parameters)
+{
+    foreach (auto parameter, parameters)
+    {
+        if (parameter->specialized())
+        {
+            QStringList values;
+
+            foreach (T value, parameter->constValues())
+            {
+                if constexpr (std::is_same<T, float>::value)
+                    values.append(QString::number(value, 'g', 9));
+                else
+                    values.append(QString::number(value));
+            }
+
+            preprocessor.setConstant(parameter->uniformName(), values);
+        }
+    }
+}
+
+
+
+bool ImageOperation::preprocessShaders(QString& vertexShader, QString& fragmentShader)
+{
+    ShaderPreprocessor preprocessor;
+
+    if (!mSourceFile.isEmpty()) {
+        preprocessor.setBaseDirectory(QFileInfo(mSourceFile).absolutePath());
+    }
+
+    preprocessor.setDefine("ARRAY_TEX_DEPTH", QString::number(mArrayTexDepth));
+    preprocessor.setDefine("TEX_WIDTH", QString::number(mTexWidth));
+    preprocessor.setDefine("TEX_HEIGHT", QString::number(mTexHeight));
+    preprocessor.setDefine("FAN_IN", QString::number(mInputData.size()));
+
+    setConstants<float>(preprocessor, floatUniformParameters);
+    setConstants<int>(preprocessor, intUniformParameters);
+    setConstants<unsigned int>(preprocessor, uintUniformParameters);
+
+    mIncludedFiles.clear();
+
+    vertexShader = preprocessor.process(mVertexShader);
+    mIncludedFiles.append(preprocessor.includedFiles());
+
+    if (!preprocessor.ok())
+    {
+        mLinkLog = "Vertex shader: " + preprocessor.error();
+        return false;
+    }
+
+    fragmentShader = preprocessor.process(mFragmentShader);
+    mIncludedFiles.append(preprocessor.includedFiles());
+
+    if (!preprocessor.ok())
+    {
+        mLinkLog = "Fragment shader: " + preprocessor.error();
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Only usable if the sources do not depend on values set at run time: specialized parameters are compiled in
+
+bool ImageOperation::linkSpirv(QSharedPointer<SharedProgram> shared)
+{
+    if (mVertexSpirv.isEmpty() || mFragmentSpirv.isEmpty()) {
+        return false;
+    }
+
+    // An edited include makes the SPIR-V stale: dropped, the GLSL is compiled instead
+
+    if (mSpirvSourceKey.isEmpty() || expandedSourceKey() != mSpirvSourceKey)
+    {
+        setSpirv(QByteArray(), QByteArray(), QMap<QString, int>());
+        return false;
+    }
+
+    foreach (auto parameter, floatUniformParameters) {
+        if (parameter->specialized())
+            return false;
+    }
+    foreach (auto parameter, intUniformParameters) {
+        if (parameter->specialized())
+            return false;
+    }
+    foreach (auto parameter, uintUniformParameters) {
+        if (parameter->specialized())
+            return false;
+    }
+
+    typedef void (QOPENGLF_APIENTRYP SpecializeShader)(GLuint, const GLchar*, GLuint, const GLuint*, const GLuint*);
+
+    SpecializeShader specializeShader = reinterpret_cast<SpecializeShader>(mContext->getProcAddress("glSpecializeShader"));
+    if (!specializeShader) {
+        specializeShader = reinterpret_cast<SpecializeShader>(mContext->getProcAddress("glSpecializeShaderARB"));
+    }
+
+    if (!specializeShader || !(mContext->format().version() >= qMakePair(4, 6) || mContext->hasExtension("GL_ARB_gl_spirv"))) {
+        return false;
+    }
+
+    QOpenGLShaderProgram* program = &shared->program;
+
+    if (!program->create()) {
+        return false;
+    }
+
+    const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const QByteArray* binaries[2] = { &mVertexSpirv, &mFragmentSpirv };
+    GLuint shaders[2] = { 0, 0 };
+
+    bool ok = true;
+
+    for (int i = 0; i < 2 && ok; i++)
+    {
+        shaders[i] = glCreateShader(types[i]);
+
+        glShaderBinary(1, &shaders[i], GL_SHADER_BINARY_FORMAT_SPIR_V, binaries[i]->constData(), binaries[i]->size());
+        specializeShader(shaders[i], "main", 0, nullptr, nullptr);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+
+        if (status == GL_TRUE) {
+            glAttachShader(program->programId(), shaders[i]);
+        }
+        else {
+            ok = false;
         }
+    }
+
+    // With no shaders added through Qt, link() only checks the link status
+
+    if (ok)
+    {
+        glLinkProgram(program->programId());
+        ok = program->link();
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (shaders[i])
+        {
+            glDetachShader(program->programId(), shaders[i]);
+            glDeleteShader(shaders[i]);
+        }
+    }
+
+    // Reported with the log of the GLSL fallback
+
+    if (!ok)
+    {
+        mLinkLog += "SPIR-V rejected, compiling GLSL\n" + program->log();
+        return false;
+    }
+
+    shared->locations = mUniformLocations;
+    shared->status = SharedProgram::Status::Ready;
+
+    return true;
+}
+
+
+
+// Programs from SPIR-V need not keep uniform names: their explicit locations are looked up instead
+
+GLint ImageOperation::uniformLocation(const QString& name)
+{
+    auto it = mSharedProgram->locations.constFind(name);
+
+    if (it != mSharedProgram->locations.constEnd()) {
+        return it.value();
+    }
+
+    return mProgram->uniformLocation(name);
+}
+
+
+
+QStringList ImageOperation::includedFiles() const
+{
+    return mIncludedFiles;
+}
+
+
+
+void ImageOperation::setTextureSize(GLuint width, GLuint height)
+{
+    mTexWidth = width;
+    mTexHeight = height;
+}
+
+
+
+// A program still linking replaces a ready one only once linked: iterations go on with the old one meanwhile
+
+void ImageOperation::adoptProgram(QSharedPointer<SharedProgram> program)
+{
+    if (program->status == SharedProgram::Status::Linking && programReady())
+    {
+        mPendingProgram = program;
+    }
+    else
+    {
+        mPendingProgram.reset();
+        setSharedProgram(program);
+    }
+}
+
+
+
+// Pick up a program linked in the background, if this instance uses it or waits for it
+// The first instance sharing the program completes it for all of them
+// Called at the start of an iteration, so that a pending program is swapped in between frames
+
+bool ImageOperation::finishLink(const CompileResult& result)
+{
+    bool pending = mPendingProgram && mPendingProgram == result.program;
+
+    if (!pending && mSharedProgram != result.program) {
+        return false;
+    }
+
+    if (result.program->status == SharedProgram::Status::Linking)
+    {
+        // With no shaders added to it, link() only checks the link status
+
+        if (result.ok && result.program->program.link())
+        {
+            result.program->status = SharedProgram::Status::Ready;
+
+            if (mProgramCache && !result.cacheKey.isEmpty()) {
+                storeProgramBinary(&result.program->program, result.cacheKey);
+            }
+        }
+        else
+        {
+            result.program->status = SharedProgram::Status::Failed;
+        }
+    }
+
+    // A failed replacement leaves the current program in place
+
+    if (pending)
+    {
+        if (result.program->status == SharedProgram::Status::Ready) {
+            setSharedProgram(mPendingProgram);
+        }
+
+        mPendingProgram.reset();
+    }
+
+    mVersion++;
+    mLinkLog += result.log;
+
+    return true;
+}
+
+
+
+bool ImageOperation::programReady() const
+{
+    return mSharedProgram && mSharedProgram->status == SharedProgram::Status::Ready;
+}
+
+
+
+bool ImageOperation::programLinking() const
+{
+    return mSharedProgram && mSharedProgram->status == SharedProgram::Status::Linking;
+}
+
+
+
+QString ImageOperation::linkLog() const
+{
+    return mLinkLog;
+}
 
-        glBindSampler(0, mSamplerId);
 
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-        glBindSampler(0, 0);
+bool ImageOperation::loadProgramBinary(QOpenGLShaderProgram* program, const QByteArray& key)
+{
+    GLenum format = 0;
+    QByteArray binary;
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+    if (!mProgramCache->load(key, format, binary)) {
+        return false;
+    }
 
-        mProgram->release();
+    if (!program->create()) {
+        return false;
     }
+
+    glProgramBinary(program->programId(), format, binary.constData(), binary.size());
+
+    // With no shaders attached, link() only checks the link status left by glProgramBinary
+
+    if (program->link()) {
+        return true;
+    }
+
+    mProgramCache->remove(key);
+
+    return false;
 }
 
 
-QOpenGLShaderProgram* ImageOperation::program()
+
+void ImageOperation::storeProgramBinary(QOpenGLShaderProgram* program, const QByteArray& key)
 {
-    return mProgram;
+    GLint length = 0;
+    glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0) {
+        return;
+    }
+
+    QByteArray binary(length, Qt::Uninitialized);
+    GLenum format = 0;
+
+    glGetProgramBinary(program->programId(), length, nullptr, &format, binary.data());
+
+    mProgramCache->store(key, format, binary);
 }
 
 
 
-QString ImageOperation::vertexShader() const
+void ImageOperation::setProgramCache(ProgramCache* cache)
 {
-    return mVertexShader;
+    mProgramCache = cache;
 }
 
 
 
-QString ImageOperation::fragmentShader() const
+void ImageOperation::setProgramPool(ProgramPool* pool)
 {
-    return mFragmentShader;
+    mProgramPool = pool;
 }
 
 
 
-void ImageOperation::setVertexShader(QString shader)
+void ImageOperation::setShaderCompiler(ShaderCompiler* compiler)
 {
-    mVertexShader = shader;
+    mShaderCompiler = compiler;
 }
 
 
 
-void ImageOperation::setFragmentShader(QString shader)
+void ImageOperation::setSharedProgram(QSharedPointer<SharedProgram> program)
 {
-    mFragmentShader = shader;
+    if (mSharedProgram && mSharedProgram->owner == this) {
+        mSharedProgram->owner = nullptr;
+    }
+
+    mSharedProgram = program;
+    mProgram = program ? &program->program : nullptr;
 }
 
 
 
-bool ImageOperation::linkShaders()
-{
-    bool ok = true;
+// Bind the program, first restoring this instance's uniforms if another instance set its own since
 
-    if (!mVertexShader.isEmpty() && !mFragmentShader.isEmpty())
+void ImageOperation::bindProgram()
+{
+    if (mUpdate && mSharedProgram->owner != this)
     {
-        mContext->makeCurrent(mSurface);
+        mSharedProgram->owner = this;
+        restoreUniforms();
+    }
 
-        mProgram->removeAllShaders();
+    mProgram->bind();
+}
 
-        if (!mProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, mVertexShader))
-        {
-            QMessageBox::information(qApp->activeWindow(), "Vertex shader error", mProgram->log());
-            ok = false;
-        }
-        if (!mProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, mFragmentShader))
-        {
-            QMessageBox::information(qApp->activeWindow(), "Fragment shader error", mProgram->log());
-            ok = false;
-        }
 
-        if (!mProgram->link())
-        {
-            QMessageBox::information(qApp->activeWindow(), "Shader link error", mProgram->log());
-            ok = false;
-        }
 
-        mContext->doneCurrent();
+void ImageOperation::restoreUniforms()
+{
+    // Same values as before: the output does not change
+
+    quint64 version = mVersion;
+
+    foreach (auto parameter, floatUniformParameters) {
+        parameter->setUniform();
     }
-    else
-    {
-        ok = false;
+    foreach (auto parameter, intUniformParameters) {
+        parameter->setUniform();
+    }
+    foreach (auto parameter, uintUniformParameters) {
+        parameter->setUniform();
+    }
+    foreach (auto parameter, mMat4UniformParameters) {
+        parameter->setUniform();
     }
 
-    return ok;
+    mVersion = version;
 }
 
 
@@ -330,12 +1008,17 @@ void ImageOperation::adjustOrtho(GLfloat left, GLfloat right, GLfloat bottom, GL
 template <>
 void ImageOperation::setUniform<float>(QString name, int type, GLsizei count, const float* values)
 {
-    if (mUpdate)
+    if (mUpdate && programReady())
     {
-        mContext->makeCurrent(mSurface);
-        mProgram->bind();
+        mVersion++;
 
-        int location = mProgram->uniformLocation(name);
+        bool current = QOpenGLContext::currentContext() == mContext;
+        if (!current)
+            mContext->makeCurrent(mSurface);
+
+        bindProgram();
+
+        int location = uniformLocation(name);
 
         if (type == GL_FLOAT)
             glUniform1fv(location, count, values);
@@ -353,7 +1036,9 @@ void ImageOperation::setUniform<float>(QString name, int type, GLsizei count, co
             glUniformMatrix4fv(location, count, GL_FALSE, values);
 
         mProgram->release();
-        mContext->doneCurrent();
+
+        if (!current)
+            mContext->doneCurrent();
     }
 }
 
@@ -362,12 +1047,17 @@ void ImageOperation::setUniform<float>(QString name, int type, GLsizei count, co
 template <>
 void ImageOperation::setUniform<int>(QString name, int type, GLsizei count, const int* values)
 {
-    if (mUpdate)
+    if (mUpdate && programReady())
     {
-        mContext->makeCurrent(mSurface);
-        mProgram->bind();
+        mVersion++;
+
+        bool current = QOpenGLContext::currentContext() == mContext;
+        if (!current)
+            mContext->makeCurrent(mSurface);
+
+        bindProgram();
 
-        int location = mProgram->uniformLocation(name);
+        int location = uniformLocation(name);
 
         if (type == GL_INT)
             glUniform1iv(location, count, values);
@@ -379,7 +1069,9 @@ void ImageOperation::setUniform<int>(QString name, int type, GLsizei count, cons
             glUniform4iv(location, count, values);
 
         mProgram->release();
-        mContext->doneCurrent();
+
+        if (!current)
+            mContext->doneCurrent();
     }
 }
 
@@ -388,12 +1080,17 @@ void ImageOperation::setUniform<int>(QString name, int type, GLsizei count, cons
 template <>
 void ImageOperation::setUniform<unsigned int>(QString name, int type, GLsizei count, const unsigned int* values)
 {
-    if (mUpdate)
+    if (mUpdate && programReady())
     {
-        mContext->makeCurrent(mSurface);
-        mProgram->bind();
+        mVersion++;
 
-        int location = mProgram->uniformLocation(name);
+        bool current = QOpenGLContext::currentContext() == mContext;
+        if (!current)
+            mContext->makeCurrent(mSurface);
+
+        bindProgram();
+
+        int location = uniformLocation(name);
 
         if (type == GL_UNSIGNED_INT)
             glUniform1uiv(location, count, values);
@@ -405,7 +1102,9 @@ void ImageOperation::setUniform<unsigned int>(QString name, int type, GLsizei co
             glUniform4uiv(location, count, values);
 
         mProgram->release();
-        mContext->doneCurrent();
+
+        if (!current)
+            mContext->doneCurrent();
     }
 }
 
@@ -413,8 +1112,10 @@ void ImageOperation::setUniform<unsigned int>(QString name, int type, GLsizei co
 
 void ImageOperation::setMat4Uniform(QString name, UniformMat4Type type, QList<float> values)
 {
-    if (mUpdate)
+    if (mUpdate && programReady())
     {
+        mVersion++;
+
         QMatrix4x4 matrix;
         matrix.setToIdentity();
 
@@ -427,14 +1128,19 @@ void ImageOperation::setMat4Uniform(QString name, UniformMat4Type type, QList<fl
         else if (type == UniformMat4Type::ORTHOGRAPHIC)
             matrix.ortho(values.at(0), values.at(1), values.at(2), values.at(3), -1.0, 1.0);
 
-        mContext->makeCurrent(mSurface);
-        mProgram->bind();
+        bool current = QOpenGLContext::currentContext() == mContext;
+        if (!current)
+            mContext->makeCurrent(mSurface);
+
+        bindProgram();
 
-        int location = mProgram->uniformLocation(name);
+        int location = uniformLocation(name);
         mProgram->setUniformValue(location, matrix);
 
         mProgram->release();
-        mContext->doneCurrent();
+
+        if (!current)
+            mContext->doneCurrent();
     }
 }
 
@@ -472,6 +1178,59 @@ void ImageOperation::setAllParameters()
 
 
 
+// Upload the uniforms whose values changed since the last frame
+// Called by the render loop with the context already current
+
+void ImageOperation::flushUniforms()
+{
+    foreach (auto parameter, floatUniformParameters)
+        parameter->notifyPending();
+    foreach (auto parameter, intUniformParameters)
+        parameter->notifyPending();
+    foreach (auto parameter, uintUniformParameters)
+        parameter->notifyPending();
+    foreach (auto parameter, mMat4UniformParameters)
+        parameter->notifyPending();
+
+    if (!mUpdate)
+        return;
+
+    bool respecialize = false;
+
+    foreach (auto parameter, floatUniformParameters) {
+        respecialize |= parameter->specialized() && parameter->dirty();
+        parameter->flushUniform();
+    }
+    foreach (auto parameter, intUniformParameters) {
+        respecialize |= parameter->specialized() && parameter->dirty();
+        parameter->flushUniform();
+    }
+    foreach (auto parameter, uintUniformParameters) {
+        respecialize |= parameter->specialized() && parameter->dirty();
+        parameter->flushUniform();
+    }
+    foreach (auto parameter, mMat4UniformParameters) {
+        parameter->flushUniform();
+    }
+
+    // Specialized values are constants of the program: relinked in the background once edits settle,
+    // so that dragging a slider does not link and cache a program per value; the current program renders meanwhile
+
+    if (respecialize)
+    {
+        mRespecializePending = true;
+        mRespecializeClock.start();
+    }
+
+    if (mRespecializePending && mRespecializeClock.elapsed() >= mRespecializeDelay)
+    {
+        mRespecializePending = false;
+        linkShaders(true);
+    }
+}
+
+
+
 QOpenGLContext* ImageOperation::context() const
 {
     return mContext;
@@ -489,12 +1248,246 @@ bool ImageOperation::enabled() const
 void ImageOperation::enable(bool set)
 {
     mEnabled = set;
+    mVersion++;
     setOutTextureId();
     setBlitInTextureId();
 }
 
 
 
+template <typename P>
+static bool sameParameters(const QList<P*>& parameters, const QList<P*>& others)
+{
+    if (parameters.size() != others.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < parameters.size(); i++)
+    {
+        if (parameters[i]->uniformName() != others[i]->uniformName() || parameters[i]->specialized() != others[i]->specialized()) {
+            return false;
+        }
+
+        auto numbers = parameters[i]->numbers();
+        auto otherNumbers = others[i]->numbers();
+
+        if (numbers.size() != otherNumbers.size()) {
+            return false;
+        }
+
+        for (int j = 0; j < numbers.size(); j++) {
+            if (numbers[j]->id() != otherNumbers[j]->id())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+template <typename P>
+static void assignParameters(const QList<P*>& parameters, const QList<P*>& others)
+{
+    for (int i = 0; i < parameters.size(); i++)
+    {
+        auto numbers = parameters[i]->numbers();
+        auto otherNumbers = others[i]->numbers();
+
+        for (int j = 0; j < numbers.size(); j++)
+        {
+            numbers[j]->setInf(otherNumbers[j]->inf());
+            numbers[j]->setSup(otherNumbers[j]->sup());
+            numbers[j]->setMin(otherNumbers[j]->min());
+            numbers[j]->setMax(otherNumbers[j]->max());
+        }
+
+        parameters[i]->setPresets(others[i]->presets());
+        parameters[i]->setValues(others[i]->values());
+    }
+}
+
+
+
+template <typename P>
+static void takeParameters(const QList<P*>& parameters, const QList<P*>& others)
+{
+    foreach (P* parameter, parameters)
+    {
+        foreach (P* other, others)
+        {
+            if (parameter->uniformName() != other->uniformName() || parameter->numbers().size() != other->numbers().size())
+                continue;
+
+            auto numbers = parameter->numbers();
+            auto otherNumbers = other->numbers();
+
+            for (int j = 0; j < numbers.size(); j++)
+                numbers[j]->setId(otherNumbers[j]->id());
+
+            parameter->setValues(other->values());
+
+            break;
+        }
+    }
+}
+
+
+
+// Same shaders and parameters, down to the ids of their numbers, which midi links refer to:
+// this instance can take the other's values instead of being replaced by it
+
+bool ImageOperation::sameLayout(ImageOperation* operation)
+{
+    if (mVertexShader != operation->mVertexShader || mFragmentShader != operation->mFragmentShader ||
+        mSampler2DName != operation->mSampler2DName || mSampler2DArrayName != operation->mSampler2DArrayName) {
+        return false;
+    }
+
+    if (!sameParameters(floatUniformParameters, operation->floatUniformParameters) ||
+        !sameParameters(intUniformParameters, operation->intUniformParameters) ||
+        !sameParameters(uintUniformParameters, operation->uintUniformParameters) ||
+        !sameParameters(mMat4UniformParameters, operation->mMat4UniformParameters)) {
+        return false;
+    }
+
+    if (glenumOptionsParameters.size() != operation->glenumOptionsParameters.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < glenumOptionsParameters.size(); i++) {
+        if (glenumOptionsParameters[i]->values() != operation->glenumOptionsParameters[i]->values())
+            return false;
+    }
+
+    return true;
+}
+
+
+
+template <typename P>
+static void addLayout(QCryptographicHash& hash, const QList<P*>& parameters)
+{
+    hash.addData(QByteArray::number(parameters.size()));
+
+    foreach (P* parameter, parameters)
+    {
+        hash.addData(parameter->uniformName().toUtf8());
+        hash.addData(QByteArray::number(parameter->specialized()));
+        hash.addData(QByteArray::number(parameter->numbers().size()));
+    }
+}
+
+
+
+// Layout as compared by sameLayout, without the ids of the numbers:
+// pairs operations of a configuration saved by another session with running ones
+
+QByteArray ImageOperation::layoutKey() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    foreach (QString text, QStringList({ mVertexShader, mFragmentShader, mSampler2DName, mSampler2DArrayName }))
+    {
+        hash.addData(text.toUtf8());
+        hash.addData(QByteArray(1, '\0'));
+    }
+
+    addLayout(hash, floatUniformParameters);
+    addLayout(hash, intUniformParameters);
+    addLayout(hash, uintUniformParameters);
+    addLayout(hash, mMat4UniformParameters);
+
+    foreach (auto parameter, glenumOptionsParameters) {
+        foreach (GLenum value, parameter->values())
+            hash.addData(QByteArray::number(value));
+    }
+
+    return hash.result();
+}
+
+
+
+template <typename P>
+static void takeNumberIds(const QList<P*>& parameters, const QList<P*>& others, QHash<QUuid, QUuid>& numberIds)
+{
+    for (int i = 0; i < parameters.size(); i++)
+    {
+        auto numbers = parameters[i]->numbers();
+        auto otherNumbers = others[i]->numbers();
+
+        for (int j = 0; j < numbers.size(); j++)
+        {
+            numberIds.insert(numbers[j]->id(), otherNumbers[j]->id());
+            numbers[j]->setId(otherNumbers[j]->id());
+        }
+    }
+}
+
+
+
+// Numbers take the ids of the other operation's, which has the same layout key: numberIds maps the old ids to the new ones
+
+void ImageOperation::takeIds(ImageOperation* operation, QHash<QUuid, QUuid>& numberIds)
+{
+    takeNumberIds(floatUniformParameters, operation->floatUniformParameters, numberIds);
+    takeNumberIds(intUniformParameters, operation->intUniformParameters, numberIds);
+    takeNumberIds(uintUniformParameters, operation->uintUniformParameters, numberIds);
+    takeNumberIds(mMat4UniformParameters, operation->mMat4UniformParameters, numberIds);
+}
+
+
+
+void ImageOperation::assignValues(ImageOperation* operation)
+{
+    enable(operation->mEnabled);
+
+    assignParameters(floatUniformParameters, operation->floatUniformParameters);
+    assignParameters(intUniformParameters, operation->intUniformParameters);
+    assignParameters(uintUniformParameters, operation->uintUniformParameters);
+    assignParameters(mMat4UniformParameters, operation->mMat4UniformParameters);
+
+    for (int i = 0; i < glenumOptionsParameters.size(); i++)
+    {
+        qsizetype index = glenumOptionsParameters[i]->values().indexOf(operation->glenumOptionsParameters[i]->value());
+
+        if (index >= 0 && glenumOptionsParameters[i]->value() != operation->glenumOptionsParameters[i]->value()) {
+            glenumOptionsParameters[i]->setValue(index);
+        }
+    }
+}
+
+
+
+// Values of the uniforms this operation shares by name with the other one, and the ids of their numbers, which midi links refer to
+// Uniforms the other one lacks keep their defaults
+
+void ImageOperation::takeValues(const ImageOperation& operation)
+{
+    takeParameters(floatUniformParameters, operation.floatUniformParameters);
+    takeParameters(intUniformParameters, operation.intUniformParameters);
+    takeParameters(uintUniformParameters, operation.uintUniformParameters);
+    takeParameters(mMat4UniformParameters, operation.mMat4UniformParameters);
+
+    foreach (auto parameter, glenumOptionsParameters)
+    {
+        foreach (auto other, operation.glenumOptionsParameters)
+        {
+            if (parameter->name() != other->name())
+                continue;
+
+            qsizetype index = parameter->values().indexOf(other->value());
+            if (index >= 0) {
+                parameter->setValue(index);
+            }
+
+            break;
+        }
+    }
+}
+
+
+
 void ImageOperation::setOutTextureId()
 {
     if (mEnabled)
@@ -546,6 +1539,7 @@ void ImageOperation::setBlitInTextureId()
 void ImageOperation::enableBlit(bool set)
 {
     mBlitEnabled = set;
+    mVersion++;
     setBlitInTextureId();
     setOutTextureId();
 }
@@ -589,6 +1583,10 @@ void ImageOperation::setName(QString theName)
 
 void ImageOperation::setInputData(QList<InputData*> data)
 {
+    mVersion++;
+
+    qsizetype fanIn = mInputData.size();
+
     if (data.size() > 1)
     {
         mBlendEnabled = true;
@@ -619,6 +1617,12 @@ void ImageOperation::setInputData(QList<InputData*> data)
     foreach(InputData* iData, data) {
         mInputBlendFactors.append(iData->blendFactor());
     }
+
+    // Shaders may use the number of inputs as FAN_IN
+
+    if (mContext && fanIn != data.size()) {
+        linkShaders(true);
+    }
 }
 
 
@@ -757,6 +1761,29 @@ void ImageOperation::setSampler2DArrayAvail(bool available)
 
 
 
+void ImageOperation::setHistogramCdfTextureId(GLuint* pTexId)
+{
+    pCdfTexId = pTexId;
+}
+
+
+
+bool ImageOperation::samplesHistogram()
+{
+    // Expects current context
+
+    return pCdfTexId && mProgram->isLinked() && uniformLocation("histogramCdf") >= 0;
+}
+
+
+
+quint64 ImageOperation::version() const
+{
+    return mVersion;
+}
+
+
+
 QString ImageOperation::sampler2DArrayName() const
 {
     return mSampler2DArrayName;
@@ -968,6 +1995,7 @@ Number<unsigned int>* ImageOperation::number(QUuid id)
 void ImageOperation::setMinMagFilter(GLenum filter)
 {
     mMinMagFilter = filter;
+    mVersion++;
 
     mContext->makeCurrent(mSurface);
 
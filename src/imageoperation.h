@@ -31,6 +31,9 @@
 #include "parameters/uniformparameter.h"
 #include "parameters/uniformmat4parameter.h"
 #include "parameters/optionsparameter.h"
+#include "programcache.h"
+#include "programpool.h"
+#include "shadercompiler.h"
 
 #include <QOpenGLFunctions_4_5_Core>
 #include <QOpenGLContext>
@@ -43,9 +46,14 @@
 #include <QVector3D>
 #include <QMatrix4x4>
 #include <QString>
+#include <QStringList>
+#include <QByteArray>
 #include <QMap>
+#include <QHash>
 #include <QUuid>
 #include <QObject>
+#include <QSharedPointer>
+#include <QElapsedTimer>
 
 
 
@@ -69,7 +77,36 @@ public:
     void setVertexShader(QString shader);
     void setFragmentShader(QString shader);
 
-    bool linkShaders();
+    QString sourceFile() const;
+    void setSourceFile(QString filename);
+
+    QString vertexShaderFile() const;
+    void setVertexShaderFile(QString filename);
+
+    QString fragmentShaderFile() const;
+    void setFragmentShaderFile(QString filename);
+
+    QByteArray vertexSpirv() const;
+    QByteArray fragmentSpirv() const;
+    QMap<QString, int> uniformLocations() const;
+    QByteArray spirvSourceKey() const;
+    void setSpirv(QByteArray vertexSpirv, QByteArray fragmentSpirv, QMap<QString, int> locations, QByteArray sourceKey = QByteArray());
+
+    QByteArray expandedSourceKey(QStringList* includedFiles = nullptr) const;
+
+    QStringList includedFiles() const;
+
+    void setTextureSize(GLuint width, GLuint height);
+
+    bool linkShaders(bool async = false);
+    bool finishLink(const CompileResult& result);
+    bool programReady() const;
+    bool programLinking() const;
+    QString linkLog() const;
+
+    void setProgramCache(ProgramCache* cache);
+    void setProgramPool(ProgramPool* pool);
+    void setShaderCompiler(ShaderCompiler* compiler);
 
     void adjustOrtho(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top);
 
@@ -82,12 +119,19 @@ public:
     void setOptionsParameter(OptionsParameter<T>* parameter);
 
     void setAllParameters();
+    void flushUniforms();
 
     QOpenGLContext* context() const;
 
     bool enabled() const;
     void enable(bool set);
 
+    bool sameLayout(ImageOperation* operation);
+    QByteArray layoutKey() const;
+    void takeIds(ImageOperation* operation, QHash<QUuid, QUuid>& numberIds);
+    void assignValues(ImageOperation* operation);
+    void takeValues(const ImageOperation& operation);
+
     bool blitEnabled() const;
     void enableBlit(bool set);
 
@@ -132,6 +176,11 @@ public:
     QString sampler2DArrayName() const;
     void setSampler2DArrayName(QString name);
 
+    void setHistogramCdfTextureId(GLuint* pTexId);
+    bool samplesHistogram();
+
+    quint64 version() const;
+
     template <typename T>
     QList<UniformParameter<T>*> uniformParameters();
 
@@ -167,11 +216,35 @@ private:
     QOpenGLContext* mContext = nullptr;
     QOffscreenSurface* mSurface = nullptr;
 
+    QSharedPointer<SharedProgram> mSharedProgram;
+    QSharedPointer<SharedProgram> mPendingProgram;
     QOpenGLShaderProgram* mProgram = nullptr;
+    ProgramCache* mProgramCache = nullptr;
+    ProgramPool* mProgramPool = nullptr;
+    ShaderCompiler* mShaderCompiler = nullptr;
+
+    QString mLinkLog;
+
+    QString mSourceFile;
+    QString mVertexShaderFile;
+    QString mFragmentShaderFile;
+
+    QStringList mIncludedFiles;
 
     QString mVertexShader;
     QString mFragmentShader;
 
+    // SPIR-V of the shaders from an operation bundle, with the uniform locations it was compiled with
+    // and the key of the sources with includes expanded it was compiled from
+
+    QByteArray mVertexSpirv;
+    QByteArray mFragmentSpirv;
+    QMap<QString, int> mUniformLocations;
+    QByteArray mSpirvSourceKey;
+
+    GLuint mTexWidth = 2048;
+    GLuint mTexHeight = 2048;
+
     GLenum mMinMagFilter = GL_NEAREST;
     GLuint mSamplerId = 0;
 
@@ -195,6 +268,18 @@ private:
     GLuint mArrayTexId = 0;
     GLsizei mArrayTexDepth = 10;
 
+    GLuint* pCdfTexId = nullptr;
+
+    // Incremented whenever the output would change for the same inputs
+
+    quint64 mVersion = 0;
+
+    // Specialized parameters being edited: relinked once the value has not changed for a while
+
+    QElapsedTimer mRespecializeClock;
+    bool mRespecializePending = false;
+    static const int mRespecializeDelay = 250;
+
     QString mSampler2DName;
     QString mSampler2DArrayName;
 
@@ -210,6 +295,19 @@ private:
     QList<OptionsParameter<GLenum>*> glenumOptionsParameters;
 
     void setMinMagFilter(GLenum filter);
+
+    bool loadProgramBinary(QOpenGLShaderProgram* program, const QByteArray& key);
+    void storeProgramBinary(QOpenGLShaderProgram* program, const QByteArray& key);
+
+    bool preprocessShaders(QString& vertexShader, QString& fragmentShader);
+    bool linkSpirv(QSharedPointer<SharedProgram> shared);
+
+    GLint uniformLocation(const QString& name);
+
+    void setSharedProgram(QSharedPointer<SharedProgram> program);
+    void adoptProgram(QSharedPointer<SharedProgram> program);
+    void bindProgram();
+    void restoreUniforms();
 };
 
 
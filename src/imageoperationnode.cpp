@@ -207,33 +207,6 @@ void ImageOperationNode::setInputSeedTexId(QUuid id, GLuint* texId)
 
 
 
-bool ImageOperationNode::computed() const
-{
-    return mComputed;
-}
-
-
-
-bool ImageOperationNode::allInputsComputed()
-{
-    foreach (ImageOperationNode* node, mInputNodes)
-    {
-        if(!node->computed() && mInputs.value(node->id())->type() == InputType::Normal)
-            return false;
-    }
-
-    return true;
-}
-
-
-
-void ImageOperationNode::setComputed(bool done)
-{
-    mComputed = done;
-}
-
-
-
 Number<float>* ImageOperationNode::blendFactor(QUuid id)
 {
     return mInputs.value(id)->blendFactor();
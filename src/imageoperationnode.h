@@ -47,10 +47,6 @@ public:
     void addOutput(ImageOperationNode* node);
     void removeOutput(ImageOperationNode* node);
 
-    bool computed() const;
-    void setComputed(bool done);
-    bool allInputsComputed();
-
     Number<float>* blendFactor(QUuid id);
     void setBlendFactor(QUuid id, float factor);
     void equalizeBlendFactors();
@@ -68,8 +64,6 @@ private:
     QMap<QUuid, ImageOperationNode*> mOutputNodes;
 
     QMap<QUuid, InputData*> mInputs;
-
-    bool mComputed = false;
 };
 
 #endif // IMAGEOPERATIONNODE_H
@@ -23,9 +23,12 @@
 
 
 #include "mainwindow.h"
+#include "operationbundle.h"
 
 #include <QApplication>
 #include <QSurfaceFormat>
+#include <QDir>
+#include <QDebug>
 
 
 
@@ -44,8 +47,38 @@ int main(int argc, char* argv[])
 
     QApplication app(argc, argv);
 
+    // fosforo --convert-operations [directory]: writes a bundle next to each operation file and exits
+
+    QStringList arguments = app.arguments();
+    qsizetype convert = arguments.indexOf("--convert-operations");
+
+    if (convert >= 0)
+    {
+        QString directory = convert + 1 < arguments.size() ? arguments[convert + 1] : QDir::currentPath() + "/operations";
+        int written = OperationBundle::convertDirectory(directory);
+
+        if (written < 0)
+        {
+            qWarning() << directory << "is not a directory";
+            return 1;
+        }
+
+        qInfo() << written << "bundles written in" << directory;
+
+        return 0;
+    }
+
     MainWindow window;
     window.show();
 
+    // fosforo --benchmark [nodes]: times building, copying, pasting, saving and loading a synthetic graph and exits
+
+    qsizetype benchmark = arguments.indexOf("--benchmark");
+
+    if (benchmark >= 0) {
+        int nodes = benchmark + 1 < arguments.size() ? arguments[benchmark + 1].toInt() : 0;
+        window.benchmark(nodes > 0 ? nodes : 1000);
+    }
+
     return app.exec();
 }
@@ -66,6 +66,14 @@ MainWindow::MainWindow()
     connect(&midiLinkManager, &MidiLinkManager::midiEnabled, nodeManager, &NodeManager::midiEnabled);
     connect(&midiLinkManager, &MidiLinkManager::midiEnabled, factory, &Factory::setMidiEnabled);
 
+    // Image statistics drive linked parameters through a virtual port
+    // Queued: statistics arrive while rendering and parameter updates make the context current
+
+    connect(plotsWidget->statisticsWidget(), &StatisticsWidget::linkRequested, &midiLinkManager, &MidiLinkManager::updateMidiLinks);
+    connect(plotsWidget->statisticsWidget(), &StatisticsWidget::linkedValuesChanged, &midiLinkManager, &MidiLinkManager::updateLinkedValues, Qt::QueuedConnection);
+
+    midiLinkManager.addVirtualPort(StatisticsWidget::portName, StatisticsWidget::indexMax);
+
     midiControl.setInputPorts();
 
     connect(iterationTimer, &TimerThread::timeout, this, &MainWindow::beat);
@@ -90,6 +98,10 @@ MainWindow::MainWindow()
 
         iterationTimer->start();
         updateTimer->start();
+
+        if (benchmarkNodes > 0) {
+            QTimer::singleShot(0, this, &MainWindow::runBenchmark);
+        }
     });
     connect(morphoWidget, &MorphoWidget::supportedTexFormats, controlWidget, &ControlWidget::populateTexFormatComboBox);
     connect(morphoWidget, &MorphoWidget::scaleTransformChanged, plotsWidget, &PlotsWidget::transformSources);
@@ -100,13 +112,29 @@ MainWindow::MainWindow()
     connect(controlWidget, &ControlWidget::iterateStateChanged, this, &MainWindow::setIterationState);
     connect(controlWidget, &ControlWidget::updateStateChanged, morphoWidget, &MorphoWidget::setUpdate);
 
+    // Queued: convergence is detected while rendering
+
+    connect(plotsWidget->convergenceWidget(), &ConvergenceWidget::reseedRequested, renderManager, &RenderManager::reset, Qt::QueuedConnection);
+    connect(plotsWidget->convergenceWidget(), &ConvergenceWidget::throttleRequested, this, &MainWindow::throttleIteration, Qt::QueuedConnection);
+    connect(plotsWidget->convergenceWidget(), &ConvergenceWidget::pauseRequested, controlWidget, &ControlWidget::pause, Qt::QueuedConnection);
+
     connect(renderManager, &RenderManager::texturesChanged, nodeManager, &NodeManager::onTexturesChanged);
+    connect(renderManager, &RenderManager::cachedOperationsChanged, graphWidget, &GraphWidget::setCachedOperations);
+    connect(factory, &Factory::shaderError, renderManager, &RenderManager::shaderError);
+    connect(factory, &Factory::replaceOpCreated, &midiLinkManager, &MidiLinkManager::relinkOperation);
+    connect(this, &MainWindow::iterationTimeMeasured, graphWidget, [=, this]() {
+        graphWidget->setRenderTimes(renderManager->renderTimes());
+    });
 
     connect(nodeManager, &NodeManager::outputTextureChanged, renderManager, &RenderManager::setOutputTextureId);
     connect(nodeManager, &NodeManager::outputTextureChanged, morphoWidget, &MorphoWidget::setOutputTextureId);
+    connect(renderManager, &RenderManager::displayTextureChanged, morphoWidget, &MorphoWidget::setOutputTextureId);
     connect(nodeManager, &NodeManager::outputTextureChanged, plotsWidget, &PlotsWidget::setTextureID);
     // connect(nodeManager, &NodeManager::outputFBOChanged, plotsWidget, &PlotsWidget::setFBO);
-    connect(nodeManager, &NodeManager::sortedOperationsChanged, renderManager, &RenderManager::setSortedOperations);
+    connect(nodeManager, &NodeManager::renderedOperationsChanged, renderManager, &RenderManager::setSortedOperations);
+    connect(nodeManager, &NodeManager::prunedNodesChanged, graphWidget, &GraphWidget::setPrunedNodes);
+    connect(plotsWidget, &PlotsWidget::probedTexturesChanged, nodeManager, &NodeManager::setSinks);
+    connect(nodeManager, &NodeManager::sortedOperationsChanged, plotsWidget, &PlotsWidget::setProbeOperations);
     connect(nodeManager, &NodeManager::parameterValueChanged, overlay, &Overlay::addMessage);
     connect(nodeManager, &NodeManager::midiSignalsCreated, &midiLinkManager, &MidiLinkManager::addMidiSignals);
     connect(nodeManager, &NodeManager::midiSignalsRemoved, &midiLinkManager, &MidiLinkManager::removeMidiSignals);
@@ -121,9 +149,11 @@ MainWindow::MainWindow()
     connect(controlWidget, &ControlWidget::overlayToggled, overlay, &Overlay::enable);
     connect(controlWidget, &ControlWidget::readConfig, configParser, &ConfigurationParser::read);
     connect(controlWidget, &ControlWidget::writeConfig, configParser, &ConfigurationParser::write);
+    connect(controlWidget, &ControlWidget::crossfadeDurationChanged, configParser, &ConfigurationParser::setCrossfadeDuration);
 
     connect(configParser, &ConfigurationParser::newImageSizeRead, controlWidget, &ControlWidget::updateWindowSizeLineEdits);
     connect(configParser, &ConfigurationParser::newImageSizeRead, this, &MainWindow::setSize);
+    connect(configParser, &ConfigurationParser::crossfadeRequested, morphoWidget, &MorphoWidget::startCrossfade);
 
     setWindowTitle("Fosforo");
     setWindowIcon(QIcon(QPixmap(":/icons/logo.png")));
@@ -246,6 +276,15 @@ void MainWindow::setIterationTimerInterval(double newFPS)
 
 
 
+void MainWindow::throttleIteration(bool on)
+{
+    // Converged system: iterate slower without forgetting the chosen rate
+
+    iterationTimer->setTimerInterval(on ? qMax(1.0, iterationFPS / 8.0) : iterationFPS);
+}
+
+
+
 void MainWindow::setUpdateTimerInterval(double newFPS)
 {
     updateFPS = newFPS;
@@ -299,6 +338,26 @@ void MainWindow::showMidiWidget()
 
 
 
+// Benchmark runs once OpenGL is initialized, since loading a configuration links programs
+
+void MainWindow::benchmark(int numNodes)
+{
+    benchmarkNodes = numNodes;
+}
+
+
+
+void MainWindow::runBenchmark()
+{
+    Benchmark* benchmark = new Benchmark(factory, nodeManager, configParser, benchmarkNodes, this);
+    connect(benchmark, &Benchmark::finished, this, [=](int exitCode) {
+        QCoreApplication::exit(exitCode);
+    });
+    benchmark->run();
+}
+
+
+
 void MainWindow::setSize(int width, int height)
 {
     if (stackedLayout->currentWidget() == controlWidget)
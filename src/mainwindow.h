@@ -18,8 +18,10 @@
 #include "midilinkmanager.h"
 #include "overlay.h"
 #include "videoinputcontrol.h"
+#include "benchmark.h"
 
 #include <QMainWindow>
+#include <QCoreApplication>
 #include <QStackedLayout>
 #include <QGraphicsOpacityEffect>
 #include <QChronoTimer>
@@ -38,6 +40,8 @@ public:
     void stopRecording();
     int getFrameCount();
 
+    void benchmark(int numNodes);
+
 signals:
     void outputTextureChanged(GLuint id);
 
@@ -88,6 +92,8 @@ private:
     QGraphicsOpacityEffect* controlWidgetOpacityEffect;
     qreal opacity = 0.9;
 
+    int benchmarkNodes = 0;
+
 private slots:
     void beat();
     void iterate();
@@ -99,12 +105,15 @@ private slots:
     void setIterationTimerInterval(double newFPS);
 
     void setIterationState(bool state);
+    void throttleIteration(bool on);
 
     void takeScreenshot(QString filename);
 
     void setSize(int with, int height);
 
     void showMidiWidget();
+
+    void runBenchmark();
 };
 
 
@@ -3,6 +3,8 @@
 
 #include "midilinkmanager.h"
 
+#include <tuple>
+
 
 
 MidiLinkManager::MidiLinkManager(QObject *parent)
@@ -13,10 +15,12 @@ MidiLinkManager::MidiLinkManager(QObject *parent)
 
 bool MidiLinkManager::enabled()
 {
+    // Virtual ports are always open and do not count as the user enabling MIDI
+
     bool anyPortOpen = false;
 
-    foreach (bool open, mPortOpen) {
-        anyPortOpen |= open;
+    for (auto [portName, open] : mPortOpen.asKeyValueRange()) {
+        anyPortOpen |= open && !mVirtualPorts.contains(portName);
     }
 
     return anyPortOpen;
@@ -92,6 +96,18 @@ void MidiLinkManager::setupMidi(QString portName, bool open)
 
 
 
+void MidiLinkManager::addVirtualPort(QString portName, int indexMax)
+{
+    // Source of values other than a MIDI device, always open, with its own resolution
+
+    mPortIndexMax[portName] = indexMax;
+    mVirtualPorts.insert(portName);
+
+    setupMidi(portName, true);
+}
+
+
+
 void MidiLinkManager::updateMidiLinks(QString portName, int key, int value)
 {
     if (mLinkingFloat != nullptr)
@@ -118,37 +134,43 @@ void MidiLinkManager::updateMidiLinks(QString portName, int key, int value)
     else
     {
         // No number being linked: set value of already linked number
-        // For each QMultiMap, iterate over all QMultiMap items
 
-        if (mFloatLinks.contains(portName) && mFloatLinks[portName].contains(key))
+        updateLinkedValues(portName, key, value);
+    }
+}
+
+
+
+void MidiLinkManager::updateLinkedValues(QString portName, int key, int value)
+{
+    // For each QMultiMap, iterate over all QMultiMap items
+    // Values are deferred: widgets learn about them once per frame, when the operation flushes its uniforms
+
+    if (mFloatLinks.contains(portName) && mFloatLinks[portName].contains(key))
+    {
+        auto [it, end] = mFloatLinks[portName].equal_range(key);
+        while (it != end)
         {
-            auto [it, end] = mFloatLinks[portName].equal_range(key);
-            while (it != end)
-            {
-                it.value()->setValueFromIndex(value);
-                it.value()->setIndex();
-                it++;
-            }
+            it.value()->setValueFromIndexDeferred(value);
+            it++;
         }
-        if (mIntLinks.contains(portName) && mIntLinks[portName].contains(key))
+    }
+    if (mIntLinks.contains(portName) && mIntLinks[portName].contains(key))
+    {
+        auto [it, end] = mIntLinks[portName].equal_range(key);
+        while (it != end)
         {
-            auto [it, end] = mIntLinks[portName].equal_range(key);
-            while (it != end)
-            {
-                it.value()->setValueFromIndex(value);
-                it.value()->setIndex();
-                it++;
-            }
+            it.value()->setValueFromIndexDeferred(value);
+            it++;
         }
-        if (mUintLinks.contains(portName) && mUintLinks[portName].contains(key))
+    }
+    if (mUintLinks.contains(portName) && mUintLinks[portName].contains(key))
+    {
+        auto [it, end] = mUintLinks[portName].equal_range(key);
+        while (it != end)
         {
-            auto [it, end] = mUintLinks[portName].equal_range(key);
-            while (it != end)
-            {
-                it.value()->setValueFromIndex(value);
-                it.value()->setIndex();
-                it++;
-            }
+            it.value()->setValueFromIndexDeferred(value);
+            it++;
         }
     }
 }
@@ -171,7 +193,7 @@ void MidiLinkManager::setupMidiLink(QString portName, int key, Number<float>* nu
 
     // Adjust to midi range
 
-    number->setIndexMax(127);
+    number->setIndexMax(mPortIndexMax.value(portName, 127));
     number->setMidiLinked(true);
 
     // Remove link on number deletion
@@ -207,7 +229,7 @@ void MidiLinkManager::setupMidiLink(QString portName, int key, Number<int>* numb
 
     // Adjust to midi range
 
-    number->setIndexMax(127);
+    number->setIndexMax(mPortIndexMax.value(portName, 127));
     number->setMidiLinked(true);
 
     // Remove link on number deletion
@@ -243,7 +265,7 @@ void MidiLinkManager::setupMidiLink(QString portName, int key, Number<unsigned i
 
     // Adjust to midi range
 
-    number->setIndexMax(127);
+    number->setIndexMax(mPortIndexMax.value(portName, 127));
     number->setMidiLinked(true);
 
     // Remove link on number deletion
@@ -305,6 +327,46 @@ void MidiLinkManager::clearLinks()
 
 
 
+// An operation replacing another one takes the ids of its numbers: links follow them to the new numbers
+// Links to the old numbers go away when they are deleted
+
+void MidiLinkManager::relinkOperation(QUuid id, ImageOperation* operation)
+{
+    Q_UNUSED(id)
+
+    relinkNumbers(mFloatLinks, operation);
+    relinkNumbers(mIntLinks, operation);
+    relinkNumbers(mUintLinks, operation);
+}
+
+
+
+template <typename T>
+void MidiLinkManager::relinkNumbers(QMap<QString, QMultiMap<int, Number<T>*>>& links, ImageOperation* operation)
+{
+    QList<std::tuple<QString, int, Number<T>*>> relinks;
+
+    for (auto [portName, portLinks] : links.asKeyValueRange())
+    {
+        QMultiMapIterator<int, Number<T>*> it(portLinks);
+        while (it.hasNext())
+        {
+            it.next();
+
+            Number<T>* number = operation->number<T>(it.value()->id());
+            if (number && number != it.value()) {
+                relinks.append({ portName, it.key(), number });
+            }
+        }
+    }
+
+    for (auto [portName, key, number] : relinks) {
+        setupMidiLink(portName, key, number);
+    }
+}
+
+
+
 bool MidiLinkManager::multiLink()
 {
     return mMultiLink;
@@ -5,10 +5,12 @@
 
 #include "parameters/number.h"
 #include "midisignals.h"
+#include "imageoperation.h"
 
 #include <QObject>
 #include <QMap>
 #include <QMultiMap>
+#include <QSet>
 #include <QUuid>
 #include <QString>
 
@@ -37,6 +39,9 @@ public slots:
     void removeMidiSignals(QUuid id);
 
     void setupMidi(QString portName, bool open);
+    void addVirtualPort(QString portName, int indexMax);
+
+    void updateLinkedValues(QString portName, int key, int value);
 
     void updateMidiLinks(QString portName, int key, int value);
 
@@ -46,6 +51,8 @@ public slots:
 
     void clearLinks();
 
+    void relinkOperation(QUuid id, ImageOperation* operation);
+
     bool multiLink();
     void setMultiLink(bool enabled);
 
@@ -61,11 +68,16 @@ private:
     Number<unsigned int>* mLinkingUint = nullptr;
 
     QMap<QString, bool> mPortOpen;
+    QMap<QString, int> mPortIndexMax;
+    QSet<QString> mVirtualPorts;
 
     bool mMultiLink = false;
 
     void removeKey(int key);
 
+    template <typename T>
+    void relinkNumbers(QMap<QString, QMultiMap<int, Number<T>*>>& links, ImageOperation* operation);
+
     void setUpConnections(bool midiOn);
 
     void connectMidiSignals(QUuid id);
@@ -51,6 +51,7 @@ MorphoWidget::~MorphoWidget()
 {
     makeCurrent();
     glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &fadeTexId);
     vao->destroy();
     vbo->destroy();
     doneCurrent();
@@ -58,6 +59,7 @@ MorphoWidget::~MorphoWidget()
     delete vao;
     delete vbo;
     delete program;
+    delete fadeProgram;
 }
 
 
@@ -253,6 +255,79 @@ void MorphoWidget::setOutputTextureId(GLuint* pTexId)
 
 
 
+// Snapshot of the current output, faded out over the next frames
+
+void MorphoWidget::startCrossfade(int duration)
+{
+    if (!pOutTexId || *pOutTexId == 0 || duration <= 0)
+        return;
+
+    makeCurrent();
+
+    GLint texWidth = 0, texHeight = 0, texFormat = 0;
+
+    glBindTexture(GL_TEXTURE_2D, *pOutTexId);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &texWidth);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &texHeight);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &texFormat);
+
+    glDeleteTextures(1, &fadeTexId);
+    glGenTextures(1, &fadeTexId);
+
+    glBindTexture(GL_TEXTURE_2D, fadeTexId);
+    glTexStorage2D(GL_TEXTURE_2D, 1, static_cast<GLenum>(texFormat), texWidth, texHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glCopyImageSubData(*pOutTexId, GL_TEXTURE_2D, 0, 0, 0, 0, fadeTexId, GL_TEXTURE_2D, 0, 0, 0, 0, texWidth, texHeight, 1);
+
+    doneCurrent();
+
+    fadeDuration = duration;
+    fadeTimer.start();
+}
+
+
+
+void MorphoWidget::drawCrossfade()
+{
+    qint64 elapsed = fadeTimer.elapsed();
+
+    if (elapsed >= fadeDuration)
+    {
+        fadeDuration = 0;
+        return;
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    fadeProgram->bind();
+    fadeProgram->setUniformValue("alpha", 1.0f - static_cast<GLfloat>(elapsed) / fadeDuration);
+    fadeProgram->setUniformValue("frame",
+        static_cast<GLfloat>(frame.x()) / image.width(),
+        static_cast<GLfloat>(frame.y()) / image.height(),
+        static_cast<GLfloat>(frame.width()) / image.width(),
+        static_cast<GLfloat>(frame.height()) / image.height());
+    fadeProgram->setUniformValue("inTexture", 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fadeTexId);
+
+    vao->bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    vao->release();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    fadeProgram->release();
+
+    glDisable(GL_BLEND);
+}
+
+
+
 void MorphoWidget::updateCursor()
 {
     GLfloat x = static_cast<GLfloat>(cursor.x());
@@ -356,6 +431,14 @@ void MorphoWidget::initializeGL()
     if (!program->link())
         qDebug() << "Shader link error:\n" << program->log();
 
+    fadeProgram = new QOpenGLShaderProgram();
+    if (!fadeProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/fade.vert"))
+        qDebug() << "Vertex shader error:\n" << fadeProgram->log();
+    if (!fadeProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fade.frag"))
+        qDebug() << "Fragment shader error:\n" << fadeProgram->log();
+    if (!fadeProgram->link())
+        qDebug() << "Shader link error:\n" << fadeProgram->log();
+
     vao = new QOpenGLVertexArrayObject();
     vao->create();
 
@@ -396,6 +479,9 @@ void MorphoWidget::paintGL()
 
     glBlitFramebuffer(frame.x(), frame.y() + frame.height(), frame.x() + frame.width(), frame.y(), 0, 0, width(), height(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
+    if (fadeDuration > 0)
+        drawCrossfade();
+
     if (drawingCursor)
     {
         glEnable(GL_BLEND);
@@ -42,6 +42,7 @@
 #include <QWheelEvent>
 #include <QMouseEvent>
 #include <QStyle>
+#include <QElapsedTimer>
 
 
 
@@ -72,6 +73,7 @@ public slots:
     void setUpdate(bool state);
     void setDrawingCursor(bool on){ drawingCursor = on; }
     void setCursor(QPoint point);
+    void startCrossfade(int duration);
 
 protected:
     void wheelEvent(QWheelEvent* event) override;
@@ -99,11 +101,17 @@ private:
     QOpenGLVertexArrayObject* vao = nullptr;
     QOpenGLBuffer* vbo = nullptr;
 
+    GLuint fadeTexId = 0;
+    QOpenGLShaderProgram* fadeProgram = nullptr;
+    QElapsedTimer fadeTimer;
+    int fadeDuration = 0;
+
     Overlay* overlay = nullptr;
 
     void setSelectedPoint(QPointF pos);
     void updateCursor();
     void getSupportedTexFormats();
+    void drawCrossfade();
 };
 
 
@@ -40,7 +40,7 @@
 
 
 
-Node::Node(QUuid id, QWidget *widget, QGraphicsItem* parent) :
+Node::Node(QUuid id, QWidget *widget, QGraphicsProxyWidget* proxyWidget, QGraphicsItem* parent) :
     QGraphicsWidget { parent },
     mId { id },
     mWidget { widget }
@@ -53,19 +53,92 @@ Node::Node(QUuid id, QWidget *widget, QGraphicsItem* parent) :
 
     mWidget->installEventFilter(this);
 
-    mProxyWidget = new QGraphicsProxyWidget(this);
+    // Embed first to get the widget's size within the scene
+
+    setProxyWidget(proxyWidget);
+
+    resize(mWidget->size());
+}
+
+
+
+Node::~Node()
+{
+    // The proxy deletes the widget it embeds, otherwise it is ours
+
+    if (!mProxyWidget) {
+        delete mWidget;
+    }
+}
+
+
+
+void Node::setProxyWidget(QGraphicsProxyWidget* proxyWidget)
+{
+    if (mProxyWidget || !proxyWidget) {
+        return;
+    }
+
+    mProxyWidget = proxyWidget;
+    mProxyWidget->setParentItem(this);
+    mProxyWidget->setPos(0.0, 0.0);
     mProxyWidget->setWidget(mWidget);
+    mProxyWidget->setVisible(true);
+    mWidget->show();
 
-    resize(mProxyWidget->size());
+    update();
 }
 
 
 
-/*Node::~Node()
+QGraphicsProxyWidget* Node::takeProxyWidget()
 {
-    // delete mProxyWidget;
-    qDebug() << this;
-}*/
+    QGraphicsProxyWidget* proxyWidget = mProxyWidget;
+
+    if (proxyWidget)
+    {
+        // Hide before unembedding, otherwise the widget shows up as a window
+
+        mWidget->hide();
+        proxyWidget->setWidget(nullptr);
+        proxyWidget->setVisible(false);
+        proxyWidget->setParentItem(nullptr);
+
+        mProxyWidget = nullptr;
+
+        update();
+    }
+
+    return proxyWidget;
+}
+
+
+
+void Node::setTitle(QString title)
+{
+    if (title != mTitle)
+    {
+        mTitle = title;
+
+        if (!mProxyWidget) {
+            update();
+        }
+    }
+}
+
+
+
+void Node::setRenderTime(double time)
+{
+    if (time != mRenderTime)
+    {
+        mRenderTime = time;
+
+        if (!mProxyWidget) {
+            update();
+        }
+    }
+}
 
 
 /*void Node::closeEvent(QCloseEvent* event)
@@ -78,7 +151,9 @@ Node::Node(QUuid id, QWidget *widget, QGraphicsItem* parent) :
 
 void Node::resizeEvent(QGraphicsSceneResizeEvent* event)
 {
-    mProxyWidget->resize(event->newSize());
+    if (mProxyWidget) {
+        mProxyWidget->resize(event->newSize());
+    }
 
     foreach (Edge *edge, edgeList)
         edge->adjust();
@@ -184,7 +259,7 @@ bool Node::connectedTo(Node *node)
 
 void Node::centerBetween(QPointF src, QPointF dst)
 {
-    setPos(src + 0.5 * (dst - src) - QPointF(0.5 * mWidget->width(), 0.5 * mWidget->height()));
+    setPos(src + 0.5 * (dst - src) - QPointF(0.5 * size().width(), 0.5 * size().height()));
 }
 
 
@@ -211,7 +286,7 @@ QRectF Node::textBoundingRect() const
 
 QRectF Node::boundingRect() const
 {
-    return mProxyWidget->boundingRect();
+    return rect();
 }
 
 
@@ -219,7 +294,7 @@ QRectF Node::boundingRect() const
 QPainterPath Node::shape() const
 {
     QPainterPath path;
-    path.addRoundedRect(mWidget->rect().toRectF(), 20.0, 20.0);
+    path.addRoundedRect(rect(), 20.0, 20.0);
     return path;
 }
 
@@ -267,17 +342,73 @@ void Node::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWid
 {
     Q_UNUSED(widget)
 
+    QRectF rect = this->rect();
+
+    if (!mProxyWidget)
+    {
+        // Low detail: box with title and render time, text sized to be readable when zoomed out
+
+        painter->setPen(QPen(QColor(96, 96, 112), 1));
+        painter->setBrush(QColor(40, 40, 48));
+        painter->drawRect(rect);
+
+        QFont font = painter->font();
+        font.setPixelSize(qMax(12, static_cast<int>(rect.height() / 8.0)));
+        painter->setFont(font);
+        painter->setPen(Qt::white);
+
+        QRectF textRect = rect.adjusted(8.0, 8.0, -8.0, -8.0);
+        painter->drawText(textRect, Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap, mTitle);
+
+        if (mRenderTime >= 0.0)
+        {
+            painter->setPen(QColor(192, 192, 128));
+            painter->drawText(textRect, Qt::AlignLeft | Qt::AlignBottom, QString("%1 us").arg(qRound(mRenderTime)));
+        }
+
+        painter->setBrush(Qt::NoBrush);
+    }
+
     if (option->state & QStyle::State_Sunken || option->state & QStyle::State_Selected)
     {
         painter->setPen(QPen(QColor(128, 128, 164), 2));
+        painter->drawRect(rect);
+    }
+    else if (mCached)
+    {
+        // Output reused from a previous iteration
 
-        QRectF rect = mWidget->rect().toRectF();
+        painter->setPen(QPen(QColor(96, 164, 96), 2, Qt::DashLine));
         painter->drawRect(rect);
     }
 }
 
 
 
+void Node::setCached(bool set)
+{
+    if (set != mCached)
+    {
+        mCached = set;
+        update();
+    }
+}
+
+
+
+void Node::setPruned(bool set)
+{
+    // Greyed out: not rendered, since nothing observed depends on it
+
+    if (set != mPruned)
+    {
+        mPruned = set;
+        setOpacity(mPruned ? 0.4 : 1.0);
+    }
+}
+
+
+
 QVariant Node::itemChange(GraphicsItemChange change, const QVariant &value)
 {
     if (change == QGraphicsItem::ItemPositionChange && scene())
@@ -55,8 +55,8 @@ public:
     //bool marked = false;
 
     //Node(GraphWidget* graphWidget, QString name);
-    explicit Node(QUuid id, QWidget* widget, QGraphicsItem* parent = nullptr);
-    // ~Node();
+    explicit Node(QUuid id, QWidget* widget, QGraphicsProxyWidget* proxyWidget, QGraphicsItem* parent = nullptr);
+    ~Node();
 
     enum { Type = UserType + 1 };
     int type() const override { return Type; }
@@ -71,6 +71,22 @@ public:
 
     void centerBetween(QPointF src, QPointF dst);
 
+    bool cached() const { return mCached; }
+    void setCached(bool set);
+
+    bool pruned() const { return mPruned; }
+    void setPruned(bool set);
+
+    // Level of detail: the widget is embedded only through a proxy taken from a pool,
+    // without it the node is drawn as a box with its title and render time
+
+    bool hasProxyWidget() const { return mProxyWidget != nullptr; }
+    void setProxyWidget(QGraphicsProxyWidget* proxyWidget);
+    QGraphicsProxyWidget* takeProxyWidget();
+
+    void setTitle(QString title);
+    void setRenderTime(double time);
+
     //QRectF textBoundingRect() const;
 
     QRectF boundingRect() const override;
@@ -104,7 +120,11 @@ private:
     //qreal penSize = 2.0;
     QUuid mId;
     QWidget* mWidget;
-    QGraphicsProxyWidget* mProxyWidget;
+    QGraphicsProxyWidget* mProxyWidget = nullptr;
+    bool mCached = false;
+    bool mPruned = false;
+    QString mTitle;
+    double mRenderTime = -1.0;
 };
 
 
@@ -24,6 +24,8 @@
 
 #include "nodemanager.h"
 
+#include <QSet>
+
 
 
 NodeManager::NodeManager(Factory* factory) :
@@ -79,72 +81,167 @@ NodeManager::~NodeManager()
 
 void NodeManager::sortOperations()
 {
-    //QList<ImageOperation*> tmpSortedOperations = sortedOperations;
+    if (mGraphDirty || mGraph.numNodes() != mOperationNodesMap.size()) {
+        rebuildGraph();
+    }
+
+    // The graph keeps a topological order of the operations through their normal inputs
+    // Blit and seed inputs do not depend on pending operations, so they are not part of it
+    // Discard isolated nodes, with no inputs nor outputs
 
     QList<ImageOperation*> sortedOperations;
 
-    //QList<QPair<QUuid, QString>> sortedOperationsData;
-    //QList<QUuid> unsortedOperationsIds;
+    foreach (QUuid id, mGraph.order())
+    {
+        ImageOperationNode* node = mOperationNodesMap.value(id);
 
-    QMap<QUuid, ImageOperationNode*> pendingNodes = mOperationNodesMap;
+        if (node && (node->numInputs() > 0 || node->numOutputs() > 0)) {
+            sortedOperations.append(node->operation());
+        }
+    }
 
-    // Set operations as non-computed (pending)
+    mSortedOperations = sortedOperations;
+    emit sortedOperationsChanged(sortedOperations);
 
-    foreach (ImageOperationNode* node, mOperationNodesMap) {
-        node->setComputed(false);
+    pruneOperations();
+}
+
+
+
+bool NodeManager::insertGraphEdge(QUuid srcId, QUuid dstId)
+{
+    QList<QUuid> cycleIds = mGraph.insertEdge(srcId, dstId);
+
+    if (cycleIds.isEmpty()) {
+        return true;
     }
 
-    // First operations are those whose inputs are all blit or seed, they do not depend on pending operations
-    // Also operations with no inputs but with some outputs, sorting algorithm depends on operations having inputs
-    // Discard isolated nodes, with no inputs nor outputs
+    // The edge closes a cycle without predges: make it the predge of the cycle
 
-    foreach (ImageOperationNode* node, mOperationNodesMap)
+    mOperationNodesMap.value(dstId)->setInputType(srcId, InputType::Blit);
+
+    emit cycleClosed(srcId, dstId, cycleIds);
+
+    return false;
+}
+
+
+
+void NodeManager::rebuildGraph()
+{
+    mGraphDirty = false;
+
+    mGraph.clear();
+
+    foreach (QUuid id, mOperationNodesMap.keys()) {
+        mGraph.addNode(id);
+    }
+
+    for (auto [dstId, node] : mOperationNodesMap.asKeyValueRange())
     {
-        if (node->numInputs() == 0 && node->numOutputs() == 0)
+        for (auto [srcId, data] : node->inputs().asKeyValueRange())
         {
-            pendingNodes.remove(node->id());
-            //unsortedOperationsIds.append(node->id);
+            if (data->type() == InputType::Normal && mOperationNodesMap.contains(srcId)) {
+                insertGraphEdge(srcId, dstId);
+            }
         }
-        else if ((node->numInputs() == 0 && node->numOutputs() > 0) || (node->numInputs() > 0 && node->numNonNormalInputs() == node->numInputs()))
-        {
-            sortedOperations.append(node->operation());
-            //sortedOperationsData.append(QPair<QUuid, QString>(node->id, node->operation->name()));
-            pendingNodes.remove(node->id());
-            node->setComputed(true);
+    }
+}
+
+
+
+void NodeManager::pruneOperations()
+{
+    // Live nodes: backward reachable from the output and the sinks, through every input type,
+    // so that operations read through blit (feedback) edges are kept too
+
+    QList<QUuid> pendingIds;
+
+    if (isNode(mOutputId)) {
+        pendingIds.append(mOutputId);
+    }
+
+    foreach (GLuint* pTexId, mSinkTexIds)
+    {
+        for (auto [id, node] : mOperationNodesMap.asKeyValueRange()) {
+            if (node->pOutTextureId() == pTexId) {
+                pendingIds.append(id);
+            }
         }
     }
 
-    // Sorting algorithm
+    QSet<QUuid> liveIds;
 
-    while (!pendingNodes.empty())
+    while (!pendingIds.isEmpty())
     {
-        QList<ImageOperationNode*> computedNodes;
+        QUuid id = pendingIds.takeLast();
 
-        foreach (ImageOperationNode* node, pendingNodes)
-        {
-            if (node->allInputsComputed())
-            {
-                sortedOperations.append(node->operation());
-                //sortedOperationsData.push_back(QPair<QUuid, QString>(node->id, node->operation->name()));
-                computedNodes.append(node);
-                node->setComputed(true);
-            }
+        if (liveIds.contains(id)) {
+            continue;
         }
 
-        foreach (ImageOperationNode* node, computedNodes)
-        {
-            pendingNodes.remove(node->id());
+        liveIds.insert(id);
+
+        if (mOperationNodesMap.contains(id)) {
+            pendingIds.append(mOperationNodesMap.value(id)->inputs().keys());
         }
+    }
 
-        if (computedNodes.empty())
-            break;
+    // Render list keeps the sorted order
+
+    QSet<ImageOperation*> liveOperations;
+
+    for (auto [id, node] : mOperationNodesMap.asKeyValueRange()) {
+        if (liveIds.contains(id)) {
+            liveOperations.insert(node->operation());
+        }
     }
 
-    //if (tmpSortedOperations != sortedOperations)
-        //emit sortedOperationsChanged(sortedOperationsData, unsortedOperationsIds);
+    QList<ImageOperation*> renderedOperations;
 
-    // mRenderManager->setSortedOperations(sortedOperations);
-    emit sortedOperationsChanged(sortedOperations);
+    foreach (ImageOperation* operation, mSortedOperations) {
+        if (liveOperations.contains(operation)) {
+            renderedOperations.append(operation);
+        }
+    }
+
+    QList<QUuid> prunedIds;
+
+    foreach (QUuid id, mOperationNodesMap.keys()) {
+        if (!liveIds.contains(id)) {
+            prunedIds.append(id);
+        }
+    }
+    foreach (QUuid id, mSeedsMap.keys()) {
+        if (!liveIds.contains(id)) {
+            prunedIds.append(id);
+        }
+    }
+
+    if (renderedOperations != mRenderedOperations)
+    {
+        mRenderedOperations = renderedOperations;
+        emit renderedOperationsChanged(mRenderedOperations);
+    }
+
+    if (prunedIds != mPrunedIds)
+    {
+        mPrunedIds = prunedIds;
+        emit prunedNodesChanged(mPrunedIds);
+    }
+}
+
+
+
+void NodeManager::setSinks(QList<GLuint*> pTexIds)
+{
+    // Changing sinks does not change the sort, only the pruning
+
+    if (pTexIds != mSinkTexIds)
+    {
+        mSinkTexIds = pTexIds;
+        pruneOperations();
+    }
 }
 
 
@@ -181,6 +278,8 @@ void NodeManager::setOutput(QUuid id)
 
     emit outputNodeChanged(id);
     emit outputTextureChanged(pOutputTextureId);
+
+    pruneOperations();
 }
 
 
@@ -194,6 +293,8 @@ bool NodeManager::tryConnectOperations(QUuid srcId, QUuid dstId, float blendFact
             mOperationNodesMap.value(dstId)->addInput(mOperationNodesMap.value(srcId), new InputData(InputType::Normal, mOperationNodesMap.value(srcId)->pOutTextureId(), blendFactor));
             mOperationNodesMap.value(srcId)->addOutput(mOperationNodesMap.value(dstId));
 
+            insertGraphEdge(srcId, dstId);
+
             sortOperations();
 
             return true;
@@ -226,6 +327,8 @@ void NodeManager::connectOperations(QUuid srcId, QUuid dstId, float factor)
 
 void NodeManager::connectOperations(QMap<QUuid, QMap<QUuid, InputData*>> connections)
 {
+    mGraphDirty = true;
+
     for (auto [dstId, iMap]: connections.asKeyValueRange())
     {
         for (auto [srcId, inData]: iMap.asKeyValueRange())
@@ -302,6 +405,8 @@ void NodeManager::disconnectOperations(QUuid srcId, QUuid dstId)
     {
         mOperationNodesMap.value(dstId)->removeInput(mOperationNodesMap.value(srcId));
         mOperationNodesMap.value(srcId)->removeOutput(mOperationNodesMap.value(dstId));
+
+        mGraph.removeEdge(srcId, dstId);
     }
     else if (mSeedsMap.contains(srcId))
     {
@@ -313,11 +418,64 @@ void NodeManager::disconnectOperations(QUuid srcId, QUuid dstId)
 
 
 
+// Same as removing from the widgets: the graph widget and the midi links follow
+
+void NodeManager::removeOperation(QUuid id)
+{
+    if (mOperationNodesMap.contains(id))
+    {
+        emit nodeRemoved(id);
+        emit midiSignalsRemoved(id);
+        removeOperationNode(id);
+    }
+}
+
+
+
+void NodeManager::removeSeed(QUuid id)
+{
+    if (mSeedsMap.contains(id))
+    {
+        emit nodeRemoved(id);
+        removeSeedNode(id);
+    }
+}
+
+
+
+void NodeManager::removeEdge(QUuid srcId, QUuid dstId)
+{
+    QPair<QUuid, QUuid> key = qMakePair(srcId, dstId);
+
+    if (mEdgeMidiIds.contains(key)) {
+        emit midiSignalsRemoved(mEdgeMidiIds.take(key));
+    }
+
+    disconnectOperations(srcId, dstId);
+    emit nodesDisconnected(srcId, dstId);
+}
+
+
+
 void NodeManager::setOperationInputType(QUuid srcId, QUuid dstId, InputType type)
 {
     if (mOperationNodesMap.contains(srcId))
     {
-        mOperationNodesMap.value(dstId)->setInputType(srcId, type);
+        ImageOperationNode* dstNode = mOperationNodesMap.value(dstId);
+
+        if (!dstNode->isInput(srcId) || dstNode->inputs().value(srcId)->type() == type) {
+            return;
+        }
+
+        dstNode->setInputType(srcId, type);
+
+        if (type == InputType::Normal) {
+            insertGraphEdge(srcId, dstId);
+        }
+        else {
+            mGraph.removeEdge(srcId, dstId);
+        }
+
         sortOperations();
     }
     else if (copiedOperationNodes[0].contains(srcId))
@@ -339,6 +497,8 @@ void NodeManager::pasteOperations()
     copiedOperationNodes[0].clear();
     copiedSeeds[0].clear();
 
+    mGraphDirty = true;
+
     sortOperations();
 }
 
@@ -457,6 +617,8 @@ void NodeManager::removeOperationNode(QUuid id)
     delete mOperationNodesMap.value(id);
     mOperationNodesMap.remove(id);
 
+    mGraph.removeNode(id);
+
     if (id == mOutputId) {
         setOutput(QUuid());
     }
@@ -501,7 +663,9 @@ EdgeWidget* NodeManager::addEdgeWidget(QUuid srcId, QUuid dstId, Number<float>*
 
     connect(edgeWidget, &EdgeWidget::operationInsert, this, [=, this](int index) {
         QUuid opId;
-        mFactory->addAvailableOperation(index, opId);
+        if (!mFactory->addAvailableOperation(index, opId)) {
+            return;
+        }
 
         connectOperations(srcId, opId, 1.0);
         connectOperations(opId, dstId, 1.0);
@@ -510,11 +674,11 @@ EdgeWidget* NodeManager::addEdgeWidget(QUuid srcId, QUuid dstId, Number<float>*
     });
 
     connect(edgeWidget, &EdgeWidget::remove, this, [=, this]() {
-        emit midiSignalsRemoved(id);
-        disconnectOperations(srcId, dstId);
-        emit nodesDisconnected(srcId, dstId);
+        removeEdge(srcId, dstId);
     });
 
+    mEdgeMidiIds.insert(qMakePair(srcId, dstId), id);
+
     emit midiSignalsCreated(id, edgeWidget->midiSignals());
 
     connect(this, &NodeManager::midiEnabled, edgeWidget, &EdgeWidget::toggleMidiAction);
@@ -528,6 +692,8 @@ void NodeManager::addOperationNode(QUuid id, ImageOperation* operation)
 {
     ImageOperationNode* node = new ImageOperationNode(id, operation);
     mOperationNodesMap.insert(id, node);
+
+    mGraph.addNode(id);
 }
 
 
@@ -543,6 +709,10 @@ void NodeManager::connectOperation(QUuid id, ImageOperation* operation)
             }
             emit parameterValueChanged(id, operation->name(), paramName, QString::number(value.toFloat(), 'f', 6));
         });
+
+        connect(parameter, &Parameter::valuesChanged, this, [=, this](int first, int last) {
+            emit parameterValueChanged(id, operation->name(), parameter->name() + "[" + QString::number(first) + ".." + QString::number(last) + "]", QString::number(last - first + 1) + " values");
+        });
     }
 
     foreach (auto parameter, operation->uniformParameters<int>())
@@ -554,6 +724,10 @@ void NodeManager::connectOperation(QUuid id, ImageOperation* operation)
             }
             emit parameterValueChanged(id, operation->name(), parameter->name(), QString::number(value.toInt()));
         });
+
+        connect(parameter, &Parameter::valuesChanged, this, [=, this](int first, int last) {
+            emit parameterValueChanged(id, operation->name(), parameter->name() + "[" + QString::number(first) + ".." + QString::number(last) + "]", QString::number(last - first + 1) + " values");
+        });
     }
 
     foreach (auto parameter, operation->uniformParameters<unsigned int>())
@@ -565,6 +739,10 @@ void NodeManager::connectOperation(QUuid id, ImageOperation* operation)
             }
             emit parameterValueChanged(id, operation->name(), parameter->name(), QString::number(value.toUInt()));
         });
+
+        connect(parameter, &Parameter::valuesChanged, this, [=, this](int first, int last) {
+            emit parameterValueChanged(id, operation->name(), parameter->name() + "[" + QString::number(first) + ".." + QString::number(last) + "]", QString::number(last - first + 1) + " values");
+        });
     }
 
     foreach (auto parameter, operation->mat4UniformParameters())
@@ -573,6 +751,14 @@ void NodeManager::connectOperation(QUuid id, ImageOperation* operation)
             QString numberName = parameter->numberNames().at(i);
             emit parameterValueChanged(id, operation->name(), parameter->name() + " " + numberName, QString::number(value.toFloat(), 'f', 6));
         });
+
+        connect(parameter, &Parameter::valuesChanged, this, [=, this](int first, int last) {
+            QStringList values;
+            for (int i = first; i <= last; i++) {
+                values.append(QString::number(parameter->value(i), 'f', 6));
+            }
+            emit parameterValueChanged(id, operation->name(), parameter->name(), values.join(", "));
+        });
     }
 }
 
@@ -960,5 +1146,9 @@ void NodeManager::removeAllNodes()
     }
     mOperationNodesMap.clear();
 
+    mGraph.clear();
+
     mSeedsMap.clear();
+
+    mEdgeMidiIds.clear();
 }
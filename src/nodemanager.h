@@ -36,6 +36,7 @@
 #include "seedwidget.h"
 #include "edgewidget.h"
 #include "midisignals.h"
+#include "operationgraph.h"
 
 #include <QObject>
 #include <QList>
@@ -43,6 +44,8 @@
 #include <QOpenGLContext>
 #include <QUuid>
 #include <QMap>
+#include <QHash>
+#include <QPair>
 
 
 
@@ -64,6 +67,10 @@ public:
     void connectCopiedOperationsB(QUuid srcId0, QUuid dstId0, QUuid srcId1, QUuid dstId1);
     void disconnectOperations(QUuid srcId, QUuid dstId);
 
+    void removeOperation(QUuid id);
+    void removeSeed(QUuid id);
+    void removeEdge(QUuid srcId, QUuid dstId);
+
     void setOperationInputType(QUuid srcId, QUuid dstId, InputType type);
 
     EdgeWidget* addEdgeWidget(QUuid srcId, QUuid dstId, Number<float>* blendFactor);
@@ -100,12 +107,13 @@ public:
     void swapTwoOperations(QUuid id1, QUuid id2);
 
     void sortOperations();
+    void pruneOperations();
 
     // void clearOperation(QUuid id);
     // void clearAllOperations();
 
-    QMap<QUuid, ImageOperationNode*> operationNodesMap() const { return mOperationNodesMap; }
-    QMap<QUuid, Seed*> seedsMap() { return mSeedsMap; }
+    const QHash<QUuid, ImageOperationNode*>& operationNodesMap() const { return mOperationNodesMap; }
+    const QHash<QUuid, Seed*>& seedsMap() const { return mSeedsMap; }
 
     bool isNode(QUuid id) { return mOperationNodesMap.contains(id) || mSeedsMap.contains(id); }
 
@@ -117,10 +125,13 @@ signals:
     void outputTextureChanged(GLuint* pTexId);
     // void sortedOperationsChanged(QList<QPair<QUuid, QString>> sortedData, QList<QUuid> unsortedData);
     void sortedOperationsChanged(QList<ImageOperation*> operations);
+    void renderedOperationsChanged(QList<ImageOperation*> operations);
+    void prunedNodesChanged(QList<QUuid> ids);
     void nodesConnected(QUuid srcId, QUuid dstId, InputType type, EdgeWidget* widget);
     void nodeRemoved(QUuid id);
     void nodesDisconnected(QUuid srcId, QUuid dstId);
     void nodeInserted(QUuid srcId, QUuid dstId, QUuid opId);
+    void cycleClosed(QUuid srcId, QUuid dstId, QList<QUuid> cycleIds);
 
     void midiSignalsCreated(QUuid id, MidiSignals* midisSignals);
     void midiSignalsRemoved(QUuid id);
@@ -131,24 +142,45 @@ signals:
 
 public slots:
     void setOutput(QUuid id);
+    void setSinks(QList<GLuint*> pTexIds);
     void onTexturesChanged();
 
 private:
     // RenderManager* mRenderManager;
     Factory* mFactory;
 
-    QMap<QUuid, ImageOperationNode*> mOperationNodesMap;
-    QMap<QUuid, ImageOperationNode*> copiedOperationNodes[2];
+    QHash<QUuid, ImageOperationNode*> mOperationNodesMap;
+    QHash<QUuid, ImageOperationNode*> copiedOperationNodes[2];
 
-    QMap<QUuid, Seed*> mSeedsMap;
-    QMap<QUuid, Seed*> copiedSeeds[2];
+    QHash<QUuid, Seed*> mSeedsMap;
+    QHash<QUuid, Seed*> copiedSeeds[2];
 
     QUuid connSrcId;
 
+    // Ids under which edge widgets registered their midi signals
+
+    QHash<QPair<QUuid, QUuid>, QUuid> mEdgeMidiIds;
+
     GLuint outputFBO;
     QUuid mOutputId;
     GLuint* pOutputTextureId = nullptr;
 
+    // Sorted operations, and those among them observed by the output or other sinks
+
+    QList<ImageOperation*> mSortedOperations;
+    QList<GLuint*> mSinkTexIds;
+    QList<ImageOperation*> mRenderedOperations;
+    QList<QUuid> mPrunedIds;
+
+    // Normal edges between operations, with their topological order kept up to date on every edit
+    // Bulk edits mark it dirty and it is rebuilt on the next sort
+
+    OperationGraph mGraph;
+    bool mGraphDirty = false;
+
+    bool insertGraphEdge(QUuid srcId, QUuid dstId);
+    void rebuildGraph();
+
 private slots:
     void addOperationNode(QUuid id, ImageOperation* operation);
     void addSeedNode(QUuid id, Seed* seed);
@@ -289,7 +289,10 @@ void OperationBuilder::loadOperation()
             return;
         }
 
-        mOperation->linkShaders();
+        if (!mOperation->linkShaders()) {
+            QMessageBox::information(this, "GLSL Shaders error", mOperation->linkLog());
+        }
+
         mOperation->enableUpdate(true);
         mOperation->setAllParameters();
 
@@ -666,7 +669,7 @@ void OperationBuilder::setupOperation()
     }
     else
     {
-        QMessageBox::information(this, "GLSL Shaders error", "Could not set up operation due to GLSL shaders error.");
+        QMessageBox::information(this, "GLSL Shaders error", "Could not set up operation due to GLSL shaders error.\n\n" + mOperation->linkLog());
     }
 }
 
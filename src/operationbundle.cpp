@@ -0,0 +1,611 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "operationbundle.h"
+#include "operationparser.h"
+#include "shaderpreprocessor.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QRegularExpression>
+#include <QDebug>
+#include <type_traits>
+
+
+
+OperationBundle::OperationBundle(){}
+
+
+
+QString OperationBundle::bundlePath(QString filename)
+{
+    QFileInfo info(filename);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".opb";
+}
+
+
+
+bool OperationBundle::upToDate(QString filename)
+{
+    QFileInfo bundle(bundlePath(filename));
+    QFileInfo source(filename);
+
+    return bundle.exists() && (!source.exists() || bundle.lastModified() >= source.lastModified());
+}
+
+
+
+QString OperationBundle::log() const
+{
+    return mLog;
+}
+
+
+
+bool OperationBundle::write(ImageOperation* operation, QString filename)
+{
+    QFile outFile(filename);
+
+    if (!outFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    mBaseDir = QFileInfo(filename).absolutePath();
+    QDir baseDir(mBaseDir);
+
+    QDataStream stream(&outFile);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    stream << magic << formatVersion;
+
+    stream << operation->name() << operation->enabled();
+
+    // GLSL is kept: it is the fallback if the driver cannot take SPIR-V and the source of the operation's editor
+
+    stream << operation->vertexShader() << operation->fragmentShader();
+
+    stream << (operation->vertexShaderFile().isEmpty() ? QString() : baseDir.relativeFilePath(operation->vertexShaderFile()));
+    stream << (operation->fragmentShaderFile().isEmpty() ? QString() : baseDir.relativeFilePath(operation->fragmentShaderFile()));
+
+    stream << operation->vertexSpirv() << operation->fragmentSpirv() << operation->uniformLocations();
+
+    // Files included by the shaders the SPIR-V was compiled from, with their modification times
+
+    QStringList includedFiles;
+
+    if (!operation->vertexSpirv().isEmpty()) {
+        operation->expandedSourceKey(&includedFiles);
+    }
+
+    includedFiles.removeDuplicates();
+
+    QStringList includePaths;
+    QList<qint64> includeTimes;
+
+    foreach (QString path, includedFiles)
+    {
+        includePaths.append(baseDir.relativeFilePath(path));
+        includeTimes.append(QFileInfo(path).lastModified().toMSecsSinceEpoch());
+    }
+
+    stream << operation->spirvSourceKey() << includePaths << includeTimes;
+
+    stream << operation->sampler2DAvail() << operation->sampler2DName();
+    stream << operation->sampler2DArrayAvail() << operation->sampler2DArrayName();
+
+    writeParameters<float>(operation, stream);
+    writeParameters<int>(operation, stream);
+    writeParameters<unsigned int>(operation, stream);
+
+    writeMat4Parameters(operation, stream);
+
+    writeOptionsParameters(operation, stream);
+
+    outFile.close();
+
+    mBaseDir.clear();
+
+    return stream.status() == QDataStream::Ok;
+}
+
+
+
+bool OperationBundle::read(ImageOperation* operation, QString filename)
+{
+    QFile inFile(filename);
+
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&inFile);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 fileMagic = 0;
+    quint32 fileVersion = 0;
+
+    stream >> fileMagic >> fileVersion;
+
+    if (fileMagic != magic || fileVersion != formatVersion) {
+        return false;
+    }
+
+    QDateTime modified = QFileInfo(filename).lastModified();
+    QDir baseDir(QFileInfo(filename).absolutePath());
+
+    QString name;
+    bool enabled;
+    QString vertexShader, fragmentShader;
+    QString vertexShaderFile, fragmentShaderFile;
+
+    stream >> name >> enabled;
+    stream >> vertexShader >> fragmentShader;
+    stream >> vertexShaderFile >> fragmentShaderFile;
+
+    // An edited external shader makes the bundle stale
+
+    if (!vertexShaderFile.isEmpty()) {
+        vertexShaderFile = baseDir.absoluteFilePath(vertexShaderFile);
+    }
+    if (!fragmentShaderFile.isEmpty()) {
+        fragmentShaderFile = baseDir.absoluteFilePath(fragmentShaderFile);
+    }
+
+    foreach (QString path, QStringList({ vertexShaderFile, fragmentShaderFile }))
+    {
+        if (!path.isEmpty() && QFileInfo(path).lastModified() > modified) {
+            return false;
+        }
+    }
+
+    QByteArray vertexSpirv, fragmentSpirv;
+    QMap<QString, int> locations;
+
+    stream >> vertexSpirv >> fragmentSpirv >> locations;
+
+    QByteArray spirvSourceKey;
+    QStringList includePaths;
+    QList<qint64> includeTimes;
+
+    stream >> spirvSourceKey >> includePaths >> includeTimes;
+
+    // An edited or missing include makes the SPIR-V stale, the rest of the bundle still holds
+
+    bool spirvValid = includePaths.size() == includeTimes.size();
+
+    for (int i = 0; i < includePaths.size() && spirvValid; i++)
+    {
+        QFileInfo include(baseDir.absoluteFilePath(includePaths[i]));
+        spirvValid = include.exists() && include.lastModified().toMSecsSinceEpoch() == includeTimes[i];
+    }
+
+    if (!spirvValid)
+    {
+        vertexSpirv.clear();
+        fragmentSpirv.clear();
+        locations.clear();
+        spirvSourceKey.clear();
+    }
+
+    bool sampler2DAvail, sampler2DArrayAvail;
+    QString sampler2DName, sampler2DArrayName;
+
+    stream >> sampler2DAvail >> sampler2DName;
+    stream >> sampler2DArrayAvail >> sampler2DArrayName;
+
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    operation->clearParameters();
+
+    operation->setName(name);
+    operation->enable(enabled);
+
+    operation->setVertexShader(vertexShader);
+    operation->setFragmentShader(fragmentShader);
+    operation->setVertexShaderFile(vertexShaderFile);
+    operation->setFragmentShaderFile(fragmentShaderFile);
+    operation->setSpirv(vertexSpirv, fragmentSpirv, locations, spirvSourceKey);
+
+    operation->setSampler2DAvail(sampler2DAvail);
+    operation->setSampler2DName(sampler2DName);
+    operation->setSampler2DArrayAvail(sampler2DArrayAvail);
+    operation->setSampler2DArrayName(sampler2DArrayName);
+
+    readParameters<float>(operation, stream);
+    readParameters<int>(operation, stream);
+    readParameters<unsigned int>(operation, stream);
+
+    readMat4Parameters(operation, stream);
+
+    readOptionsParameters(operation, stream);
+
+    inFile.close();
+
+    return stream.status() == QDataStream::Ok;
+}
+
+
+
+template<typename T>
+void OperationBundle::writeParameters(ImageOperation* operation, QDataStream& stream)
+{
+    stream << static_cast<qint32>(operation->uniformParameters<T>().size());
+
+    foreach (auto parameter, operation->uniformParameters<T>())
+    {
+        stream << parameter->name() << parameter->editable() << static_cast<qint32>(parameter->row()) << static_cast<qint32>(parameter->col());
+        stream << parameter->specialized();
+
+        stream << parameter->uniformName() << static_cast<qint32>(parameter->uniformType()) << static_cast<qint32>(parameter->numItems());
+
+        QList<T> values, mins, maxs, infs, sups;
+
+        foreach (auto number, parameter->numbers())
+        {
+            values.append(number->value());
+            mins.append(number->min());
+            maxs.append(number->max());
+            infs.append(number->inf());
+            sups.append(number->sup());
+        }
+
+        stream << values << mins << maxs << infs << sups;
+
+        stream << parameter->presets();
+    }
+}
+
+
+
+template<typename T>
+void OperationBundle::readParameters(ImageOperation* operation, QDataStream& stream)
+{
+    qint32 count = 0;
+    stream >> count;
+
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+    {
+        QString paramName;
+        bool editable, specialize;
+        qint32 row, col;
+
+        stream >> paramName >> editable >> row >> col;
+        stream >> specialize;
+
+        QString uniformName;
+        qint32 uniformType, numItems;
+
+        stream >> uniformName >> uniformType >> numItems;
+
+        QList<T> values, mins, maxs, infs, sups;
+        stream >> values >> mins >> maxs >> infs >> sups;
+
+        QMap<QString, QList<T>> presets;
+        stream >> presets;
+
+        if (stream.status() != QDataStream::Ok) {
+            return;
+        }
+
+        UniformParameter<T>* parameter = new UniformParameter<T>(paramName, uniformName, uniformType, numItems, editable, values, mins, maxs, infs, sups, operation);
+
+        parameter->setPresets(presets);
+
+        parameter->setRow(row);
+        parameter->setCol(col);
+
+        parameter->setSpecialized(specialize);
+
+        operation->addUniformParameter<T>(parameter);
+    }
+}
+
+
+
+void OperationBundle::writeMat4Parameters(ImageOperation* operation, QDataStream& stream)
+{
+    stream << static_cast<qint32>(operation->mat4UniformParameters().size());
+
+    foreach (auto parameter, operation->mat4UniformParameters())
+    {
+        stream << parameter->name() << parameter->editable() << static_cast<qint32>(parameter->row()) << static_cast<qint32>(parameter->col());
+
+        stream << parameter->uniformName() << static_cast<qint32>(parameter->typeIndex());
+
+        QList<float> values, mins, maxs, infs, sups;
+
+        foreach (auto number, parameter->numbers())
+        {
+            values.append(number->value());
+            mins.append(number->min());
+            maxs.append(number->max());
+            infs.append(number->inf());
+            sups.append(number->sup());
+        }
+
+        stream << values << mins << maxs << infs << sups;
+
+        stream << parameter->presets();
+    }
+}
+
+
+
+void OperationBundle::readMat4Parameters(ImageOperation* operation, QDataStream& stream)
+{
+    qint32 count = 0;
+    stream >> count;
+
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+    {
+        QString paramName;
+        bool editable;
+        qint32 row, col;
+
+        stream >> paramName >> editable >> row >> col;
+
+        QString uniformName;
+        qint32 mat4Type;
+
+        stream >> uniformName >> mat4Type;
+
+        QList<float> values, mins, maxs, infs, sups;
+        stream >> values >> mins >> maxs >> infs >> sups;
+
+        QMap<QString, QList<float>> presets;
+        stream >> presets;
+
+        if (stream.status() != QDataStream::Ok) {
+            return;
+        }
+
+        UniformMat4Parameter* parameter = new UniformMat4Parameter(paramName, uniformName, editable, static_cast<UniformMat4Type>(mat4Type), values, mins, maxs, infs, sups, operation);
+
+        parameter->setPresets(presets);
+
+        parameter->setRow(row);
+        parameter->setCol(col);
+
+        operation->addMat4UniformParameter(parameter);
+    }
+}
+
+
+
+void OperationBundle::writeOptionsParameters(ImageOperation* operation, QDataStream& stream)
+{
+    stream << static_cast<qint32>(operation->optionsParameters<GLenum>().size());
+
+    foreach (auto parameter, operation->optionsParameters<GLenum>())
+    {
+        stream << parameter->name() << parameter->editable() << static_cast<qint32>(parameter->row()) << static_cast<qint32>(parameter->col());
+        stream << parameter->valueNames() << parameter->values() << parameter->value();
+    }
+}
+
+
+
+void OperationBundle::readOptionsParameters(ImageOperation* operation, QDataStream& stream)
+{
+    qint32 count = 0;
+    stream >> count;
+
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+    {
+        QString paramName;
+        bool editable;
+        qint32 row, col;
+
+        stream >> paramName >> editable >> row >> col;
+
+        QList<QString> names;
+        QList<GLenum> values;
+        GLenum value;
+
+        stream >> names >> values >> value;
+
+        if (stream.status() != QDataStream::Ok) {
+            return;
+        }
+
+        OptionsParameter<GLenum>* parameter = new OptionsParameter<GLenum>(paramName, editable, names, values, value, operation);
+
+        parameter->setRow(row);
+        parameter->setCol(col);
+
+        operation->addOptionsParameter<GLenum>(parameter);
+    }
+}
+
+
+
+// SPIR-V is compiled from the preprocessed shaders with glslangValidator (or $GLSLANG_VALIDATOR)
+// Not possible if the shaders depend on values known only at run time: such operations are bundled as GLSL only
+
+bool OperationBundle::compileSpirv(ImageOperation* operation)
+{
+    mLog.clear();
+
+    bool specialized = false;
+
+    foreach (auto parameter, operation->uniformParameters<float>())
+        specialized |= parameter->specialized();
+    foreach (auto parameter, operation->uniformParameters<int>())
+        specialized |= parameter->specialized();
+    foreach (auto parameter, operation->uniformParameters<unsigned int>())
+        specialized |= parameter->specialized();
+
+    if (specialized)
+    {
+        mLog = "Specialized parameters";
+        return false;
+    }
+
+    ShaderPreprocessor preprocessor;
+
+    if (!operation->sourceFile().isEmpty()) {
+        preprocessor.setBaseDirectory(QFileInfo(operation->sourceFile()).absolutePath());
+    }
+
+    QString vertexShader = preprocessor.process(operation->vertexShader());
+    QString fragmentShader = preprocessor.ok() ? preprocessor.process(operation->fragmentShader()) : QString();
+
+    if (!preprocessor.ok())
+    {
+        mLog = preprocessor.error();
+        return false;
+    }
+
+    // Defines set per instance by ImageOperation::preprocessShaders
+
+    foreach (QString name, QStringList({ "ARRAY_TEX_DEPTH", "TEX_WIDTH", "TEX_HEIGHT", "FAN_IN" }))
+    {
+        QRegularExpression nameRe(QString("\\b%1\\b").arg(name));
+
+        if (vertexShader.contains(nameRe) || fragmentShader.contains(nameRe))
+        {
+            mLog = QString("Uses %1").arg(name);
+            return false;
+        }
+    }
+
+    QMap<QString, int> locations;
+
+    vertexShader = ShaderPreprocessor::assignLocations(vertexShader, locations);
+    fragmentShader = ShaderPreprocessor::assignLocations(fragmentShader, locations);
+
+    QByteArray vertexSpirv, fragmentSpirv;
+
+    if (!runValidator(vertexShader, "vert", vertexSpirv) || !runValidator(fragmentShader, "frag", fragmentSpirv)) {
+        return false;
+    }
+
+    operation->setSpirv(vertexSpirv, fragmentSpirv, locations, operation->expandedSourceKey());
+
+    return true;
+}
+
+
+
+bool OperationBundle::runValidator(QString source, QString stage, QByteArray& spirv)
+{
+    QTemporaryDir dir;
+
+    if (!dir.isValid())
+    {
+        mLog = "Cannot create temporary directory";
+        return false;
+    }
+
+    QString sourcePath = dir.filePath("shader." + stage);
+    QString spirvPath = dir.filePath("shader." + stage + ".spv");
+
+    QFile sourceFile(sourcePath);
+
+    if (!sourceFile.open(QIODevice::WriteOnly))
+    {
+        mLog = "Cannot write " + sourcePath;
+        return false;
+    }
+
+    sourceFile.write(source.toUtf8());
+    sourceFile.close();
+
+    QString validator = qEnvironmentVariable("GLSLANG_VALIDATOR", "glslangValidator");
+
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(validator, QStringList({ "-G", "-o", spirvPath, sourcePath }));
+
+    if (!process.waitForFinished(60000) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+    {
+        mLog = process.error() == QProcess::FailedToStart ? validator + " not found" : QString::fromUtf8(process.readAll());
+        return false;
+    }
+
+    QFile spirvFile(spirvPath);
+
+    if (!spirvFile.open(QIODevice::ReadOnly))
+    {
+        mLog = "No SPIR-V output";
+        return false;
+    }
+
+    spirv = spirvFile.readAll();
+    spirvFile.close();
+
+    return !spirv.isEmpty();
+}
+
+
+
+// Batch conversion of an operations directory: returns the number of bundles written, -1 if the directory does not exist
+
+int OperationBundle::convertDirectory(QString directory)
+{
+    QDir dir(directory);
+
+    if (!dir.exists()) {
+        return -1;
+    }
+
+    int written = 0;
+
+    foreach (QString fileName, dir.entryList(QStringList({ "*.op" }), QDir::Files, QDir::Name))
+    {
+        QString path = dir.absoluteFilePath(fileName);
+
+        ImageOperation operation;
+        OperationParser opParser;
+
+        if (!opParser.read(&operation, path, false))
+        {
+            qWarning() << fileName << "cannot be read";
+            continue;
+        }
+
+        OperationBundle bundle;
+
+        if (!bundle.compileSpirv(&operation)) {
+            qInfo() << fileName << "bundled without SPIR-V:" << bundle.log();
+        }
+
+        if (bundle.write(&operation, bundlePath(path))) {
+            written++;
+        }
+        else {
+            qWarning() << fileName << "bundle cannot be written";
+        }
+    }
+
+    return written;
+}
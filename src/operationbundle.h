@@ -0,0 +1,82 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef OPERATIONBUNDLE_H
+#define OPERATIONBUNDLE_H
+
+
+
+#include "imageoperation.h"
+
+#include <QDataStream>
+#include <QString>
+
+
+
+// OperationBundle: binary companion of an operation file, foo.opb next to foo.op
+// Holds the operation serialized with QDataStream and, if it could be compiled, SPIR-V for each stage
+// Used instead of the operation file while it is newer than it and than its external shader files
+// The SPIR-V is dropped, and the GLSL compiled instead, if a file it includes changed since
+
+class OperationBundle
+{
+public:
+    OperationBundle();
+
+    bool write(ImageOperation* operation, QString filename);
+    bool read(ImageOperation* operation, QString filename);
+
+    bool compileSpirv(ImageOperation* operation);
+    QString log() const;
+
+    static QString bundlePath(QString filename);
+    static bool upToDate(QString filename);
+
+    static int convertDirectory(QString directory);
+
+private:
+    static constexpr quint32 magic = 0x4d474f42;
+    static constexpr quint32 formatVersion = 2;
+
+    QString mBaseDir;
+    QString mLog;
+
+    template<typename T>
+    void writeParameters(ImageOperation* operation, QDataStream& stream);
+
+    template<typename T>
+    void readParameters(ImageOperation* operation, QDataStream& stream);
+
+    void writeMat4Parameters(ImageOperation* operation, QDataStream& stream);
+    void readMat4Parameters(ImageOperation* operation, QDataStream& stream);
+
+    void writeOptionsParameters(ImageOperation* operation, QDataStream& stream);
+    void readOptionsParameters(ImageOperation* operation, QDataStream& stream);
+
+    bool runValidator(QString source, QString stage, QByteArray& spirv);
+};
+
+
+
+#endif // OPERATIONBUNDLE_H
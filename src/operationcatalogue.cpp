@@ -0,0 +1,200 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "operationcatalogue.h"
+#include "operationparser.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QHash>
+
+
+
+OperationCatalogue::OperationCatalogue(QString directory) :
+    mDirectory { directory },
+    mIndexPath { directory + ".index" }
+{}
+
+
+
+QString OperationCatalogue::directory() const
+{
+    return mDirectory;
+}
+
+
+
+// Returns whether the catalogue changed since the last scan
+
+bool OperationCatalogue::scan()
+{
+    if (!mLoaded)
+    {
+        load();
+        mLoaded = true;
+    }
+
+    QDir dir(mDirectory);
+
+    QFileInfoList infos;
+
+    if (dir.exists()) {
+        infos = dir.entryInfoList(QStringList { "*.op" }, QDir::Files | QDir::NoSymLinks, QDir::Name);
+    }
+
+    QHash<QString, CatalogueEntry> previous;
+
+    foreach (const CatalogueEntry& entry, mEntries) {
+        previous.insert(entry.fileName, entry);
+    }
+
+    QList<CatalogueEntry> entries;
+    bool changed = false;
+
+    OperationParser opParser;
+
+    foreach (const QFileInfo& info, infos)
+    {
+        CatalogueEntry entry = previous.value(info.fileName());
+        qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+        if (entry.fileName.isEmpty() || entry.modified != modified || entry.size != info.size())
+        {
+            QFile file(info.absoluteFilePath());
+
+            if (!file.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+
+            QByteArray hash = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1);
+
+            file.close();
+
+            if (hash != entry.hash)
+            {
+                entry.fileName = info.fileName();
+                entry.hash = hash;
+
+                if (!opParser.readMetadata(info.absoluteFilePath(), entry.name, entry.parameters)) {
+                    continue;
+                }
+            }
+
+            entry.modified = modified;
+            entry.size = info.size();
+
+            changed = true;
+        }
+
+        entries.append(entry);
+    }
+
+    changed = changed || entries.size() != mEntries.size();
+
+    mEntries = entries;
+
+    if (changed) {
+        save();
+    }
+
+    return changed;
+}
+
+
+
+const QList<CatalogueEntry>& OperationCatalogue::entries() const
+{
+    return mEntries;
+}
+
+
+
+QString OperationCatalogue::filePath(int index) const
+{
+    return mDirectory + "/" + mEntries[index].fileName;
+}
+
+
+
+void OperationCatalogue::load()
+{
+    QFile file(mIndexPath);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+
+    quint32 fileMagic = 0;
+    quint32 fileVersion = 0;
+    qint32 count = 0;
+
+    in >> fileMagic >> fileVersion >> count;
+
+    if (in.status() != QDataStream::Ok || fileMagic != magic || fileVersion != formatVersion) {
+        return;
+    }
+
+    QList<CatalogueEntry> entries;
+
+    for (int i = 0; i < count; i++)
+    {
+        CatalogueEntry entry;
+        in >> entry.fileName >> entry.name >> entry.parameters >> entry.modified >> entry.size >> entry.hash;
+        entries.append(entry);
+    }
+
+    // A damaged index is rebuilt by the scan
+
+    if (in.status() == QDataStream::Ok) {
+        mEntries = entries;
+    }
+}
+
+
+
+void OperationCatalogue::save()
+{
+    QSaveFile file(mIndexPath);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << magic << formatVersion << static_cast<qint32>(mEntries.size());
+
+    foreach (const CatalogueEntry& entry, mEntries) {
+        out << entry.fileName << entry.name << entry.parameters << entry.modified << entry.size << entry.hash;
+    }
+
+    file.commit();
+}
@@ -0,0 +1,83 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef OPERATIONCATALOGUE_H
+#define OPERATIONCATALOGUE_H
+
+
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+
+
+
+// Index entry of an operation file: enough to list it without parsing it
+
+struct CatalogueEntry
+{
+    QString fileName;
+    QString name;
+    QStringList parameters;
+    qint64 modified = 0;
+    qint64 size = 0;
+    QByteArray hash;
+};
+
+
+
+// OperationCatalogue: index of the operations directory, persisted next to it
+// A rescan stats every file but reads only new or modified ones, and parses their metadata only if the contents changed
+
+class OperationCatalogue
+{
+public:
+    OperationCatalogue(QString directory);
+
+    QString directory() const;
+
+    bool scan();
+
+    const QList<CatalogueEntry>& entries() const;
+    QString filePath(int index) const;
+
+private:
+    static constexpr quint32 magic = 0x4d474f43;
+    static constexpr quint32 formatVersion = 1;
+
+    QString mDirectory;
+    QString mIndexPath;
+
+    QList<CatalogueEntry> mEntries;
+    bool mLoaded = false;
+
+    void load();
+    void save();
+};
+
+
+
+#endif // OPERATIONCATALOGUE_H
@@ -0,0 +1,521 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "operationgraph.h"
+
+#include <algorithm>
+
+
+
+OperationGraph::OperationGraph()
+{
+    clear();
+}
+
+
+
+void OperationGraph::clear()
+{
+    mIndices.clear();
+    mIds.clear();
+    mOrd.clear();
+    mNodeAt.clear();
+    mNumNodes = 0;
+
+    mEdges.clear();
+
+    mOutOffsets = { 0 };
+    mOutTargets.clear();
+    mInOffsets = { 0 };
+    mInSources.clear();
+
+    mRemovedEdges.clear();
+    mAddedOut.clear();
+    mAddedIn.clear();
+    mNumEdits = 0;
+
+    mVisited.clear();
+    mParents.clear();
+    mVisitStamp = 0;
+}
+
+
+
+void OperationGraph::addNode(QUuid id)
+{
+    if (mIndices.contains(id)) {
+        return;
+    }
+
+    // New nodes go last in the order, they have no edges yet
+
+    int index = mIds.size();
+
+    mIndices.insert(id, index);
+    mIds.append(id);
+    mOrd.append(mNodeAt.size());
+    mNodeAt.append(index);
+    mNumNodes++;
+
+    mAddedOut.append(QList<int>());
+    mAddedIn.append(QList<int>());
+
+    mVisited.append(0);
+    mParents.append(-1);
+}
+
+
+
+void OperationGraph::removeNode(QUuid id)
+{
+    if (!mIndices.contains(id)) {
+        return;
+    }
+
+    int index = mIndices.value(id);
+
+    QList<int> outputs;
+    forEachOutput(index, [&](int w) { outputs.append(w); });
+
+    QList<int> inputs;
+    forEachInput(index, [&](int w) { inputs.append(w); });
+
+    foreach (int w, outputs) {
+        removeEdgeAt(index, w);
+    }
+    foreach (int w, inputs) {
+        removeEdgeAt(w, index);
+    }
+
+    // Leave a hole in the order, the index is not reused until the next rebuild
+
+    mNodeAt[mOrd[index]] = -1;
+    mOrd[index] = -1;
+    mIds[index] = QUuid();
+    mIndices.remove(id);
+    mNumNodes--;
+
+    rebuildIfNeeded();
+}
+
+
+
+bool OperationGraph::contains(QUuid id) const
+{
+    return mIndices.contains(id);
+}
+
+
+
+QList<QUuid> OperationGraph::insertEdge(QUuid srcId, QUuid dstId)
+{
+    if (!mIndices.contains(srcId) || !mIndices.contains(dstId)) {
+        return QList<QUuid>();
+    }
+
+    if (srcId == dstId) {
+        return QList<QUuid>({ srcId });
+    }
+
+    int x = mIndices.value(srcId);
+    int y = mIndices.value(dstId);
+
+    quint64 key = edgeKey(x, y);
+
+    if (mEdges.contains(key)) {
+        return QList<QUuid>();
+    }
+
+    // The order is only affected if the destination comes before the source
+    // Search forward from the destination and backward from the source, within the affected region
+
+    int lowerBound = mOrd[y];
+    int upperBound = mOrd[x];
+
+    if (lowerBound < upperBound)
+    {
+        QList<int> forward;
+
+        if (searchForward(y, upperBound, x, forward))
+        {
+            // Reached the source: the edge would close a cycle, follow the search tree back to the destination
+
+            QList<QUuid> path;
+
+            for (int w = x; w != -1; w = mParents[w]) {
+                path.prepend(mIds[w]);
+            }
+
+            path.removeLast();
+            path.prepend(srcId);
+
+            return path;
+        }
+
+        QList<int> backward;
+        searchBackward(x, lowerBound, backward);
+
+        reorder(backward, forward);
+    }
+
+    mEdges.insert(key);
+
+    if (!mRemovedEdges.remove(key))
+    {
+        mAddedOut[x].append(y);
+        mAddedIn[y].append(x);
+    }
+
+    mNumEdits++;
+
+    rebuildIfNeeded();
+
+    return QList<QUuid>();
+}
+
+
+
+void OperationGraph::removeEdge(QUuid srcId, QUuid dstId)
+{
+    if (!mIndices.contains(srcId) || !mIndices.contains(dstId)) {
+        return;
+    }
+
+    removeEdgeAt(mIndices.value(srcId), mIndices.value(dstId));
+
+    rebuildIfNeeded();
+}
+
+
+
+bool OperationGraph::hasEdge(QUuid srcId, QUuid dstId) const
+{
+    if (!mIndices.contains(srcId) || !mIndices.contains(dstId)) {
+        return false;
+    }
+
+    return mEdges.contains(edgeKey(mIndices.value(srcId), mIndices.value(dstId)));
+}
+
+
+
+int OperationGraph::numNodes() const
+{
+    return mNumNodes;
+}
+
+
+
+int OperationGraph::numEdges() const
+{
+    return mEdges.size();
+}
+
+
+
+QList<QUuid> OperationGraph::order() const
+{
+    QList<QUuid> ids;
+    ids.reserve(mNumNodes);
+
+    foreach (int index, mNodeAt) {
+        if (index >= 0) {
+            ids.append(mIds[index]);
+        }
+    }
+
+    return ids;
+}
+
+
+
+quint64 OperationGraph::edgeKey(int src, int dst)
+{
+    return (static_cast<quint64>(src) << 32) | static_cast<quint32>(dst);
+}
+
+
+
+void OperationGraph::removeEdgeAt(int x, int y)
+{
+    quint64 key = edgeKey(x, y);
+
+    if (!mEdges.remove(key)) {
+        return;
+    }
+
+    // Removing an edge keeps the order valid
+
+    if (mAddedOut[x].removeOne(y)) {
+        mAddedIn[y].removeOne(x);
+    }
+    else {
+        mRemovedEdges.insert(key);
+    }
+
+    mNumEdits++;
+}
+
+
+
+template <typename Function>
+void OperationGraph::forEachOutput(int index, Function function) const
+{
+    if (index + 1 < mOutOffsets.size())
+    {
+        for (int k = mOutOffsets[index]; k < mOutOffsets[index + 1]; k++)
+        {
+            int w = mOutTargets[k];
+            if (mRemovedEdges.isEmpty() || !mRemovedEdges.contains(edgeKey(index, w))) {
+                function(w);
+            }
+        }
+    }
+
+    foreach (int w, mAddedOut[index]) {
+        function(w);
+    }
+}
+
+
+
+template <typename Function>
+void OperationGraph::forEachInput(int index, Function function) const
+{
+    if (index + 1 < mInOffsets.size())
+    {
+        for (int k = mInOffsets[index]; k < mInOffsets[index + 1]; k++)
+        {
+            int w = mInSources[k];
+            if (mRemovedEdges.isEmpty() || !mRemovedEdges.contains(edgeKey(w, index))) {
+                function(w);
+            }
+        }
+    }
+
+    foreach (int w, mAddedIn[index]) {
+        function(w);
+    }
+}
+
+
+
+bool OperationGraph::searchForward(int start, int upperBound, int target, QList<int>& reached)
+{
+    if (++mVisitStamp == 0)
+    {
+        mVisited.fill(0);
+        mVisitStamp = 1;
+    }
+
+    QList<int> stack = { start };
+    mVisited[start] = mVisitStamp;
+    mParents[start] = -1;
+
+    bool found = false;
+
+    while (!stack.isEmpty() && !found)
+    {
+        int v = stack.takeLast();
+        reached.append(v);
+
+        forEachOutput(v, [&](int w) {
+            if (found) {
+                return;
+            }
+
+            if (w == target)
+            {
+                mParents[w] = v;
+                found = true;
+            }
+            else if (mVisited[w] != mVisitStamp && mOrd[w] < upperBound)
+            {
+                mVisited[w] = mVisitStamp;
+                mParents[w] = v;
+                stack.append(w);
+            }
+        });
+    }
+
+    return found;
+}
+
+
+
+void OperationGraph::searchBackward(int start, int lowerBound, QList<int>& reached)
+{
+    if (++mVisitStamp == 0)
+    {
+        mVisited.fill(0);
+        mVisitStamp = 1;
+    }
+
+    QList<int> stack = { start };
+    mVisited[start] = mVisitStamp;
+
+    while (!stack.isEmpty())
+    {
+        int v = stack.takeLast();
+        reached.append(v);
+
+        forEachInput(v, [&](int w) {
+            if (mVisited[w] != mVisitStamp && mOrd[w] > lowerBound)
+            {
+                mVisited[w] = mVisitStamp;
+                stack.append(w);
+            }
+        });
+    }
+}
+
+
+
+void OperationGraph::reorder(QList<int> backward, QList<int> forward)
+{
+    // Nodes reaching the source go before those reached from the destination,
+    // reusing the same positions and keeping the relative order within each set
+
+    auto byOrd = [this](int a, int b) { return mOrd[a] < mOrd[b]; };
+
+    std::sort(backward.begin(), backward.end(), byOrd);
+    std::sort(forward.begin(), forward.end(), byOrd);
+
+    QList<int> nodes = backward + forward;
+
+    QList<int> positions;
+    positions.reserve(nodes.size());
+
+    foreach (int v, nodes) {
+        positions.append(mOrd[v]);
+    }
+
+    std::sort(positions.begin(), positions.end());
+
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        mOrd[nodes[i]] = positions[i];
+        mNodeAt[positions[i]] = nodes[i];
+    }
+}
+
+
+
+void OperationGraph::rebuild()
+{
+    // Compact indices following the order, so that after a rebuild index and position coincide
+
+    QList<int> remap(mIds.size(), -1);
+    QList<QUuid> ids;
+    ids.reserve(mNumNodes);
+
+    foreach (int index, mNodeAt)
+    {
+        if (index >= 0)
+        {
+            remap[index] = ids.size();
+            ids.append(mIds[index]);
+        }
+    }
+
+    int n = ids.size();
+
+    QSet<quint64> edges;
+    edges.reserve(mEdges.size());
+
+    QList<int> outDegrees(n, 0);
+    QList<int> inDegrees(n, 0);
+
+    foreach (quint64 key, mEdges)
+    {
+        int src = remap[static_cast<int>(key >> 32)];
+        int dst = remap[static_cast<int>(key & 0xffffffff)];
+
+        edges.insert(edgeKey(src, dst));
+        outDegrees[src]++;
+        inDegrees[dst]++;
+    }
+
+    mIds = ids;
+    mIndices.clear();
+    mOrd.resize(n);
+    mNodeAt.resize(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        mIndices.insert(mIds[i], i);
+        mOrd[i] = i;
+        mNodeAt[i] = i;
+    }
+
+    mEdges = edges;
+
+    // Compressed sparse rows
+
+    mOutOffsets = QList<int>(n + 1, 0);
+    mInOffsets = QList<int>(n + 1, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        mOutOffsets[i + 1] = mOutOffsets[i] + outDegrees[i];
+        mInOffsets[i + 1] = mInOffsets[i] + inDegrees[i];
+    }
+
+    mOutTargets = QList<int>(mEdges.size(), 0);
+    mInSources = QList<int>(mEdges.size(), 0);
+
+    QList<int> outFill = mOutOffsets;
+    QList<int> inFill = mInOffsets;
+
+    foreach (quint64 key, mEdges)
+    {
+        int src = static_cast<int>(key >> 32);
+        int dst = static_cast<int>(key & 0xffffffff);
+
+        mOutTargets[outFill[src]++] = dst;
+        mInSources[inFill[dst]++] = src;
+    }
+
+    mRemovedEdges.clear();
+    mAddedOut = QList<QList<int>>(n);
+    mAddedIn = QList<QList<int>>(n);
+    mNumEdits = 0;
+
+    mVisited = QList<quint32>(n, 0);
+    mParents = QList<int>(n, -1);
+    mVisitStamp = 0;
+}
+
+
+
+void OperationGraph::rebuildIfNeeded()
+{
+    int maxEdits = qMax(64, static_cast<int>(mEdges.size() / 4));
+    int maxHoles = qMax(64, mNumNodes);
+
+    if (mNumEdits > maxEdits || mNodeAt.size() - mNumNodes > maxHoles) {
+        rebuild();
+    }
+}
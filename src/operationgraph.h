@@ -0,0 +1,117 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef OPERATIONGRAPH_H
+#define OPERATIONGRAPH_H
+
+
+
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QUuid>
+
+
+
+// OperationGraph: dependency graph of the operations through their normal (non blit) edges
+// Adjacency is stored in compressed sparse rows, with small per node lists of the edits made since the last rebuild
+// A topological order is maintained incrementally under edge insertion (Pearce-Kelly), so that
+// an edge closing a cycle is detected as soon as it is inserted, and is rejected
+
+class OperationGraph
+{
+public:
+    OperationGraph();
+
+    void clear();
+
+    void addNode(QUuid id);
+    void removeNode(QUuid id);
+    bool contains(QUuid id) const;
+
+    // Returns an empty list if the edge was inserted, otherwise the cycle it would close, starting at srcId
+
+    QList<QUuid> insertEdge(QUuid srcId, QUuid dstId);
+    void removeEdge(QUuid srcId, QUuid dstId);
+    bool hasEdge(QUuid srcId, QUuid dstId) const;
+
+    int numNodes() const;
+    int numEdges() const;
+
+    QList<QUuid> order() const;
+
+private:
+    // Node index <-> id, position of each index in the order and index at each position (-1 for holes)
+
+    QHash<QUuid, int> mIndices;
+    QList<QUuid> mIds;
+    QList<int> mOrd;
+    QList<int> mNodeAt;
+    int mNumNodes = 0;
+
+    // All edges, keyed by source and destination indices
+
+    QSet<quint64> mEdges;
+
+    // Compressed sparse rows, forward and backward
+
+    QList<int> mOutOffsets;
+    QList<int> mOutTargets;
+    QList<int> mInOffsets;
+    QList<int> mInSources;
+
+    // Edits since the last rebuild
+
+    QSet<quint64> mRemovedEdges;
+    QList<QList<int>> mAddedOut;
+    QList<QList<int>> mAddedIn;
+    int mNumEdits = 0;
+
+    // Search state
+
+    QList<quint32> mVisited;
+    QList<int> mParents;
+    quint32 mVisitStamp = 0;
+
+    static quint64 edgeKey(int src, int dst);
+
+    void removeEdgeAt(int x, int y);
+
+    template <typename Function>
+    void forEachOutput(int index, Function function) const;
+    template <typename Function>
+    void forEachInput(int index, Function function) const;
+
+    bool searchForward(int start, int upperBound, int target, QList<int>& reached);
+    void searchBackward(int start, int lowerBound, QList<int>& reached);
+    void reorder(QList<int> backward, QList<int> forward);
+
+    void rebuild();
+    void rebuildIfNeeded();
+};
+
+
+
+#endif // OPERATIONGRAPH_H
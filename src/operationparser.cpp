@@ -4,6 +4,8 @@
 #include "operationparser.h"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
 
 
 
@@ -13,6 +15,8 @@ OperationParser::OperationParser(){}
 
 void OperationParser::write(ImageOperation *operation, QString filename, bool writeIds)
 {
+    mBaseDir = QFileInfo(filename).absolutePath();
+
     QFile outFile(filename);
     if (outFile.open(QIODevice::WriteOnly))
     {
@@ -32,6 +36,8 @@ void OperationParser::write(ImageOperation *operation, QString filename, bool wr
 
         outFile.close();
     }
+
+    mBaseDir.clear();
 }
 
 
@@ -47,12 +53,20 @@ bool OperationParser::read(ImageOperation* operation, QString filename, bool rea
         QXmlStreamReader mStream;
         mStream.setDevice(&inFile);
 
+        mBaseDir = QFileInfo(filename).absolutePath();
+
         if (mStream.readNextStartElement() && mStream.name() == "fosforo")
         {
             mStream.readNextStartElement();
             success = readOperation(operation, mStream, readIds);
         }
 
+        if (success) {
+            operation->setSourceFile(QFileInfo(filename).absoluteFilePath());
+        }
+
+        mBaseDir.clear();
+
         if (mStream.tokenType() == QXmlStreamReader::Invalid)
             mStream.readNext();
 
@@ -67,6 +81,46 @@ bool OperationParser::read(ImageOperation* operation, QString filename, bool rea
 
 
 
+// Name and parameter signatures ("type name") only: shaders are skipped without decoding
+
+bool OperationParser::readMetadata(QString filename, QString& name, QStringList& parameters)
+{
+    bool success = false;
+
+    name.clear();
+    parameters.clear();
+
+    QFile inFile(filename);
+    if (inFile.open(QIODevice::ReadOnly))
+    {
+        QXmlStreamReader mStream;
+        mStream.setDevice(&inFile);
+
+        if (mStream.readNextStartElement() && mStream.name() == "fosforo" &&
+            mStream.readNextStartElement() && mStream.name() == "operation")
+        {
+            name = mStream.attributes().value("name").toString();
+
+            while (mStream.readNextStartElement())
+            {
+                if (mStream.name() == "parameter") {
+                    parameters.append(mStream.attributes().value("type").toString() + " " + mStream.attributes().value("name").toString());
+                }
+
+                mStream.skipCurrentElement();
+            }
+
+            success = !mStream.hasError();
+        }
+
+        inFile.close();
+    }
+
+    return success;
+}
+
+
+
 void OperationParser::writeOperation(ImageOperation *operation, QXmlStreamWriter& stream, bool writeIds)
 {
     // Operation
@@ -76,13 +130,24 @@ void OperationParser::writeOperation(ImageOperation *operation, QXmlStreamWriter
     stream.writeAttribute("name", operation->name());
     stream.writeAttribute("enabled", QString::number(operation->enabled()));
 
-    // Shaders: encoded in base64
+    // Operation file the operation was read from, to keep reloading it in a configuration
+
+    if (writeIds && !operation->sourceFile().isEmpty())
+        stream.writeAttribute("source", operation->sourceFile());
+
+    // Shaders: encoded in base64, along with the external file they were read from if any
+
+    QDir baseDir(mBaseDir);
 
     stream.writeStartElement("vertex_shader");
+    if (!operation->vertexShaderFile().isEmpty())
+        stream.writeAttribute("file", mBaseDir.isEmpty() ? operation->vertexShaderFile() : baseDir.relativeFilePath(operation->vertexShaderFile()));
     stream.writeCharacters(QString::fromUtf8(operation->vertexShader().toUtf8().toBase64()));
     stream.writeEndElement();
 
     stream.writeStartElement("fragment_shader");
+    if (!operation->fragmentShaderFile().isEmpty())
+        stream.writeAttribute("file", mBaseDir.isEmpty() ? operation->fragmentShaderFile() : baseDir.relativeFilePath(operation->fragmentShaderFile()));
     stream.writeCharacters(QString::fromUtf8(operation->fragmentShader().toUtf8().toBase64()));
     stream.writeEndElement();
 
@@ -131,6 +196,9 @@ bool OperationParser::readOperation(ImageOperation* operation, QXmlStreamReader&
         operation->setName(name);
         operation->enable(enabled);
 
+        if (stream.attributes().hasAttribute("source"))
+            operation->setSourceFile(stream.attributes().value("source").toString());
+
         operation->setSampler2DAvail(false);
         operation->setSampler2DArrayAvail(false);
 
@@ -138,13 +206,15 @@ bool OperationParser::readOperation(ImageOperation* operation, QXmlStreamReader&
         {
             if (stream.name() == "vertex_shader")
             {
-                QString vertexShader = QString::fromUtf8(QByteArray::fromBase64(stream.readElementText().toUtf8()));
-                operation->setVertexShader(vertexShader);
+                QString filename;
+                operation->setVertexShader(readShader(stream, filename));
+                operation->setVertexShaderFile(filename);
             }
             else if (stream.name() == "fragment_shader")
             {
-                QString fragmentShader = QString::fromUtf8(QByteArray::fromBase64(stream.readElementText().toUtf8()));
-                operation->setFragmentShader(fragmentShader);
+                QString filename;
+                operation->setFragmentShader(readShader(stream, filename));
+                operation->setFragmentShaderFile(filename);
             }
             else if (stream.name() == "sampler2d")
             {
@@ -186,6 +256,33 @@ bool OperationParser::readOperation(ImageOperation* operation, QXmlStreamReader&
 
 
 
+// The external file wins over the embedded copy if it can be read
+
+QString OperationParser::readShader(QXmlStreamReader& stream, QString& filename)
+{
+    filename = stream.attributes().value("file").toString();
+
+    if (!filename.isEmpty()) {
+        filename = QDir(mBaseDir.isEmpty() ? QDir::currentPath() + "/operations" : mBaseDir).absoluteFilePath(filename);
+    }
+
+    QString shader = QString::fromUtf8(QByteArray::fromBase64(stream.readElementText().toUtf8()));
+
+    if (!filename.isEmpty())
+    {
+        QFile file(filename);
+        if (file.open(QIODevice::ReadOnly))
+        {
+            shader = QString::fromUtf8(file.readAll());
+            file.close();
+        }
+    }
+
+    return shader;
+}
+
+
+
 template<typename T>
 void OperationParser::writeParameters(ImageOperation* operation, QXmlStreamWriter& stream, bool writeIds)
 {
@@ -208,6 +305,9 @@ void OperationParser::writeParameters(ImageOperation* operation, QXmlStreamWrite
         stream.writeAttribute("row", QString::number(parameter->row()));
         stream.writeAttribute("column", QString::number(parameter->col()));
 
+        if (parameter->specialized())
+            stream.writeAttribute("specialize", "1");
+
         stream.writeStartElement("uniform");
 
         stream.writeAttribute("name", parameter->uniformName());
@@ -272,6 +372,7 @@ void OperationParser::readParameters(ImageOperation* operation, QXmlStreamReader
     bool editable = stream.attributes().value("editable").toInt();
     int row = stream.attributes().value("row").toInt();
     int col = stream.attributes().value("column").toInt();
+    bool specialize = stream.attributes().value("specialize").toInt();
 
     QString uniformName;
     int uniformType;
@@ -378,6 +479,8 @@ void OperationParser::readParameters(ImageOperation* operation, QXmlStreamReader
     parameter->setRow(row);
     parameter->setCol(col);
 
+    parameter->setSpecialized(specialize);
+
     operation->addUniformParameter<T>(parameter);
 }
 
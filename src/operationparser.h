@@ -7,6 +7,7 @@
 
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
+#include <QStringList>
 
 
 
@@ -17,6 +18,7 @@ public:
 
     void write(ImageOperation* operation, QString filename, bool writeIds);
     bool read(ImageOperation* operation, QString filename, bool readIds);
+    bool readMetadata(QString filename, QString& name, QStringList& parameters);
 
     void writeOperation(ImageOperation* operation, QXmlStreamWriter& stream, bool writeIds);
     bool readOperation(ImageOperation* operation, QXmlStreamReader& stream, bool readIds);
@@ -32,6 +34,13 @@ public:
 
     template<typename T>
     void readParameters(ImageOperation* operation, QXmlStreamReader& stream, bool readIds);
+
+private:
+    // Directory of the operation file being read or written: external shader files are relative to it
+
+    QString mBaseDir;
+
+    QString readShader(QXmlStreamReader& stream, QString& filename);
 };
 
 
@@ -27,6 +27,17 @@ OperationWidget::OperationWidget(QUuid id, ImageOperation* operation, bool midiE
 
     connect(mOpBuilder, &OperationBuilder::operationSetUp, this, &OperationWidget::recreate);
 
+    // Operation rebuilt by the factory after its file changed
+
+    connect(mFactory, &Factory::operationReloaded, this, [=, this](ImageOperation* oldOperation, ImageOperation* operation) {
+        if (oldOperation == mOperation)
+        {
+            mOpBuilder->setOperation(operation);
+            mOperation = operation;
+            recreate();
+        }
+    });
+
     mainLayout = new QVBoxLayout;
     mainLayout->setSizeConstraint(QLayout::SetMinAndMaxSize);
     mainLayout->setContentsMargins(5, 5, 5, 5);
@@ -781,7 +792,7 @@ void OperationWidget::updateSelParamControls(ParameterWidget<T>* widget)
     selParamSlider->setValue(number->index());
 
     selParamSliderConns.clear();
-    selParamSliderConns.resize(3);
+    selParamSliderConns.resize(5);
 
     selParamSliderConns[0] = connect(selParamSlider, &QAbstractSlider::sliderMoved, widget, &ParameterWidget<T>::setValueFromIndex);
     selParamSliderConns[1] = connect(number, &Number<T>::indexChanged, selParamSlider, &QAbstractSlider::setValue);
@@ -789,6 +800,15 @@ void OperationWidget::updateSelParamControls(ParameterWidget<T>* widget)
         selParamSlider->setRange(0, indexMax);
     });
 
+    // Deferred changes arrive per parameter
+
+    selParamSliderConns[3] = connect(widget->parameter(), QOverload<int, QVariant>::of(&Parameter::valueChanged), this, [=, this](int, QVariant) {
+        selParamSlider->setValue(number->index());
+    });
+    selParamSliderConns[4] = connect(widget->parameter(), &Parameter::valuesChanged, this, [=, this](int, int) {
+        selParamSlider->setValue(number->index());
+    });
+
     // Minimum
 
     selParamMinLineEdit->setVisible(true);
@@ -881,7 +901,7 @@ void OperationWidget::updateSelParamEditControls(ParameterWidget<T>* widget)
     selParamSlider->setValue(number->index());
 
     selParamSliderConns.clear();
-    selParamSliderConns.resize(3);
+    selParamSliderConns.resize(5);
 
     selParamSliderConns[0] = connect(selParamSlider, &QAbstractSlider::sliderMoved, widget, &ParameterWidget<T>::setValueFromIndex);
     selParamSliderConns[1] = connect(number, &Number<T>::indexChanged, selParamSlider, &QAbstractSlider::setValue);
@@ -889,6 +909,13 @@ void OperationWidget::updateSelParamEditControls(ParameterWidget<T>* widget)
         selParamSlider->setRange(0, indexMax);
     });
 
+    selParamSliderConns[3] = connect(widget->parameter(), QOverload<int, QVariant>::of(&Parameter::valueChanged), this, [=, this](int, QVariant) {
+        selParamSlider->setValue(number->index());
+    });
+    selParamSliderConns[4] = connect(widget->parameter(), &Parameter::valuesChanged, this, [=, this](int, int) {
+        selParamSlider->setValue(number->index());
+    });
+
     // Inf (lowest)
 
     selParamInfLineEdit->setVisible(true);
@@ -1293,6 +1320,10 @@ void OperationWidget::replaceOperation(QAction* action)
 
         ImageOperation* operation = mFactory->createReplaceOp(mId, mOperation, index);
 
+        if (!operation) {
+            return;
+        }
+
         mOpBuilder->setOperation(operation);
 
         ImageOperation* oldOperation = mOperation;
@@ -22,17 +22,7 @@ BaseUniformParameter<T>::BaseUniformParameter(QString theName, QString theUnifor
     mUniformType { theUniformType }
 {
     for (int i = 0; i < theValues.size(); i++)
-    {
-        Number<T>* number = new Number<T>(theValues.at(i), theMin.at(i), theMax.at(i), theInf.at(i), theSup.at(i));
-        mNumbers.append(number);
-    }
-
-    for (int i = 0; i < mNumbers.size(); i++) {
-        connect(mNumbers[i], &NumberSignals::valueChanged, this, [=, this](QVariant value) {
-            emit valueChanged(i, value);
-            setUniform();
-        });
-    }
+        appendNumber(QUuid::createUuid(), theValues.at(i), theMin.at(i), theMax.at(i), theInf.at(i), theSup.at(i));
 }
 
 
@@ -44,17 +34,7 @@ BaseUniformParameter<T>::BaseUniformParameter(QString theName, QString theUnifor
     mUniformType { theUniformType }
 {
     for (int i = 0; i < theValues.size(); i++)
-    {
-        Number<T>* number = new Number<T>(theIds.at(i), theValues.at(i), theMin.at(i), theMax.at(i), theInf.at(i), theSup.at(i));
-        mNumbers.append(number);
-    }
-
-    for (int i = 0; i < mNumbers.size(); i++) {
-        connect(mNumbers[i], &NumberSignals::valueChanged, this, [=, this](QVariant value) {
-            emit valueChanged(i, value);
-            setUniform();
-        });
-    }
+        appendNumber(theIds.at(i), theValues.at(i), theMin.at(i), theMax.at(i), theInf.at(i), theSup.at(i));
 }
 
 
@@ -65,19 +45,13 @@ BaseUniformParameter<T>::BaseUniformParameter(const BaseUniformParameter<T>& par
 {
     foreach (Number<T>* number, parameter.mNumbers)
     {
-        Number<T>* newNumber = new Number<T>(*number);
-        mNumbers.append(newNumber);
-    }
-
-    for (int i = 0; i < mNumbers.size(); i++) {
-        connect(mNumbers[i], &NumberSignals::valueChanged, this, [=, this](QVariant value) {
-            emit valueChanged(i, value);
-            setUniform();
-        });
+        Number<T>* newNumber = appendNumber(number->id(), number->value(), number->min(), number->max(), number->inf(), number->sup());
+        newNumber->setIndexMax(number->indexMax());
     }
 
     mUniformName = parameter.mUniformName;
     mUniformType = parameter.mUniformType;
+    mSpecialized = parameter.mSpecialized;
     mPresets = parameter.mPresets;
 }
 
@@ -91,6 +65,36 @@ BaseUniformParameter<T>::~BaseUniformParameter()
 
 
 
+// Numbers are handles to consecutive slots of the parameter's store
+
+template <typename T>
+Number<T>* BaseUniformParameter<T>::appendNumber(QUuid id, T value, T min, T max, T inf, T sup)
+{
+    int i = mStore.append(id, value, min, max, inf, sup);
+
+    Number<T>* number = new Number<T>(&mStore, i);
+    mNumbers.append(number);
+
+    connect(number, &NumberSignals::valueChanged, this, [=, this](QVariant value) {
+        if (!mBatchUpdate)
+            emit valueChanged(i, value);
+    });
+
+    return number;
+}
+
+
+
+template <typename T>
+void BaseUniformParameter<T>::clearNumbers()
+{
+    qDeleteAll(mNumbers);
+    mNumbers.clear();
+    mStore.clear();
+}
+
+
+
 template <typename T>
 QString BaseUniformParameter<T>::uniformName() const
 {
@@ -107,6 +111,24 @@ int BaseUniformParameter<T>::uniformType() const
 
 
 
+// Specialized: values are compiled into the program as constants, which is relinked when they change
+
+template <typename T>
+bool BaseUniformParameter<T>::specialized() const
+{
+    return mSpecialized;
+}
+
+
+
+template <typename T>
+void BaseUniformParameter<T>::setSpecialized(bool set)
+{
+    mSpecialized = set;
+}
+
+
+
 template <typename T>
 T BaseUniformParameter<T>::value(int i)
 {
@@ -123,12 +145,11 @@ void BaseUniformParameter<T>::setValue(int i, T theValue)
 {
     if (i < mNumbers.size())
     {
+        // The number's valueChanged already emits valueChanged(i, value)
+
         mNumbers[i]->setValue(theValue);
 
-        //emit valueChanged(i, QVariant(theValue));
         emit valueChanged(QVariant(theValue));
-
-        setUniform();
     }
 }
 
@@ -141,10 +162,7 @@ void BaseUniformParameter<T>::setValueFromIndex(int i, int index)
     {
         mNumbers[i]->setValueFromIndex(index);
 
-        emit valueChanged(i, QVariant(mNumbers[i]->value()));
         emit valueChanged(QVariant(mNumbers[i]->value()));
-
-        setUniform();
     }
 }
 
@@ -154,15 +172,33 @@ template <typename T>
 void BaseUniformParameter<T>::setValues(QList<T> values)
 {
     if (values.size() == mNumbers.size())
-    {
-        for (int i = 0; i < mNumbers.size(); i++)
-            mNumbers[i]->setValue(values[i]);
+        setValues(0, values);
+}
 
-        setUniform();
-    }
+
+
+// Batch update: per number signals are held back and a single valuesChanged covers the whole range
+
+template <typename T>
+void BaseUniformParameter<T>::setValues(int first, QList<T> values)
+{
+    if (first < 0 || first >= mNumbers.size() || values.isEmpty())
+        return;
+
+    int last = qMin(first + static_cast<int>(values.size()), static_cast<int>(mNumbers.size())) - 1;
+
+    mBatchUpdate = true;
+
+    for (int i = first; i <= last; i++)
+        mNumbers[i]->setValue(values[i - first]);
+
+    mBatchUpdate = false;
+
+    emit valuesChanged(first, last);
 }
 
 
+
 template <typename T>
 void BaseUniformParameter<T>::setMin(T theMin)
 {
@@ -202,10 +238,55 @@ void BaseUniformParameter<T>::setSup(T theSup)
 template <typename T>
 QList<T> BaseUniformParameter<T>::values()
 {
-    QList<T> theValues;
-    foreach (Number<T>* number, mNumbers)
-        theValues.append(number->value());
-    return theValues;
+    return mStore.values();
+}
+
+
+
+template <typename T>
+const QList<T>& BaseUniformParameter<T>::constValues() const
+{
+    return mStore.values();
+}
+
+
+
+// Upload the uniform if any of its values changed since the last flush
+
+template <typename T>
+void BaseUniformParameter<T>::flushUniform()
+{
+    if (mStore.dirty())
+    {
+        setUniform();
+        mStore.clearDirty();
+    }
+}
+
+
+
+template <typename T>
+bool BaseUniformParameter<T>::dirty() const
+{
+    return mStore.dirty();
+}
+
+
+
+// Deferred writes (MIDI, statistics feedback) are announced once per flush, as one range over the pending slots
+
+template <typename T>
+void BaseUniformParameter<T>::notifyPending()
+{
+    int first, last;
+
+    if (mStore.takePending(first, last))
+    {
+        if (first == last)
+            emit valueChanged(first, QVariant(mStore.value(first)));
+        else
+            emit valuesChanged(first, last);
+    }
 }
 
 
@@ -221,10 +302,8 @@ QList<Number<T>*> BaseUniformParameter<T>::numbers()
 template <typename T>
 Number<T>* BaseUniformParameter<T>::number(QUuid theId)
 {
-    foreach (Number<T>* number, mNumbers)
-        if (theId == number->id())
-            return number;
-    return nullptr;
+    int i = mStore.slot(theId);
+    return i >= 0 ? mNumbers[i] : nullptr;
 }
 
 
@@ -288,15 +367,7 @@ template <typename T>
 void BaseUniformParameter<T>::setPreset(QString name)
 {
     if (mPresets.contains(name))
-    {
-        for (int i = 0; i < mNumbers.size(); i++)
-        {
-            mNumbers[i]->setValue(mPresets[name][i]);
-            emit valueChanged(i, QVariant(mNumbers[i]->value()));
-        }
-
-        setUniform();
-    }
+        setValues(0, mPresets[name]);
 }
 
 
@@ -25,12 +25,19 @@ public:
     QString uniformName() const;
     int uniformType() const;
 
+    bool specialized() const;
+    void setSpecialized(bool set);
+
     T value(int i);
     void setValue(int i, T theValue);
     void setValueFromIndex(int i, int index);
     void setValues(QList<T> values);
+    void setValues(int first, QList<T> values);
 
     virtual void setUniform() = 0;
+    void flushUniform();
+    bool dirty() const;
+    void notifyPending();
 
     void setMin(T theMin);
     void setMax(T theMax);
@@ -39,6 +46,7 @@ public:
     void setSup(T theSup);
 
     QList<T> values();
+    const QList<T>& constValues() const;
 
     QList<Number<T>*> numbers();
 
@@ -57,8 +65,14 @@ public:
 protected:
     QString mUniformName;
     int mUniformType;
+    bool mSpecialized = false;
+    ParameterStore<T> mStore;
     QList<Number<T>*> mNumbers;
     QMap<QString, QList<T>> mPresets;
+    bool mBatchUpdate = false;
+
+    Number<T>* appendNumber(QUuid id, T value, T min, T max, T inf, T sup);
+    void clearNumbers();
 };
 
 #endif // BASEUNIFORMPARAMETER_H
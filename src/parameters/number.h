@@ -7,6 +7,8 @@
 #include <QUuid>
 #include <QVariant>
 
+#include "parameterstore.h"
+
 
 
 class NumberSignals : public QObject
@@ -28,174 +30,193 @@ signals:
 
 
 
+// Number: handle to one slot of a parameter store
+// Numbers created on their own (blend factors, builder defaults) own a single slot store
+
 template <class T>
 class Number : public NumberSignals
 {
 public:
     Number(T theValue, T theMin, T theMax, T theInf, T theSup) :
-        mValue { theValue },
-        mMin { theMin },
-        mMax { theMax },
-        mInf { theInf },
-        mSup { theSup }
-    {
-        mId = QUuid::createUuid();
-    }
-
-    Number(QUuid theId, T theValue, T theMin, T theMax, T theInf, T theSup) :
-        mId { theId },
-        mValue { theValue },
-        mMin { theMin },
-        mMax { theMax },
-        mInf { theInf },
-        mSup { theSup }
+        Number(QUuid::createUuid(), theValue, theMin, theMax, theInf, theSup)
+    {}
+
+    Number(QUuid theId, T theValue, T theMin, T theMax, T theInf, T theSup)
+    {
+        mOwnStore = new ParameterStore<T>;
+        mStore = mOwnStore;
+        mSlot = mStore->append(theId, theValue, theMin, theMax, theInf, theSup);
+    }
+
+    Number(ParameterStore<T>* theStore, int theSlot) :
+        mStore { theStore },
+        mSlot { theSlot }
     {}
 
     Number(const Number<T>& number) :
         NumberSignals()
     {
-        mId = number.mId;
-        mValue = number.mValue;
-        mMin = number.mMin;
-        mMax = number.mMax;
-        mInf = number.mInf;
-        mSup = number.mSup;
+        mOwnStore = new ParameterStore<T>;
+        mStore = mOwnStore;
+        mSlot = mStore->append(number.id(), number.value(), number.min(), number.max(), number.inf(), number.sup());
         mIndexMax = number.mIndexMax;
     }
 
     ~Number()
     {
         emit deleting();
+        delete mOwnStore;
     }
 
     QUuid id() const
     {
-        return mId;
+        return mStore->id(mSlot);
+    }
+
+    void setId(QUuid theId)
+    {
+        mStore->setId(mSlot, theId);
     }
 
     void setLimits()
     {
-        if (mInf > mSup) {
-            mInf = mSup;
+        if (inf() > sup()) {
+            mStore->setInf(mSlot, sup());
         }
 
-        if (mMin < mInf)
+        if (min() < inf())
         {
-            mMin = mInf;
+            mStore->setMin(mSlot, inf());
             emit minChanged();
         }
 
-        if (mMax > mSup)
+        if (max() > sup())
         {
-            mMax = mSup;
+            mStore->setMax(mSlot, sup());
             emit maxChanged();
         }
 
-        if (mMin > mMax)
+        if (min() > max())
         {
-            mMin = mMax;
+            mStore->setMin(mSlot, max());
             emit minChanged();
         }
 
-        if (mValue < mInf)
+        if (value() < inf())
         {
-            mValue = mInf;
-            emit valueChanged(QVariant(mValue));
+            mStore->setValue(mSlot, inf());
+            emit valueChanged(QVariant(value()));
         }
 
-        if (mValue > mSup)
+        if (value() > sup())
         {
-            mValue = mSup;
-            emit valueChanged(QVariant(mValue));
+            mStore->setValue(mSlot, sup());
+            emit valueChanged(QVariant(value()));
         }
 
-        if (mMin > mValue)
+        if (min() > value())
         {
-            mMin = mValue;
+            mStore->setMin(mSlot, value());
             emit minChanged();
         }
 
-        if (mMax < mValue)
+        if (max() < value())
         {
-            mMax = mValue;
+            mStore->setMax(mSlot, value());
             emit maxChanged();
         }
     }
 
     void setMin(T theMin)
     {
-        mMin = theMin;
+        mStore->setMin(mSlot, theMin);
         setLimits();
         setIndex();
     }
 
     T min() const
     {
-        return mMin;
+        return mStore->min(mSlot);
     }
 
     void setMax(T theMax)
     {
-        mMax = theMax;
+        mStore->setMax(mSlot, theMax);
         setLimits();
         setIndex();
     }
 
     T max() const
     {
-        return mMax;
+        return mStore->max(mSlot);
     }
 
     void setInf(T theInf)
     {
-        mInf = theInf;
+        mStore->setInf(mSlot, theInf);
         setLimits();
     }
 
     T inf() const
     {
-        return mInf;
+        return mStore->inf(mSlot);
     }
 
     void setSup(T theSup)
     {
-        mSup = theSup;
+        mStore->setSup(mSlot, theSup);
         setLimits();
     }
 
     T sup() const
     {
-        return mSup;
+        return mStore->sup(mSlot);
     }
 
     void setValue(T theValue)
     {
-        mValue = theValue;
+        mStore->setValue(mSlot, theValue);
         setLimits();
         setIndex();
-        emit valueChanged(QVariant(mValue));
+        emit valueChanged(QVariant(value()));
     }
 
     void setValueFromIndex(int theIndex)
     {
-        mValue = static_cast<T>(mMin + (mMax - mMin) * static_cast<float>(theIndex) / static_cast<float>(mIndexMax));
-        emit valueChanged(QVariant(mValue));
+        mStore->setValue(mSlot, valueAt(theIndex));
+        emit valueChanged(QVariant(value()));
+    }
+
+    // Deferred: no signals here, the owning parameter notifies once for all its numbers at the next flush
+    // Numbers owning their store have no parameter flushing them and notify right away
+
+    void setValueFromIndexDeferred(int theIndex)
+    {
+        if (mOwnStore)
+        {
+            setValueFromIndex(theIndex);
+            setIndex();
+        }
+        else
+        {
+            mStore->setValue(mSlot, valueAt(theIndex));
+            mStore->setPending(mSlot);
+        }
     }
 
     T value() const
     {
-        return mValue;
+        return mStore->value(mSlot);
     }
 
     void setIndex()
     {
-        int index = static_cast<int>(mIndexMax * static_cast<float>(mValue - mMin) / static_cast<float>(mMax - mMin));
-        emit indexChanged(index);
+        emit indexChanged(index());
     }
 
     int index() const
     {
-        return static_cast<int>(mIndexMax * static_cast<float>(mValue - mMin) / static_cast<float>(mMax - mMin));
+        return static_cast<int>(mIndexMax * static_cast<float>(value() - min()) / static_cast<float>(max() - min()));
     }
 
     int indexMax() const
@@ -221,10 +242,16 @@ public:
     }
 
 private:
-    QUuid mId;
-    T mValue, mMin, mMax, mInf, mSup;
+    ParameterStore<T>* mStore = nullptr;
+    ParameterStore<T>* mOwnStore = nullptr;
+    int mSlot = 0;
     int mIndexMax = 100'000;
     bool mMidiLinked = false;
+
+    T valueAt(int theIndex) const
+    {
+        return static_cast<T>(min() + (max() - min()) * static_cast<float>(theIndex) / static_cast<float>(mIndexMax));
+    }
 };
 
 
@@ -46,6 +46,7 @@ public:
 signals:
     void valueChanged(QVariant value);
     void valueChanged(int i, QVariant value);
+    void valuesChanged(int first, int last);
     void indexChanged(int index);
 };
 
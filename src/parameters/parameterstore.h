@@ -0,0 +1,161 @@
+#ifndef PARAMETERSTORE_H
+#define PARAMETERSTORE_H
+
+
+
+#include <QList>
+#include <QHash>
+#include <QUuid>
+#include <QBitArray>
+
+
+
+// Structure of arrays holding the numbers of a parameter
+// Values are contiguous so that the uniform upload reads them in place
+// Value writes set a dirty bit, consumed once per frame by the owning operation
+// Deferred writes also set a pending bit, turned into a single change notification at the same flush
+
+template <typename T>
+class ParameterStore
+{
+public:
+    int append(QUuid id, T value, T min, T max, T inf, T sup)
+    {
+        int slot = mValues.size();
+
+        mIds.append(id);
+        mSlots.insert(id, slot);
+
+        mValues.append(value);
+        mMin.append(min);
+        mMax.append(max);
+        mInf.append(inf);
+        mSup.append(sup);
+
+        mDirty.resize(slot + 1);
+        mDirty.setBit(slot);
+        mDirtyCount++;
+
+        mPending.resize(slot + 1);
+
+        return slot;
+    }
+
+    void clear()
+    {
+        mIds.clear();
+        mSlots.clear();
+        mValues.clear();
+        mMin.clear();
+        mMax.clear();
+        mInf.clear();
+        mSup.clear();
+        mDirty.clear();
+        mDirtyCount = 0;
+        mPending.clear();
+        mPendingCount = 0;
+    }
+
+    int size() const { return mValues.size(); }
+
+    QUuid id(int slot) const { return mIds.at(slot); }
+    int slot(QUuid id) const { return mSlots.value(id, -1); }
+
+    void setId(int slot, QUuid id)
+    {
+        mSlots.remove(mIds.at(slot));
+        mIds[slot] = id;
+        mSlots.insert(id, slot);
+    }
+
+    T value(int slot) const { return mValues.at(slot); }
+    T min(int slot) const { return mMin.at(slot); }
+    T max(int slot) const { return mMax.at(slot); }
+    T inf(int slot) const { return mInf.at(slot); }
+    T sup(int slot) const { return mSup.at(slot); }
+
+    void setValue(int slot, T value)
+    {
+        if (mValues.at(slot) != value)
+        {
+            mValues[slot] = value;
+
+            if (!mDirty.testBit(slot))
+            {
+                mDirty.setBit(slot);
+                mDirtyCount++;
+            }
+        }
+    }
+
+    void setMin(int slot, T min) { mMin[slot] = min; }
+    void setMax(int slot, T max) { mMax[slot] = max; }
+    void setInf(int slot, T inf) { mInf[slot] = inf; }
+    void setSup(int slot, T sup) { mSup[slot] = sup; }
+
+    const QList<T>& values() const { return mValues; }
+
+    bool dirty() const { return mDirtyCount > 0; }
+    bool dirty(int slot) const { return mDirty.testBit(slot); }
+
+    void clearDirty()
+    {
+        if (mDirtyCount > 0)
+        {
+            mDirty.fill(false);
+            mDirtyCount = 0;
+        }
+    }
+
+    void setPending(int slot)
+    {
+        if (!mPending.testBit(slot))
+        {
+            mPending.setBit(slot);
+            mPendingCount++;
+        }
+    }
+
+    bool pending() const { return mPendingCount > 0; }
+
+    // Range of slots written since the last call, which clears them
+
+    bool takePending(int& first, int& last)
+    {
+        if (mPendingCount == 0)
+            return false;
+
+        first = 0;
+        while (!mPending.testBit(first))
+            first++;
+
+        last = mPending.size() - 1;
+        while (!mPending.testBit(last))
+            last--;
+
+        mPending.fill(false);
+        mPendingCount = 0;
+
+        return true;
+    }
+
+private:
+    QList<QUuid> mIds;
+    QHash<QUuid, int> mSlots;
+
+    QList<T> mValues;
+    QList<T> mMin;
+    QList<T> mMax;
+    QList<T> mInf;
+    QList<T> mSup;
+
+    QBitArray mDirty;
+    int mDirtyCount = 0;
+
+    QBitArray mPending;
+    int mPendingCount = 0;
+};
+
+
+
+#endif // PARAMETERSTORE_H
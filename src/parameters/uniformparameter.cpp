@@ -37,17 +37,9 @@ UniformParameter<T>::UniformParameter(QString theName, QString theUniformName, i
     QList<T> theValues = QList<T>(nItems * numValuesPerItem, 0);
 
     for (T value : theValues)
-    {
-        Number<T>* number = new Number<T>(value, 0, 1, 0, 1);
-        BaseUniformParameter<T>::mNumbers.append(number);
-    }
+        BaseUniformParameter<T>::appendNumber(QUuid::createUuid(), value, 0, 1, 0, 1);
 
     BaseUniformParameter<T>::mEmpty = theValues.empty();
-
-    // Connections
-
-    for (int i = 0; i < BaseUniformParameter<T>::mNumbers.size(); i++)
-        BaseUniformParameter<T>::connect(BaseUniformParameter<T>::mNumbers[i], &NumberSignals::valueChanged, this, [=, this](QVariant value){ emit BaseUniformParameter<T>::valueChanged(i, value); });
 }
 
 
@@ -89,7 +81,7 @@ UniformParameter<T>::UniformParameter(const UniformParameter<T>& parameter) :
 template <typename T>
 void UniformParameter<T>::setUniform()
 {
-    BaseUniformParameter<T>::mOperation->setUniform(BaseUniformParameter<T>::mUniformName, BaseUniformParameter<T>::mUniformType, nItems, BaseUniformParameter<T>::values().constData());
+    BaseUniformParameter<T>::mOperation->setUniform(BaseUniformParameter<T>::mUniformName, BaseUniformParameter<T>::mUniformType, nItems, BaseUniformParameter<T>::constValues().constData());
 }
 
 
@@ -39,6 +39,12 @@ PlotsWidget::PlotsWidget(RenderManager*renderManager, QWidget* parent) :
 
     rgbWidget = new RGBWidget(mTexWidth, mTexHeight);
 
+    histogramWidget = new HistogramWidget(mRenderManager->histogramEngine());
+
+    mStatisticsWidget = new StatisticsWidget(mRenderManager->statisticsEngine());
+
+    mConvergenceWidget = new ConvergenceWidget(mRenderManager->fingerprintEngine());
+
     selectPathComboBox = new QComboBox;
     selectPathComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
 
@@ -51,6 +57,19 @@ PlotsWidget::PlotsWidget(RenderManager*renderManager, QWidget* parent) :
     numItsLineEdit->setValidator(numItsValidator);
     numItsLineEdit->setText(QString::number(numIts));
 
+    // Point cloud subsampling stride
+
+    QLineEdit* strideLineEdit = new QLineEdit;
+    QIntValidator* strideValidator = new QIntValidator(1, 64, strideLineEdit);
+    strideLineEdit->setValidator(strideValidator);
+    strideLineEdit->setText("1");
+    strideLineEdit->setToolTip("Stride");
+
+    QPushButton* densityButton = new QPushButton(QIcon(QPixmap(":/icons/office-chart-area-stacked.png")), "");
+    densityButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    densityButton->setCheckable(true);
+    densityButton->setToolTip("Density");
+
     QPushButton* addPathButton = new QPushButton(QIcon(QPixmap(":/icons/list-add.png")), "");
     addPathButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
 
@@ -65,6 +84,10 @@ PlotsWidget::PlotsWidget(RenderManager*renderManager, QWidget* parent) :
     yCoordValidator = new QIntValidator(0, mTexHeight - 1, xCoordLineEdit);
     yCoordLineEdit->setValidator(yCoordValidator);
 
+    probeNodeComboBox = new QComboBox;
+    probeNodeComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    probeNodeComboBox->addItem("Output");
+
     QPushButton* viewSourcePushButton = new QPushButton(QIcon(QPixmap(":/icons/eye.png")), "");
     viewSourcePushButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
     viewSourcePushButton->setCheckable(true);
@@ -72,25 +95,36 @@ PlotsWidget::PlotsWidget(RenderManager*renderManager, QWidget* parent) :
     QHBoxLayout* controlsLayout = new QHBoxLayout;
     controlsLayout->addWidget(enableButton);
     controlsLayout->addWidget(numItsLineEdit);
+    controlsLayout->addWidget(strideLineEdit);
+    controlsLayout->addWidget(densityButton);
     controlsLayout->addWidget(addPathButton);
     controlsLayout->addWidget(removePathButton);
     controlsLayout->addWidget(selectPathComboBox);
     controlsLayout->addWidget(xCoordLineEdit);
     controlsLayout->addWidget(yCoordLineEdit);
+    controlsLayout->addWidget(probeNodeComboBox);
     controlsLayout->addWidget(viewSourcePushButton);
 
     QVBoxLayout* layout = new QVBoxLayout;
     layout->addLayout(controlsLayout);
     layout->addWidget(rgbWidget);
+    layout->addWidget(histogramWidget);
+    layout->addWidget(mStatisticsWidget);
+    layout->addWidget(mConvergenceWidget);
 
     connect(enableButton, &QPushButton::toggled, this, [&](bool checked) {
         rgbWidget->setUpdatesEnabled(checked);
         enabled = checked;
     });
+    connect(strideLineEdit, &QLineEdit::editingFinished, this, [=, this]() {
+        rgbWidget->setStride(strideLineEdit->text().toInt());
+    });
+    connect(densityButton, &QPushButton::toggled, rgbWidget, &RGBWidget::setDensityMode);
     connect(addPathButton, &QPushButton::clicked, this, &PlotsWidget::addColorPath);
     connect(removePathButton, &QPushButton::clicked, this, &PlotsWidget::removeColorPath);
     connect(viewSourcePushButton, &QPushButton::toggled, this, &PlotsWidget::drawCursor);
     connect(selectPathComboBox, &QComboBox::activated, this, &PlotsWidget::setControls);
+    connect(probeNodeComboBox, &QComboBox::activated, this, &PlotsWidget::setProbeNode);
 
     connect(numItsLineEdit, &QLineEdit::editingFinished, this, &PlotsWidget::setNumIts);
 
@@ -138,6 +172,8 @@ PlotsWidget::~PlotsWidget()
 
 void PlotsWidget::updatePlots()
 {
+    updateProbedTextures();
+
     if (enabled)
     {
         setPixelRGB();
@@ -157,6 +193,47 @@ void PlotsWidget::updatePlots()
 
 
 
+void PlotsWidget::updateProbedTextures()
+{
+    // Nodes observed by probes, histogram and statistics must be rendered even if they do not reach the output
+
+    QList<GLuint*> texIds;
+
+    if (enabled)
+    {
+        foreach (ColorPath path, colorPaths) {
+            if (path.texId() && !texIds.contains(path.texId())) {
+                texIds.append(path.texId());
+            }
+        }
+    }
+
+    HistogramEngine* histogram = mRenderManager->histogramEngine();
+
+    if (histogram->enabled() && histogram->source() && !texIds.contains(histogram->source())) {
+        texIds.append(histogram->source());
+    }
+
+    StatisticsEngine* statistics = mRenderManager->statisticsEngine();
+
+    if (statistics->enabled())
+    {
+        foreach (GLuint* pTexId, statistics->sources()) {
+            if (pTexId && !texIds.contains(pTexId)) {
+                texIds.append(pTexId);
+            }
+        }
+    }
+
+    if (texIds != mProbedTexIds)
+    {
+        mProbedTexIds = texIds;
+        emit probedTexturesChanged(mProbedTexIds);
+    }
+}
+
+
+
 void PlotsWidget::setTextureID(GLuint* texId)
 {
     if (texId)
@@ -176,12 +253,7 @@ void PlotsWidget::setSize(int width, int height)
     xCoordValidator->setTop(width - 1);
     yCoordValidator->setTop(height - 1);
 
-    if (rgbWidget->isValid())
-    {
-        rgbWidget->makeCurrent();
-        rgbWidget->setupBuffer(width, height);
-        rgbWidget->doneCurrent();
-    }
+    rgbWidget->setTextureSize(width, height);
 }
 
 
@@ -278,6 +350,17 @@ void PlotsWidget::setControls(int index)
     xCoordLineEdit->setText(QString::number(colorPaths[index].source().x()));
     yCoordLineEdit->setText(QString::number(colorPaths[index].source().y()));
 
+    int nodeIndex = 0;
+
+    for (int i = 0; i < probeOperations.size(); i++)
+    {
+        if (probeOperations[i]->pOutTextureId() == colorPaths[index].texId()) {
+            nodeIndex = i + 1;
+        }
+    }
+
+    probeNodeComboBox->setCurrentIndex(nodeIndex);
+
     cursor = colorPaths[index].source();
 
     emit selectedPointChanged(cursor);
@@ -285,6 +368,57 @@ void PlotsWidget::setControls(int index)
 
 
 
+void PlotsWidget::setProbeNode(int index)
+{
+    int pathIndex = selectPathComboBox->currentIndex();
+
+    if (pathIndex >= 0)
+    {
+        colorPaths[pathIndex].setTexId(index > 0 ? probeOperations[index - 1]->pOutTextureId() : nullptr);
+        colorPaths[pathIndex].clear();
+    }
+}
+
+
+
+void PlotsWidget::setProbeOperations(QList<ImageOperation*> operations)
+{
+    probeOperations = operations;
+
+    histogramWidget->setSourceOperations(operations);
+    mStatisticsWidget->setSourceOperations(operations);
+
+    // Paths probing removed operations fall back to the output
+
+    QList<GLuint*> texIds;
+
+    foreach (ImageOperation* operation, probeOperations) {
+        texIds.append(operation->pOutTextureId());
+    }
+
+    for (ColorPath &path : colorPaths)
+    {
+        if (path.texId() && !texIds.contains(path.texId()))
+        {
+            path.setTexId(nullptr);
+            path.clear();
+        }
+    }
+
+    probeNodeComboBox->clear();
+    probeNodeComboBox->addItem("Output");
+
+    for (int i = 0; i < probeOperations.size(); i++) {
+        probeNodeComboBox->addItem(QString::number(i + 1) + ": " + probeOperations[i]->name());
+    }
+
+    if (selectPathComboBox->currentIndex() >= 0) {
+        setControls(selectPathComboBox->currentIndex());
+    }
+}
+
+
+
 void PlotsWidget::setNumIts()
 {
     numIts = numItsLineEdit->text().toInt();
@@ -323,12 +457,31 @@ void PlotsWidget::setNumIts()
 
 void PlotsWidget::setPixelRGB()
 {
+    // Probe results arrive with at least one iteration of delay
+    // Results of requests made before the paths changed are discarded
+
+    foreach (QList<float> rgb, mRenderManager->takePixelProbeResults())
+    {
+        if (rgb.size() == 3 * colorPaths.size())
+        {
+            for (int i = 0; i < colorPaths.size(); i++) {
+                colorPaths[i].addPoint(rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]);
+            }
+        }
+    }
+
+    QList<PixelProbe> probes;
+
     for (ColorPath &path : colorPaths)
     {
-        QList<float> rgb = mRenderManager->rgbPixel(path.source());
-        path.addPoint(rgb[0], rgb[1], rgb[2]);
+        PixelProbe probe;
+        probe.pTexId = path.texId();
+        probe.pos = path.source();
+        probes.append(probe);
     }
 
+    mRenderManager->requestPixelProbes(probes);
+
     setVertices();
 }
 
@@ -344,3 +497,17 @@ void PlotsWidget::setVertices()
         numVertices.append(path.linesSize());
     }
 }
+
+
+
+StatisticsWidget* PlotsWidget::statisticsWidget()
+{
+    return mStatisticsWidget;
+}
+
+
+
+ConvergenceWidget* PlotsWidget::convergenceWidget()
+{
+    return mConvergenceWidget;
+}
@@ -26,6 +26,9 @@
 
 #include "rendermanager.h"
 #include "rgbwidget.h"
+#include "histogramwidget.h"
+#include "statisticswidget.h"
+#include "convergencewidget.h"
 #include "colorpath.h"
 
 #include <QWidget>
@@ -47,10 +50,13 @@ public:
     // void init(QOpenGLContext* mainContext);
     bool isEnabled(){ return enabled; }
     void updatePlots();
+    StatisticsWidget* statisticsWidget();
+    ConvergenceWidget* convergenceWidget();
 
 signals:
     void selectedPointChanged(QPoint point);
     void drawCursor(bool on);
+    void probedTexturesChanged(QList<GLuint*> pTexIds);
 
 public slots:
     // void setFBO(GLuint theFBO) { fbo = theFBO; };
@@ -58,10 +64,15 @@ public slots:
     void setSize(int width, int height);
     void setSelectedPoint(QPoint point);
     void transformSources(QTransform transform);
+    void setProbeOperations(QList<ImageOperation*> operations);
 
 private:
     RenderManager* mRenderManager;
     RGBWidget* rgbWidget;
+    HistogramWidget* histogramWidget;
+    QList<GLuint*> mProbedTexIds;
+    StatisticsWidget* mStatisticsWidget;
+    ConvergenceWidget* mConvergenceWidget;
 
     // QOpenGLContext* context;
     // QOffscreenSurface* surface;
@@ -83,7 +94,10 @@ private:
 
     int numIts = 100;
 
+    QList<ImageOperation*> probeOperations;
+
     QComboBox* selectPathComboBox;
+    QComboBox* probeNodeComboBox;
     QLineEdit* xCoordLineEdit;
     QLineEdit* yCoordLineEdit;
     QIntValidator* xCoordValidator;
@@ -93,10 +107,12 @@ private:
     void checkPoint(QPoint &point);
     void setVertices();
     void setPixelRGB();
+    void updateProbedTextures();
 
 private slots:
     void addColorPath();
     void removeColorPath();
     void setControls(int index);
+    void setProbeNode(int index);
     void setNumIts();
 };
@@ -0,0 +1,282 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "programcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+
+
+ProgramCache::ProgramCache()
+{
+    setDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programs");
+}
+
+
+
+QString ProgramCache::directory() const
+{
+    return mDirectory;
+}
+
+
+
+void ProgramCache::setDirectory(QString dir)
+{
+    mDirectory = dir;
+    QDir().mkpath(mDirectory);
+    scan();
+}
+
+
+
+QByteArray ProgramCache::key(const QString& vertexShader, const QString& fragmentShader, const QByteArray& driver)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    hash.addData(QByteArray::number(formatVersion));
+    hash.addData(driver);
+    hash.addData(vertexShader.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(fragmentShader.toUtf8());
+
+    return hash.result().toHex();
+}
+
+
+
+bool ProgramCache::load(const QByteArray& key, GLenum& format, QByteArray& binary)
+{
+    QFile file(filePath(key));
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        mMisses++;
+        return false;
+    }
+
+    QDataStream in(&file);
+
+    quint32 fileMagic = 0;
+    quint32 fileVersion = 0;
+    quint32 fileFormat = 0;
+
+    in >> fileMagic >> fileVersion >> fileFormat >> binary;
+
+    if (in.status() != QDataStream::Ok || fileMagic != magic || fileVersion != formatVersion || binary.isEmpty())
+    {
+        file.close();
+        remove(key);
+        mMisses++;
+        return false;
+    }
+
+    format = static_cast<GLenum>(fileFormat);
+
+    file.close();
+
+    // Used binaries are the last to be evicted
+
+    if (file.open(QIODevice::Append)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    mHits++;
+
+    return true;
+}
+
+
+
+void ProgramCache::store(const QByteArray& key, GLenum format, const QByteArray& binary)
+{
+    if (binary.isEmpty())
+        return;
+
+    QString path = filePath(key);
+    bool exists = QFileInfo::exists(path);
+    qint64 oldSize = exists ? QFileInfo(path).size() : 0;
+
+    // Write to a temporary file and rename, so that a crash never leaves a truncated binary behind
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out << magic << formatVersion << static_cast<quint32>(format) << binary;
+
+    if (file.commit())
+    {
+        if (!exists)
+            mCount++;
+
+        mSize += QFileInfo(path).size() - oldSize;
+
+        evict(QFileInfo(path).fileName());
+    }
+}
+
+
+
+// Drop a binary the driver rejected, or one that could not be read
+
+void ProgramCache::remove(const QByteArray& key)
+{
+    QFileInfo info(filePath(key));
+
+    if (info.exists() && QFile::remove(info.filePath()))
+    {
+        mCount--;
+        mSize -= info.size();
+    }
+}
+
+
+
+void ProgramCache::clear()
+{
+    QDir dir(mDirectory);
+
+    foreach (QString name, dir.entryList(QStringList { "*.bin" }, QDir::Files)) {
+        dir.remove(name);
+    }
+
+    mCount = 0;
+    mSize = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+
+
+int ProgramCache::hits() const
+{
+    return mHits;
+}
+
+
+
+int ProgramCache::misses() const
+{
+    return mMisses;
+}
+
+
+
+double ProgramCache::hitRate() const
+{
+    int lookups = mHits + mMisses;
+    return lookups > 0 ? static_cast<double>(mHits) / lookups : 0.0;
+}
+
+
+
+int ProgramCache::count() const
+{
+    return mCount;
+}
+
+
+
+qint64 ProgramCache::size() const
+{
+    return mSize;
+}
+
+
+
+qint64 ProgramCache::maxSize() const
+{
+    return mMaxSize;
+}
+
+
+
+void ProgramCache::setMaxSize(qint64 bytes)
+{
+    mMaxSize = qMax<qint64>(0, bytes);
+    evict();
+}
+
+
+
+QString ProgramCache::filePath(const QByteArray& key) const
+{
+    return mDirectory + "/" + QString::fromLatin1(key) + ".bin";
+}
+
+
+
+void ProgramCache::scan()
+{
+    mCount = 0;
+    mSize = 0;
+
+    QDir dir(mDirectory);
+
+    foreach (QFileInfo info, dir.entryInfoList(QStringList { "*.bin" }, QDir::Files))
+    {
+        mCount++;
+        mSize += info.size();
+    }
+
+    evict();
+}
+
+
+
+void ProgramCache::evict(const QString& keep)
+{
+    // Oldest first, never the binary just stored
+
+    if (mSize <= mMaxSize)
+        return;
+
+    QDir dir(mDirectory);
+
+    foreach (QFileInfo info, dir.entryInfoList(QStringList { "*.bin" }, QDir::Files, QDir::Time | QDir::Reversed))
+    {
+        if (mSize <= mMaxSize)
+            break;
+
+        if (info.fileName() == keep)
+            continue;
+
+        if (QFile::remove(info.filePath()))
+        {
+            mCount--;
+            mSize -= info.size();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QString>
+#include <QByteArray>
+
+
+
+// ProgramCache: linked program binaries stored on disk, one file per program
+// Keyed by a hash of the shader sources, the driver (vendor, renderer, version) and the cache format,
+// so that a driver update or a source edit simply misses
+// Bounded in size: least recently used binaries, by modification time, are evicted first
+
+class ProgramCache
+{
+public:
+    ProgramCache();
+
+    QString directory() const;
+    void setDirectory(QString dir);
+
+    static QByteArray key(const QString& vertexShader, const QString& fragmentShader, const QByteArray& driver);
+
+    bool load(const QByteArray& key, GLenum& format, QByteArray& binary);
+    void store(const QByteArray& key, GLenum format, const QByteArray& binary);
+    void remove(const QByteArray& key);
+    void clear();
+
+    int hits() const;
+    int misses() const;
+    double hitRate() const;
+
+    int count() const;
+    qint64 size() const;
+
+    qint64 maxSize() const;
+    void setMaxSize(qint64 bytes);
+
+private:
+    static constexpr quint32 magic = 0x4d474c50;
+    static constexpr quint32 formatVersion = 1;
+
+    QString mDirectory;
+
+    int mHits = 0;
+    int mMisses = 0;
+
+    int mCount = 0;
+    qint64 mSize = 0;
+    qint64 mMaxSize = 128 * 1024 * 1024;
+
+    QString filePath(const QByteArray& key) const;
+    void scan();
+    void evict(const QString& keep = QString());
+};
+
+
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,70 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "programpool.h"
+
+
+
+QSharedPointer<SharedProgram> ProgramPool::find(const QByteArray& key)
+{
+    QSharedPointer<SharedProgram> program = mPrograms.value(key).toStrongRef();
+
+    if (!program) {
+        mPrograms.remove(key);
+    }
+
+    return program;
+}
+
+
+
+void ProgramPool::insert(const QByteArray& key, QSharedPointer<SharedProgram> program)
+{
+    prune();
+
+    mPrograms.insert(key, program.toWeakRef());
+}
+
+
+
+int ProgramPool::count()
+{
+    prune();
+
+    return mPrograms.size();
+}
+
+
+
+void ProgramPool::prune()
+{
+    for (auto it = mPrograms.begin(); it != mPrograms.end();)
+    {
+        if (it.value().isNull())
+            it = mPrograms.erase(it);
+        else
+            it++;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef PROGRAMPOOL_H
+#define PROGRAMPOOL_H
+
+
+
+#include <QOpenGLShaderProgram>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QString>
+
+
+
+// A linked program shared by all operation instances with the same shaders
+// Uniforms are program state: owner is the instance whose values the program currently holds
+
+struct SharedProgram
+{
+    enum class Status { Linking, Ready, Failed };
+
+    QOpenGLShaderProgram program;
+    Status status = Status::Linking;
+    const void* owner = nullptr;
+
+    // Explicit uniform locations of a program linked from SPIR-V, which may drop uniform names
+
+    QMap<QString, int> locations;
+};
+
+
+
+// ProgramPool: linked programs by source hash, held weakly
+// A program is deleted when its last instance drops it, with the instance's context current
+
+class ProgramPool
+{
+public:
+    QSharedPointer<SharedProgram> find(const QByteArray& key);
+    void insert(const QByteArray& key, QSharedPointer<SharedProgram> program);
+
+    int count();
+
+private:
+    QHash<QByteArray, QWeakPointer<SharedProgram>> mPrograms;
+
+    void prune();
+};
+
+
+
+#endif // PROGRAMPOOL_H
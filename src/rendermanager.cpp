@@ -26,7 +26,9 @@
 
 #include <QApplication>
 #include <QMessageBox>
-#include <QPainter>
+#include <QDir>
+#include <QFileInfo>
+#include <bit>
 
 
 
@@ -36,8 +38,18 @@ RenderManager::RenderManager(Factory *factory, VideoInputControl *videoInCtrl)
 {
     setOutputImage();
 
+    mHistogram = new HistogramEngine();
+    mStatistics = new StatisticsEngine();
+    mFingerprint = new FingerprintEngine();
+
+    mCheckpointWriter = new CheckpointWriter();
+    mCheckpointDirectory = QDir::currentPath() + "/checkpoints";
+
+    connect(mCheckpointWriter, &CheckpointWriter::written, this, &RenderManager::finishCheckpoint);
+
     connect(mFactory, &Factory::newOperationCreated, this, &RenderManager::initOperation);
     connect(mFactory, &Factory::replaceOpCreated, this, &RenderManager::initOperation);
+    connect(mFactory, &Factory::reloadOpCreated, this, &RenderManager::linkOperation);
     connect(mFactory, &Factory::newSeedCreated, this, &RenderManager::initSeed);
 
     connect(mVideoInputControl, &VideoInputControl::cameraUsed, this, &RenderManager::genImageTexture);
@@ -121,15 +133,90 @@ void RenderManager::init(QOpenGLContext* shareContext)
 
     setPbos();
 
+    // Pixel probes: coordinates and colors storage buffers, and readback ring
+
+    mProbeProgram = new QOpenGLShaderProgram();
+    setProbeProgram();
+
+    glCreateBuffers(1, &mProbeCoordsBuffer);
+    glNamedBufferStorage(mProbeCoordsBuffer, mMaxProbes * 4 * sizeof(GLint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &mProbeColorsBuffer);
+    glNamedBufferStorage(mProbeColorsBuffer, mMaxProbes * 4 * sizeof(GLfloat), nullptr, 0);
+
+    mProbeReadBuffers.resize(mProbeRingSize, 0);
+    mProbeFences.resize(mProbeRingSize, 0);
+    mProbeCounts.resize(mProbeRingSize, 0);
+
+    glCreateBuffers(mProbeRingSize, mProbeReadBuffers.data());
+
+    foreach (GLuint buffer, mProbeReadBuffers) {
+        glNamedBufferStorage(buffer, mMaxProbes * 4 * sizeof(GLfloat), nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+
+    // Histogram engine
+
+    mHistogram->init();
+
+    // Statistics engine
+
+    mStatistics->init();
+
+    // Fingerprint engine
+
+    mFingerprint->init();
+
+    // Rewind buffer
+
+    mRewind.init();
+
+    // Shader compiler: programs are linked without stalling iterations
+
+    mShaderCompiler = new ShaderCompiler();
+    mShaderCompiler->init(mContext);
+
     mContext->doneCurrent();
+
+    // Texture uploader: own thread and context shared with ours
+
+    mUploader = new TextureUploader();
+    mUploader->setTextureParameters(static_cast<GLenum>(mTexFormat), mTexWidth, mTexHeight);
+    mUploader->init(mContext);
 }
 
 
 
 RenderManager::~RenderManager()
 {
+    mUploader->stop();
+
     mContext->makeCurrent(mSurface);
 
+    mShaderCompiler->stop();
+
+    // Checkpoints in flight are completed before their buffers go
+
+    submitCheckpoints(true);
+    mCheckpointWriter->stop();
+
+    for (CheckpointReadback& readback : mCheckpointReadbacks) {
+        releaseCheckpoint(readback);
+    }
+
+    clearCheckpointBuffers();
+
+    foreach (TextureUpload upload, mPendingUploads)
+    {
+        glDeleteSync(upload.fence);
+        glDeleteTextures(1, &upload.texId);
+    }
+
+    foreach (GLuint* texId, mVideoTextures)
+    {
+        glDeleteTextures(1, texId);
+        delete texId;
+    }
+
     glDeleteFramebuffers(1, &mOutFbo);
     glDeleteFramebuffers(1, &mReadFbo);
     glDeleteFramebuffers(1, &mDrawFbo);
@@ -150,8 +237,43 @@ RenderManager::~RenderManager()
 
     glDeleteBuffers(mPboCount, mPbos.data());
 
+    delete mProbeProgram;
+
+    foreach (GLsync fence, mProbeFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    glDeleteBuffers(1, &mProbeCoordsBuffer);
+    glDeleteBuffers(1, &mProbeColorsBuffer);
+    glDeleteBuffers(mProbeRingSize, mProbeReadBuffers.data());
+
+    foreach (const CacheEntry& entry, mCacheEntries) {
+        if (entry.query) {
+            mRetiredCacheQueries.append(entry.query);
+        }
+    }
+
+    glDeleteQueries(mRetiredCacheQueries.size(), mRetiredCacheQueries.data());
+
+    mHistogram->cleanup();
+    mStatistics->cleanup();
+    mFingerprint->cleanup();
+    mRewind.cleanup();
+
+    glDeleteTextures(1, &mRewindViewTexId);
+
     mContext->doneCurrent();
 
+    delete mHistogram;
+    delete mStatistics;
+    delete mFingerprint;
+
+    delete mUploader;
+    delete mShaderCompiler;
+    delete mCheckpointWriter;
+
     delete mOutputImage;
 
     delete mContext;
@@ -176,21 +298,66 @@ void RenderManager::setActive(bool set)
 
 void RenderManager::iterate()
 {
-    for (auto [id, texId] : mVideoTextures.asKeyValueRange()) {
-        setImageTexture(texId, mVideoInputControl->frameImage(id));
+    // Iterating again leaves the rewind view for the live output
+
+    scrubRewind(0);
+
+    // Request upload of new camera frames only
+
+    for (auto [id, pTexId] : mVideoTextures.asKeyValueRange())
+    {
+        QImage* image = mVideoInputControl->frameImage(id);
+
+        if (mVideoFrameKeys.value(id, 0) != image->cacheKey())
+        {
+            mVideoFrameKeys.insert(id, image->cacheKey());
+            setImageTexture(pTexId, image);
+        }
     }
 
-    if (!mSortedOperations.isEmpty())
+    mContext->makeCurrent(mSurface);
+
+    swapUploadedTextures();
+
+    finishLinks();
+
+    // Parameter changes since the last iteration reach the programs here, once per frame
+
+    foreach (ImageOperation* operation, mSortedOperations) {
+        operation->flushUniforms();
+    }
+
+    foreach (Seed* seed, mFactory->seeds())
     {
-        mContext->makeCurrent(mSurface);
+        int skippedFrame = seed->stepSequence(mIterationNumber);
+        if (skippedFrame >= 0) {
+            emit sequenceFrameSkipped(seed->sequenceFilename(), skippedFrame);
+        }
+    }
 
+    if (!mSortedOperations.isEmpty())
+    {
         copyTextures();
         shiftCopyArrayTextures();
         render();
+        captureRewind();
+    }
 
-        mContext->doneCurrent();
+    mHistogram->compute(mOutputTexId);
+    mStatistics->compute(mOutputTexId, mIterationNumber);
+    mFingerprint->compute(mOutputTexId, mIterationNumber);
+
+    readPixelProbes();
+    probePixels();
+
+    submitCheckpoints(false);
+
+    if (mCheckpointInterval > 0 && (mIterationNumber + 1) % mCheckpointInterval == 0) {
+        writeCheckpoint(QDir(mCheckpointDirectory).filePath(QString("checkpoint-%1.mgck").arg(mIterationNumber + 1)), mIterationNumber + 1);
     }
 
+    mContext->doneCurrent();
+
     foreach (Seed* seed, mFactory->seeds()) {
         seed->setClearTexture();
     }
@@ -346,20 +513,159 @@ QImage RenderManager::outputImage()
 
 
 
-QList<float> RenderManager::rgbPixel(QPoint pos)
+void RenderManager::requestPixelProbes(const QList<PixelProbe>& probes)
 {
-    QList<float> rgb(3, 0.0f);
+    // Probes are sampled at the end of the next iteration
 
-    if (mOutputTexId)
+    mProbes = probes.mid(0, mMaxProbes);
+    mProbesRequested = true;
+}
+
+
+
+QList<QList<float>> RenderManager::takePixelProbeResults()
+{
+    // Each result holds red, green and blue of every probe, in request order
+
+    QList<QList<float>> results = mProbeResults;
+    mProbeResults.clear();
+
+    return results;
+}
+
+
+
+HistogramEngine* RenderManager::histogramEngine()
+{
+    return mHistogram;
+}
+
+
+
+StatisticsEngine* RenderManager::statisticsEngine()
+{
+    return mStatistics;
+}
+
+
+
+FingerprintEngine* RenderManager::fingerprintEngine()
+{
+    return mFingerprint;
+}
+
+
+
+void RenderManager::probePixels()
+{
+    // Expects current context
+    // All probes sampled by one compute dispatch per distinct texture, results copied to a readback buffer
+
+    if (!mProbesRequested || mProbes.isEmpty() || !mProbeProgram->isLinked()) {
+        return;
+    }
+
+    mProbesRequested = false;
+
+    // Readback ring full: skip this request
+
+    if (mProbeFences[mProbeSubmitIndex]) {
+        return;
+    }
+
+    // Group probe coordinates by texture, keeping their index in the request
+
+    QMap<GLuint, QList<GLint>> coordsMap;
+
+    for (int i = 0; i < mProbes.size(); i++)
     {
-        mContext->makeCurrent(mSurface);
+        GLuint* pTexId = mProbes[i].pTexId ? mProbes[i].pTexId : mOutputTexId;
 
-        glGetTextureSubImage(*mOutputTexId, 0, pos.x(), pos.y(), 0, 1, 1, 1, GL_RGB, GL_FLOAT, rgb.size() * sizeof(float), rgb.data());
+        if (pTexId && *pTexId) {
+            coordsMap[*pTexId] << mProbes[i].pos.x() << mProbes[i].pos.y() << i << 0;
+        }
+    }
 
-        mContext->doneCurrent();
+    int count = mProbes.size();
+
+    glClearNamedBufferSubData(mProbeColorsBuffer, GL_RGBA32F, 0, count * 4 * sizeof(GLfloat), GL_RGBA, GL_FLOAT, nullptr);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mProbeCoordsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mProbeColorsBuffer);
+
+    mProbeProgram->bind();
+
+    GLint offset = 0;
+
+    for (auto [texId, coords] : coordsMap.asKeyValueRange())
+    {
+        GLint groupCount = coords.size() / 4;
+
+        glNamedBufferSubData(mProbeCoordsBuffer, offset * 4 * sizeof(GLint), coords.size() * sizeof(GLint), coords.constData());
+
+        glBindTextureUnit(0, texId);
+
+        mProbeProgram->setUniformValue("offset", offset);
+        mProbeProgram->setUniformValue("count", groupCount);
+
+        glDispatchCompute((groupCount + 63) / 64, 1, 1);
+
+        offset += groupCount;
     }
 
-    return rgb;
+    mProbeProgram->release();
+
+    glBindTextureUnit(0, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glCopyNamedBufferSubData(mProbeColorsBuffer, mProbeReadBuffers[mProbeSubmitIndex], 0, 0, count * 4 * sizeof(GLfloat));
+
+    mProbeFences[mProbeSubmitIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mProbeCounts[mProbeSubmitIndex] = count;
+
+    mProbeSubmitIndex = (mProbeSubmitIndex + 1) % mProbeRingSize;
+}
+
+
+
+void RenderManager::readPixelProbes()
+{
+    // Expects current context
+    // Collect, oldest first, readbacks whose fence has already signaled, never waiting on the GPU
+
+    for (int i = 0; i < mProbeRingSize; i++)
+    {
+        int index = (mProbeSubmitIndex + i) % mProbeRingSize;
+
+        if (!mProbeFences[index]) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(mProbeFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(mProbeFences[index]);
+        mProbeFences[index] = 0;
+
+        QList<float> colors(4 * mProbeCounts[index]);
+        glGetNamedBufferSubData(mProbeReadBuffers[index], 0, colors.size() * sizeof(GLfloat), colors.data());
+
+        QList<float> rgb;
+        rgb.reserve(3 * mProbeCounts[index]);
+
+        for (int j = 0; j < mProbeCounts[index]; j++) {
+            rgb << colors[4 * j] << colors[4 * j + 1] << colors[4 * j + 2];
+        }
+
+        mProbeResults.append(rgb);
+    }
 }
 
 
@@ -375,6 +681,9 @@ void RenderManager::setTextureFormat(TextureFormat format)
 {
     mTexFormat = format;
 
+    mUploader->setTextureParameters(static_cast<GLenum>(mTexFormat), mTexWidth, mTexHeight);
+    mVideoFrameKeys.clear();
+
     QList<GLuint*> oldTexIds;
 
     foreach (Seed* seed, mFactory->seeds()) {
@@ -412,214 +721,1176 @@ void RenderManager::setTextureFormat(TextureFormat format)
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    recreateArrayTexture(&mBlendArrayTexId, mNumArrayTexLayers);
+    recreateArrayTexture(&mBlendArrayTexId, mNumArrayTexLayers);
+
+    foreach (ImageOperation* operation, mFactory->operations()) {
+        if (operation->sampler2DArrayAvail()) {
+            recreateArrayTexture(operation->arrayTextureId(), operation->arrayTextureDepth());
+        }
+    }
+
+    clearRewind();
+
+    mContext->doneCurrent();
+
+    invalidateCache();
+
+    foreach (Seed* seed, mFactory->seeds())
+    {
+        seed->resizeImage();
+        seed->setOutTextureId();
+    }
+
+    foreach (ImageOperation* operation, mFactory->operations())
+    {
+        operation->setBlitInTextureId();
+        operation->setOutTextureId();
+    }
+
+    emit texturesChanged();
+}
+
+
+
+GLuint RenderManager::texWidth()
+{
+    return mTexWidth;
+}
+
+
+
+GLuint RenderManager::texHeight()
+{
+    return mTexHeight;
+}
+
+
+
+void RenderManager::resetIterationNumer()
+{
+    mIterationNumber = 0;
+}
+
+
+
+int RenderManager::iterationNumber()
+{
+    return mIterationNumber;
+}
+
+
+
+bool RenderManager::cachingEnabled() const
+{
+    return mCachingEnabled;
+}
+
+
+
+void RenderManager::setCachingEnabled(bool set)
+{
+    mCachingEnabled = set;
+    invalidateCache();
+}
+
+
+
+int RenderManager::numCachedOperations() const
+{
+    return mCachedOperations.size();
+}
+
+
+
+double RenderManager::cacheSavedTime() const
+{
+    // Microseconds of GPU time per iteration, as last measured for the cached operations
+
+    return mCacheSavedTime;
+}
+
+
+
+QMap<ImageOperation*, double> RenderManager::renderTimes() const
+{
+    // Microseconds of GPU time per iteration of each rendered operation, as last measured
+
+    QMap<ImageOperation*, double> times;
+
+    foreach (ImageOperation* operation, mSortedOperations) {
+        if (mCacheEntries.contains(operation)) {
+            times.insert(operation, mCacheEntries.value(operation).renderTime);
+        }
+    }
+
+    return times;
+}
+
+
+
+void RenderManager::invalidateCache()
+{
+    for (auto it = mCacheEntries.begin(); it != mCacheEntries.end(); it++) {
+        it.value().valid = false;
+    }
+}
+
+
+
+ProgramCache* RenderManager::programCache()
+{
+    return &mProgramCache;
+}
+
+
+
+ProgramPool* RenderManager::programPool()
+{
+    return &mProgramPool;
+}
+
+
+
+int RenderManager::checkpointInterval() const
+{
+    return mCheckpointInterval;
+}
+
+
+
+void RenderManager::setCheckpointInterval(int iterations)
+{
+    mCheckpointInterval = iterations;
+}
+
+
+
+QString RenderManager::checkpointDirectory() const
+{
+    return mCheckpointDirectory;
+}
+
+
+
+void RenderManager::setCheckpointDirectory(QString directory)
+{
+    mCheckpointDirectory = directory;
+}
+
+
+
+bool RenderManager::checkpointCompressed() const
+{
+    return mCheckpointWriter->compressed();
+}
+
+
+
+void RenderManager::setCheckpointCompressed(bool set)
+{
+    mCheckpointWriter->setCompressed(set);
+}
+
+
+
+QString RenderManager::checkpointError() const
+{
+    return mCheckpointError;
+}
+
+
+
+QHash<GLuint, quint64> RenderManager::seedVersions()
+{
+    // Camera seeds change every frame: left out, so that they never match
+
+    QHash<GLuint, quint64> versions;
+
+    foreach (Seed* seed, mFactory->seeds()) {
+        if (seed->type() != 3 && *seed->pOutTextureId()) {
+            versions.insert(*seed->pOutTextureId(), seed->contentVersion());
+        }
+    }
+
+    return versions;
+}
+
+
+
+QList<quint64> RenderManager::cacheKey(ImageOperation* operation, const QHash<GLuint, quint64>& versions)
+{
+    // Operation version, then texture and version of each input, then blend factors
+    // Textures of unknown origin get a fresh stamp and never match
+
+    QList<quint64> key { operation->version() };
+
+    foreach (GLuint* pTexId, operation->inputTextures())
+    {
+        GLuint texId = pTexId ? *pTexId : 0;
+
+        key.append(texId);
+        key.append(versions.contains(texId) ? versions.value(texId) : ++mCacheStamp);
+    }
+
+    foreach (Number<float>* factor, operation->inputBlendFactors()) {
+        key.append(std::bit_cast<quint32>(factor->value()));
+    }
+
+    return key;
+}
+
+
+
+void RenderManager::readCacheQuery(CacheEntry& entry)
+{
+    if (!entry.queryPending) {
+        return;
+    }
+
+    GLuint available = 0;
+    glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (available)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(entry.query, GL_QUERY_RESULT, &elapsed);
+
+        entry.renderTime = elapsed / 1000.0;
+        entry.queryPending = false;
+    }
+}
+
+
+
+void RenderManager::resize(GLuint width, GLuint height)
+{
+    mOldTexWidth = mTexWidth;
+    mOldTexHeight = mTexHeight;
+
+    mTexWidth = width;
+    mTexHeight = height;
+
+    setOutputImage();
+
+    if (mContext)
+    {
+        mUploader->setTextureParameters(static_cast<GLenum>(mTexFormat), mTexWidth, mTexHeight);
+        mVideoFrameKeys.clear();
+
+        mContext->makeCurrent(mSurface);
+
+        setVao();
+        foreach (Seed* seed, mFactory->seeds()) {
+            seed->setVao(width, height);
+        }
+
+        setPbos();
+
+        glViewport(0, 0, mTexWidth, mTexHeight);
+
+        resizeTextures();
+        recreateArrayTexture(&mBlendArrayTexId, mNumArrayTexLayers);
+
+        clearRewind();
+
+        foreach (ImageOperation* operation, mFactory->operations())
+        {
+            if (operation->sampler2DArrayAvail()) {
+                recreateArrayTexture(operation->arrayTextureId(), operation->arrayTextureDepth());
+            }
+
+            // Shaders see the resolution as TEX_WIDTH and TEX_HEIGHT: unchanged sources reuse their pooled program
+
+            operation->setTextureSize(mTexWidth, mTexHeight);
+
+            if (!operation->linkShaders(true)) {
+                emit shaderError(operation->name(), operation->linkLog());
+            }
+        }
+
+        mContext->doneCurrent();
+
+        invalidateCache();
+
+        adjustOrtho();
+    }
+}
+
+
+
+void RenderManager::setOutputTextureId(GLuint* pTexId)
+{
+    // The new output is displayed as it is
+
+    mOutputTexId = pTexId;
+    mRewindAge = 0;
+}
+
+
+
+void RenderManager::initOperation(QUuid id, ImageOperation* operation)
+{
+    mOperationIds.insert(operation, id);
+
+    // New operation may reuse the address of a deleted one
+
+    if (mCacheEntries.contains(operation))
+    {
+        if (mCacheEntries[operation].query) {
+            mRetiredCacheQueries.append(mCacheEntries[operation].query);
+        }
+        mCacheEntries.remove(operation);
+    }
+
+    operation->init(mContext, mSurface);
+    operation->setHistogramCdfTextureId(mHistogram->cdfTextureId());
+    operation->setProgramCache(&mProgramCache);
+    operation->setProgramPool(&mProgramPool);
+    operation->setShaderCompiler(mShaderCompiler);
+    operation->setTextureSize(mTexWidth, mTexHeight);
+
+    if (!operation->linkShaders(true)) {
+        emit shaderError(operation->name(), operation->linkLog());
+    }
+
+    operation->setAllParameters();
+    genOpTextures(operation);
+}
+
+
+
+// Link the program of an operation about to be added: adding it later finds the program in the pool
+
+void RenderManager::prepareOperation(ImageOperation* operation)
+{
+    linkOperation(operation);
+    mPreparedOperations.append(operation);
+}
+
+
+
+// Link the program of an operation not rendered yet, such as one rebuilt on reload
+
+void RenderManager::linkOperation(ImageOperation* operation)
+{
+    operation->init(mContext, mSurface);
+    operation->setProgramCache(&mProgramCache);
+    operation->setProgramPool(&mProgramPool);
+    operation->setShaderCompiler(mShaderCompiler);
+    operation->setTextureSize(mTexWidth, mTexHeight);
+
+    if (!operation->linkShaders(true)) {
+        emit shaderError(operation->name(), operation->linkLog());
+    }
+}
+
+
+
+// Picks up programs linked since the last iteration, which may not run while rendering is paused
+
+bool RenderManager::operationsPrepared()
+{
+    mContext->makeCurrent(mSurface);
+    finishLinks();
+    mContext->doneCurrent();
+
+    foreach (ImageOperation* operation, mPreparedOperations) {
+        if (operation->programLinking())
+            return false;
+    }
+
+    return true;
+}
+
+
+
+void RenderManager::releasePreparedOperations()
+{
+    mPreparedOperations.clear();
+}
+
+
+
+void RenderManager::initSeed(QUuid id, Seed* seed)
+{
+    mSeedIds.insert(seed, id);
+
+    // New seed may reuse the address of a deleted one
+
+    mRandomStates.remove(seed);
+
+    seed->init(static_cast<GLenum>(mTexFormat), mTexWidth, mTexHeight, mContext, mSurface, mUploader);
+}
+
+
+
+void RenderManager::setSortedOperations(QList<ImageOperation*> sortedOperations)
+{
+    mSortedOperations = sortedOperations;
+
+    // Forget removed operations, their queries are deleted when a context is current
+
+    for (auto it = mCacheEntries.begin(); it != mCacheEntries.end();)
+    {
+        if (!mSortedOperations.contains(it.key()))
+        {
+            if (it.value().query) {
+                mRetiredCacheQueries.append(it.value().query);
+            }
+            it = mCacheEntries.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+
+
+void RenderManager::reset()
+{
+    clearAllOpsTextures();
+    drawAllSeeds();
+    resetIterationNumer();
+}
+
+
+
+void RenderManager::genImageTexture(QByteArray devId)
+{
+    if (!mVideoTextures.contains(devId))
+    {
+        GLuint* newTexId = new GLuint(0);
+
+        mContext->makeCurrent(mSurface);
+        genTexture(newTexId, mTexFormat);
+        mContext->doneCurrent();
+
+        mVideoTextures.insert(devId, newTexId);
+    }
+}
+
+
+
+void RenderManager::delImageTexture(QByteArray devId)
+{
+    if (mVideoTextures.contains(devId))
+    {
+        GLuint* texId = mVideoTextures.value(devId);
+
+        mUploader->cancel(texId);
+
+        mContext->makeCurrent(mSurface);
+        glDeleteTextures(1, texId);
+        mContext->doneCurrent();
+
+        delete texId;
+
+        mVideoTextures.remove(devId);
+        mVideoFrameKeys.remove(devId);
+    }
+}
+
+
+void RenderManager::setVideoTextures()
+{
+    foreach (Seed* seed, mFactory->seeds())
+    {
+        QByteArray devId = seed->videoDevId();
+        seed->setVideoTexture(mVideoTextures.contains(devId) ? *mVideoTextures.value(devId) : 0);
+    }
+}
+
+
+
+void RenderManager::setImageTexture(GLuint* pTexId, QImage* image)
+{
+    // Scaling and upload happen on the uploader's thread
+
+    mUploader->requestImage(pTexId, *image);
+}
+
+
+
+void RenderManager::swapUploadedTextures()
+{
+    // Expects active OpenGL context
+    // Swap in uploaded textures whose fences have passed, never waiting on them
+
+    mPendingUploads.append(mUploader->takeUploads());
+
+    if (mPendingUploads.isEmpty()) {
+        return;
+    }
+
+    bool swapped = false;
+
+    QList<TextureUpload> pendingUploads;
+
+    foreach (TextureUpload upload, mPendingUploads)
+    {
+        GLenum status = glClientWaitSync(upload.fence, 0, 0);
+
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            pendingUploads.append(upload);
+            continue;
+        }
+
+        glDeleteSync(upload.fence);
+
+        if (status != GL_WAIT_FAILED && mUploader->isCurrent(upload))
+        {
+            glDeleteTextures(1, upload.pTexId);
+            *upload.pTexId = upload.texId;
+            swapped = true;
+        }
+        else
+        {
+            glDeleteTextures(1, &upload.texId);
+        }
+    }
+
+    mPendingUploads = pendingUploads;
+
+    if (swapped)
+    {
+        setVideoTextures();
+
+        foreach (Seed* seed, mFactory->seeds()) {
+            seed->setOutTextureId();
+        }
+    }
+}
+
+
+
+// Every texture holding simulation state: seeds, operations and their history arrays
+
+QList<StateTexture> RenderManager::stateTextures()
+{
+    QList<StateTexture> textures;
+
+    foreach (Seed* seed, mFactory->seeds())
+    {
+        QString id = mSeedIds.value(seed).toString(QUuid::WithoutBraces);
+        QList<GLuint*> texIds = seed->textureIds();
+
+        for (int i = 0; i < texIds.size(); i++) {
+            if (*texIds[i])
+                textures.append({ QString("seed/%1/%2").arg(id).arg(i), *texIds[i], GL_TEXTURE_2D, 1 });
+        }
+    }
+
+    foreach (ImageOperation* operation, mFactory->operations())
+    {
+        QString id = mOperationIds.value(operation).toString(QUuid::WithoutBraces);
+        QList<GLuint*> texIds = operation->textureIds();
+
+        for (int i = 0; i < texIds.size(); i++) {
+            if (*texIds[i])
+                textures.append({ QString("operation/%1/%2").arg(id).arg(i), *texIds[i], GL_TEXTURE_2D, 1 });
+        }
+
+        if (operation->sampler2DArrayAvail() && *operation->arrayTextureId()) {
+            textures.append({ QString("operation/%1/history").arg(id), *operation->arrayTextureId(), GL_TEXTURE_2D_ARRAY, operation->arrayTextureDepth() });
+        }
+    }
+
+    return textures;
+}
+
+
+
+QMap<QUuid, QByteArray> RenderManager::seedRandomStates()
+{
+    // Called every iteration while rewinding: generators that did not advance are not serialized again
+
+    QMap<QUuid, QByteArray> states;
+
+    foreach (Seed* seed, mFactory->seeds())
+    {
+        auto it = mRandomStates.find(seed);
+
+        if (it == mRandomStates.end() || it->version != seed->randomVersion()) {
+            it = mRandomStates.insert(seed, RandomState { seed->randomVersion(), seed->randomState() });
+        }
+
+        states.insert(mSeedIds.value(seed), it->state);
+    }
+
+    return states;
+}
+
+
+
+// Seeds resume where they were: same random sequence, and no longer injected past the first iteration
+
+void RenderManager::resumeSeeds(const QMap<QUuid, QByteArray>& randomStates, unsigned int iteration)
+{
+    foreach (Seed* seed, mFactory->seeds())
+    {
+        QUuid id = mSeedIds.value(seed);
+
+        if (randomStates.contains(id)) {
+            seed->setRandomState(randomStates.value(id));
+        }
+
+        if (iteration > 0) {
+            seed->setClearTexture();
+        }
+    }
+}
+
+
+
+RewindMode RenderManager::rewindMode() const
+{
+    return mRewind.mode();
+}
+
+
+
+void RenderManager::setRewindMode(RewindMode mode)
+{
+    scrubRewind(0);
+    mRewind.setMode(mode);
+    updateRewindError();
+}
+
+
+
+int RenderManager::rewindBudget() const
+{
+    return mRewind.budget();
+}
+
+
+
+void RenderManager::setRewindBudget(int megabytes)
+{
+    scrubRewind(0);
+    mRewind.setBudget(megabytes);
+    updateRewindError();
+}
+
+
+
+int RenderManager::rewindScale() const
+{
+    return mRewind.scale();
+}
+
+
+
+void RenderManager::setRewindScale(int divisor)
+{
+    scrubRewind(0);
+    mRewind.setScale(divisor);
+    updateRewindError();
+}
+
+
+
+int RenderManager::rewindCount() const
+{
+    return mRewind.count();
+}
+
+
+
+int RenderManager::rewindAge() const
+{
+    return mRewindAge;
+}
+
+
+
+QString RenderManager::rewindError() const
+{
+    return mRewindError;
+}
+
+
+
+// Shows a retained iteration instead of the output, age 0 being the latest, that is, the live output
+
+void RenderManager::scrubRewind(int age)
+{
+    if (age <= 0 || age >= mRewind.count() || !mContext)
+    {
+        if (mRewindAge > 0)
+        {
+            mRewindAge = 0;
+            emit displayTextureChanged(mOutputTexId);
+        }
+        return;
+    }
+
+    bool current = QOpenGLContext::currentContext() == mContext;
+
+    if (!current) {
+        mContext->makeCurrent(mSurface);
+    }
+
+    if (!mRewindViewTexId) {
+        genTexture(&mRewindViewTexId, mTexFormat);
+    }
+
+    mRewind.view(age, mRewindViewTexId);
+
+    if (!current) {
+        mContext->doneCurrent();
+    }
+
+    if (mRewindAge == 0) {
+        emit displayTextureChanged(&mRewindViewTexId);
+    }
+
+    mRewindAge = age;
+}
+
+
+
+// Continues the simulation from a retained iteration, forgetting the ones after it
+
+bool RenderManager::resumeRewind(int age)
+{
+    if (age < 0 || age >= mRewind.count() || !mContext || !mOutputTexId) {
+        return false;
+    }
+
+    bool current = QOpenGLContext::currentContext() == mContext;
+
+    if (!current) {
+        mContext->makeCurrent(mSurface);
+    }
+
+    bool restored = mRewind.restore(age, *mOutputTexId, mRewind.mode() == RewindMode::State ? stateTextures() : QList<StateTexture>());
+
+    if (!current) {
+        mContext->doneCurrent();
+    }
+
+    if (!restored) {
+        return false;
+    }
+
+    resumeSeeds(mRewind.randomStates(age), mRewind.iteration(age));
+
+    mIterationNumber = mRewind.iteration(age);
+
+    mRewind.discardNewer(age);
+
+    invalidateCache();
+
+    scrubRewind(0);
+
+    return true;
+}
+
+
+
+void RenderManager::captureRewind()
+{
+    // Expects active OpenGL context
+
+    if (mOutputTexId)
+    {
+        bool off = mRewind.mode() == RewindMode::Off;
 
-    foreach (ImageOperation* operation, mFactory->operations()) {
-        if (operation->sampler2DArrayAvail()) {
-            recreateArrayTexture(operation->arrayTextureId(), operation->arrayTextureDepth());
-        }
+        mRewind.capture(*mOutputTexId, mRewind.mode() == RewindMode::State ? stateTextures() : QList<StateTexture>(), mTexWidth, mTexHeight, static_cast<GLenum>(mTexFormat), mIterationNumber + 1, off ? QMap<QUuid, QByteArray>() : seedRandomStates());
+        updateRewindError();
     }
+}
 
-    mContext->doneCurrent();
 
-    foreach (Seed* seed, mFactory->seeds()) {
-        seed->setOutTextureId();
-    }
 
-    foreach (ImageOperation* operation, mFactory->operations())
+void RenderManager::updateRewindError()
+{
+    if (mRewind.error() != mRewindError)
     {
-        operation->setBlitInTextureId();
-        operation->setOutTextureId();
+        mRewindError = mRewind.error();
+        emit rewindErrorChanged(mRewindError);
     }
-
-    emit texturesChanged();
 }
 
 
 
-GLuint RenderManager::texWidth()
+void RenderManager::clearRewind()
 {
-    return mTexWidth;
-}
+    // Expects active OpenGL context
 
+    scrubRewind(0);
 
+    mRewind.clear();
 
-GLuint RenderManager::texHeight()
-{
-    return mTexHeight;
+    glDeleteTextures(1, &mRewindViewTexId);
+    mRewindViewTexId = 0;
 }
 
 
 
-void RenderManager::resetIterationNumer()
+// Smallest client type holding the texture format without loss
+
+GLenum RenderManager::checkpointPixelType(int& texelSize)
 {
-    mIterationNumber = 0;
+    switch (mTexFormat)
+    {
+        case TextureFormat::RGBA12:
+        case TextureFormat::RGBA16:
+            texelSize = 8;
+            return GL_UNSIGNED_SHORT;
+        case TextureFormat::RGBA16F:
+            texelSize = 8;
+            return GL_HALF_FLOAT;
+        case TextureFormat::RGBA32F:
+            texelSize = 16;
+            return GL_FLOAT;
+        default:
+            texelSize = 4;
+            return GL_UNSIGNED_BYTE;
+    }
 }
 
 
 
-int RenderManager::iterationNumber()
+// Issues the readback of every state texture, which is the state after the given iteration
+// Only one checkpoint is in flight at a time: requests meanwhile fail
+
+bool RenderManager::writeCheckpoint(QString filename, unsigned int iteration)
 {
-    return mIterationNumber;
-}
+    if (!mContext || !mCheckpointReadbacks.isEmpty())
+    {
+        emit checkpointWritten(filename, false);
+        return false;
+    }
 
+    QDir().mkpath(QFileInfo(filename).absolutePath());
 
+    bool current = QOpenGLContext::currentContext() == mContext;
 
-void RenderManager::resize(GLuint width, GLuint height)
-{
-    mOldTexWidth = mTexWidth;
-    mOldTexHeight = mTexHeight;
+    if (!current) {
+        mContext->makeCurrent(mSurface);
+    }
 
-    mTexWidth = width;
-    mTexHeight = height;
+    int texelSize = 4;
+    GLenum type = checkpointPixelType(texelSize);
 
-    setOutputImage();
+    CheckpointReadback readback;
+    readback.ticket = mNextCheckpointTicket++;
+    readback.filename = filename;
 
-    if (mContext)
+    readback.info.iteration = iteration;
+    readback.info.width = mTexWidth;
+    readback.info.height = mTexHeight;
+    readback.info.texFormat = static_cast<GLenum>(mTexFormat);
+
+    readback.info.randomStates = seedRandomStates();
+
+    qint64 layerSize = static_cast<qint64>(mTexWidth) * mTexHeight * texelSize;
+    bool mapped = true;
+
+    foreach (const StateTexture& texture, stateTextures())
     {
-        mContext->makeCurrent(mSurface);
+        CheckpointEntry entry;
+        entry.key = texture.key;
+        entry.target = texture.target;
+        entry.layers = texture.layers;
+        entry.type = type;
+        entry.size = layerSize * texture.layers;
 
-        setVao();
-        foreach (Seed* seed, mFactory->seeds()) {
-            seed->setVao(width, height);
+        CheckpointBuffer buffer;
+
+        if (!acquireCheckpointBuffer(entry.size, buffer))
+        {
+            mapped = false;
+            break;
         }
 
-        setPbos();
+        readback.buffers.append(buffer);
 
-        glViewport(0, 0, mTexWidth, mTexHeight);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
 
-        resizeTextures();
-        recreateArrayTexture(&mBlendArrayTexId, mNumArrayTexLayers);
+        // Layer by layer, keeping buffer offsets and sizes within GLsizei
 
-        foreach (ImageOperation* operation, mFactory->operations())
-        {
-            if (operation->sampler2DArrayAvail()) {
-                recreateArrayTexture(operation->arrayTextureId(), operation->arrayTextureDepth());
-            }
+        for (GLsizei layer = 0; layer < texture.layers; layer++) {
+            glGetTextureSubImage(texture.texId, 0, 0, 0, layer, mTexWidth, mTexHeight, 1, GL_RGBA, type, GLsizei(layerSize), reinterpret_cast<void*>(layer * layerSize));
         }
 
-        mContext->doneCurrent();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-        adjustOrtho();
+        entry.data = buffer.data;
+
+        readback.entries.append(entry);
     }
-}
 
+    // Free buffers left over were sized for an older state
 
+    clearCheckpointBuffers();
 
-void RenderManager::setOutputTextureId(GLuint* pTexId)
-{
-    mOutputTexId = pTexId;
-}
+    if (!mapped)
+    {
+        releaseCheckpoint(readback);
 
+        if (!current) {
+            mContext->doneCurrent();
+        }
 
+        emit checkpointWritten(filename, false);
 
-void RenderManager::initOperation(QUuid id, ImageOperation* operation)
-{
-    Q_UNUSED(id)
+        return false;
+    }
 
-    operation->init(mContext, mSurface);
-    operation->linkShaders();
-    operation->setAllParameters();
-    genOpTextures(operation);
-}
+    // Writes into persistent mappings become visible once the fence passes
 
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
+    mCheckpointReadbacks.append(readback);
 
-void RenderManager::initSeed(QUuid id, Seed* seed)
-{
-    Q_UNUSED(id)
+    // Outside iterations there is no frame to keep smooth
+
+    submitCheckpoints(!current);
+
+    if (!current) {
+        mContext->doneCurrent();
+    }
 
-    seed->init(static_cast<GLenum>(mTexFormat), mTexWidth, mTexHeight, mContext, mSurface);
+    return true;
 }
 
 
 
-void RenderManager::setSortedOperations(QList<ImageOperation*> sortedOperations)
+void RenderManager::submitCheckpoints(bool wait)
 {
-    mSortedOperations = sortedOperations;
+    // Expects active OpenGL context
+
+    for (CheckpointReadback& readback : mCheckpointReadbacks)
+    {
+        if (readback.submitted) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GLuint64(-1) : 0);
+
+        if (status == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+
+        glDeleteSync(readback.fence);
+        readback.fence = 0;
+        readback.submitted = true;
+
+        mCheckpointWriter->write(readback.ticket, readback.filename, readback.info, readback.entries);
+    }
 }
 
 
 
-void RenderManager::reset()
+void RenderManager::releaseCheckpoint(CheckpointReadback& readback)
 {
-    clearAllOpsTextures();
-    drawAllSeeds();
-    resetIterationNumer();
+    // Expects active OpenGL context
+
+    if (readback.fence)
+    {
+        glDeleteSync(readback.fence);
+        readback.fence = 0;
+    }
+
+    mCheckpointBuffers.append(readback.buffers);
+
+    readback.buffers.clear();
+    readback.entries.clear();
 }
 
 
 
-void RenderManager::genImageTexture(QByteArray devId)
+bool RenderManager::acquireCheckpointBuffer(qint64 size, CheckpointBuffer& buffer)
 {
-    if (!mVideoTextures.contains(devId))
+    // Expects active OpenGL context
+    // A free buffer of the same size, otherwise a new one
+
+    for (int i = 0; i < mCheckpointBuffers.size(); i++)
     {
-        GLuint newTexId = 0;
-        genTexture(&newTexId, mTexFormat);
-        mVideoTextures.insert(devId, newTexId);
+        if (mCheckpointBuffers[i].size == size)
+        {
+            buffer = mCheckpointBuffers.takeAt(i);
+            return true;
+        }
+    }
+
+    buffer.size = size;
+
+    glCreateBuffers(1, &buffer.id);
+    glNamedBufferStorage(buffer.id, size, nullptr, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_CLIENT_STORAGE_BIT);
+
+    buffer.data = static_cast<const char*>(glMapNamedBufferRange(buffer.id, 0, size, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT));
+
+    if (!buffer.data)
+    {
+        glDeleteBuffers(1, &buffer.id);
+        buffer = CheckpointBuffer();
+        return false;
     }
+
+    return true;
 }
 
 
 
-void RenderManager::delImageTexture(QByteArray devId)
+void RenderManager::clearCheckpointBuffers()
 {
-    if (mVideoTextures.contains(devId))
-    {
-        mContext->makeCurrent(mSurface);
-        glDeleteTextures(1, &mVideoTextures[devId]);
-        mContext->doneCurrent();
+    // Expects active OpenGL context
 
-        mVideoTextures.remove(devId);
+    foreach (const CheckpointBuffer& buffer, mCheckpointBuffers)
+    {
+        glUnmapNamedBuffer(buffer.id);
+        glDeleteBuffers(1, &buffer.id);
     }
+
+    mCheckpointBuffers.clear();
 }
 
 
-void RenderManager::setVideoTextures()
+
+void RenderManager::finishCheckpoint(quint64 ticket, QString filename, bool success)
 {
-    foreach (Seed* seed, mFactory->seeds())
+    for (int i = 0; i < mCheckpointReadbacks.size(); i++)
     {
-        QByteArray devId = seed->videoDevId();
-        seed->setVideoTexture(mVideoTextures.value(devId, 0));
+        if (mCheckpointReadbacks[i].ticket == ticket)
+        {
+            bool current = QOpenGLContext::currentContext() == mContext;
+
+            if (!current) {
+                mContext->makeCurrent(mSurface);
+            }
+
+            releaseCheckpoint(mCheckpointReadbacks[i]);
+
+            if (!current) {
+                mContext->doneCurrent();
+            }
+
+            mCheckpointReadbacks.removeAt(i);
+            break;
+        }
     }
+
+    emit checkpointWritten(filename, success);
 }
 
 
 
-void RenderManager::setImageTexture(GLuint texId, QImage* image)
+// Uploads straight from the mapped file into the textures of nodes with the same ids
+
+bool RenderManager::restoreCheckpoint(QString filename)
 {
-    if (!image->isNull())
+    mCheckpointError.clear();
+
+    if (!mContext) {
+        return false;
+    }
+
+    CheckpointReader reader;
+
+    if (!reader.open(filename))
     {
-        qreal sx = static_cast<qreal>(mTexWidth)  / image->width();
-        qreal sy = static_cast<qreal>(mTexHeight) / image->height();
-        qreal scale = qMin(1.0, qMin(sx, sy));
+        mCheckpointError = reader.errorString();
+        return false;
+    }
+
+    const CheckpointInfo& info = reader.info();
 
-        int displayWidth = qRound(image->width() * scale);
-        int displayHeight = qRound(image->height() * scale);
+    if (info.width != mTexWidth || info.height != mTexHeight || info.texFormat != static_cast<GLenum>(mTexFormat))
+    {
+        mCheckpointError = QString("Checkpoint taken at %1x%2 with another texture format or size").arg(info.width).arg(info.height);
+        return false;
+    }
 
-        int offsetX = (mTexWidth  - displayWidth) / 2;
-        int offsetY = (mTexHeight - displayHeight) / 2;
+    QHash<QString, StateTexture> textures;
 
-        QImage scaled = image->scaled(displayWidth, displayHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    foreach (const StateTexture& texture, stateTextures()) {
+        textures.insert(texture.key, texture);
+    }
 
-        QImage buffer(mTexWidth, mTexHeight, QImage::Format_RGBA8888);
-        buffer.fill(Qt::black);
+    int texelSize = 4;
+    GLenum type = checkpointPixelType(texelSize);
+    qint64 layerSize = static_cast<qint64>(mTexWidth) * mTexHeight * texelSize;
 
-        QPainter painter(&buffer);
-        painter.drawImage(offsetX, offsetY, scaled);
+    bool current = QOpenGLContext::currentContext() == mContext;
 
+    if (!current) {
         mContext->makeCurrent(mSurface);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    int numRestored = 0;
+
+    foreach (const CheckpointEntry& entry, reader.entries())
+    {
+        if (!textures.contains(entry.key)) {
+            continue;
+        }
+
+        const StateTexture& texture = textures[entry.key];
 
-        glBindTexture(GL_TEXTURE_2D, texId);
+        if (texture.target != entry.target || texture.layers != entry.layers || entry.type != type || entry.size != layerSize * entry.layers) {
+            continue;
+        }
+
+        const char* data = reader.data(entry);
 
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (!data) {
+            continue;
+        }
 
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mTexWidth, mTexHeight, GL_RGBA, GL_UNSIGNED_BYTE, buffer.constBits());
+        if (entry.target == GL_TEXTURE_2D_ARRAY) {
+            glTextureSubImage3D(texture.texId, 0, 0, 0, 0, mTexWidth, mTexHeight, entry.layers, GL_RGBA, type, data);
+        }
+        else {
+            glTextureSubImage2D(texture.texId, 0, 0, 0, mTexWidth, mTexHeight, GL_RGBA, type, data);
+        }
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        numRestored++;
+    }
 
+    if (!current) {
         mContext->doneCurrent();
     }
+
+    if (numRestored == 0)
+    {
+        mCheckpointError = "No texture of the checkpoint belongs to the current nodes";
+        return false;
+    }
+
+    resumeSeeds(info.randomStates, info.iteration);
+
+    mIterationNumber = info.iteration;
+
+    invalidateCache();
+
+    return true;
+}
+
+
+
+void RenderManager::setProbeProgram()
+{
+    if (!mProbeProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/probe.comp"))
+        qDebug() << "Compute shader error:\n" << mProbeProgram->log();
+    if (!mProbeProgram->link())
+        qDebug() << "Shader link error:\n" << mProbeProgram->log();
+
+    // Input texture (uniform sampler2D inTex): texture unit 0
+
+    mProbeProgram->bind();
+    mProbeProgram->setUniformValue("inTex", 0);
+    mProbeProgram->release();
 }
 
 
@@ -887,16 +2158,18 @@ void RenderManager::resizeTextures()
 
     // Resize video textures
 
-    for (auto [devId, texId] : mVideoTextures.asKeyValueRange())
+    foreach (GLuint* texId, mVideoTextures)
     {
         GLuint newTexId = 0;
         genTexture(&newTexId, mTexFormat);
 
-        blitTextures(texId, mOldTexWidth, mOldTexHeight, newTexId, mTexWidth, mTexHeight);
+        blitTextures(*texId, mOldTexWidth, mOldTexHeight, newTexId, mTexWidth, mTexHeight);
 
-        glDeleteTextures(1, &texId);
-        mVideoTextures[devId] = newTexId;
+        glDeleteTextures(1, texId);
+        *texId = newTexId;
     }
+
+    setVideoTextures();
 }
 
 
@@ -993,6 +2266,8 @@ void RenderManager::clearAllOpsTextures()
     }
 
     mContext->doneCurrent();
+
+    invalidateCache();
 }
 
 
@@ -1088,22 +2363,141 @@ void RenderManager::renderOperation(ImageOperation* operation)
 
 
 
+void RenderManager::passThrough(ImageOperation* operation)
+{
+    // Placeholder while the operation's program is being linked: its output is its input
+
+    if (!operation->enabled()) {
+        return;
+    }
+
+    if (operation->inTextureId())
+    {
+        glCopyImageSubData(operation->inTextureId(), GL_TEXTURE_2D, 0, 0, 0, 0, operation->outTextureId(), GL_TEXTURE_2D, 0, 0, 0, 0, mTexWidth, mTexHeight, 1);
+    }
+    else
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, operation->outTextureId(), 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+}
+
+
+
+void RenderManager::finishLinks()
+{
+    // Programs linked in the background since the last iteration
+
+    foreach (const CompileResult& result, mShaderCompiler->takeResults())
+    {
+        QStringList names;
+
+        foreach (ImageOperation* operation, mFactory->operations() + mFactory->reloadingOperations() + mPreparedOperations) {
+            if (operation->finishLink(result)) {
+                names.append(operation->name());
+            }
+        }
+
+        if (!result.ok && !names.isEmpty()) {
+            emit shaderError(names.join(", "), result.log);
+        }
+    }
+}
+
+
+
 void RenderManager::render()
 {
+    if (!mRetiredCacheQueries.isEmpty())
+    {
+        glDeleteQueries(mRetiredCacheQueries.size(), mRetiredCacheQueries.data());
+        mRetiredCacheQueries.clear();
+    }
+
+    // Versions of the contents of textures read as inputs
+    // Blit outputs hold the previous iteration: always new
+
+    QHash<GLuint, quint64> versions = seedVersions();
+
+    foreach (ImageOperation* operation, mSortedOperations) {
+        if (operation->blitEnabled()) {
+            versions.insert(operation->blitOutTextureId(), ++mCacheStamp);
+        }
+    }
+
+    QList<ImageOperation*> cachedOperations;
+    double savedTime = 0.0;
+
     glBindFramebuffer(GL_FRAMEBUFFER, mOutFbo);
 
     glBindVertexArray(mVao);
 
     foreach (ImageOperation* operation, mSortedOperations)
     {
-        if (operation->blendEnabled()) {
-            blend(operation);
+        CacheEntry& entry = mCacheEntries[operation];
+
+        QList<quint64> key = cacheKey(operation, versions);
+
+        bool cacheable = mCachingEnabled && !operation->sampler2DArrayAvail() && !operation->samplesHistogram();
+
+        readCacheQuery(entry);
+
+        if (cacheable && entry.valid && entry.key == key)
+        {
+            cachedOperations.append(operation);
+            savedTime += entry.renderTime;
+        }
+        else
+        {
+            if (!entry.query) {
+                glGenQueries(1, &entry.query);
+            }
+
+            bool timed = !entry.queryPending;
+
+            if (timed) {
+                glBeginQuery(GL_TIME_ELAPSED, entry.query);
+            }
+
+            if (operation->blendEnabled()) {
+                blend(operation);
+            }
+
+            if (operation->programReady()) {
+                operation->render();
+            }
+            else {
+                passThrough(operation);
+            }
+
+            if (timed)
+            {
+                glEndQuery(GL_TIME_ELAPSED);
+                entry.queryPending = true;
+            }
+
+            entry.valid = true;
+            entry.key = key;
+            entry.stamp = ++mCacheStamp;
         }
 
-        operation->render();
+        if (operation->enabled()) {
+            versions.insert(operation->outTextureId(), entry.stamp);
+        }
+        if (operation->blendEnabled()) {
+            versions.insert(operation->blendOutTextureId(), entry.stamp);
+        }
     }
 
     glBindVertexArray(0);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    mCacheSavedTime = savedTime;
+
+    if (cachedOperations != mCachedOperations)
+    {
+        mCachedOperations = cachedOperations;
+        emit cachedOperationsChanged(mCachedOperations);
+    }
 }
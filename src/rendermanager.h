@@ -32,6 +32,15 @@
 #include "seed.h"
 #include "factory.h"
 #include "videoinputcontrol.h"
+#include "textureuploader.h"
+#include "programcache.h"
+#include "programpool.h"
+#include "shadercompiler.h"
+#include "histogramengine.h"
+#include "statisticsengine.h"
+#include "fingerprintengine.h"
+#include "checkpoint.h"
+#include "rewindbuffer.h"
 
 #include <QObject>
 #include <QOpenGLFunctions_4_5_Core>
@@ -39,6 +48,19 @@
 #include <QOffscreenSurface>
 #include <QOpenGLShaderProgram>
 #include <QImage>
+#include <QPoint>
+#include <QHash>
+#include <QStringList>
+
+
+
+// Pixel probe: texel of the texture pointed to by pTexId, or of the output texture if null
+
+struct PixelProbe
+{
+    GLuint* pTexId = nullptr;
+    QPoint pos;
+};
 
 
 
@@ -58,7 +80,13 @@ public:
     void iterate();
 
     QImage outputImage();
-    QList<float> rgbPixel(QPoint pos);
+
+    void requestPixelProbes(const QList<PixelProbe>& probes);
+    QList<QList<float>> takePixelProbeResults();
+
+    HistogramEngine* histogramEngine();
+    StatisticsEngine* statisticsEngine();
+    FingerprintEngine* fingerprintEngine();
 
     TextureFormat texFormat();
     void setTextureFormat(TextureFormat format);
@@ -73,8 +101,53 @@ public:
     void resetIterationNumer();
     int iterationNumber();
 
+    bool cachingEnabled() const;
+    void setCachingEnabled(bool set);
+    int numCachedOperations() const;
+    double cacheSavedTime() const;
+    QMap<ImageOperation*, double> renderTimes() const;
+    void invalidateCache();
+
+    ProgramCache* programCache();
+    ProgramPool* programPool();
+
+    void prepareOperation(ImageOperation* operation);
+    void linkOperation(ImageOperation* operation);
+    bool operationsPrepared();
+    void releasePreparedOperations();
+
+    bool writeCheckpoint(QString filename, unsigned int iteration);
+    bool restoreCheckpoint(QString filename);
+    QString checkpointError() const;
+
+    int checkpointInterval() const;
+    void setCheckpointInterval(int iterations);
+    QString checkpointDirectory() const;
+    void setCheckpointDirectory(QString directory);
+    bool checkpointCompressed() const;
+    void setCheckpointCompressed(bool set);
+
+    RewindMode rewindMode() const;
+    void setRewindMode(RewindMode mode);
+    int rewindBudget() const;
+    void setRewindBudget(int megabytes);
+    int rewindScale() const;
+    void setRewindScale(int divisor);
+    int rewindCount() const;
+    int rewindAge() const;
+    QString rewindError() const;
+
+    void scrubRewind(int age);
+    bool resumeRewind(int age);
+
 signals:
     void texturesChanged();
+    void cachedOperationsChanged(QList<ImageOperation*> operations);
+    void shaderError(QString name, QString log);
+    void checkpointWritten(QString filename, bool success);
+    void displayTextureChanged(GLuint* pTexId);
+    void rewindErrorChanged(QString error);
+    void sequenceFrameSkipped(QString filename, int frame);
 
 public slots:
     void resize(GLuint width, GLuint height);
@@ -87,7 +160,7 @@ public slots:
     void genImageTexture(QByteArray devId);
     void delImageTexture(QByteArray devId);
     void setVideoTextures();
-    void setImageTexture(GLuint texId, QImage *image);
+    void setImageTexture(GLuint* pTexId, QImage* image);
 
 private:
     Factory* mFactory;
@@ -137,12 +210,133 @@ private:
     int mReadIndex = 0;
     QList<GLsync> mFences;
 
-    QMap<QByteArray, GLuint> mVideoTextures;
+    HistogramEngine* mHistogram;
+    StatisticsEngine* mStatistics;
+    FingerprintEngine* mFingerprint;
+
+    QOpenGLShaderProgram* mProbeProgram;
+    const int mMaxProbes = 256;
+    const int mProbeRingSize = 3;
+    GLuint mProbeCoordsBuffer = 0;
+    GLuint mProbeColorsBuffer = 0;
+    QList<GLuint> mProbeReadBuffers;
+    QList<GLsync> mProbeFences;
+    QList<int> mProbeCounts;
+    int mProbeSubmitIndex = 0;
+    QList<PixelProbe> mProbes;
+    bool mProbesRequested = false;
+    QList<QList<float>> mProbeResults;
+
+    QMap<QByteArray, GLuint*> mVideoTextures;
+    QMap<QByteArray, qint64> mVideoFrameKeys;
+
+    TextureUploader* mUploader = nullptr;
+    QList<TextureUpload> mPendingUploads;
+
+    ProgramCache mProgramCache;
+    ProgramPool mProgramPool;
+    ShaderCompiler* mShaderCompiler = nullptr;
+
+    // Operations not yet in the graph whose programs are linking, so that they render as soon as they are added
+
+    QList<ImageOperation*> mPreparedOperations;
+
+    // Ids of seeds and operations, naming their textures in checkpoints
+
+    QHash<ImageOperation*, QUuid> mOperationIds;
+    QHash<Seed*, QUuid> mSeedIds;
+
+    // Checkpoints: textures are read back into persistently mapped buffers,
+    // handed to the writer thread once their fence passes, and released once written
+    // Released buffers stay mapped and are reused while the state keeps its size
+
+    struct CheckpointBuffer
+    {
+        GLuint id = 0;
+        qint64 size = 0;
+        const char* data = nullptr;
+    };
+
+    struct CheckpointReadback
+    {
+        quint64 ticket = 0;
+        QString filename;
+        CheckpointInfo info;
+        QList<CheckpointEntry> entries;
+        QList<CheckpointBuffer> buffers;
+        GLsync fence = 0;
+        bool submitted = false;
+    };
+
+    CheckpointWriter* mCheckpointWriter = nullptr;
+    QList<CheckpointReadback> mCheckpointReadbacks;
+    QList<CheckpointBuffer> mCheckpointBuffers;
+    quint64 mNextCheckpointTicket = 1;
+    int mCheckpointInterval = 0;
+    QString mCheckpointDirectory;
+    QString mCheckpointError;
+
+    // Rewind: recent iterations kept on the GPU, and the texture showing the one scrubbed to
+
+    RewindBuffer mRewind;
+    GLuint mRewindViewTexId = 0;
+    int mRewindAge = 0;
+    QString mRewindError;
+
+    // Serialized generator states of the seeds, redone only when a generator advanced
+
+    struct RandomState
+    {
+        quint64 version = 0;
+        QByteArray state;
+    };
+
+    QHash<Seed*, RandomState> mRandomStates;
+
+    // Static subgraph cache: operations whose inputs and parameters did not change since
+    // their last render are skipped and their output texture reused
+
+    struct CacheEntry
+    {
+        bool valid = false;
+        QList<quint64> key;
+        quint64 stamp = 0;
+        GLuint query = 0;
+        bool queryPending = false;
+        double renderTime = 0.0;
+    };
+
+    bool mCachingEnabled = true;
+    QHash<ImageOperation*, CacheEntry> mCacheEntries;
+    QList<GLuint> mRetiredCacheQueries;
+    quint64 mCacheStamp = 0;
+    QList<ImageOperation*> mCachedOperations;
+    double mCacheSavedTime = 0.0;
+
+    QHash<GLuint, quint64> seedVersions();
+    QList<quint64> cacheKey(ImageOperation* operation, const QHash<GLuint, quint64>& versions);
+    void readCacheQuery(CacheEntry& entry);
+
+    void swapUploadedTextures();
+
+    QList<StateTexture> stateTextures();
+    QMap<QUuid, QByteArray> seedRandomStates();
+    void resumeSeeds(const QMap<QUuid, QByteArray>& randomStates, unsigned int iteration);
+
+    void captureRewind();
+    void clearRewind();
+    void updateRewindError();
+    GLenum checkpointPixelType(int& texelSize);
+    void submitCheckpoints(bool wait);
+    void releaseCheckpoint(CheckpointReadback& readback);
+    bool acquireCheckpointBuffer(qint64 size, CheckpointBuffer& buffer);
+    void clearCheckpointBuffers();
 
     void setPbos();
     void setOutputImage();
 
     void setBlenderProgram();
+    void setProbeProgram();
     // void setIdentityProgram();
 
     void verticesCoords(GLfloat& left, GLfloat& right, GLfloat& bottom, GLfloat& top);
@@ -168,7 +362,15 @@ private:
     void copyTextures();
     void blend(ImageOperation* operation);
     void renderOperation(ImageOperation* operation);
+    void passThrough(ImageOperation* operation);
+    void finishLinks();
     void render();
+
+    void probePixels();
+    void readPixelProbes();
+
+private slots:
+    void finishCheckpoint(quint64 ticket, QString filename, bool success);
 };
 
 
@@ -0,0 +1,458 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "rewindbuffer.h"
+
+
+
+RewindBuffer::RewindBuffer()
+{}
+
+
+
+void RewindBuffer::init()
+{
+    initializeOpenGLFunctions();
+
+    glGenFramebuffers(1, &mReadFbo);
+    glGenFramebuffers(1, &mDrawFbo);
+
+    mInitialized = true;
+}
+
+
+
+void RewindBuffer::cleanup()
+{
+    if (!mInitialized) {
+        return;
+    }
+
+    release();
+
+    glDeleteFramebuffers(1, &mReadFbo);
+    glDeleteFramebuffers(1, &mDrawFbo);
+
+    mInitialized = false;
+}
+
+
+
+RewindMode RewindBuffer::mode() const
+{
+    return mMode;
+}
+
+
+
+// Settings take effect on the next capture, which reallocates the storage
+
+void RewindBuffer::setMode(RewindMode mode)
+{
+    mMode = mode;
+    mLayout.clear();
+    mError.clear();
+}
+
+
+
+int RewindBuffer::budget() const
+{
+    return mBudget;
+}
+
+
+
+void RewindBuffer::setBudget(int megabytes)
+{
+    mBudget = megabytes;
+    mLayout.clear();
+    mError.clear();
+}
+
+
+
+int RewindBuffer::scale() const
+{
+    return mScale;
+}
+
+
+
+void RewindBuffer::setScale(int divisor)
+{
+    mScale = qMax(1, divisor);
+    mLayout.clear();
+    mError.clear();
+}
+
+
+
+int RewindBuffer::count() const
+{
+    return mLayout.isEmpty() ? 0 : mCount;
+}
+
+
+
+int RewindBuffer::capacity() const
+{
+    return mSlots.size();
+}
+
+
+
+QString RewindBuffer::error() const
+{
+    return mError;
+}
+
+
+
+unsigned int RewindBuffer::iteration(int age) const
+{
+    return age >= 0 && age < count() ? mSlots[slotIndex(age)].iteration : 0;
+}
+
+
+
+QMap<QUuid, QByteArray> RewindBuffer::randomStates(int age) const
+{
+    return age >= 0 && age < count() ? mSlots[slotIndex(age)].randomStates : QMap<QUuid, QByteArray>();
+}
+
+
+
+void RewindBuffer::capture(GLuint outTexId, const QList<StateTexture>& textures, GLuint width, GLuint height, GLenum texFormat, unsigned int iteration, const QMap<QUuid, QByteArray>& randomStates)
+{
+    if (!mInitialized) {
+        return;
+    }
+
+    if (mMode == RewindMode::Off)
+    {
+        if (!mSlots.isEmpty()) {
+            release();
+        }
+        return;
+    }
+
+    QString newLayout = layout(textures, width, height, texFormat);
+
+    if (newLayout != mLayout) {
+        allocate(textures, width, height, texFormat);
+    }
+
+    if (mSlots.isEmpty()) {
+        return;
+    }
+
+    Slot& slot = mSlots[mHead];
+    slot.iteration = iteration;
+    slot.randomStates = randomStates;
+    slot.outputIndex = -1;
+
+    if (mMode == RewindMode::Output)
+    {
+        blit(outTexId, -1, mWidth, mHeight, mOutputArrayTexId, mHead, ringWidth(), ringHeight());
+    }
+    else
+    {
+        for (int i = 0; i < textures.size(); i++)
+        {
+            glCopyImageSubData(textures[i].texId, textures[i].target, 0, 0, 0, 0, slot.texIds[i], textures[i].target, 0, 0, 0, 0, mWidth, mHeight, textures[i].layers);
+
+            if (textures[i].texId == outTexId && textures[i].target == GL_TEXTURE_2D) {
+                slot.outputIndex = i;
+            }
+        }
+    }
+
+    mHead = (mHead + 1) % mSlots.size();
+    mCount = qMin(mCount + 1, static_cast<int>(mSlots.size()));
+}
+
+
+
+// Output of the retained iteration, into a texture of the full size and format
+
+void RewindBuffer::view(int age, GLuint dstTexId)
+{
+    if (age < 0 || age >= count()) {
+        return;
+    }
+
+    const Slot& slot = mSlots[slotIndex(age)];
+
+    if (mMode == RewindMode::Output) {
+        blit(mOutputArrayTexId, slotIndex(age), ringWidth(), ringHeight(), dstTexId, -1, mWidth, mHeight);
+    }
+    else if (slot.outputIndex >= 0) {
+        glCopyImageSubData(slot.texIds[slot.outputIndex], GL_TEXTURE_2D, 0, 0, 0, 0, dstTexId, GL_TEXTURE_2D, 0, 0, 0, 0, mWidth, mHeight, 1);
+    }
+}
+
+
+
+// State mode copies every texture back, output mode only the output
+
+bool RewindBuffer::restore(int age, GLuint outTexId, const QList<StateTexture>& textures)
+{
+    if (age < 0 || age >= count()) {
+        return false;
+    }
+
+    const Slot& slot = mSlots[slotIndex(age)];
+
+    if (mMode == RewindMode::Output)
+    {
+        blit(mOutputArrayTexId, slotIndex(age), ringWidth(), ringHeight(), outTexId, -1, mWidth, mHeight);
+        return true;
+    }
+
+    if (layout(textures, mWidth, mHeight, mTexFormat) != mLayout) {
+        return false;
+    }
+
+    for (int i = 0; i < textures.size(); i++) {
+        glCopyImageSubData(slot.texIds[i], textures[i].target, 0, 0, 0, 0, textures[i].texId, textures[i].target, 0, 0, 0, 0, mWidth, mHeight, textures[i].layers);
+    }
+
+    return true;
+}
+
+
+
+// Resuming from an older iteration drops the ones after it
+
+void RewindBuffer::discardNewer(int age)
+{
+    if (age <= 0 || age >= count()) {
+        return;
+    }
+
+    mHead = (mHead - age + mSlots.size()) % mSlots.size();
+    mCount -= age;
+}
+
+
+
+void RewindBuffer::clear()
+{
+    mHead = 0;
+    mCount = 0;
+}
+
+
+
+QString RewindBuffer::layout(const QList<StateTexture>& textures, GLuint width, GLuint height, GLenum texFormat) const
+{
+    QString result = QString("%1 %2 %3 %4 %5 %6").arg(static_cast<int>(mMode)).arg(mBudget).arg(mScale).arg(width).arg(height).arg(texFormat);
+
+    if (mMode == RewindMode::State)
+    {
+        foreach (const StateTexture& texture, textures) {
+            result += QString(" %1:%2").arg(texture.key).arg(texture.layers);
+        }
+    }
+
+    return result;
+}
+
+
+
+bool RewindBuffer::allocate(const QList<StateTexture>& textures, GLuint width, GLuint height, GLenum texFormat)
+{
+    release();
+
+    mError.clear();
+
+    mLayout = layout(textures, width, height, texFormat);
+    mWidth = width;
+    mHeight = height;
+    mTexFormat = texFormat;
+
+    qint64 budgetBytes = static_cast<qint64>(mBudget) * 1024 * 1024;
+
+    if (mMode == RewindMode::Output)
+    {
+        // One layer per iteration, 8 bit
+
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+        qint64 layerBytes = static_cast<qint64>(ringWidth()) * ringHeight() * 4;
+        int capacity = static_cast<int>(qMin<qint64>(budgetBytes / layerBytes, maxLayers));
+
+        if (capacity < 1)
+        {
+            mError = QString("Rewind memory too small for a single frame of %1 MB").arg((layerBytes + 1024 * 1024 - 1) / (1024 * 1024));
+            return false;
+        }
+
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &mOutputArrayTexId);
+        glTextureStorage3D(mOutputArrayTexId, 1, GL_RGBA8, ringWidth(), ringHeight(), capacity);
+        glTextureParameteri(mOutputArrayTexId, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(mOutputArrayTexId, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        mSlots.resize(capacity);
+    }
+    else
+    {
+        // Copies of every state texture per iteration, same size and format so that copies are exact
+
+        qint64 stateBytes = 0;
+
+        foreach (const StateTexture& texture, textures) {
+            stateBytes += static_cast<qint64>(width) * height * texture.layers * texelSize(texFormat);
+        }
+
+        if (stateBytes == 0) {
+            return false;
+        }
+
+        int capacity = static_cast<int>(qMin<qint64>(budgetBytes / stateBytes, mMaxStates));
+
+        if (capacity < 1)
+        {
+            mError = QString("Rewind memory too small for a single state of %1 MB").arg((stateBytes + 1024 * 1024 - 1) / (1024 * 1024));
+            return false;
+        }
+
+        mSlots.resize(capacity);
+
+        for (Slot& slot : mSlots)
+        {
+            foreach (const StateTexture& texture, textures)
+            {
+                GLuint texId = 0;
+                glCreateTextures(texture.target, 1, &texId);
+
+                if (texture.target == GL_TEXTURE_2D_ARRAY) {
+                    glTextureStorage3D(texId, 1, texFormat, width, height, texture.layers);
+                }
+                else {
+                    glTextureStorage2D(texId, 1, texFormat, width, height);
+                }
+
+                glTextureParameteri(texId, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTextureParameteri(texId, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+                slot.texIds.append(texId);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+
+void RewindBuffer::release()
+{
+    if (mOutputArrayTexId)
+    {
+        glDeleteTextures(1, &mOutputArrayTexId);
+        mOutputArrayTexId = 0;
+    }
+
+    for (Slot& slot : mSlots) {
+        glDeleteTextures(slot.texIds.size(), slot.texIds.data());
+    }
+
+    mSlots.clear();
+    mLayout.clear();
+
+    mHead = 0;
+    mCount = 0;
+}
+
+
+
+int RewindBuffer::slotIndex(int age) const
+{
+    return (mHead - 1 - age + 2 * mSlots.size()) % mSlots.size();
+}
+
+
+
+GLuint RewindBuffer::ringWidth() const
+{
+    return qMax(1u, mWidth / mScale);
+}
+
+
+
+GLuint RewindBuffer::ringHeight() const
+{
+    return qMax(1u, mHeight / mScale);
+}
+
+
+
+int RewindBuffer::texelSize(GLenum texFormat)
+{
+    switch (texFormat)
+    {
+        case GL_RGBA12:
+        case GL_RGBA16:
+        case GL_RGBA16F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+
+
+void RewindBuffer::blit(GLuint srcTexId, GLint srcLayer, GLuint srcWidth, GLuint srcHeight, GLuint dstTexId, GLint dstLayer, GLuint dstWidth, GLuint dstHeight)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mReadFbo);
+
+    if (srcLayer < 0) {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, srcTexId, 0);
+    }
+    else {
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, srcTexId, 0, srcLayer);
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDrawFbo);
+
+    if (dstLayer < 0) {
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dstTexId, 0);
+    }
+    else {
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, dstTexId, 0, dstLayer);
+    }
+
+    GLenum filter = (srcWidth == dstWidth && srcHeight == dstHeight) ? GL_NEAREST : GL_LINEAR;
+
+    glBlitFramebuffer(0, 0, srcWidth, srcHeight, 0, 0, dstWidth, dstHeight, GL_COLOR_BUFFER_BIT, filter);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,141 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef REWINDBUFFER_H
+#define REWINDBUFFER_H
+
+
+
+#include "checkpoint.h"
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QList>
+#include <QMap>
+#include <QUuid>
+#include <QByteArray>
+#include <QString>
+
+
+
+// What the rewind buffer keeps of each iteration
+
+enum class RewindMode
+{
+    Off,
+    Output,  // Output only, 8 bit and optionally downsampled: many iterations, approximate resume
+    State    // Every state texture at full size and precision: fewer iterations, exact resume
+};
+
+
+
+// RewindBuffer: ring of the last iterations kept on the GPU within a memory budget
+// Capturing is one blit (output) or one copy per state texture (state), never a readback
+// Expects the render context to be current in every call
+
+class RewindBuffer : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    RewindBuffer();
+
+    void init();
+    void cleanup();
+
+    RewindMode mode() const;
+    void setMode(RewindMode mode);
+
+    int budget() const;
+    void setBudget(int megabytes);
+
+    int scale() const;
+    void setScale(int divisor);
+
+    int count() const;
+    int capacity() const;
+
+    // Why nothing is being captured, empty if the storage could be allocated
+
+    QString error() const;
+
+    // Ages count back from the latest capture, which is age 0
+
+    unsigned int iteration(int age) const;
+    QMap<QUuid, QByteArray> randomStates(int age) const;
+
+    void capture(GLuint outTexId, const QList<StateTexture>& textures, GLuint width, GLuint height, GLenum texFormat, unsigned int iteration, const QMap<QUuid, QByteArray>& randomStates);
+
+    void view(int age, GLuint dstTexId);
+    bool restore(int age, GLuint outTexId, const QList<StateTexture>& textures);
+
+    void discardNewer(int age);
+    void clear();
+
+private:
+    struct Slot
+    {
+        unsigned int iteration = 0;
+        QMap<QUuid, QByteArray> randomStates;
+        QList<GLuint> texIds;
+        int outputIndex = -1;
+    };
+
+    bool mInitialized = false;
+
+    RewindMode mMode = RewindMode::Off;
+    int mBudget = 256;
+    int mScale = 1;
+
+    GLuint mReadFbo = 0;
+    GLuint mDrawFbo = 0;
+
+    // Layout the storage was allocated for: reallocated, and the ring emptied, when it changes
+
+    QString mLayout;
+    QString mError;
+    GLuint mWidth = 0;
+    GLuint mHeight = 0;
+    GLenum mTexFormat = GL_RGBA8;
+
+    const int mMaxStates = 256;
+
+    GLuint mOutputArrayTexId = 0;
+    QList<Slot> mSlots;
+    int mHead = 0;
+    int mCount = 0;
+
+    QString layout(const QList<StateTexture>& textures, GLuint width, GLuint height, GLenum texFormat) const;
+    bool allocate(const QList<StateTexture>& textures, GLuint width, GLuint height, GLenum texFormat);
+    void release();
+
+    int slotIndex(int age) const;
+    GLuint ringWidth() const;
+    GLuint ringHeight() const;
+    static int texelSize(GLenum texFormat);
+
+    void blit(GLuint srcTexId, GLint srcLayer, GLuint srcWidth, GLuint srcHeight, GLuint dstTexId, GLint dstLayer, GLuint dstWidth, GLuint dstHeight);
+};
+
+
+
+#endif // REWINDBUFFER_H
@@ -24,6 +24,7 @@
 
 #include "rgbwidget.h"
 #include <QGraphicsOpacityEffect>
+#include <QApplication>
 
 
 RGBWidget::RGBWidget(int w, int h, QWidget* parent) :
@@ -40,6 +41,17 @@ RGBWidget::RGBWidget(int w, int h, QWidget* parent) :
 
     resize(512, 512);
     setUpdatesEnabled(false);
+
+    // Wheel events have no release, interaction ends after a short idle time
+
+    interactionTimer = new QTimer(this);
+    interactionTimer->setSingleShot(true);
+    interactionTimer->setInterval(250);
+
+    connect(interactionTimer, &QTimer::timeout, this, [=, this](){
+        if (!(QApplication::mouseButtons() & Qt::LeftButton))
+            setInteracting(false);
+    });
 }
 
 
@@ -49,19 +61,24 @@ RGBWidget::~RGBWidget()
     if (vao && vao->isCreated())
         vao->destroy();
 
-    if (vbo && vbo->isCreated())
-        vbo->destroy();
-
     if (vao3D && vao3D->isCreated())
         vao3D->destroy();
 
     if (vbo3D && vbo3D->isCreated())
         vbo3D->destroy();
 
+    if (densityTexId)
+    {
+        makeCurrent();
+        glDeleteTextures(1, &densityTexId);
+        doneCurrent();
+    }
+
     if (program) delete program;
     if (program3D) delete program3D;
+    if (densityProgram) delete densityProgram;
+    if (raymarchProgram) delete raymarchProgram;
     if (vao) delete vao;
-    if (vbo) delete vbo;
     if (vao3D) delete vao3D;
     if (vbo3D) delete vbo3D;
 }
@@ -93,14 +110,33 @@ void RGBWidget::initializeGL()
     if (!program3D->link())
         qDebug() << "Shader link error:\n" << program3D->log();
 
+    densityProgram = new QOpenGLShaderProgram();
+    if (!densityProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/density.comp"))
+        qDebug() << "Compute shader error:\n" << densityProgram->log();
+    if (!densityProgram->link())
+        qDebug() << "Shader link error:\n" << densityProgram->log();
+
+    raymarchProgram = new QOpenGLShaderProgram();
+    if (!raymarchProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/density.vert"))
+        qDebug() << "Vertex shader error:\n" << raymarchProgram->log();
+    if (!raymarchProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/density.frag"))
+        qDebug() << "Fragment shader error:\n" << raymarchProgram->log();
+    if (!raymarchProgram->link())
+        qDebug() << "Shader link error:\n" << raymarchProgram->log();
+
+    // Empty VAO: points and full screen triangle are generated from gl_VertexID
+
     vao = new QOpenGLVertexArrayObject();
     vao->create();
 
-    vbo = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
-    vbo->create();
-    vbo->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    // 3D histogram of colors for density mode
 
-    setupBuffer(texWidth, texHeight);
+    glGenTextures(1, &densityTexId);
+    glBindTexture(GL_TEXTURE_3D, densityTexId);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R32UI, densityBins, densityBins, densityBins);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
 
     vao3D = new QOpenGLVertexArrayObject();
     vao3D->create();
@@ -118,22 +154,13 @@ void RGBWidget::paintGL()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Draw RGB points
-
-    program->bind();
-
-    if (textureID)
-        glBindTexture(GL_TEXTURE_2D, *textureID);
-    else
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-    vao->bind();
-    glDrawArrays(GL_POINTS, 0, numPoints);
-    vao->release();
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    program->release();
+    if (textureID && *textureID)
+    {
+        if (densityMode)
+            drawDensity();
+        else
+            drawPoints();
+    }
 
     // Draw RGB lines
 
@@ -168,31 +195,121 @@ void RGBWidget::setTextureID(GLuint* id)
 
 
 
-void RGBWidget::setupBuffer(int w, int h)
+void RGBWidget::setTextureSize(int w, int h)
 {
-    vao->bind();
-    vbo->bind();
+    texWidth = w;
+    texHeight = h;
+
+    update();
+}
+
+
+
+void RGBWidget::setStride(int s)
+{
+    stride = s < 1 ? 1 : s;
+    update();
+}
+
+
+
+void RGBWidget::setDensityMode(bool on)
+{
+    densityMode = on;
+    update();
+}
+
+
+
+int RGBWidget::currentStride()
+{
+    // Coarser subsampling while rotating, to keep interaction smooth on large textures
+
+    return interacting ? 2 * stride : stride;
+}
+
 
-    QList<QVector2D> texCoords;
 
-    for (int y = 0; y < h; y++)
+void RGBWidget::setInteracting(bool on)
+{
+    if (on)
+        interactionTimer->start();
+
+    if (interacting != on)
     {
-        for (int x = 0; x < w; x++)
-        {
-            texCoords.append(QVector2D(x / static_cast<float>(w), y / static_cast<float>(h)));
-        }
+        interacting = on;
+        update();
     }
+}
+
+
+
+void RGBWidget::drawPoints()
+{
+    // One point per subsampled texel, without vertex buffer
+
+    int s = currentStride();
+    int numPoints = ((texWidth + s - 1) / s) * ((texHeight + s - 1) / s);
+
+    program->bind();
+    glUniform2i(program->uniformLocation("texSize"), texWidth, texHeight);
+    program->setUniformValue("stride", s);
+
+    glBindTexture(GL_TEXTURE_2D, *textureID);
+
+    vao->bind();
+    glDrawArrays(GL_POINTS, 0, numPoints);
+    vao->release();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    program->release();
+}
+
 
-    vbo->allocate(texCoords.constData(), texCoords.size() * sizeof(QVector2D));
 
-    int texLocation = program->attributeLocation("texCoord");
-    program->enableAttributeArray(texLocation);
-    program->setAttributeBuffer(texLocation, GL_FLOAT, 0, 2);
+void RGBWidget::drawDensity()
+{
+    // Accumulate subsampled texels into the 3D histogram
+
+    int s = currentStride();
+
+    GLuint zero = 0;
+    glClearTexImage(densityTexId, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    densityProgram->bind();
+    glUniform2i(densityProgram->uniformLocation("texSize"), texWidth, texHeight);
+    densityProgram->setUniformValue("stride", s);
+
+    glBindTexture(GL_TEXTURE_2D, *textureID);
+    glBindImageTexture(0, densityTexId, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+
+    glDispatchCompute((((texWidth + s - 1) / s) + 15) / 16, (((texHeight + s - 1) / s) + 15) / 16, 1);
+
+    glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    densityProgram->release();
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // Raymarch the histogram through the RGB cube
+
+    float densityScale = 4.0f / std::log(1.0f + static_cast<float>(texWidth) * texHeight / (s * s));
 
-    vbo->release();
+    raymarchProgram->bind();
+    raymarchProgram->setUniformValue("inverseTransform", transform.inverted());
+    raymarchProgram->setUniformValue("densityScale", densityScale);
+
+    glBindTexture(GL_TEXTURE_3D, densityTexId);
+
+    vao->bind();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
     vao->release();
 
-    numPoints = w * h;
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    raymarchProgram->release();
 }
 
 
@@ -238,7 +355,7 @@ void RGBWidget::computeTransformMatrix()
     model.scale(scale);
     model.translate(-0.5f, -0.5f, -0.5f);
 
-    QMatrix4x4 transform = projection * view * model;
+    transform = projection * view * model;
 
     makeCurrent();
 
@@ -269,6 +386,7 @@ void RGBWidget::wheelEvent(QWheelEvent* event)
 {
     scale += event->angleDelta().y() / 6000.0f;
     if (scale < 0.0f) scale = 0.0f;
+    setInteracting(true);
     computeTransformMatrix();
 }
 
@@ -279,6 +397,18 @@ void RGBWidget::mousePressEvent(QMouseEvent* event)
     if (event->buttons() == Qt::LeftButton)
     {
         prevPos = event->pos();
+        setInteracting(true);
+    }
+}
+
+
+
+void RGBWidget::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (!(event->buttons() & Qt::LeftButton))
+    {
+        interactionTimer->stop();
+        setInteracting(false);
     }
 }
 
@@ -298,6 +428,7 @@ void RGBWidget::mouseMoveEvent(QMouseEvent* event)
 
             rotation.rotate(rotationQuaternion);
 
+            setInteracting(true);
             computeTransformMatrix();
         }
 
@@ -26,7 +26,7 @@
 
 #include <cmath>
 #include <QOpenGLWidget>
-#include <QOpenGLExtraFunctions>
+#include <QOpenGLFunctions_4_5_Core>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLBuffer>
@@ -38,10 +38,11 @@
 #include <QCloseEvent>
 #include <QWheelEvent>
 #include <QMouseEvent>
+#include <QTimer>
 
 
 
-class RGBWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
+class RGBWidget : public QOpenGLWidget, protected QOpenGLFunctions_4_5_Core
 {
     Q_OBJECT
 
@@ -53,8 +54,10 @@ public:
     void paintGL() override;
     void resizeGL(int w, int h) override;
 
-    void setupBuffer(int w, int h);
+    void setTextureSize(int w, int h);
     void setTextureID(GLuint *id);
+    void setStride(int s);
+    void setDensityMode(bool on);
     void setLines(QList<GLfloat> vertices);
     void setNumVertices(QList<GLuint> nv){ numVertices = nv; }
 
@@ -66,11 +69,17 @@ protected:
     void wheelEvent(QWheelEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
     void mousePressEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
 
 private:
     QOpenGLShaderProgram* program = nullptr;
     QOpenGLVertexArrayObject* vao = nullptr;
-    QOpenGLBuffer* vbo = nullptr;
+
+    QOpenGLShaderProgram* densityProgram = nullptr;
+    QOpenGLShaderProgram* raymarchProgram = nullptr;
+    GLuint densityTexId = 0;
+    const int densityBins = 64;
+    bool densityMode = false;
 
     QOpenGLShaderProgram* program3D = nullptr;
     QOpenGLVertexArrayObject* vao3D = nullptr;
@@ -78,7 +87,9 @@ private:
 
     GLuint* textureID = nullptr;
     int texWidth, texHeight;
-    int numPoints;
+    int stride = 1;
+    bool interacting = false;
+    QTimer* interactionTimer;
 
     QList<GLuint> numVertices;
 
@@ -86,9 +97,15 @@ private:
     QMatrix4x4 rotation;
     QMatrix4x4 model;
     QMatrix4x4 projection;
+    QMatrix4x4 transform;
     QQuaternion rotationQuaternion;
     QPoint prevPos;
 
+    int currentStride();
+    void setInteracting(bool on);
+    void drawPoints();
+    void drawDensity();
+
     void computeTransformMatrix();
     QVector3D getArcBallVector(const QPoint& point);
 };
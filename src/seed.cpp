@@ -25,7 +25,7 @@
 #include "seed.h"
 
 #include <QFile>
-#include <QPainter>
+#include <sstream>
 
 
 
@@ -39,7 +39,7 @@ Seed::Seed()
 
 
 
-Seed::Seed(int type, bool fixed, QString imageFilename)
+Seed::Seed(int type, bool fixed, QString imageFilename, QString sequenceFilename, int iterationsPerFrame)
 {
     pOutTexId = new GLuint(0);
     pVideoTexId = new GLuint(0);
@@ -49,6 +49,8 @@ Seed::Seed(int type, bool fixed, QString imageFilename)
     mType = type;
     mFixed = fixed;
     mImageFilename = imageFilename;
+    mSequenceFilename = sequenceFilename;
+    mIterationsPerFrame = qMax(1, iterationsPerFrame);
 }
 
 
@@ -160,12 +162,19 @@ Seed::Seed(GLenum texFormat, GLuint width, GLuint height, const Seed& seed) :
 
 Seed::~Seed()
 {
+    if (mUploader) {
+        mUploader->cancel(&mImageTexId);
+    }
+
+    delete mDecoder;
+
     mContext->makeCurrent(mSurface);
 
     glDeleteFramebuffers(1, &mOutFbo);
+    glDeleteFramebuffers(1, &mReadFbo);
 
-    GLuint texIds[] = { mRandomTexId, mImageTexId, mClearTexId };
-    glDeleteTextures(3, texIds);
+    GLuint texIds[] = { mRandomTexId, mImageTexId, mClearTexId, mSequenceTexId };
+    glDeleteTextures(4, texIds);
 
     delete pOutTexId;
     delete pVideoTexId;
@@ -177,10 +186,11 @@ Seed::~Seed()
 
 
 
-void Seed::init(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* context, QOffscreenSurface* surface)
+void Seed::init(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* context, QOffscreenSurface* surface, TextureUploader* uploader)
 {
     mContext = context;
     mSurface = surface;
+    mUploader = uploader;
 
     mContext->makeCurrent(mSurface);
 
@@ -192,6 +202,10 @@ void Seed::init(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* c
 
     glGenFramebuffers(1, &mOutFbo);
 
+    // Framebuffer object to read decoded sequence frames from
+
+    glGenFramebuffers(1, &mReadFbo);
+
     // Vertex array object
 
     glGenVertexArrays(1, &mVao);
@@ -222,6 +236,7 @@ void Seed::init(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* c
     mContext->doneCurrent();
 
     loadImage(mImageFilename);
+    loadSequence(mSequenceFilename);
 }
 
 
@@ -235,7 +250,7 @@ GLuint* Seed::pOutTextureId()
 
 QList<GLuint*> Seed::textureIds()
 {
-    return QList<GLuint*> { &mRandomTexId, &mImageTexId, &mClearTexId };
+    return QList<GLuint*> { &mRandomTexId, &mImageTexId, &mClearTexId, &mSequenceTexId };
 }
 
 
@@ -288,6 +303,12 @@ void Seed::setVao(GLuint width, GLuint height)
 
     mTexWidth = width;
     mTexHeight = height;
+
+    if (mDecoder) {
+        mDecoder->setTargetSize(width, height);
+    }
+
+    mSequenceFrame = -1;
 }
 
 
@@ -297,9 +318,8 @@ void Seed::loadImage(QString filename)
     QFile imageFile(filename);
 
     if (imageFile.exists()) {
-        mImage = QImage(filename).convertToFormat(QImage::Format_RGBA8888);
-        resizeImage();
         mImageFilename = filename;
+        resizeImage();
     }
 }
 
@@ -307,38 +327,118 @@ void Seed::loadImage(QString filename)
 
 void Seed::resizeImage()
 {
-    if (!mImage.isNull())
+    // Decoding, scaling and uploading happen on the uploader's thread
+    // The new texture replaces mImageTexId once ready, see RenderManager::swapUploadedTextures
+
+    if (mUploader && !mImageFilename.isEmpty()) {
+        mUploader->requestImage(&mImageTexId, mImageFilename);
+    }
+}
+
+
+
+void Seed::loadSequence(QString filename)
+{
+    if (filename.isEmpty() || !QFile::exists(filename)) {
+        return;
+    }
+
+    mSequenceFilename = filename;
+    mSequenceFrame = -1;
+
+    if (mUploader)
     {
-        qreal sx = static_cast<qreal>(mTexWidth)  / mImage.width();
-        qreal sy = static_cast<qreal>(mTexHeight) / mImage.height();
-        qreal scale = qMin(1.0, qMin(sx, sy));
+        // Decoding and uploading of frames happen on the decoder's thread
+
+        delete mDecoder;
+
+        mDecoder = new FrameDecoder();
+        mDecoder->init(mContext, mSequenceFilename, mTexWidth, mTexHeight);
+    }
+}
 
-        int displayWidth = qRound(mImage.width() * scale);
-        int displayHeight = qRound(mImage.height() * scale);
 
-        int offsetX = (mTexWidth  - displayWidth) / 2;
-        int offsetY = (mTexHeight - displayHeight) / 2;
 
-        QImage scaled = mImage.scaled(displayWidth, displayHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+QString Seed::sequenceFilename() const
+{
+    return mSequenceFilename;
+}
 
-        QImage buffer(mTexWidth, mTexHeight, QImage::Format_RGBA8888);
-        buffer.fill(Qt::black);
 
-        QPainter painter(&buffer);
-        painter.drawImage(offsetX, offsetY, scaled);
 
-        mContext->makeCurrent(mSurface);
+int Seed::iterationsPerFrame() const
+{
+    return mIterationsPerFrame;
+}
 
-        glBindTexture(GL_TEXTURE_2D, mImageTexId);
 
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mTexWidth, mTexHeight, GL_RGBA, GL_UNSIGNED_BYTE, buffer.constBits());
+void Seed::setIterationsPerFrame(int iterations)
+{
+    mIterationsPerFrame = qMax(1, iterations);
+}
 
-        glBindTexture(GL_TEXTURE_2D, 0);
 
-        mContext->doneCurrent();
+
+int Seed::stepSequence(unsigned int iteration)
+{
+    // Expects current context
+    // Frame is a function of the iteration number; if the decoder has not caught up,
+    // the previous frame is kept and the missed frame number returned, otherwise -1
+
+    if (mType != 4 || !mDecoder) {
+        return -1;
+    }
+
+    int count = mDecoder->frameCount();
+    if (count == 0) {
+        return -1;
+    }
+
+    int frame = static_cast<int>((iteration / mIterationsPerFrame) % count);
+    if (frame == mSequenceFrame) {
+        return -1;
+    }
+
+    GLuint frameTexId, frameWidth, frameHeight;
+    GLsync frameFence;
+
+    if (!mDecoder->acquireFrame(frame, frameTexId, frameWidth, frameHeight, frameFence)) {
+        return frame;
     }
+
+    glWaitSync(frameFence, 0, GL_TIMEOUT_IGNORED);
+
+    // Letterboxed copy into the seed texture, scaling done by the blit
+
+    qreal scale = qMin(1.0, qMin(static_cast<qreal>(mTexWidth) / frameWidth, static_cast<qreal>(mTexHeight) / frameHeight));
+
+    GLint width = static_cast<GLint>(frameWidth * scale);
+    GLint height = static_cast<GLint>(frameHeight * scale);
+    GLint x0 = (static_cast<GLint>(mTexWidth) - width) / 2;
+    GLint y0 = (static_cast<GLint>(mTexHeight) - height) / 2;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mReadFbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameTexId, 0);
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mOutFbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mSequenceTexId, 0);
+
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glBlitFramebuffer(0, 0, frameWidth, frameHeight, x0, y0, x0 + width, y0 + height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    mDecoder->releaseFrame(frame, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    mSequenceFrame = frame;
+    mContentVersion++;
+
+    setOutTextureId();
+
+    return -1;
 }
 
 
@@ -370,6 +470,15 @@ int Seed::type() const
 }
 
 
+
+quint64 Seed::contentVersion() const
+{
+    // Changes whenever the contents of the current output texture are rewritten
+
+    return mContentVersion;
+}
+
+
 void Seed::setType(int type)
 {
     mType = type;
@@ -402,6 +511,37 @@ QString Seed::imageFilename() const
 
 
 
+// Random generator state in its standard textual form, saved with checkpoints
+
+QByteArray Seed::randomState() const
+{
+    std::ostringstream state;
+    state << mGenerator;
+
+    return QByteArray::fromStdString(state.str());
+}
+
+
+
+void Seed::setRandomState(const QByteArray& state)
+{
+    std::istringstream stream(state.toStdString());
+    stream >> mGenerator;
+
+    mRandomVersion++;
+}
+
+
+
+// Changes whenever the generator advances or is set, so that its state need not be serialized otherwise
+
+quint64 Seed::randomVersion() const
+{
+    return mRandomVersion;
+}
+
+
+
 void Seed::draw()
 {
     if (mType == 0 || mType == 1) {
@@ -409,6 +549,7 @@ void Seed::draw()
     }
 
     mCleared = false;
+    mContentVersion++;
 
     setOutTextureId();
 }
@@ -439,6 +580,9 @@ void Seed::setOutTextureId()
         else if (mType == 3) {
             *pOutTexId = *pVideoTexId;
         }
+        else if (mType == 4) {
+            *pOutTexId = mSequenceTexId;
+        }
     }
     else {
         *pOutTexId = mClearTexId;
@@ -511,6 +655,7 @@ void Seed::drawRandom(bool grayscale)
 
     std::uniform_real_distribution<float> distribution(0, 1);
     float randomNumber = distribution(mGenerator);
+    mRandomVersion++;
 
     mRandomProgram->setUniformValue("randomNumber", randomNumber);
     mRandomProgram->setUniformValue("grayscale", grayscale);
@@ -27,6 +27,9 @@
 
 
 
+#include "textureuploader.h"
+#include "framedecoder.h"
+
 #include <random>
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLVertexArrayObject>
@@ -45,12 +48,12 @@ class Seed : protected QOpenGLExtraFunctions
 {
 public:
     Seed();
-    Seed(int type, bool fixed, QString imageFilename);
+    Seed(int type, bool fixed, QString imageFilename, QString sequenceFilename = QString(), int iterationsPerFrame = 1);
     Seed(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* context, QOffscreenSurface* surface);
     Seed(GLenum texFormat, GLuint width, GLuint height, const Seed& seed);
     ~Seed();
 
-    void init(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* context, QOffscreenSurface* surface);
+    void init(GLenum texFormat, GLuint width, GLuint height, QOpenGLContext* context, QOffscreenSurface* surface, TextureUploader* uploader);
 
     GLuint* pOutTextureId();
     QList<GLuint*> textureIds();
@@ -71,9 +74,23 @@ public:
     bool fixed() const;
     void setFixed(bool set);
 
+    quint64 contentVersion() const;
+
     QString imageFilename() const;
     void resizeImage();
 
+    QByteArray randomState() const;
+    void setRandomState(const QByteArray& state);
+    quint64 randomVersion() const;
+
+    void loadSequence(QString filename);
+    QString sequenceFilename() const;
+
+    int iterationsPerFrame() const;
+    void setIterationsPerFrame(int iterations);
+
+    int stepSequence(unsigned int iteration);
+
     QByteArray videoDevId() const;
     void setVideoDevId(QByteArray devId);
 
@@ -84,19 +101,30 @@ private:
     bool mFixed = false;
     bool mCleared = true;
 
+    quint64 mContentVersion = 0;
+    quint64 mRandomVersion = 0;
+
     QString mImageFilename;
-    QImage mImage;
+
+    TextureUploader* mUploader = nullptr;
+
+    QString mSequenceFilename;
+    FrameDecoder* mDecoder = nullptr;
+    int mIterationsPerFrame = 1;
+    int mSequenceFrame = -1;
 
     QOpenGLContext* mContext;
     QOffscreenSurface* mSurface;
 
     GLuint mOutFbo = 0;
+    GLuint mReadFbo = 0;
     GLuint mVao = 0;
     GLuint mVboPos = 0;
 
     GLuint mRandomTexId = 0;
     GLuint mImageTexId = 0;
     GLuint mClearTexId = 0;
+    GLuint mSequenceTexId = 0;
     GLuint* pOutTexId = nullptr;
 
     GLuint* pVideoTexId = nullptr;
@@ -8,6 +8,7 @@
 #include <QActionGroup>
 #include <QHBoxLayout>
 #include <QFileDialog>
+#include <QInputDialog>
 
 
 
@@ -48,14 +49,21 @@ SeedWidget::SeedWidget(QUuid id, Seed* seed, VideoInputControl* videoInCtrl, QWi
 
     connect(mAvailVideoMenu, &QMenu::triggered, this, &SeedWidget::selectVideo);
 
+    sequenceAction = headerToolBar->addAction(QIcon(QPixmap(":/icons/emblem-videos.png")), "Sequence", this, &SeedWidget::setSeedType);
+    sequenceAction->setEnabled(!mSeed->sequenceFilename().isEmpty());
+    sequenceAction->setCheckable(true);
+    sequenceAction->setData(QVariant(4));
+
     QActionGroup* type = new QActionGroup(this);
     type->addAction(colorAction);
     type->addAction(grayScaleAction);
     type->addAction(imageAction);
+    type->addAction(sequenceAction);
 
     colorAction->setChecked(mSeed->type() == 0);
     grayScaleAction->setChecked(mSeed->type() == 1);
     imageAction->setChecked(mSeed->type() == 2);
+    sequenceAction->setChecked(mSeed->type() == 4);
 
     headerToolBar->addSeparator();
 
@@ -63,6 +71,14 @@ SeedWidget::SeedWidget(QUuid id, Seed* seed, VideoInputControl* videoInCtrl, QWi
 
     headerToolBar->addAction(QIcon(QPixmap(":/icons/folder-image.png")), "Load image", this, &SeedWidget::loadSeedImage);
 
+    // Load video file or image sequence action
+
+    headerToolBar->addAction(QIcon(QPixmap(":/icons/document-open.png")), "Load sequence", this, &SeedWidget::loadSeedSequence);
+
+    // Iterations per sequence frame action
+
+    headerToolBar->addAction(QIcon(QPixmap(":/icons/format-list-ordered.png")), "Iterations per frame", this, &SeedWidget::setIterationsPerFrame);
+
     headerToolBar->addSeparator();
 
     // Set as output action
@@ -166,6 +182,31 @@ void SeedWidget::loadSeedImage()
 
 
 
+void SeedWidget::loadSeedSequence()
+{
+    QString filename = QFileDialog::getOpenFileName(this->parentWidget(), "Load video or first image of sequence", QDir::homePath(), "Videos (*.mp4 *.m4v *.mov *.avi *.mkv *.webm *.mpg *.mpeg *.ogv);;Images (*.bmp *.jpeg *.jpg *.png *.tif *.tiff)");
+
+    if (!filename.isEmpty())
+    {
+        mSeed->loadSequence(filename);
+        sequenceAction->setEnabled(true);
+    }
+}
+
+
+
+void SeedWidget::setIterationsPerFrame()
+{
+    bool ok;
+    int iterations = QInputDialog::getInt(this->parentWidget(), "Sequence", "Iterations per frame:", mSeed->iterationsPerFrame(), 1, 100000, 1, &ok);
+
+    if (ok) {
+        mSeed->setIterationsPerFrame(iterations);
+    }
+}
+
+
+
 void SeedWidget::toggleOutputAction(QUuid id)
 {
     bool checked = (id == mId);
@@ -218,5 +259,6 @@ void SeedWidget::selectVideo(QAction* action)
         colorAction->setChecked(false);
         grayScaleAction->setChecked(false);
         imageAction->setChecked(false);
+        sequenceAction->setChecked(false);
     }
 }
@@ -44,6 +44,7 @@ private:
     QAction* grayScaleAction;
     QAction* imageAction;
     QAction* videoAction;
+    QAction* sequenceAction;
     QAction* outputAction;
     QAction* fixedAction;
 
@@ -54,6 +55,8 @@ private slots:
     void setFixedSeed(bool fixed);
     void setSeedType();
     void loadSeedImage();
+    void loadSeedSequence();
+    void setIterationsPerFrame();
     void populateAvailVideoMenu();
     void selectVideo(QAction* action);
 };
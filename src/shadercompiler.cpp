@@ -0,0 +1,344 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "shadercompiler.h"
+
+#include <QOpenGLFunctions>
+
+
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+
+
+ShaderCompiler::ShaderCompiler(QObject* parent)
+    : QObject { parent }
+{}
+
+
+
+ShaderCompiler::~ShaderCompiler()
+{
+    stop();
+
+    delete mSurface;
+}
+
+
+
+void ShaderCompiler::init(QOpenGLContext* context)
+{
+    // Called with the render context current
+
+    bool khr = context->hasExtension("GL_KHR_parallel_shader_compile");
+    mParallel = khr || context->hasExtension("GL_ARB_parallel_shader_compile");
+
+    if (mParallel)
+    {
+        // The driver compiles in the background: jobs are submitted and polled on the render thread
+
+        initializeOpenGLFunctions();
+        mInitialized = true;
+
+        typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+
+        MaxShaderCompilerThreads maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreads>(context->getProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+
+        if (maxShaderCompilerThreads) {
+            maxShaderCompilerThreads(0xFFFFFFFF);
+        }
+    }
+    else
+    {
+        // Create context sharing objects with the render context, to be used only from the compiler thread
+
+        mContext = new QOpenGLContext();
+        mContext->setFormat(context->format());
+        mContext->setShareContext(context);
+        mContext->create();
+
+        mSurface = new QOffscreenSurface();
+        mSurface->setFormat(context->format());
+        mSurface->create();
+
+        mContext->moveToThread(&mThread);
+        moveToThread(&mThread);
+
+        mThread.start();
+    }
+}
+
+
+
+void ShaderCompiler::stop()
+{
+    // Called with the render context current, so that programs dropped here are deleted in it
+
+    if (mThread.isRunning())
+    {
+        QMetaObject::invokeMethod(this, &ShaderCompiler::cleanup, Qt::BlockingQueuedConnection);
+
+        mThread.quit();
+        mThread.wait();
+    }
+    else if (mParallel)
+    {
+        cleanup();
+    }
+
+    mResults.clear();
+}
+
+
+
+bool ShaderCompiler::parallel() const
+{
+    return mParallel;
+}
+
+
+
+void ShaderCompiler::submit(QSharedPointer<SharedProgram> program, QString vertexShader, QString fragmentShader, QByteArray cacheKey)
+{
+    // The program object must have been created: it is shared with the compiler context
+
+    CompileJob job;
+    job.program = program;
+    job.programId = program->program.programId();
+    job.vertexShader = vertexShader;
+    job.fragmentShader = fragmentShader;
+    job.cacheKey = cacheKey;
+
+    if (mParallel)
+    {
+        compile(job);
+        mCompiling.append(job);
+    }
+    else
+    {
+        mMutex.lock();
+        mJobs.append(job);
+        mMutex.unlock();
+
+        QMetaObject::invokeMethod(this, &ShaderCompiler::processJobs, Qt::QueuedConnection);
+    }
+}
+
+
+
+QList<CompileResult> ShaderCompiler::takeResults()
+{
+    QList<CompileResult> results;
+
+    if (mParallel)
+    {
+        for (auto it = mCompiling.begin(); it != mCompiling.end();)
+        {
+            if (completed(*it))
+            {
+                results.append(finish(*it));
+                it = mCompiling.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+    else
+    {
+        QMutexLocker locker(&mMutex);
+        results.swap(mResults);
+    }
+
+    return results;
+}
+
+
+
+void ShaderCompiler::compile(CompileJob& job)
+{
+    // No status queries here: they would wait for the compiler
+
+    QByteArray vertexSource = job.vertexShader.toUtf8();
+    QByteArray fragmentSource = job.fragmentShader.toUtf8();
+
+    const char* vertexData = vertexSource.constData();
+    const char* fragmentData = fragmentSource.constData();
+
+    job.vertexId = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(job.vertexId, 1, &vertexData, nullptr);
+    glCompileShader(job.vertexId);
+
+    job.fragmentId = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(job.fragmentId, 1, &fragmentData, nullptr);
+    glCompileShader(job.fragmentId);
+
+    glAttachShader(job.programId, job.vertexId);
+    glAttachShader(job.programId, job.fragmentId);
+
+    glLinkProgram(job.programId);
+}
+
+
+
+bool ShaderCompiler::completed(const CompileJob& job)
+{
+    GLint status = GL_FALSE;
+    glGetProgramiv(job.programId, GL_COMPLETION_STATUS_KHR, &status);
+
+    return status == GL_TRUE;
+}
+
+
+
+CompileResult ShaderCompiler::finish(CompileJob& job)
+{
+    GLint status = GL_FALSE;
+    glGetProgramiv(job.programId, GL_LINK_STATUS, &status);
+
+    CompileResult result;
+    result.cacheKey = job.cacheKey;
+    result.ok = status == GL_TRUE;
+
+    if (!result.ok) {
+        result.log = shaderLog(job.vertexId) + shaderLog(job.fragmentId) + programLog(job.programId);
+    }
+
+    glDetachShader(job.programId, job.vertexId);
+    glDetachShader(job.programId, job.fragmentId);
+    glDeleteShader(job.vertexId);
+    glDeleteShader(job.fragmentId);
+
+    // Moved so that the last reference is always dropped on the render thread
+
+    result.program = std::move(job.program);
+
+    return result;
+}
+
+
+
+QString ShaderCompiler::shaderLog(GLuint shaderId)
+{
+    GLint length = 0;
+    glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &length);
+
+    if (length <= 1) {
+        return QString();
+    }
+
+    QByteArray log(length, '\0');
+    glGetShaderInfoLog(shaderId, length, nullptr, log.data());
+
+    return QString::fromUtf8(log.constData());
+}
+
+
+
+QString ShaderCompiler::programLog(GLuint programId)
+{
+    GLint length = 0;
+    glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &length);
+
+    if (length <= 1) {
+        return QString();
+    }
+
+    QByteArray log(length, '\0');
+    glGetProgramInfoLog(programId, length, nullptr, log.data());
+
+    return QString::fromUtf8(log.constData());
+}
+
+
+
+void ShaderCompiler::processJobs()
+{
+    QList<CompileJob> jobs;
+
+    mMutex.lock();
+    jobs.swap(mJobs);
+    mMutex.unlock();
+
+    if (jobs.isEmpty()) {
+        return;
+    }
+
+    mContext->makeCurrent(mSurface);
+
+    if (!mInitialized)
+    {
+        initializeOpenGLFunctions();
+        mInitialized = true;
+    }
+
+    QList<CompileResult> results;
+
+    for (CompileJob& job : jobs)
+    {
+        compile(job);
+        results.append(finish(job));
+    }
+
+    // Linked state must be complete before the render context picks the programs up
+
+    glFinish();
+
+    mContext->doneCurrent();
+
+    mMutex.lock();
+    mResults.append(std::move(results));
+    mMutex.unlock();
+}
+
+
+
+void ShaderCompiler::cleanup()
+{
+    // Release shaders of programs still compiling
+
+    if (mParallel)
+    {
+        for (CompileJob& job : mCompiling)
+        {
+            glDeleteShader(job.vertexId);
+            glDeleteShader(job.fragmentId);
+        }
+
+        mCompiling.clear();
+    }
+    else
+    {
+        mMutex.lock();
+        mJobs.clear();
+        mMutex.unlock();
+
+        delete mContext;
+        mContext = nullptr;
+    }
+}
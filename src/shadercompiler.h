@@ -0,0 +1,118 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef SHADERCOMPILER_H
+#define SHADERCOMPILER_H
+
+
+
+#include "programpool.h"
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QSharedPointer>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+
+
+
+// Finished compilation: the program has been linked and can be picked up with QOpenGLShaderProgram::link()
+
+struct CompileResult
+{
+    QSharedPointer<SharedProgram> program;
+    QByteArray cacheKey;
+    bool ok = false;
+    QString log;
+};
+
+
+
+// ShaderCompiler: compiles and links programs without stalling the render thread
+// With GL_KHR/ARB_parallel_shader_compile the driver compiles in the background and completion is polled,
+// otherwise programs are linked on a worker thread with its own context, shared with the render context
+
+class ShaderCompiler : public QObject, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    explicit ShaderCompiler(QObject* parent = nullptr);
+    ~ShaderCompiler();
+
+    void init(QOpenGLContext* context);
+    void stop();
+
+    bool parallel() const;
+
+    void submit(QSharedPointer<SharedProgram> program, QString vertexShader, QString fragmentShader, QByteArray cacheKey);
+    QList<CompileResult> takeResults();
+
+private:
+    struct CompileJob
+    {
+        QSharedPointer<SharedProgram> program;
+        GLuint programId = 0;
+        GLuint vertexId = 0;
+        GLuint fragmentId = 0;
+        QString vertexShader;
+        QString fragmentShader;
+        QByteArray cacheKey;
+    };
+
+    bool mParallel = false;
+
+    QThread mThread;
+
+    QOpenGLContext* mContext = nullptr;
+    QOffscreenSurface* mSurface = nullptr;
+    bool mInitialized = false;
+
+    QList<CompileJob> mCompiling;
+
+    QMutex mMutex;
+    QList<CompileJob> mJobs;
+    QList<CompileResult> mResults;
+
+    void compile(CompileJob& job);
+    bool completed(const CompileJob& job);
+    CompileResult finish(CompileJob& job);
+
+    QString shaderLog(GLuint shaderId);
+    QString programLog(GLuint programId);
+
+private slots:
+    void processJobs();
+    void cleanup();
+};
+
+
+
+#endif // SHADERCOMPILER_H
@@ -0,0 +1,312 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "shaderpreprocessor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+
+
+ShaderPreprocessor::ShaderPreprocessor() :
+    mBaseDir { includeDirectory() }
+{}
+
+
+
+QString ShaderPreprocessor::includeDirectory()
+{
+    return QDir::currentPath() + "/operations/include";
+}
+
+
+
+void ShaderPreprocessor::setBaseDirectory(QString dir)
+{
+    mBaseDir = dir;
+}
+
+
+
+void ShaderPreprocessor::setDefine(QString name, QString value)
+{
+    mDefines.insert(name, value);
+}
+
+
+
+void ShaderPreprocessor::setConstant(QString uniformName, QStringList values)
+{
+    mConstants.insert(uniformName, values);
+}
+
+
+
+QString ShaderPreprocessor::process(QString source)
+{
+    mError.clear();
+    mIncludedFiles.clear();
+
+    QString result = expandIncludes(source, mBaseDir, 0);
+
+    if (!mError.isEmpty()) {
+        return source;
+    }
+
+    result = specialize(result);
+    result = injectDefines(result);
+
+    return result;
+}
+
+
+
+// Explicit locations are kept, the others are assigned after them, one per array element
+// Locations are shared by name across the stages of a program, so the map is passed along
+
+QString ShaderPreprocessor::assignLocations(QString source, QMap<QString, int>& locations)
+{
+    static const QRegularExpression explicitRe("\\blayout\\s*\\(\\s*location\\s*=\\s*(\\d+)\\s*\\)\\s*uniform\\s+\\w+\\s+(\\w+)\\s*(?:\\[\\s*(\\d+)\\s*\\])?\\s*;");
+    static const QRegularExpression declRe("^(\\s*)uniform\\s+(\\w+)\\s+(\\w+)\\s*(?:\\[\\s*(\\d+)\\s*\\])?\\s*;", QRegularExpression::MultilineOption);
+
+    int next = 0;
+
+    for (auto [name, location] : locations.asKeyValueRange()) {
+        next = qMax(next, location + 1);
+    }
+
+    QRegularExpressionMatchIterator it = explicitRe.globalMatch(source);
+
+    while (it.hasNext())
+    {
+        QRegularExpressionMatch match = it.next();
+
+        int location = match.captured(1).toInt();
+        int count = match.captured(3).isEmpty() ? 1 : match.captured(3).toInt();
+
+        locations.insert(match.captured(2), location);
+        next = qMax(next, location + count);
+    }
+
+    QString result;
+    qsizetype last = 0;
+
+    it = declRe.globalMatch(source);
+
+    while (it.hasNext())
+    {
+        QRegularExpressionMatch match = it.next();
+
+        QString name = match.captured(3);
+        int count = match.captured(4).isEmpty() ? 1 : match.captured(4).toInt();
+
+        if (!locations.contains(name))
+        {
+            locations.insert(name, next);
+            next += count;
+        }
+
+        // Inserted before the uniform keyword, after the indentation
+
+        result += source.mid(last, match.capturedEnd(1) - last);
+        result += QString("layout(location = %1) ").arg(locations.value(name));
+        last = match.capturedEnd(1);
+    }
+
+    result += source.mid(last);
+
+    return result;
+}
+
+
+
+bool ShaderPreprocessor::ok() const
+{
+    return mError.isEmpty();
+}
+
+
+
+QString ShaderPreprocessor::error() const
+{
+    return mError;
+}
+
+
+
+QStringList ShaderPreprocessor::includedFiles() const
+{
+    return mIncludedFiles;
+}
+
+
+
+// Each file is included once, which also stops include cycles
+
+QString ShaderPreprocessor::expandIncludes(QString source, QString dir, int depth)
+{
+    static const QRegularExpression includeRe("^\\s*#\\s*include\\s+[\"<]([^\">]+)[\">]\\s*$");
+
+    if (depth > 32)
+    {
+        mError = "Includes nested too deep";
+        return QString();
+    }
+
+    QStringList lines = source.split('\n');
+
+    for (int i = 0; i < lines.size(); i++)
+    {
+        QRegularExpressionMatch match = includeRe.match(lines[i]);
+
+        if (!match.hasMatch()) {
+            continue;
+        }
+
+        QString name = match.captured(1);
+
+        QString path = QDir(dir).absoluteFilePath(name);
+        if (!QFileInfo::exists(path)) {
+            path = QDir(includeDirectory()).absoluteFilePath(name);
+        }
+
+        if (mIncludedFiles.contains(path))
+        {
+            lines[i] = QString();
+            continue;
+        }
+
+        QFile file(path);
+
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            mError = QString("Cannot open included file %1").arg(name);
+            return QString();
+        }
+
+        mIncludedFiles.append(path);
+
+        lines[i] = expandIncludes(QString::fromUtf8(file.readAll()), QFileInfo(path).absolutePath(), depth + 1);
+
+        if (!mError.isEmpty()) {
+            return QString();
+        }
+    }
+
+    return lines.join('\n');
+}
+
+
+
+// uniform T name; or uniform T name[N]; becomes a constant built with T's constructor, which accepts any scalar literal
+
+QString ShaderPreprocessor::specialize(QString source)
+{
+    for (auto [name, values] : mConstants.asKeyValueRange())
+    {
+        QRegularExpression declRe(QString("\\buniform\\s+(\\w+)\\s+%1\\s*(?:\\[\\s*(\\d+)\\s*\\])?\\s*;").arg(QRegularExpression::escape(name)));
+        QRegularExpressionMatch match = declRe.match(source);
+
+        if (!match.hasMatch() || values.isEmpty()) {
+            continue;
+        }
+
+        QString type = match.captured(1);
+        QString constant;
+
+        if (match.captured(2).isEmpty())
+        {
+            constant = QString("const %1 %2 = %1(%3);").arg(type, name, values.join(", "));
+        }
+        else
+        {
+            int count = match.captured(2).toInt();
+            int size = count > 0 ? values.size() / count : 0;
+
+            if (size == 0) {
+                continue;
+            }
+
+            QStringList items;
+
+            for (int i = 0; i < count; i++) {
+                items.append(QString("%1(%2)").arg(type, values.mid(i * size, size).join(", ")));
+            }
+
+            constant = QString("const %1 %2[%3] = %1[%3](%4);").arg(type, name, match.captured(2), items.join(", "));
+        }
+
+        source.replace(match.capturedStart(), match.capturedLength(), constant);
+    }
+
+    return source;
+}
+
+
+
+// Only the defines a source refers to are injected, so that a shader not using them is unaffected by their values
+
+QString ShaderPreprocessor::injectDefines(QString source)
+{
+    QStringList defines;
+
+    for (auto [name, value] : mDefines.asKeyValueRange())
+    {
+        QRegularExpression nameRe(QString("\\b%1\\b").arg(QRegularExpression::escape(name)));
+
+        if (source.contains(nameRe)) {
+            defines.append(QString("#define %1 %2").arg(name, value));
+        }
+    }
+
+    if (defines.isEmpty()) {
+        return source;
+    }
+
+    QStringList lines = source.split('\n');
+
+    int versionLine = -1;
+
+    for (int i = 0; i < lines.size(); i++)
+    {
+        if (lines[i].trimmed().startsWith("#version"))
+        {
+            versionLine = i;
+            break;
+        }
+    }
+
+    // Restore line numbering after the injected lines, for error messages
+
+    defines.append(QString("#line %1").arg(versionLine + 2));
+
+    for (int i = defines.size() - 1; i >= 0; i--) {
+        lines.insert(versionLine + 1, defines[i]);
+    }
+
+    return lines.join('\n');
+}
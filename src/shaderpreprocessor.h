@@ -0,0 +1,77 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+
+
+
+// ShaderPreprocessor: runs on shader sources before they are compiled
+// Expands #include "file" from the shader's directory or the shared library in operations/include,
+// injects the #defines the source refers to after #version,
+// and turns specialized uniforms into constants holding their current values
+// Also gives uniforms the explicit locations SPIR-V for OpenGL requires
+
+class ShaderPreprocessor
+{
+public:
+    ShaderPreprocessor();
+
+    void setBaseDirectory(QString dir);
+    void setDefine(QString name, QString value);
+    void setConstant(QString uniformName, QStringList values);
+
+    QString process(QString source);
+
+    static QString assignLocations(QString source, QMap<QString, int>& locations);
+
+    bool ok() const;
+    QString error() const;
+    QStringList includedFiles() const;
+
+    static QString includeDirectory();
+
+private:
+    QString mBaseDir;
+    QMap<QString, QString> mDefines;
+    QMap<QString, QStringList> mConstants;
+
+    QString mError;
+    QStringList mIncludedFiles;
+
+    QString expandIncludes(QString source, QString dir, int depth);
+    QString specialize(QString source);
+    QString injectDefines(QString source);
+};
+
+
+
+#endif // SHADERPREPROCESSOR_H
@@ -0,0 +1,365 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "statisticsengine.h"
+
+#include <QDebug>
+
+
+
+StatisticsEngine::StatisticsEngine(QObject* parent)
+    : QObject { parent }
+{}
+
+
+
+StatisticsEngine::~StatisticsEngine()
+{
+    stopLog();
+}
+
+
+
+QStringList StatisticsEngine::statisticNames()
+{
+    // Order of the values in each source block
+
+    QStringList names;
+    QStringList channels = { "red", "green", "blue", "luminance" };
+
+    foreach (QString statistic, QStringList { "Mean", "Variance", "Min", "Max", "Energy" }) {
+        foreach (QString channel, channels) {
+            names.append(statistic + " " + channel);
+        }
+    }
+
+    return names;
+}
+
+
+
+void StatisticsEngine::init()
+{
+    // Expects current context
+
+    initializeOpenGLFunctions();
+
+    mReduceProgram = new QOpenGLShaderProgram();
+    if (!mReduceProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/reduce.comp"))
+        qDebug() << "Compute shader error:\n" << mReduceProgram->log();
+    if (!mReduceProgram->link())
+        qDebug() << "Shader link error:\n" << mReduceProgram->log();
+
+    mFinalProgram = new QOpenGLShaderProgram();
+    if (!mFinalProgram->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/reduce-final.comp"))
+        qDebug() << "Compute shader error:\n" << mFinalProgram->log();
+    if (!mFinalProgram->link())
+        qDebug() << "Shader link error:\n" << mFinalProgram->log();
+
+    // Statistics blocks: 20 floats per source
+
+    glCreateBuffers(1, &mBlocksBuffer);
+    glNamedBufferStorage(mBlocksBuffer, maxSources * numStatistics * sizeof(GLfloat), nullptr, 0);
+
+    mReadBuffers.resize(mRingSize, 0);
+    mFences.resize(mRingSize, 0);
+    mReadCounts.resize(mRingSize, 0);
+    mReadIterations.resize(mRingSize, 0);
+
+    glCreateBuffers(mRingSize, mReadBuffers.data());
+
+    foreach (GLuint buffer, mReadBuffers) {
+        glNamedBufferStorage(buffer, maxSources * numStatistics * sizeof(GLfloat), nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+
+    mInitialized = true;
+}
+
+
+
+void StatisticsEngine::cleanup()
+{
+    // Expects current context
+
+    if (!mInitialized) {
+        return;
+    }
+
+    delete mReduceProgram;
+    delete mFinalProgram;
+
+    foreach (GLsync fence, mFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    glDeleteBuffers(1, &mPartialsBuffer);
+    glDeleteBuffers(1, &mBlocksBuffer);
+    glDeleteBuffers(mRingSize, mReadBuffers.data());
+
+    mInitialized = false;
+}
+
+
+
+bool StatisticsEngine::enabled() const
+{
+    return mEnabled;
+}
+
+
+
+void StatisticsEngine::setEnabled(bool set)
+{
+    mEnabled = set;
+}
+
+
+
+QList<GLuint*> StatisticsEngine::sources() const
+{
+    return mSources;
+}
+
+
+
+void StatisticsEngine::setSources(QList<GLuint*> pTexIds)
+{
+    // Null source stands for the output texture
+
+    mSources = pTexIds.mid(0, maxSources);
+}
+
+
+
+void StatisticsEngine::compute(GLuint* pOutputTexId, unsigned int iteration)
+{
+    // Expects current context
+
+    if (!mInitialized || !mEnabled || mSources.isEmpty() || !mReduceProgram->isLinked() || !mFinalProgram->isLinked()) {
+        return;
+    }
+
+    readStatistics();
+
+    // Readback ring full: skip this iteration
+
+    if (mFences[mSubmitIndex]) {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mBlocksBuffer);
+
+    for (int block = 0; block < mSources.size(); block++)
+    {
+        GLuint* pTexId = mSources[block] ? mSources[block] : pOutputTexId;
+
+        if (!pTexId || !*pTexId) {
+            continue;
+        }
+
+        GLint texWidth = 0;
+        GLint texHeight = 0;
+        glGetTextureLevelParameteriv(*pTexId, 0, GL_TEXTURE_WIDTH, &texWidth);
+        glGetTextureLevelParameteriv(*pTexId, 0, GL_TEXTURE_HEIGHT, &texHeight);
+
+        // One partial per 64 x 64 texels tile, 64 bytes each
+
+        GLuint groupsX = (texWidth + 63) / 64;
+        GLuint groupsY = (texHeight + 63) / 64;
+        GLsizeiptr partialsSize = groupsX * groupsY * 16 * sizeof(GLfloat);
+
+        if (partialsSize > mPartialsSize)
+        {
+            glDeleteBuffers(1, &mPartialsBuffer);
+            glCreateBuffers(1, &mPartialsBuffer);
+            glNamedBufferStorage(mPartialsBuffer, partialsSize, nullptr, 0);
+            mPartialsSize = partialsSize;
+        }
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mPartialsBuffer);
+
+        mReduceProgram->bind();
+        mReduceProgram->setUniformValue("inTex", 0);
+
+        glBindTextureUnit(0, *pTexId);
+
+        glDispatchCompute(groupsX, groupsY, 1);
+
+        glBindTextureUnit(0, 0);
+
+        mReduceProgram->release();
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        mFinalProgram->bind();
+        mFinalProgram->setUniformValue("numPartials", static_cast<GLint>(groupsX * groupsY));
+        mFinalProgram->setUniformValue("numTexels", texWidth * texHeight);
+        mFinalProgram->setUniformValue("block", block);
+
+        glDispatchCompute(1, 1, 1);
+
+        mFinalProgram->release();
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glCopyNamedBufferSubData(mBlocksBuffer, mReadBuffers[mSubmitIndex], 0, 0, mSources.size() * numStatistics * sizeof(GLfloat));
+
+    mFences[mSubmitIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mReadCounts[mSubmitIndex] = mSources.size();
+    mReadIterations[mSubmitIndex] = iteration;
+
+    mSubmitIndex = (mSubmitIndex + 1) % mRingSize;
+}
+
+
+
+void StatisticsEngine::readStatistics()
+{
+    // Oldest first, only readbacks whose fence has already signaled
+
+    for (int i = 0; i < mRingSize; i++)
+    {
+        int index = (mSubmitIndex + i) % mRingSize;
+
+        if (!mFences[index]) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(mFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(mFences[index]);
+        mFences[index] = 0;
+
+        QList<float> values(mReadCounts[index] * numStatistics);
+        glGetNamedBufferSubData(mReadBuffers[index], 0, values.size() * sizeof(GLfloat), values.data());
+
+        log(mReadIterations[index], values);
+
+        emit statisticsReady(mReadIterations[index], values);
+    }
+}
+
+
+
+bool StatisticsEngine::startLog(QString filename)
+{
+    // CSV if the file name ends in .csv, raw little endian records otherwise
+
+    stopLog();
+
+    mLogFile.setFileName(filename);
+
+    if (!mLogFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    mLogBinary = !filename.endsWith(".csv", Qt::CaseInsensitive);
+
+    if (mLogBinary)
+    {
+        mLogDataStream.setDevice(&mLogFile);
+        mLogDataStream.setByteOrder(QDataStream::LittleEndian);
+        mLogDataStream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    }
+    else
+    {
+        mLogTextStream.setDevice(&mLogFile);
+        mLogTextStream << "iteration,source," << statisticNames().join(",").replace(" ", "_") << "\n";
+    }
+
+    return true;
+}
+
+
+
+void StatisticsEngine::stopLog()
+{
+    if (mLogFile.isOpen())
+    {
+        if (mLogBinary) {
+            mLogDataStream.setDevice(nullptr);
+        }
+        else {
+            mLogTextStream.flush();
+            mLogTextStream.setDevice(nullptr);
+        }
+
+        mLogFile.close();
+    }
+}
+
+
+
+bool StatisticsEngine::logging() const
+{
+    return mLogFile.isOpen();
+}
+
+
+
+void StatisticsEngine::log(unsigned int iteration, const QList<float>& values)
+{
+    // Buffered by the streams: one record per source
+
+    if (!mLogFile.isOpen()) {
+        return;
+    }
+
+    int numSources = values.size() / numStatistics;
+
+    for (int source = 0; source < numSources; source++)
+    {
+        if (mLogBinary)
+        {
+            mLogDataStream << quint32(iteration) << quint32(source);
+
+            for (int i = 0; i < numStatistics; i++) {
+                mLogDataStream << values[source * numStatistics + i];
+            }
+        }
+        else
+        {
+            mLogTextStream << iteration << "," << source;
+
+            for (int i = 0; i < numStatistics; i++) {
+                mLogTextStream << "," << values[source * numStatistics + i];
+            }
+
+            mLogTextStream << "\n";
+        }
+    }
+}
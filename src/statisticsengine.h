@@ -0,0 +1,107 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef STATISTICSENGINE_H
+#define STATISTICSENGINE_H
+
+
+
+#include <QObject>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QFile>
+#include <QTextStream>
+#include <QDataStream>
+#include <QStringList>
+#include <QList>
+
+
+
+// StatisticsEngine: per channel mean, variance, minimum, maximum and energy of selected textures,
+// reduced on the GPU every iteration and read back asynchronously
+
+class StatisticsEngine : public QObject, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    explicit StatisticsEngine(QObject* parent = nullptr);
+    ~StatisticsEngine();
+
+    static const int numStatistics = 20;
+    static const int maxSources = 16;
+
+    static QStringList statisticNames();
+
+    void init();
+    void cleanup();
+
+    bool enabled() const;
+    void setEnabled(bool set);
+
+    QList<GLuint*> sources() const;
+    void setSources(QList<GLuint*> pTexIds);
+
+    void compute(GLuint* pOutputTexId, unsigned int iteration);
+
+    bool startLog(QString filename);
+    void stopLog();
+    bool logging() const;
+
+signals:
+    void statisticsReady(unsigned int iteration, QList<float> values);
+
+private:
+    bool mInitialized = false;
+    bool mEnabled = false;
+
+    QList<GLuint*> mSources;
+
+    QOpenGLShaderProgram* mReduceProgram = nullptr;
+    QOpenGLShaderProgram* mFinalProgram = nullptr;
+
+    GLuint mPartialsBuffer = 0;
+    GLsizeiptr mPartialsSize = 0;
+    GLuint mBlocksBuffer = 0;
+
+    const int mRingSize = 3;
+    QList<GLuint> mReadBuffers;
+    QList<GLsync> mFences;
+    QList<int> mReadCounts;
+    QList<unsigned int> mReadIterations;
+    int mSubmitIndex = 0;
+
+    QFile mLogFile;
+    QTextStream mLogTextStream;
+    QDataStream mLogDataStream;
+    bool mLogBinary = false;
+
+    void readStatistics();
+    void log(unsigned int iteration, const QList<float>& values);
+};
+
+
+
+#endif // STATISTICSENGINE_H
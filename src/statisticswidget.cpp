@@ -0,0 +1,327 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "statisticswidget.h"
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QDir>
+
+
+
+const QString StatisticsWidget::portName = "Statistics";
+
+
+
+StatisticsWidget::StatisticsWidget(StatisticsEngine* engine, QWidget* parent)
+    : QWidget { parent },
+    mEngine { engine }
+{
+    QPushButton* enableButton = new QPushButton(QIcon(QPixmap(":/icons/circle-green.png")), "");
+    enableButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    enableButton->setCheckable(true);
+    enableButton->setChecked(mEngine->enabled());
+    enableButton->setToolTip("Statistics");
+
+    mSourceComboBox = new QComboBox;
+    mSourceComboBox->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    mSourceComboBox->addItem("Output");
+
+    QPushButton* addButton = new QPushButton(QIcon(QPixmap(":/icons/list-add.png")), "");
+    addButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    addButton->setToolTip("Track node");
+
+    QPushButton* removeButton = new QPushButton(QIcon(QPixmap(":/icons/list-remove.png")), "");
+    removeButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    removeButton->setToolTip("Untrack selected node");
+
+    QPushButton* linkButton = new QPushButton(QIcon(QPixmap(":/icons/network-connect.png")), "");
+    linkButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    linkButton->setToolTip("Link selected statistic to parameter waiting for link");
+
+    QPushButton* linkInvertedButton = new QPushButton(QIcon(QPixmap(":/icons/view-refresh.png")), "");
+    linkInvertedButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    linkInvertedButton->setToolTip("Link inverted selected statistic to parameter waiting for link");
+
+    mLogButton = new QPushButton(QIcon(QPixmap(":/icons/media-record.png")), "");
+    mLogButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    mLogButton->setCheckable(true);
+    mLogButton->setToolTip("Log to file");
+
+    mTable = new QTableWidget(StatisticsEngine::numStatistics, 0);
+    mTable->setVerticalHeaderLabels(StatisticsEngine::statisticNames());
+    mTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    mTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    QHBoxLayout* controlsLayout = new QHBoxLayout;
+    controlsLayout->addWidget(enableButton);
+    controlsLayout->addWidget(mSourceComboBox);
+    controlsLayout->addWidget(addButton);
+    controlsLayout->addWidget(removeButton);
+    controlsLayout->addWidget(linkButton);
+    controlsLayout->addWidget(linkInvertedButton);
+    controlsLayout->addWidget(mLogButton);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(controlsLayout);
+    layout->addWidget(mTable);
+
+    setLayout(layout);
+
+    connect(enableButton, &QPushButton::toggled, this, [=, this](bool checked) {
+        mEngine->setEnabled(checked);
+    });
+    connect(addButton, &QPushButton::clicked, this, &StatisticsWidget::addSource);
+    connect(removeButton, &QPushButton::clicked, this, &StatisticsWidget::removeSource);
+    connect(linkButton, &QPushButton::clicked, this, [=, this]() { link(false); });
+    connect(linkInvertedButton, &QPushButton::clicked, this, [=, this]() { link(true); });
+    connect(mLogButton, &QPushButton::toggled, this, &StatisticsWidget::toggleLog);
+
+    connect(mEngine, &StatisticsEngine::statisticsReady, this, &StatisticsWidget::setStatistics);
+
+    // Output always has id 0
+
+    mSourceIds.insert(nullptr, 0);
+
+    foreach (GLuint* pTexId, mEngine->sources()) {
+        if (!mSourceIds.contains(pTexId)) {
+            mSourceIds.insert(pTexId, mNextSourceId++);
+        }
+    }
+}
+
+
+
+int StatisticsWidget::key(int column, int statistic, bool inverted)
+{
+    int sourceId = mSourceIds.value(mEngine->sources().value(column), 0);
+    return mKeyBase + 2 * (sourceId * StatisticsEngine::numStatistics + statistic) + (inverted ? 1 : 0);
+}
+
+
+
+int StatisticsWidget::index(float value)
+{
+    return qBound(0, qRound(value * indexMax), indexMax);
+}
+
+
+
+void StatisticsWidget::setStatistics(unsigned int iteration, QList<float> values)
+{
+    Q_UNUSED(iteration)
+
+    mValues = values;
+
+    // Drive linked parameters: direct and inverted keys
+
+    for (int i = 0; i < mValues.size(); i++)
+    {
+        int column = i / StatisticsEngine::numStatistics;
+        int row = i % StatisticsEngine::numStatistics;
+
+        emit linkedValuesChanged(portName, key(column, row, false), index(mValues[i]));
+        emit linkedValuesChanged(portName, key(column, row, true), indexMax - index(mValues[i]));
+    }
+
+    if (isVisible())
+    {
+        for (int i = 0; i < mValues.size(); i++)
+        {
+            int column = i / StatisticsEngine::numStatistics;
+            int row = i % StatisticsEngine::numStatistics;
+
+            if (column < mTable->columnCount())
+            {
+                QTableWidgetItem* item = mTable->item(row, column);
+
+                if (!item)
+                {
+                    item = new QTableWidgetItem;
+                    mTable->setItem(row, column, item);
+                }
+
+                item->setText(QString::number(mValues[i], 'f', 4));
+            }
+        }
+    }
+}
+
+
+
+QString StatisticsWidget::sourceName(GLuint* pTexId)
+{
+    for (int i = 0; i < mOperations.size(); i++)
+    {
+        if (mOperations[i]->pOutTextureId() == pTexId) {
+            return QString::number(i + 1) + ": " + mOperations[i]->name();
+        }
+    }
+
+    return "Output";
+}
+
+
+
+void StatisticsWidget::updateColumns()
+{
+    QStringList labels;
+
+    foreach (GLuint* pTexId, mEngine->sources()) {
+        labels.append(sourceName(pTexId));
+    }
+
+    mTable->setColumnCount(labels.size());
+    mTable->setHorizontalHeaderLabels(labels);
+}
+
+
+
+void StatisticsWidget::addSource()
+{
+    QList<GLuint*> sources = mEngine->sources();
+
+    if (sources.size() >= StatisticsEngine::maxSources) {
+        return;
+    }
+
+    int index = mSourceComboBox->currentIndex();
+    GLuint* pTexId = index > 0 ? mOperations[index - 1]->pOutTextureId() : nullptr;
+
+    if (!sources.contains(pTexId))
+    {
+        if (!mSourceIds.contains(pTexId)) {
+            mSourceIds.insert(pTexId, mNextSourceId++);
+        }
+
+        sources.append(pTexId);
+        mEngine->setSources(sources);
+        updateColumns();
+    }
+}
+
+
+
+void StatisticsWidget::removeSource()
+{
+    QList<GLuint*> sources = mEngine->sources();
+
+    int column = mTable->currentColumn();
+
+    if (column >= 0 && column < sources.size())
+    {
+        // Links to an untracked node stay dead, even if the node is tracked again
+
+        if (sources[column]) {
+            mSourceIds.remove(sources[column]);
+        }
+
+        sources.removeAt(column);
+        mEngine->setSources(sources);
+        updateColumns();
+    }
+}
+
+
+
+void StatisticsWidget::link(bool inverted)
+{
+    // Key identifies tracked node and statistic
+
+    int row = mTable->currentRow();
+    int column = mTable->currentColumn();
+
+    if (row < 0 || column < 0) {
+        return;
+    }
+
+    int i = column * StatisticsEngine::numStatistics + row;
+    int value = i < mValues.size() ? index(mValues[i]) : 0;
+
+    emit linkRequested(portName, key(column, row, inverted), inverted ? indexMax - value : value);
+}
+
+
+
+void StatisticsWidget::toggleLog(bool checked)
+{
+    if (checked)
+    {
+        QString filename = QFileDialog::getSaveFileName(this, "Log statistics", QDir::homePath(), "CSV (*.csv);;Binary (*.stats)");
+
+        if (filename.isEmpty() || !mEngine->startLog(filename))
+        {
+            mLogButton->blockSignals(true);
+            mLogButton->setChecked(false);
+            mLogButton->blockSignals(false);
+        }
+    }
+    else
+    {
+        mEngine->stopLog();
+    }
+}
+
+
+
+void StatisticsWidget::setSourceOperations(QList<ImageOperation*> operations)
+{
+    mOperations = operations;
+
+    // Untrack removed operations
+
+    QList<GLuint*> texIds;
+
+    foreach (ImageOperation* operation, mOperations) {
+        texIds.append(operation->pOutTextureId());
+    }
+
+    QList<GLuint*> sources;
+
+    foreach (GLuint* pTexId, mEngine->sources())
+    {
+        if (!pTexId || texIds.contains(pTexId)) {
+            sources.append(pTexId);
+        }
+        else {
+            mSourceIds.remove(pTexId);
+        }
+    }
+
+    mEngine->setSources(sources);
+
+    mSourceComboBox->clear();
+    mSourceComboBox->addItem("Output");
+
+    for (int i = 0; i < mOperations.size(); i++) {
+        mSourceComboBox->addItem(QString::number(i + 1) + ": " + mOperations[i]->name());
+    }
+
+    updateColumns();
+}
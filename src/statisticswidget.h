@@ -0,0 +1,97 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef STATISTICSWIDGET_H
+#define STATISTICSWIDGET_H
+
+
+
+#include "statisticsengine.h"
+#include "imageoperation.h"
+
+#include <QWidget>
+#include <QComboBox>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QString>
+#include <QList>
+#include <QMap>
+
+
+
+// StatisticsWidget: choice of tracked nodes, live values, links to parameters and logging
+// Values reach linked parameters through the "Statistics" virtual port of MidiLinkManager
+
+class StatisticsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit StatisticsWidget(StatisticsEngine* engine, QWidget* parent = nullptr);
+
+    static const QString portName;
+    static const int indexMax = 1000;
+
+signals:
+    void linkRequested(QString portName, int key, int value);
+    void linkedValuesChanged(QString portName, int key, int value);
+
+public slots:
+    void setStatistics(unsigned int iteration, QList<float> values);
+    void setSourceOperations(QList<ImageOperation*> operations);
+
+private:
+    StatisticsEngine* mEngine;
+
+    QList<ImageOperation*> mOperations;
+    QList<float> mValues;
+
+    QComboBox* mSourceComboBox;
+    QTableWidget* mTable;
+    QPushButton* mLogButton;
+
+    // Keys above the MIDI controller range, built from an id given to each source when tracked,
+    // so that links keep pointing at the same node when other sources are untracked
+
+    const int mKeyBase = 1000;
+
+    QMap<GLuint*, int> mSourceIds;
+    int mNextSourceId = 1;
+
+    int key(int column, int statistic, bool inverted);
+    int index(float value);
+    QString sourceName(GLuint* pTexId);
+    void updateColumns();
+
+private slots:
+    void addSource();
+    void removeSource();
+    void link(bool inverted);
+    void toggleLog(bool checked);
+};
+
+
+
+#endif // STATISTICSWIDGET_H
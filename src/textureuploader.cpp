@@ -0,0 +1,298 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "textureuploader.h"
+
+#include <QFile>
+#include <QPainter>
+
+
+
+TextureUploader::TextureUploader(QObject* parent)
+    : QObject { parent }
+{}
+
+
+
+TextureUploader::~TextureUploader()
+{
+    stop();
+
+    delete mSurface;
+}
+
+
+
+void TextureUploader::init(QOpenGLContext* shareContext)
+{
+    // Create context sharing objects with the render context, to be used only from the upload thread
+
+    mContext = new QOpenGLContext();
+    mContext->setFormat(shareContext->format());
+    mContext->setShareContext(shareContext);
+    mContext->create();
+
+    mSurface = new QOffscreenSurface();
+    mSurface->setFormat(shareContext->format());
+    mSurface->create();
+
+    mContext->moveToThread(&mThread);
+    moveToThread(&mThread);
+
+    mThread.start();
+}
+
+
+
+void TextureUploader::stop()
+{
+    if (mThread.isRunning())
+    {
+        QMetaObject::invokeMethod(this, &TextureUploader::cleanup, Qt::BlockingQueuedConnection);
+
+        mThread.quit();
+        mThread.wait();
+    }
+}
+
+
+
+void TextureUploader::setTextureParameters(GLenum texFormat, GLuint width, GLuint height)
+{
+    mTexFormat = texFormat;
+    mTexWidth = width;
+    mTexHeight = height;
+}
+
+
+
+void TextureUploader::requestImage(GLuint* pTexId, QString filename)
+{
+    if (QFile::exists(filename))
+    {
+        UploadJob job;
+        job.pTexId = pTexId;
+        job.filename = filename;
+
+        enqueue(job);
+    }
+}
+
+
+
+void TextureUploader::requestImage(GLuint* pTexId, const QImage& image)
+{
+    if (!image.isNull())
+    {
+        UploadJob job;
+        job.pTexId = pTexId;
+        job.image = image;
+
+        enqueue(job);
+    }
+}
+
+
+
+void TextureUploader::enqueue(UploadJob job)
+{
+    // Tickets are handed out and checked on the requesting thread only
+
+    job.ticket = mNextTicket++;
+    job.texFormat = mTexFormat;
+    job.width = mTexWidth;
+    job.height = mTexHeight;
+
+    mLatestTickets[job.pTexId] = job.ticket;
+
+    mMutex.lock();
+    mJobs.append(job);
+    mMutex.unlock();
+
+    QMetaObject::invokeMethod(this, &TextureUploader::processJobs, Qt::QueuedConnection);
+}
+
+
+
+void TextureUploader::cancel(GLuint* pTexId)
+{
+    mLatestTickets.remove(pTexId);
+}
+
+
+
+QList<TextureUpload> TextureUploader::takeUploads()
+{
+    QMutexLocker locker(&mMutex);
+
+    QList<TextureUpload> uploads = mUploads;
+    mUploads.clear();
+
+    return uploads;
+}
+
+
+
+bool TextureUploader::isCurrent(const TextureUpload& upload) const
+{
+    return mLatestTickets.value(upload.pTexId, 0) == upload.ticket;
+}
+
+
+
+QImage TextureUploader::fitImage(const QImage& image, GLuint width, GLuint height)
+{
+    // Scale down keeping aspect ratio and center on black background
+
+    qreal sx = static_cast<qreal>(width) / image.width();
+    qreal sy = static_cast<qreal>(height) / image.height();
+    qreal scale = qMin(1.0, qMin(sx, sy));
+
+    int displayWidth = qRound(image.width() * scale);
+    int displayHeight = qRound(image.height() * scale);
+
+    int offsetX = (width - displayWidth) / 2;
+    int offsetY = (height - displayHeight) / 2;
+
+    QImage buffer(width, height, QImage::Format_RGBA8888);
+    buffer.fill(Qt::black);
+
+    QPainter painter(&buffer);
+
+    if (displayWidth == image.width() && displayHeight == image.height()) {
+        painter.drawImage(offsetX, offsetY, image);
+    }
+    else {
+        painter.drawImage(offsetX, offsetY, image.scaled(displayWidth, displayHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+
+    return buffer;
+}
+
+
+
+void TextureUploader::processJobs()
+{
+    mMutex.lock();
+    QList<UploadJob> jobs = mJobs;
+    mJobs.clear();
+    mMutex.unlock();
+
+    if (jobs.isEmpty()) {
+        return;
+    }
+
+    // Only the latest job per target texture is worth uploading
+
+    QMap<GLuint*, UploadJob> latestJobs;
+
+    foreach (const UploadJob& job, jobs) {
+        latestJobs.insert(job.pTexId, job);
+    }
+
+    mContext->makeCurrent(mSurface);
+
+    if (!mInitialized)
+    {
+        initializeOpenGLFunctions();
+        mInitialized = true;
+    }
+
+    QList<TextureUpload> uploads;
+
+    foreach (const UploadJob& job, latestJobs)
+    {
+        // Decode and scale on the CPU
+
+        QImage image = job.filename.isEmpty() ? job.image : QImage(job.filename);
+
+        if (image.isNull()) {
+            continue;
+        }
+
+        QImage buffer = fitImage(image.convertToFormat(QImage::Format_RGBA8888), job.width, job.height);
+
+        // Upload into staging texture
+
+        TextureUpload upload;
+        upload.pTexId = job.pTexId;
+        upload.ticket = job.ticket;
+
+        glGenTextures(1, &upload.texId);
+        glBindTexture(GL_TEXTURE_2D, upload.texId);
+        glTexStorage2D(GL_TEXTURE_2D, 1, job.texFormat, job.width, job.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE, buffer.constBits());
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        uploads.append(upload);
+    }
+
+    // Make sure fences reach the GPU so that the render context can poll them
+
+    glFlush();
+
+    mContext->doneCurrent();
+
+    mMutex.lock();
+    mUploads.append(uploads);
+    mMutex.unlock();
+}
+
+
+
+void TextureUploader::cleanup()
+{
+    // Release staging textures that were never swapped in
+
+    mContext->makeCurrent(mSurface);
+
+    if (mInitialized)
+    {
+        QMutexLocker locker(&mMutex);
+
+        foreach (const TextureUpload& upload, mUploads)
+        {
+            glDeleteSync(upload.fence);
+            glDeleteTextures(1, &upload.texId);
+        }
+
+        mUploads.clear();
+        mJobs.clear();
+    }
+
+    mContext->doneCurrent();
+
+    delete mContext;
+    mContext = nullptr;
+}
@@ -0,0 +1,120 @@
+/*
+*  Copyright 2021 Jose Maria Castelo Ares
+*
+*  Contact: <jose.maria.castelo@gmail.com>
+*  Repository: <https://github.com/jmcastelo/MorphogenGL>
+*
+*  This file is part of MorphogenGL.
+*
+*  MorphogenGL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  MorphogenGL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with MorphogenGL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef TEXTUREUPLOADER_H
+#define TEXTUREUPLOADER_H
+
+
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QImage>
+#include <QString>
+#include <QList>
+#include <QMap>
+
+
+
+// Finished upload: staging texture holding the new contents of the texture pointed to by pTexId
+// The fence signals when the upload has completed on the GPU
+
+struct TextureUpload
+{
+    GLuint* pTexId = nullptr;
+    quint64 ticket = 0;
+    GLuint texId = 0;
+    GLsync fence = 0;
+};
+
+
+
+// TextureUploader: decodes, scales and uploads images on its own thread and OpenGL context,
+// shared with the render context, so that the render loop never waits on an upload
+
+class TextureUploader : public QObject, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    explicit TextureUploader(QObject* parent = nullptr);
+    ~TextureUploader();
+
+    void init(QOpenGLContext* shareContext);
+    void stop();
+
+    void setTextureParameters(GLenum texFormat, GLuint width, GLuint height);
+
+    void requestImage(GLuint* pTexId, QString filename);
+    void requestImage(GLuint* pTexId, const QImage& image);
+
+    void cancel(GLuint* pTexId);
+
+    QList<TextureUpload> takeUploads();
+    bool isCurrent(const TextureUpload& upload) const;
+
+private:
+    struct UploadJob
+    {
+        GLuint* pTexId = nullptr;
+        quint64 ticket = 0;
+        QString filename;
+        QImage image;
+        GLenum texFormat = GL_RGBA8;
+        GLuint width = 0;
+        GLuint height = 0;
+    };
+
+    QThread mThread;
+
+    QOpenGLContext* mContext = nullptr;
+    QOffscreenSurface* mSurface = nullptr;
+    bool mInitialized = false;
+
+    GLenum mTexFormat = GL_RGBA8;
+    GLuint mTexWidth = 2048;
+    GLuint mTexHeight = 2048;
+
+    quint64 mNextTicket = 1;
+    QMap<GLuint*, quint64> mLatestTickets;
+
+    QMutex mMutex;
+    QList<UploadJob> mJobs;
+    QList<TextureUpload> mUploads;
+
+    void enqueue(UploadJob job);
+
+    static QImage fitImage(const QImage& image, GLuint width, GLuint height);
+
+private slots:
+    void processJobs();
+    void cleanup();
+};
+
+
+
+#endif // TEXTUREUPLOADER_H
@@ -32,6 +32,7 @@
 #include <QComboBox>
 #include <QPushButton>
 #include <QGroupBox>
+#include <QTableView>
 
 
 
@@ -173,4 +174,32 @@ signals:
 
 
 
+// A custom QTableView that signals focus out and in
+
+class FocusTableView : public QTableView
+{
+    Q_OBJECT
+
+public:
+    FocusTableView(QWidget* parent = nullptr) : QTableView(parent) {}
+
+protected:
+    void focusOutEvent(QFocusEvent* event)
+    {
+        QTableView::focusOutEvent(event);
+        emit focusOut();
+    }
+    void focusInEvent(QFocusEvent* event)
+    {
+        QTableView::focusInEvent(event);
+        emit focusIn();
+    }
+
+signals:
+    void focusOut();
+    void focusIn();
+};
+
+
+
 #endif // FOCUSWIDGETS_H
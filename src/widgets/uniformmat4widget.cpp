@@ -81,6 +81,14 @@ UniformMat4ParameterWidget::UniformMat4ParameterWidget(UniformMat4Parameter* the
             }
         });
     }
+
+    ParameterWidget<float>::connect(mUniformMat4Parameter, &Parameter::valuesChanged, this, [=, this](int first, int last){
+        for (int i = first; i <= last; i++)
+        {
+            mLineEdits[i]->setText(QString::number(mUniformMat4Parameter->number(i)->value()));
+            mLineEdits[i]->setCursorPosition(0);
+        }
+    });
 }
 
 
@@ -0,0 +1,220 @@
+
+
+
+#include "uniformtablemodel.h"
+
+#include <QLineEdit>
+#include <QValidator>
+
+
+
+template <typename T>
+UniformTableModel<T>::UniformTableModel(BaseUniformParameter<T>* parameter, QPair<int, int> colsRowsPerItem, QObject* parent) :
+    QAbstractTableModel(parent),
+    mParameter { parameter }
+{
+    mWrapped = colsRowsPerItem.first <= 1 && colsRowsPerItem.second <= 1;
+    mCols = mWrapped ? scalarColumns : colsRowsPerItem.first;
+    mRowsPerItem = mWrapped ? 1 : qMax(colsRowsPerItem.second, 1);
+
+    // Single cell changes repaint one cell, batches repaint the rows they span
+
+    connect(mParameter, QOverload<int, QVariant>::of(&Parameter::valueChanged), this, [=, this](int i, QVariant) {
+        QModelIndex index = modelIndex(i);
+        emit dataChanged(index, index, { Qt::DisplayRole, Qt::EditRole });
+    });
+
+    connect(mParameter, &Parameter::valuesChanged, this, [=, this](int first, int last) {
+        emit dataChanged(index(first / mCols, 0), index(last / mCols, mCols - 1), { Qt::DisplayRole, Qt::EditRole });
+    });
+}
+
+
+
+template <typename T>
+int UniformTableModel<T>::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return (mParameter->numbers().size() + mCols - 1) / mCols;
+}
+
+
+
+template <typename T>
+int UniformTableModel<T>::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mCols;
+}
+
+
+
+template <typename T>
+QVariant UniformTableModel<T>::data(const QModelIndex& index, int role) const
+{
+    int i = numberIndex(index);
+
+    if (i < 0)
+        return QVariant();
+
+    if (role == Qt::DisplayRole || role == Qt::EditRole)
+        return QVariant(mParameter->number(i)->value());
+    else if (role == Qt::TextAlignmentRole)
+        return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+
+    return QVariant();
+}
+
+
+
+template <typename T>
+bool UniformTableModel<T>::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    int i = numberIndex(index);
+
+    if (i < 0 || role != Qt::EditRole)
+        return false;
+
+    mParameter->setValue(i, value.value<T>());
+
+    return true;
+}
+
+
+
+template <typename T>
+QVariant UniformTableModel<T>::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Horizontal)
+    {
+        if (mWrapped)
+            return QString("+%1").arg(section);
+        else if (mRowsPerItem == 1 && mCols <= 4)
+            return QString(QString("xyzw").at(section));
+        else
+            return QString::number(section);
+    }
+    else
+    {
+        if (mWrapped)
+            return QString::number(section * mCols);
+        else if (mRowsPerItem == 1)
+            return QString::number(section);
+        else
+            return QString("%1 [%2]").arg(section / mRowsPerItem).arg(section % mRowsPerItem);
+    }
+}
+
+
+
+template <typename T>
+Qt::ItemFlags UniformTableModel<T>::flags(const QModelIndex& index) const
+{
+    if (numberIndex(index) < 0)
+        return Qt::NoItemFlags;
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+
+
+template <typename T>
+int UniformTableModel<T>::numberIndex(const QModelIndex& index) const
+{
+    if (!index.isValid())
+        return -1;
+
+    int i = index.row() * mCols + index.column();
+
+    return i < mParameter->numbers().size() ? i : -1;
+}
+
+
+
+template <typename T>
+QModelIndex UniformTableModel<T>::modelIndex(int i) const
+{
+    return index(i / mCols, i % mCols);
+}
+
+
+
+template <typename T>
+UniformTableDelegate<T>::UniformTableDelegate(BaseUniformParameter<T>* parameter, UniformTableModel<T>* model, QObject* parent) :
+    QStyledItemDelegate(parent),
+    mParameter { parameter },
+    mModel { model }
+{}
+
+
+
+template <typename T>
+QWidget* UniformTableDelegate<T>::createEditor(QWidget* parent, const QStyleOptionViewItem&, const QModelIndex& index) const
+{
+    int i = mModel->numberIndex(index);
+
+    if (i < 0)
+        return nullptr;
+
+    Number<T>* number = mParameter->number(i);
+
+    QLineEdit* lineEdit = new QLineEdit(parent);
+    lineEdit->setFrame(false);
+
+    if (std::is_same<T, float>::value) {
+        lineEdit->setValidator(new QDoubleValidator(number->inf(), number->sup(), 5, lineEdit));
+    }
+    else if (std::is_same<T, int>::value || std::is_same<T, unsigned int>::value) {
+        lineEdit->setValidator(new QIntValidator(number->inf(), number->sup(), lineEdit));
+    }
+
+    return lineEdit;
+}
+
+
+
+template <typename T>
+void UniformTableDelegate<T>::setEditorData(QWidget* editor, const QModelIndex& index) const
+{
+    QLineEdit* lineEdit = static_cast<QLineEdit*>(editor);
+    lineEdit->setText(index.data(Qt::EditRole).toString());
+    lineEdit->selectAll();
+}
+
+
+
+template <typename T>
+void UniformTableDelegate<T>::setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const
+{
+    QLineEdit* lineEdit = static_cast<QLineEdit*>(editor);
+
+    if (!lineEdit->hasAcceptableInput())
+        return;
+
+    if (std::is_same<T, float>::value) {
+        model->setData(index, QVariant(lineEdit->text().toFloat()), Qt::EditRole);
+    }
+    else if (std::is_same<T, int>::value) {
+        model->setData(index, QVariant(lineEdit->text().toInt()), Qt::EditRole);
+    }
+    else if (std::is_same<T, unsigned int>::value) {
+        model->setData(index, QVariant(lineEdit->text().toUInt()), Qt::EditRole);
+    }
+}
+
+
+
+template class UniformTableModel<float>;
+template class UniformTableModel<int>;
+template class UniformTableModel<unsigned int>;
+
+template class UniformTableDelegate<float>;
+template class UniformTableDelegate<int>;
+template class UniformTableDelegate<unsigned int>;
@@ -0,0 +1,68 @@
+#ifndef UNIFORMTABLEMODEL_H
+#define UNIFORMTABLEMODEL_H
+
+
+
+#include "../parameters/baseuniformparameter.h"
+
+#include <QAbstractTableModel>
+#include <QStyledItemDelegate>
+#include <QPair>
+
+
+
+// Table model over the numbers of a large uniform parameter
+// Vectors and matrices take one table row per item row, scalars are wrapped in rows of scalarColumns
+// Only the cells in view are painted, and only the edited cell gets an editor widget
+
+template <typename T>
+class UniformTableModel : public QAbstractTableModel
+{
+public:
+    UniformTableModel(BaseUniformParameter<T>* parameter, QPair<int, int> colsRowsPerItem, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    int numberIndex(const QModelIndex& index) const;
+    QModelIndex modelIndex(int i) const;
+
+    static constexpr int scalarColumns = 8;
+
+private:
+    BaseUniformParameter<T>* mParameter;
+
+    int mCols;
+    int mRowsPerItem;
+    bool mWrapped;
+};
+
+
+
+// Delegate creating a validated line edit for the cell being edited
+
+template <typename T>
+class UniformTableDelegate : public QStyledItemDelegate
+{
+public:
+    UniformTableDelegate(BaseUniformParameter<T>* parameter, UniformTableModel<T>* model, QObject* parent = nullptr);
+
+    QWidget* createEditor(QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    void setEditorData(QWidget* editor, const QModelIndex& index) const override;
+    void setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const override;
+
+private:
+    BaseUniformParameter<T>* mParameter;
+    UniformTableModel<T>* mModel;
+};
+
+
+
+#endif // UNIFORMTABLEMODEL_H
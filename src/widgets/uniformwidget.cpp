@@ -2,7 +2,17 @@
 
 
 #include "uniformwidget.h"
+#include "../formula.h"
 #include <QValidator>
+#include <QHeaderView>
+#include <QAction>
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QRegularExpression>
+#include <QInputDialog>
+#include <QMessageBox>
+
+#include <algorithm>
 
 
 
@@ -13,6 +23,22 @@ UniformParameterWidget<T>::UniformParameterWidget(UniformParameter<T>* theUnifor
 {
     ParameterWidget<T>::mGroupBox->setTitle(mUniformParameter->name());
 
+    ParameterWidget<T>::mSelectedNumber = mUniformParameter->number(0);
+    mLastIndex = 0;
+
+    if (mUniformParameter->numbers().size() > maxLineEdits)
+        setupTable();
+    else
+        setupLineEdits();
+
+    ParameterWidget<T>::mGroupBox->setVisible(mUniformParameter->editable());
+}
+
+
+
+template <typename T>
+void UniformParameterWidget<T>::setupLineEdits()
+{
     // Set up line edits
 
     foreach (Number<T>* number, mUniformParameter->numbers())
@@ -27,8 +53,6 @@ UniformParameterWidget<T>::UniformParameterWidget(UniformParameter<T>* theUnifor
     setValidators();
 
     ParameterWidget<T>::mLastFocusedWidget = mLineEdits[0];
-    ParameterWidget<T>::mSelectedNumber = mUniformParameter->number(0);
-    mLastIndex = 0;
 
     // Set up widgets and layouts
 
@@ -55,22 +79,13 @@ UniformParameterWidget<T>::UniformParameterWidget(UniformParameter<T>* theUnifor
     setItemsLayouts();
     setDefaultLayoutFormat();
     ParameterWidget<T>::mGroupBox->setLayout(layout);
-    ParameterWidget<T>::mGroupBox->setVisible(mUniformParameter->editable());
 
     // Connections
 
     for (int i = 0; i < mUniformParameter->numbers().size(); i++)
     {
         ParameterWidget<T>::connect(mLineEdits[i], &FocusLineEdit::editingFinished, this, [=, this]() {
-            if (std::is_same<T, float>::value) {
-                mUniformParameter->setValue(i, mLineEdits[i]->text().toFloat());
-            }
-            else if (std::is_same<T, int>::value) {
-                mUniformParameter->setValue(i, mLineEdits[i]->text().toInt());
-            }
-            else if (std::is_same<T, unsigned int>::value) {
-                mUniformParameter->setValue(i, mLineEdits[i]->text().toUInt());
-            }
+            mUniformParameter->setValue(i, toValue(mLineEdits[i]->text()));
         });
 
         ParameterWidget<T>::connect(mLineEdits[i], &FocusLineEdit::focusIn, this, [=, this]() {
@@ -85,27 +100,261 @@ UniformParameterWidget<T>::UniformParameterWidget(UniformParameter<T>* theUnifor
 
         ParameterWidget<T>::connect(mLineEdits[i], &FocusLineEdit::focusIn, this, &UniformParameterWidget::focusIn);
         ParameterWidget<T>::connect(mLineEdits[i], &FocusLineEdit::focusOut, this, &UniformParameterWidget::focusOut);
+    }
 
-        ParameterWidget<T>::connect(mUniformParameter, QOverload<int, QVariant>::of(&Parameter::valueChanged), this, [=, this](int i, QVariant newValue) {
-            if (std::is_same<T, float>::value) {
-                mLineEdits[i]->setText(QString::number(newValue.toFloat()));
-            }
-            else if (std::is_same<T, int>::value) {
-                mLineEdits[i]->setText(QString::number(newValue.toInt()));
-            }
-            else if (std::is_same<T, unsigned int>::value) {
-                mLineEdits[i]->setText(QString::number(newValue.toUInt()));
-            }
+    ParameterWidget<T>::connect(mUniformParameter, QOverload<int, QVariant>::of(&Parameter::valueChanged), this, [=, this](int i, QVariant newValue) {
+        mLineEdits[i]->setText(QString::number(newValue.value<T>()));
+        mLineEdits[i]->setCursorPosition(0);
 
+        if (!mLineEdits[i]->hasFocus()) {
+            mLineEdits[i]->focusIn();
+        }
+    });
+
+    ParameterWidget<T>::connect(mUniformParameter, &Parameter::valuesChanged, this, [=, this](int first, int last) {
+        for (int i = first; i <= last; i++)
+        {
+            mLineEdits[i]->setText(QString::number(mUniformParameter->number(i)->value()));
             mLineEdits[i]->setCursorPosition(0);
+        }
+    });
 
-            if (!mLineEdits[i]->hasFocus()) {
-                mLineEdits[i]->focusIn();
-            }
-        });
+    ParameterWidget<T>::connect(mScrollBar, &QScrollBar::valueChanged, mStackedLayout, &QStackedLayout::setCurrentIndex);
+}
+
+
+
+template <typename T>
+void UniformParameterWidget<T>::setupTable()
+{
+    // Large arrays and matrices: a table view only paints visible cells and creates an editor for the edited cell
+
+    mLayoutFormat = LayoutFormat::Column;
+
+    mTableModel = new UniformTableModel<T>(mUniformParameter, mUniformParameter->colsRowsPerItem(), this);
+
+    mTableView = new FocusTableView;
+    mTableView->setModel(mTableModel);
+    mTableView->setItemDelegate(new UniformTableDelegate<T>(mUniformParameter, mTableModel, mTableView));
+    mTableView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    mTableView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed | QAbstractItemView::AnyKeyPressed);
+    mTableView->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
+    mTableView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    mTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    mTableView->horizontalHeader()->setDefaultSectionSize(80);
+    mTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    mTableView->verticalHeader()->setDefaultSectionSize(mTableView->fontMetrics().height() + 6);
+    mTableView->setMinimumHeight(200);
+    mTableView->setMinimumWidth(mTableView->verticalHeader()->sizeHint().width() + 80 * mTableModel->columnCount() + 30);
+    mTableView->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
+
+    ParameterWidget<T>::mLastFocusedWidget = mTableView;
+
+    // Bulk editing actions
+
+    QAction* pasteAction = new QAction("Paste", mTableView);
+    pasteAction->setShortcut(QKeySequence::Paste);
+    pasteAction->setShortcutContext(Qt::WidgetShortcut);
+
+    QAction* fillAction = new QAction("Fill selection...", mTableView);
+    QAction* generateAction = new QAction("Generate from formula...", mTableView);
+
+    mTableView->addAction(pasteAction);
+    mTableView->addAction(fillAction);
+    mTableView->addAction(generateAction);
+    mTableView->setContextMenuPolicy(Qt::ActionsContextMenu);
+
+    ParameterWidget<T>::connect(pasteAction, &QAction::triggered, this, &UniformParameterWidget<T>::pasteValues);
+    ParameterWidget<T>::connect(fillAction, &QAction::triggered, this, &UniformParameterWidget<T>::fillValues);
+    ParameterWidget<T>::connect(generateAction, &QAction::triggered, this, &UniformParameterWidget<T>::generateValues);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addWidget(mTableView);
+    layout->addWidget(ParameterWidget<T>::mPresetsComboBox);
+
+    ParameterWidget<T>::mGroupBox->setLayout(layout);
+
+    // Connections
+
+    ParameterWidget<T>::connect(mTableView->selectionModel(), &QItemSelectionModel::currentChanged, this, [=, this](const QModelIndex& current) {
+        int i = mTableModel->numberIndex(current);
+        if (i >= 0)
+        {
+            ParameterWidget<T>::mSelectedNumber = mUniformParameter->number(i);
+            mLastIndex = i;
+
+            emit ParameterWidget<T>::focusIn();
+        }
+    });
+
+    ParameterWidget<T>::connect(mTableView, &FocusTableView::focusIn, this, &UniformParameterWidget::focusIn);
+    ParameterWidget<T>::connect(mTableView, &FocusTableView::focusOut, this, &UniformParameterWidget::focusOut);
+}
+
+
+
+template <typename T>
+T UniformParameterWidget<T>::toValue(QString text)
+{
+    if (std::is_same<T, float>::value) {
+        return static_cast<T>(text.toFloat());
+    }
+    else if (std::is_same<T, int>::value) {
+        return static_cast<T>(text.toInt());
+    }
+    else {
+        return static_cast<T>(text.toUInt());
     }
+}
 
-    ParameterWidget<T>::connect(mScrollBar, &QScrollBar::valueChanged, mStackedLayout, &QStackedLayout::setCurrentIndex);
+
+
+template <typename T>
+T UniformParameterWidget<T>::toValue(double value, Number<T>* number)
+{
+    // Clamp before casting so that negative values never wrap around unsigned ints
+
+    value = qBound(static_cast<double>(number->inf()), value, static_cast<double>(number->sup()));
+
+    if (std::is_same<T, float>::value)
+        return static_cast<T>(value);
+    else
+        return static_cast<T>(qRound64(value));
+}
+
+
+
+// Indices of the selected numbers, or all of them if there is no selection
+
+template <typename T>
+QList<int> UniformParameterWidget<T>::selectedIndices()
+{
+    QList<int> indices;
+
+    foreach (QModelIndex index, mTableView->selectionModel()->selectedIndexes())
+    {
+        int i = mTableModel->numberIndex(index);
+        if (i >= 0)
+            indices.append(i);
+    }
+
+    if (indices.isEmpty())
+    {
+        for (int i = 0; i < mUniformParameter->numbers().size(); i++)
+            indices.append(i);
+    }
+
+    std::sort(indices.begin(), indices.end());
+
+    return indices;
+}
+
+
+
+// Write the given values at the given indices as a single batch spanning them
+
+template <typename T>
+void UniformParameterWidget<T>::setBatch(QList<int> indices, QList<T> values)
+{
+    if (indices.isEmpty())
+        return;
+
+    int first = indices.first();
+    int last = indices.last();
+
+    QList<T> batch = mUniformParameter->values().mid(first, last - first + 1);
+
+    for (int k = 0; k < indices.size(); k++)
+        batch[indices[k] - first] = values[k];
+
+    mUniformParameter->setValues(first, batch);
+}
+
+
+
+template <typename T>
+void UniformParameterWidget<T>::pasteValues()
+{
+    QStringList tokens = QGuiApplication::clipboard()->text().split(QRegularExpression("[\\s,;]+"), Qt::SkipEmptyParts);
+
+    int first = mTableModel->numberIndex(mTableView->currentIndex());
+    if (first < 0)
+        first = 0;
+
+    QList<T> values;
+
+    for (int k = 0; k < tokens.size() && first + k < mUniformParameter->numbers().size(); k++)
+    {
+        bool ok;
+        double value = tokens[k].toDouble(&ok);
+
+        if (!ok)
+        {
+            QMessageBox::warning(mTableView, "Paste", QString("Could not read '%1' as a number.").arg(tokens[k]));
+            return;
+        }
+
+        values.append(toValue(value, mUniformParameter->number(first + k)));
+    }
+
+    mUniformParameter->setValues(first, values);
+}
+
+
+
+template <typename T>
+void UniformParameterWidget<T>::fillValues()
+{
+    QList<int> indices = selectedIndices();
+
+    Number<T>* number = mUniformParameter->number(indices.first());
+
+    bool ok;
+    double value;
+
+    if (std::is_same<T, float>::value)
+        value = QInputDialog::getDouble(mTableView, "Fill", "Value:", number->value(), number->inf(), number->sup(), 5, &ok);
+    else
+        value = QInputDialog::getInt(mTableView, "Fill", "Value:", number->value(), number->inf(), number->sup(), 1, &ok);
+
+    if (!ok)
+        return;
+
+    QList<T> values;
+    foreach (int i, indices)
+        values.append(toValue(value, mUniformParameter->number(i)));
+
+    setBatch(indices, values);
+}
+
+
+
+template <typename T>
+void UniformParameterWidget<T>::generateValues()
+{
+    QList<int> indices = selectedIndices();
+
+    bool ok;
+    QString expression = QInputDialog::getText(mTableView, "Generate", "Formula of i (position in selection), n (selection size) and x = i / (n - 1):", QLineEdit::Normal, mLastFormula, &ok);
+
+    if (!ok || expression.isEmpty())
+        return;
+
+    Formula formula(expression);
+
+    if (!formula.isValid())
+    {
+        QMessageBox::warning(mTableView, "Generate", formula.error());
+        return;
+    }
+
+    mLastFormula = expression;
+
+    QList<T> values;
+    for (int k = 0; k < indices.size(); k++)
+        values.append(toValue(formula.evaluate(k, indices.size()), mUniformParameter->number(indices[k])));
+
+    setBatch(indices, values);
 }
 
 
@@ -113,6 +362,9 @@ UniformParameterWidget<T>::UniformParameterWidget(UniformParameter<T>* theUnifor
 template <typename T>
 void UniformParameterWidget<T>::setValidators()
 {
+    if (mLineEdits.isEmpty())
+        return;
+
     int i = 0;
 
     foreach (Number<T>* number, mUniformParameter->numbers())
@@ -7,6 +7,7 @@
 #include "../parameters/uniformparameter.h"
 #include "layoutformat.h"
 #include "focuswidgets.h"
+#include "uniformtablemodel.h"
 
 #include <QGridLayout>
 #include <QStackedLayout>
@@ -46,6 +47,9 @@ public:
     bool isMat4Equivalent();
     UniformParameter<T>* parameter() const { return mUniformParameter; }
 
+    // Above this many numbers the parameter is edited through a table instead of line edits
+    static constexpr int maxLineEdits = 64;
+
 private:
     UniformParameter<T>* mUniformParameter;
 
@@ -54,17 +58,34 @@ private:
 
     QList<FocusLineEdit*> mLineEdits;
 
-    QStackedLayout* mStackedLayout;
-    QScrollBar* mScrollBar;
+    QStackedLayout* mStackedLayout = nullptr;
+    QScrollBar* mScrollBar = nullptr;
 
     QList<QWidget*> mItemWidgets;
 
-    QWidget* mColWidget;
-    QWidget* mRowWidget;
-    QWidget* mGridWidget;
+    QWidget* mColWidget = nullptr;
+    QWidget* mRowWidget = nullptr;
+    QWidget* mGridWidget = nullptr;
+
+    FocusTableView* mTableView = nullptr;
+    UniformTableModel<T>* mTableModel = nullptr;
+    QString mLastFormula = "sin(2 * pi * x)";
 
     int mLastIndex;
 
+    void setupLineEdits();
+    void setupTable();
+
+    T toValue(QString text);
+    T toValue(double value, Number<T>* number);
+
+    QList<int> selectedIndices();
+    void setBatch(QList<int> indices, QList<T> values);
+
+    void pasteValues();
+    void fillValues();
+    void generateValues();
+
     void setValidators();
     void setItemsLayouts();
     void clearLayouts();